@@ -15,7 +15,18 @@ SOURCES += \
     mainwindow.cpp \
     chatwidget.cpp \
     roommanager.cpp \
-    aiassistant.cpp
+    aiassistant.cpp \
+    attachmenttransfer.cpp \
+    chatmodel.cpp \
+    chatdelegate.cpp \
+    sseparser.cpp \
+    aicache.cpp \
+    aischeduler.cpp \
+    chatconnection.cpp \
+    messagestore.cpp \
+    connectionworker.cpp \
+    framemeter.cpp \
+    roomlistmodel.cpp
 
 HEADERS += \
     client.h \
@@ -23,11 +34,25 @@ HEADERS += \
     mainwindow.h \
     chatwidget.h \
     roommanager.h \
-    aiassistant.h
+    aiassistant.h \
+    attachmenttransfer.h \
+    chatmodel.h \
+    chatdelegate.h \
+    sseparser.h \
+    aicache.h \
+    aischeduler.h \
+    chatconnection.h \
+    messagestore.h \
+    chatevent.h \
+    connectionworker.h \
+    framemeter.h \
+    roomlistmodel.h
 
 FORMS += \
     client.ui
 
+include(../Common/common.pri)
+
 RC_FILE=Images/duckicon.rc
 
 TARGET=AI-ChatRoom
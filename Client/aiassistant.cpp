@@ -4,11 +4,23 @@
 #include <QHBoxLayout>
 #include <QLabel>
 #include <QGroupBox>
+#include <QScrollBar>
+#include <QTextCursor>
+
+namespace {
+// 流式回复的刷新间隔，期间到达的增量合并成一次插入
+constexpr int kRenderIntervalMs = 50;
+}
 
 AIAssistant::AIAssistant(QWidget *parent)
     : QWidget(parent)
 {
     setupUI();
+
+    renderTimer = new QTimer(this);
+    renderTimer->setSingleShot(true);
+    renderTimer->setInterval(kRenderIntervalMs);
+    connect(renderTimer, &QTimer::timeout, this, &AIAssistant::flushStream);
 }
 
 void AIAssistant::setupUI()
@@ -97,6 +109,10 @@ void AIAssistant::setupUI()
     responseDisplay->setPlaceholderText("AI回复将显示在这里...");
     layout->addWidget(responseDisplay, 1);
 
+    statsLabel = new QLabel(this);
+    statsLabel->setStyleSheet("font-size: 9pt; color: #888888;");
+    layout->addWidget(statsLabel);
+
     // 自定义提示
     auto *promptLabel = new QLabel("自定义提问:", this);
     layout->addWidget(promptLabel);
@@ -105,42 +121,153 @@ void AIAssistant::setupUI()
     promptEdit->setPlaceholderText("输入你的问题...");
     layout->addWidget(promptEdit);
 
+    auto *sendLayout = new QHBoxLayout();
     sendButton = new QPushButton("发送给AI", this);
-    layout->addWidget(sendButton);
+    sendLayout->addWidget(sendButton, 1);
+    cancelButton = new QPushButton("取消", this);
+    cancelButton->setEnabled(false);
+    sendLayout->addWidget(cancelButton);
+    layout->addLayout(sendLayout);
 
     // 连接信号
     connect(sendButton, &QPushButton::clicked, this, &AIAssistant::onSendClicked);
     connect(promptEdit, &QLineEdit::returnPressed, this, &AIAssistant::onSendClicked);
+    connect(cancelButton, &QPushButton::clicked, this, [this]() {
+        emit cancelRequested(currentRoom);
+    });
+    // 先显示等待提示，接收方可能同步回复错误信息
     connect(summarizeButton, &QPushButton::clicked, this, [this]() {
-        if (!chatContext.isEmpty()) {
-            QString prompt = "请总结以下聊天内容的要点:\n\n" + chatContext;
-            emit aiRequestSent(prompt);
-            responseDisplay->setText("正在总结聊天内容...");
+        showPending("正在总结聊天内容...");
+        if (gatewayMode) {
+            emit gatewayRequestSent("summarize", QString());
         } else {
-            responseDisplay->setText("暂无聊天内容可总结");
+            emit aiRequestSent("summarize", QString());
         }
     });
     connect(suggestReplyButton, &QPushButton::clicked, this, [this]() {
-        if (!chatContext.isEmpty()) {
-            QString prompt = "基于以下聊天内容，建议我如何回复最后一条消息:\n\n" + chatContext;
-            emit aiRequestSent(prompt);
-            responseDisplay->setText("正在生成回复建议...");
+        showPending("正在生成回复建议...");
+        if (gatewayMode) {
+            emit gatewayRequestSent("suggest", QString());
         } else {
-            responseDisplay->setText("暂无聊天内容");
+            emit aiRequestSent("suggest", QString());
         }
     });
 
     setEnabled(false);
 }
 
-void AIAssistant::setChatContext(const QString &chatHistory)
+void AIAssistant::setRoom(const QString &room)
 {
-    chatContext = chatHistory;
+    if (room == currentRoom) {
+        return;
+    }
+    renderTimer->stop();
+    pendingText.clear();
+    pendingStats.clear();
+    currentRoom = room;
+    const RoomView view = views.value(room);
+    responseDisplay->setPlainText(view.text);
+    statsLabel->setText(view.stats);
+    cancelButton->setEnabled(view.busy);
+}
+
+void AIAssistant::removeRoom(const QString &room)
+{
+    views.remove(room);
 }
 
 void AIAssistant::appendResponse(const QString &response)
 {
-    responseDisplay->setText(response);
+    appendResponse(currentRoom, response);
+}
+
+void AIAssistant::appendResponse(const QString &room, const QString &response)
+{
+    RoomView &view = views[room];
+    view.text = response;
+    view.stats.clear();
+    if (room != currentRoom) {
+        return;
+    }
+    renderTimer->stop();
+    pendingText.clear();
+    pendingStats.clear();
+    statsLabel->clear();
+    responseDisplay->setPlainText(response);
+}
+
+void AIAssistant::beginStream(const QString &room, const QString &header)
+{
+    appendResponse(room, header);
+}
+
+void AIAssistant::appendStreamText(const QString &room, const QString &delta)
+{
+    views[room].text += delta;
+    if (room != currentRoom) {
+        return;
+    }
+    pendingText += delta;
+    if (!renderTimer->isActive()) {
+        renderTimer->start();
+    }
+}
+
+void AIAssistant::setStreamStats(const QString &room, const QString &stats)
+{
+    views[room].stats = stats;
+    if (room != currentRoom) {
+        return;
+    }
+    pendingStats = stats;
+    if (!renderTimer->isActive()) {
+        renderTimer->start();
+    }
+}
+
+void AIAssistant::finishStream(const QString &room)
+{
+    if (room != currentRoom) {
+        return;
+    }
+    renderTimer->stop();
+    flushStream();
+}
+
+void AIAssistant::showPending(const QString &text)
+{
+    // 当前房间还有请求在途时新请求只是排队，不覆盖正在显示的回复
+    if (!views.value(currentRoom).busy) {
+        appendResponse(text);
+    }
+}
+
+void AIAssistant::setBusy(const QString &room, bool busy)
+{
+    views[room].busy = busy;
+    if (room == currentRoom) {
+        cancelButton->setEnabled(busy);
+    }
+}
+
+void AIAssistant::flushStream()
+{
+    if (!pendingText.isEmpty()) {
+        // 只在末尾追加，不重排整个文档；用户往上翻看时不强制滚到底部
+        QScrollBar *bar = responseDisplay->verticalScrollBar();
+        const bool atBottom = bar->value() >= bar->maximum() - 4;
+        QTextCursor cursor(responseDisplay->document());
+        cursor.movePosition(QTextCursor::End);
+        cursor.insertText(pendingText);
+        pendingText.clear();
+        if (atBottom) {
+            bar->setValue(bar->maximum());
+        }
+    }
+    if (!pendingStats.isEmpty()) {
+        statsLabel->setText(pendingStats);
+        pendingStats.clear();
+    }
 }
 
 void AIAssistant::setEnabled(bool enabled)
@@ -151,17 +278,23 @@ void AIAssistant::setEnabled(bool enabled)
     suggestReplyButton->setEnabled(enabled);
 }
 
+void AIAssistant::setGatewayMode(bool enabled)
+{
+    gatewayMode = enabled;
+}
+
 void AIAssistant::onSendClicked()
 {
     QString prompt = promptEdit->text().trimmed();
-    if (!prompt.isEmpty()) {
-        QString fullPrompt = prompt;
-        if (!chatContext.isEmpty()) {
-            fullPrompt = "聊天上下文:\n" + chatContext + "\n\n用户问题: " + prompt;
-        }
-        emit aiRequestSent(fullPrompt);
-        promptEdit->clear();
-        responseDisplay->setText("正在等待AI回复...");
+    if (prompt.isEmpty()) {
+        return;
+    }
+    promptEdit->clear();
+    showPending("正在等待AI回复...");
+    if (gatewayMode) {
+        emit gatewayRequestSent("ask", prompt);
+    } else {
+        emit aiRequestSent("ask", prompt);
     }
 }
 
@@ -6,6 +6,9 @@
 #include <QLineEdit>
 #include <QPushButton>
 #include <QComboBox>
+#include <QLabel>
+#include <QTimer>
+#include <QHash>
 
 class AIAssistant : public QWidget
 {
@@ -13,28 +16,59 @@ class AIAssistant : public QWidget
 public:
     explicit AIAssistant(QWidget *parent = nullptr);
 
-    void setChatContext(const QString &chatHistory);
+    // 每个房间各自保留回复内容，面板只显示当前房间的
+    void setRoom(const QString &room);
+    void removeRoom(const QString &room);
     void appendResponse(const QString &response);
+    void appendResponse(const QString &room, const QString &response);
+    // 流式回复：先显示标题，之后的增量合并到下一次刷新时一起追加
+    void beginStream(const QString &room, const QString &header);
+    void appendStreamText(const QString &room, const QString &delta);
+    void setStreamStats(const QString &room, const QString &stats);
+    void finishStream(const QString &room);
+    // 房间有在途或排队的请求时可以取消
+    void setBusy(const QString &room, bool busy);
     void setEnabled(bool enabled);
+    void setGatewayMode(bool enabled);
 
 signals:
-    void aiRequestSent(const QString &prompt);
+    // kind 为 summarize / suggest / ask；上下文由接收方在发请求时组装
+    void aiRequestSent(const QString &kind, const QString &question);
+    // 交给服务器 AI 网关处理
+    void gatewayRequestSent(const QString &kind, const QString &question);
+    void cancelRequested(const QString &room);
 
 private slots:
     void onSendClicked();
     void onQuickActionClicked();
+    void flushStream();
 
 private:
     void setupUI();
+    void showPending(const QString &text);
 
     QTextEdit *responseDisplay;
+    QLabel *statsLabel;
     QLineEdit *promptEdit;
     QPushButton *sendButton;
     QPushButton *summarizeButton;
     QPushButton *suggestReplyButton;
+    QPushButton *cancelButton;
     QComboBox *quickActions;
 
-    QString chatContext;
+    bool gatewayMode = false;
+
+    struct RoomView {
+        QString text;
+        QString stats;
+        bool busy = false;
+    };
+    QHash<QString, RoomView> views;
+    QString currentRoom;
+
+    QTimer *renderTimer;
+    QString pendingText;   // 尚未刷到界面的增量
+    QString pendingStats;
 };
 
 #endif // AIASSISTANT_H
@@ -0,0 +1,190 @@
+#include "aicache.h"
+
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+#include <QtEndian>
+
+namespace {
+const QByteArray kMagic("AICACHE1");
+constexpr int kKeyBytes = 32;
+// 记录头：类型 1 字节 + 负载长度 4 字节，之后是键和负载
+constexpr int kHeaderBytes = 1 + 4;
+constexpr qint64 kEntryOverhead = kKeyBytes + kHeaderBytes + 32;
+// 单条回复的上限，防止损坏的长度字段导致一次分配过大
+constexpr quint32 kMaxPayloadBytes = 4 * 1024 * 1024;
+}
+
+AICache::AICache(const QString &path, qint64 maxBytes)
+    : path(path)
+    , maxBytes(maxBytes)
+{
+}
+
+bool AICache::load()
+{
+    entries.clear();
+    lru.clear();
+    bytes = 0;
+
+    QFile in(path);
+    if (in.open(QIODevice::ReadOnly)) {
+        const QByteArray data = in.readAll();
+        in.close();
+        qint64 pos = kMagic.size();
+        qint64 good = data.startsWith(kMagic) ? pos : 0;
+        while (good > 0 && pos + kHeaderBytes + kKeyBytes <= data.size()) {
+            const auto type = quint8(data.at(pos));
+            const quint32 length = qFromLittleEndian<quint32>(data.constData() + pos + 1);
+            const qint64 end = pos + kHeaderBytes + kKeyBytes + length;
+            if (length > kMaxPayloadBytes || end > data.size()) {
+                break;
+            }
+            const QByteArray key = data.mid(pos + kHeaderBytes, kKeyBytes);
+            if (type == PutRecord) {
+                put(key, data.mid(pos + kHeaderBytes + kKeyBytes, length));
+            } else if (type == TouchRecord) {
+                touch(key);
+            }
+            pos = good = end;
+        }
+        // 崩溃时可能留下半条记录，截掉后继续追加
+        if (good < data.size()) {
+            QFile::resize(path, good);
+        }
+    }
+    return openForAppend();
+}
+
+void AICache::setMaxBytes(qint64 newMaxBytes)
+{
+    maxBytes = qMax<qint64>(0, newMaxBytes);
+    evict();
+}
+
+QByteArray AICache::keyFor(const QJsonObject &requestBody)
+{
+    QJsonObject normalized = requestBody;
+    normalized.remove("stream");
+    // QJsonObject 按键排序输出，同样的请求得到同样的字节
+    return QCryptographicHash::hash(QJsonDocument(normalized).toJson(QJsonDocument::Compact),
+                                    QCryptographicHash::Sha256);
+}
+
+bool AICache::lookup(const QByteArray &key, QString *text)
+{
+    auto it = entries.constFind(key);
+    if (it == entries.cend()) {
+        return false;
+    }
+    *text = QString::fromUtf8(it->text);
+    touch(key);
+    appendRecord(TouchRecord, key, QByteArray());
+    return true;
+}
+
+void AICache::insert(const QByteArray &key, const QString &text)
+{
+    const QByteArray utf8 = text.toUtf8();
+    if (key.size() != kKeyBytes || utf8.size() > qint64(kMaxPayloadBytes) || utf8.size() + kEntryOverhead > maxBytes) {
+        return;
+    }
+    put(key, utf8);
+    appendRecord(PutRecord, key, utf8);
+}
+
+bool AICache::openForAppend()
+{
+    QDir().mkpath(QFileInfo(path).absolutePath());
+    file.close();
+    file.setFileName(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Append)) {
+        return false;
+    }
+    if (file.size() == 0) {
+        file.write(kMagic);
+    }
+    return true;
+}
+
+void AICache::appendRecord(RecordType type, const QByteArray &key, const QByteArray &payload)
+{
+    if (!file.isOpen()) {
+        return;
+    }
+    char header[kHeaderBytes];
+    header[0] = char(type);
+    qToLittleEndian<quint32>(quint32(payload.size()), header + 1);
+    file.write(header, kHeaderBytes);
+    file.write(key);
+    file.write(payload);
+    file.flush();
+
+    // 命中记录和被淘汰的旧内容会让文件越来越长，超过上限两倍时重写
+    if (file.size() > 2 * maxBytes + kMagic.size()) {
+        compact();
+    }
+}
+
+void AICache::put(const QByteArray &key, QByteArray text)
+{
+    auto it = entries.find(key);
+    if (it != entries.end()) {
+        bytes -= it->text.size() + kEntryOverhead;
+        lru.remove(it->tick);
+        it->text = std::move(text);
+    } else {
+        it = entries.insert(key, Entry{std::move(text), 0});
+    }
+    it->tick = ++clock;
+    lru.insert(it->tick, key);
+    bytes += it->text.size() + kEntryOverhead;
+    evict();
+}
+
+void AICache::touch(const QByteArray &key)
+{
+    auto it = entries.find(key);
+    if (it == entries.end()) {
+        return;
+    }
+    lru.remove(it->tick);
+    it->tick = ++clock;
+    lru.insert(it->tick, key);
+}
+
+void AICache::evict()
+{
+    while (bytes > maxBytes && !lru.isEmpty()) {
+        const QByteArray key = lru.take(lru.firstKey());
+        auto it = entries.find(key);
+        if (it != entries.end()) {
+            bytes -= it->text.size() + kEntryOverhead;
+            entries.erase(it);
+        }
+    }
+}
+
+void AICache::compact()
+{
+    file.close();
+    QSaveFile out(path);
+    if (out.open(QIODevice::WriteOnly)) {
+        out.write(kMagic);
+        // 按 LRU 顺序写出，重放后顺序不变
+        for (auto it = lru.cbegin(); it != lru.cend(); ++it) {
+            const QByteArray &text = entries.value(it.value()).text;
+            char header[kHeaderBytes];
+            header[0] = char(PutRecord);
+            qToLittleEndian<quint32>(quint32(text.size()), header + 1);
+            out.write(header, kHeaderBytes);
+            out.write(it.value());
+            out.write(text);
+        }
+        out.commit();
+    }
+    openForAppend();
+}
@@ -0,0 +1,57 @@
+#ifndef AICACHE_H
+#define AICACHE_H
+
+#include <QByteArray>
+#include <QFile>
+#include <QHash>
+#include <QMap>
+#include <QString>
+
+class QJsonObject;
+
+// AI 回复的本地缓存，键是请求体（模型、参数和完整提示词）的 SHA-256。
+// 落盘为 config/ 下的追加写文件：写入和命中都只追加一条记录，
+// 启动时按顺序重放得到 LRU 顺序；文件超过上限的两倍时按当前内容重写。
+class AICache
+{
+public:
+    explicit AICache(const QString &path, qint64 maxBytes = kDefaultMaxBytes);
+
+    bool load();
+    void setMaxBytes(qint64 bytes);
+
+    // 请求体中不影响结果的字段（stream）不参与计算
+    static QByteArray keyFor(const QJsonObject &requestBody);
+    bool lookup(const QByteArray &key, QString *text);
+    void insert(const QByteArray &key, const QString &text);
+
+    static constexpr qint64 kDefaultMaxBytes = 8 * 1024 * 1024;
+
+private:
+    enum RecordType : quint8 {
+        PutRecord = 1,
+        TouchRecord = 2
+    };
+
+    struct Entry {
+        QByteArray text;   // UTF-8
+        quint64 tick = 0;
+    };
+
+    bool openForAppend();
+    void appendRecord(RecordType type, const QByteArray &key, const QByteArray &payload);
+    void put(const QByteArray &key, QByteArray text);
+    void touch(const QByteArray &key);
+    void evict();
+    void compact();
+
+    QString path;
+    QFile file;
+    qint64 maxBytes;
+    qint64 bytes = 0;          // 内存中所有条目的大小
+    quint64 clock = 0;
+    QHash<QByteArray, Entry> entries;
+    QMap<quint64, QByteArray> lru;   // tick -> key，最早使用的在前
+};
+
+#endif // AICACHE_H
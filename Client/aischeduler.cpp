@@ -0,0 +1,367 @@
+#include "aischeduler.h"
+
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QNetworkRequest>
+#include <QTimer>
+#if QT_CONFIG(ssl)
+#include <QSslConfiguration>
+#endif
+
+#include <algorithm>
+
+namespace {
+// 空闲连接通常一两分钟后被服务端关闭，按这个间隔重新预连接
+constexpr int kKeepWarmIntervalMs = 45000;
+
+#if QT_CONFIG(ssl)
+// 预连接和正式请求用同一份配置，连接才能被复用；ALPN 优先 HTTP/2
+QSslConfiguration sslConfiguration()
+{
+    QSslConfiguration ssl = QSslConfiguration::defaultConfiguration();
+    ssl.setAllowedNextProtocols({QSslConfiguration::ALPNProtocolHTTP2, QSslConfiguration::NextProtocolHttp1_1});
+    return ssl;
+}
+#endif
+}
+
+AIScheduler::AIScheduler(const QString &cachePath, QObject *parent)
+    : QObject(parent)
+    , network(new QNetworkAccessManager(this))
+    , cache(cachePath)
+    , warmTimer(new QTimer(this))
+{
+    warmTimer->setInterval(kKeepWarmIntervalMs);
+    connect(warmTimer, &QTimer::timeout, this, [this]() {
+        // 有请求在途说明连接正在用，不必再预连
+        if (running.isEmpty()) {
+            prewarm();
+        }
+    });
+}
+
+AIScheduler::~AIScheduler()
+{
+    for (Job *job : std::as_const(running)) {
+        job->reply->disconnect(this);
+        job->reply->abort();
+        job->reply->deleteLater();
+        delete job;
+    }
+    for (const QList<Job *> &queue : std::as_const(queues)) {
+        qDeleteAll(queue);
+    }
+}
+
+void AIScheduler::setConfig(const Config &newConfig)
+{
+    config = newConfig;
+    config.maxConcurrent = qMax(1, config.maxConcurrent);
+    startNext();
+}
+
+void AIScheduler::loadCache(qint64 maxBytes)
+{
+    cache.setMaxBytes(maxBytes);
+    cache.load();
+}
+
+AIScheduler::Priority AIScheduler::priorityFor(const QString &kind)
+{
+    if (kind == "ask") {
+        return Interactive;
+    }
+    return kind == "suggest" ? Normal : Background;
+}
+
+void AIScheduler::submit(const QString &room, const QString &kind, const QString &prompt)
+{
+    QJsonObject messageObj;
+    messageObj["role"] = "user";
+    messageObj["content"] = prompt;
+
+    QJsonObject requestBody;
+    requestBody["model"] = config.model;
+    requestBody["messages"] = QJsonArray{messageObj};
+    requestBody["temperature"] = 0.7;
+    requestBody["max_tokens"] = 1000;
+
+    // 模型、参数和提示词都相同的请求直接用本地缓存
+    const QByteArray cacheKey = AICache::keyFor(requestBody);
+    QString cached;
+    if (cache.lookup(cacheKey, &cached)) {
+        emit jobFinished(room, true, cached, false, true);
+        return;
+    }
+    // 重复点击同一个按钮不再排第二次
+    if (isDuplicate(room, cacheKey)) {
+        return;
+    }
+
+    // 流式返回，收到一段显示一段
+    requestBody["stream"] = true;
+
+    auto *job = new Job;
+    job->id = nextId++;
+    job->room = room;
+    job->priority = priorityFor(kind);
+    job->body = QJsonDocument(requestBody).toJson(QJsonDocument::Compact);
+    job->cacheKey = cacheKey;
+
+    QList<Job *> &queue = queues[room];
+    auto pos = std::upper_bound(queue.begin(), queue.end(), job, [](const Job *a, const Job *b) {
+        return a->priority < b->priority;
+    });
+    queue.insert(pos, job);
+    emit busyChanged(room, true);
+    startNext();
+}
+
+void AIScheduler::cancel(const QString &room)
+{
+    const bool busy = isBusy(room);
+    qDeleteAll(queues.take(room));
+    if (Job *job = running.take(room)) {
+        job->reply->disconnect(this);
+        job->reply->abort();
+        job->reply->deleteLater();
+        delete job;
+    }
+    if (busy) {
+        emit busyChanged(room, false);
+    }
+    startNext();
+}
+
+bool AIScheduler::isBusy(const QString &room) const
+{
+    return running.contains(room) || !queues.value(room).isEmpty();
+}
+
+void AIScheduler::setWarm(bool warm)
+{
+    if (warm == warmTimer->isActive()) {
+        return;
+    }
+    if (warm) {
+        prewarm();
+        warmTimer->start();
+    } else {
+        warmTimer->stop();
+    }
+}
+
+void AIScheduler::prewarm()
+{
+    // 走服务器网关时没有密钥，不直连接口
+    const QUrl &url = config.endpoint;
+    if (config.apiKey.isEmpty() || !url.isValid() || url.host().isEmpty()) {
+        return;
+    }
+    // h2c 的连接由第一个请求建立，预先建的 HTTP/1.1 连接用不上
+    if (config.h2c && url.scheme() == "http") {
+        return;
+    }
+    // 已有可用连接时 QNetworkAccessManager 直接复用，不会重复握手
+#if QT_CONFIG(ssl)
+    if (url.scheme() == "https") {
+        network->connectToHostEncrypted(url.host(), quint16(url.port(443)), sslConfiguration());
+        return;
+    }
+#endif
+    network->connectToHost(url.host(), quint16(url.port(80)));
+}
+
+bool AIScheduler::isDuplicate(const QString &room, const QByteArray &cacheKey) const
+{
+    if (const Job *job = running.value(room)) {
+        if (job->cacheKey == cacheKey) {
+            return true;
+        }
+    }
+    const QList<Job *> queue = queues.value(room);
+    return std::any_of(queue.cbegin(), queue.cend(), [&](const Job *job) { return job->cacheKey == cacheKey; });
+}
+
+void AIScheduler::startNext()
+{
+    while (running.size() < config.maxConcurrent) {
+        // 在没有在途请求的房间里挑优先级最高、提交最早的
+        Job *best = nullptr;
+        for (auto it = queues.cbegin(); it != queues.cend(); ++it) {
+            if (it.value().isEmpty() || running.contains(it.key())) {
+                continue;
+            }
+            Job *head = it.value().first();
+            if (!best || head->priority < best->priority
+                || (head->priority == best->priority && head->id < best->id)) {
+                best = head;
+            }
+        }
+        if (!best) {
+            return;
+        }
+        QList<Job *> &queue = queues[best->room];
+        queue.removeFirst();
+        if (queue.isEmpty()) {
+            queues.remove(best->room);
+        }
+        start(best);
+    }
+}
+
+void AIScheduler::start(Job *job)
+{
+    QNetworkRequest request(config.endpoint);
+    request.setHeader(QNetworkRequest::ContentTypeHeader, "application/json");
+    request.setRawHeader("Authorization", QString("Bearer %1").arg(config.apiKey).toUtf8());
+    request.setAttribute(QNetworkRequest::Http2AllowedAttribute, true);
+    if (config.h2c && config.endpoint.scheme() == "http") {
+        request.setAttribute(QNetworkRequest::Http2DirectAttribute, true);
+    }
+#if QT_CONFIG(ssl)
+    if (config.endpoint.scheme() == "https") {
+        request.setSslConfiguration(sslConfiguration());
+    }
+#endif
+
+    running.insert(job->room, job);
+    job->clock.start();
+    job->reply = network->post(request, job->body);
+    // 复用已有连接时不会触发 socketStartedConnecting
+    connect(job->reply, &QNetworkReply::socketStartedConnecting, this, [job]() { job->newConnection = true; });
+    connect(job->reply, &QNetworkReply::requestSent, this, [job]() {
+        if (job->sentMs < 0) {
+            job->sentMs = job->clock.elapsed();
+        }
+    });
+    connect(job->reply, &QNetworkReply::readyRead, this, [this, job]() { onReadyRead(job); });
+    connect(job->reply, &QNetworkReply::finished, this, [this, job]() { onFinished(job); });
+    emit jobStarted(job->room);
+}
+
+bool AIScheduler::isEventStream(QNetworkReply *reply)
+{
+    return reply->header(QNetworkRequest::ContentTypeHeader).toString().startsWith("text/event-stream");
+}
+
+void AIScheduler::onReadyRead(Job *job)
+{
+    // 非流式的响应（比如接口直接返回的错误）留到 finished 时整体解析
+    if (!isEventStream(job->reply)) {
+        return;
+    }
+    job->stream.feed(job->reply->readAll());
+    handleEvents(job);
+}
+
+void AIScheduler::handleEvents(Job *job)
+{
+    QByteArray data;
+    while (job->stream.next(&data)) {
+        if (data == "[DONE]") {
+            continue;
+        }
+        const QJsonObject obj = QJsonDocument::fromJson(data).object();
+        if (obj.contains("error")) {
+            job->streamError = obj.value("error").toObject().value("message").toString();
+            continue;
+        }
+        const int usageTokens = obj.value("usage").toObject().value("completion_tokens").toInt();
+        const QString delta = obj.value("choices").toArray().at(0).toObject()
+                                  .value("delta").toObject().value("content").toString();
+        if (delta.isEmpty() && usageTokens == 0) {
+            continue;
+        }
+
+        const qint64 now = job->clock.elapsed();
+        if (!delta.isEmpty()) {
+            if (job->firstTokenMs < 0) {
+                job->firstTokenMs = now;
+                emit streamStarted(job->room);
+            }
+            // 兼容接口一般每个分片一个 token；带 usage 时以它为准
+            ++job->tokens;
+            job->text += delta;
+            emit streamDelta(job->room, delta);
+        }
+        if (usageTokens > 0) {
+            job->tokens = usageTokens;
+        }
+        if (job->firstTokenMs >= 0) {
+            const qint64 elapsed = now - job->firstTokenMs;
+            Timing timing;
+            timing.setupMs = job->sentMs;
+            timing.firstTokenMs = job->sentMs >= 0 ? job->firstTokenMs - job->sentMs : job->firstTokenMs;
+            timing.tokens = job->tokens;
+            timing.tokensPerSecond = elapsed > 0 ? (job->tokens - 1) * 1000.0 / elapsed : 0.0;
+            timing.newConnection = job->newConnection;
+            timing.http2 = job->reply->attribute(QNetworkRequest::Http2WasUsedAttribute).toBool();
+            emit streamStats(job->room, timing);
+        }
+    }
+}
+
+void AIScheduler::onFinished(Job *job)
+{
+    QNetworkReply *reply = job->reply;
+    if (isEventStream(reply)) {
+        job->stream.feed(reply->readAll());
+        job->stream.finish();
+        handleEvents(job);
+        if (job->firstTokenMs >= 0) {
+            const bool ok = reply->error() == QNetworkReply::NoError && job->streamError.isEmpty();
+            if (ok) {
+                cache.insert(job->cacheKey, job->text);
+            }
+            finish(job, ok, ok ? job->text : (job->streamError.isEmpty() ? reply->errorString() : job->streamError));
+        } else if (!job->streamError.isEmpty()) {
+            finish(job, false, "❌ API错误:\n\n" + job->streamError);
+        } else if (reply->error() != QNetworkReply::NoError) {
+            finish(job, false, "❌ 网络错误:\n\n" + reply->errorString());
+        } else {
+            finish(job, false, "❌ 错误: API返回为空");
+        }
+        return;
+    }
+
+    if (reply->error() != QNetworkReply::NoError) {
+        finish(job, false, "❌ 网络错误:\n\n" + reply->errorString() + "\n\n提示: 请检查网络连接和API密钥是否正确");
+        return;
+    }
+    const QJsonObject obj = QJsonDocument::fromJson(reply->readAll()).object();
+    if (obj.contains("choices")) {
+        const QJsonArray choices = obj.value("choices").toArray();
+        const QString content = choices.at(0).toObject().value("message").toObject().value("content").toString();
+        if (!choices.isEmpty()) {
+            if (!content.isEmpty()) {
+                cache.insert(job->cacheKey, content);
+            }
+            finish(job, true, content);
+        } else {
+            finish(job, false, "❌ 错误: API返回为空");
+        }
+    } else if (obj.contains("error")) {
+        finish(job, false, "❌ API错误:\n\n" + obj.value("error").toObject().value("message").toString());
+    } else {
+        finish(job, false, "❌ 错误: 无法解析API响应");
+    }
+}
+
+void AIScheduler::finish(Job *job, bool ok, const QString &text)
+{
+    const QString room = job->room;
+    const bool streamed = job->firstTokenMs >= 0;
+    running.remove(room);
+    job->reply->deleteLater();
+    delete job;
+
+    emit jobFinished(room, ok, text, streamed, false);
+    if (!isBusy(room)) {
+        emit busyChanged(room, false);
+    }
+    startNext();
+}
@@ -0,0 +1,109 @@
+#ifndef AISCHEDULER_H
+#define AISCHEDULER_H
+
+#include <QObject>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QList>
+#include <QUrl>
+
+#include "aicache.h"
+#include "sseparser.h"
+
+class QNetworkAccessManager;
+class QNetworkReply;
+class QTimer;
+
+// 客户端直连 AI 接口的请求调度。每个房间一个队列、同一时间最多一个请求在途，
+// 房间之间并发执行，总数受 maxConcurrent 限制；空出名额时优先启动提问，其次回复建议、总结。
+// 请求只会在用户明确取消（或关闭房间）时中止，结果按房间发回。
+// AI 面板可用期间提前建好到接口主机的连接（TLS + ALPN 协商 HTTP/2），并发请求复用同一条连接。
+class AIScheduler : public QObject
+{
+    Q_OBJECT
+public:
+    enum Priority {
+        Interactive = 0,   // 自定义提问
+        Normal = 1,        // 回复建议
+        Background = 2     // 总结
+    };
+
+    struct Config {
+        QString apiKey;
+        QUrl endpoint = QUrl("https://api.siliconflow.cn/v1/chat/completions");
+        QString model = "Qwen/Qwen2.5-7B-Instruct";
+        int maxConcurrent = 2;
+        bool h2c = false;    // 明文 http 地址直接用 HTTP/2（h2c），不经过 HTTP/1.1 升级
+    };
+
+    // 单次请求的耗时拆分：建连与模型分开统计
+    struct Timing {
+        qint64 setupMs = -1;       // 发起到请求发完，新建连接时包含 TCP 和 TLS 握手
+        qint64 firstTokenMs = -1;  // 请求发完到首个分片，即模型首字耗时
+        int tokens = 0;
+        double tokensPerSecond = 0;
+        bool newConnection = false;
+        bool http2 = false;
+    };
+
+    AIScheduler(const QString &cachePath, QObject *parent = nullptr);
+    ~AIScheduler();
+
+    void setConfig(const Config &config);
+    void loadCache(qint64 maxBytes);
+
+    static Priority priorityFor(const QString &kind);
+    void submit(const QString &room, const QString &kind, const QString &prompt);
+    // 中止该房间在途的请求并清空它的队列
+    void cancel(const QString &room);
+    bool isBusy(const QString &room) const;
+    // 开启后立即预连接，并定期检查连接是否还在
+    void setWarm(bool warm);
+
+signals:
+    void jobStarted(const QString &room);
+    void streamStarted(const QString &room);
+    void streamDelta(const QString &room, const QString &delta);
+    void streamStats(const QString &room, const AIScheduler::Timing &timing);
+    // ok 为 false 时 text 是错误信息；streamed 表示内容已经通过 streamDelta 发出
+    void jobFinished(const QString &room, bool ok, const QString &text, bool streamed, bool cached);
+    void busyChanged(const QString &room, bool busy);
+
+private:
+    struct Job {
+        quint64 id = 0;
+        QString room;
+        Priority priority = Normal;
+        QByteArray body;
+        QByteArray cacheKey;
+        QNetworkReply *reply = nullptr;
+        SseParser stream;
+        QElapsedTimer clock;
+        qint64 sentMs = -1;
+        qint64 firstTokenMs = -1;
+        bool newConnection = false;
+        int tokens = 0;
+        QString text;
+        QString streamError;
+    };
+
+    void prewarm();
+    void startNext();
+    void start(Job *job);
+    void onReadyRead(Job *job);
+    void handleEvents(Job *job);
+    void onFinished(Job *job);
+    void finish(Job *job, bool ok, const QString &text);
+    bool isDuplicate(const QString &room, const QByteArray &cacheKey) const;
+    static bool isEventStream(QNetworkReply *reply);
+
+    Config config;
+    QNetworkAccessManager *network;
+    AICache cache;
+    QTimer *warmTimer;
+    QHash<QString, QList<Job *>> queues;   // 按优先级、提交顺序排列
+    QHash<QString, Job *> running;
+    quint64 nextId = 1;
+};
+
+#endif // AISCHEDULER_H
@@ -0,0 +1,163 @@
+#include "attachmenttransfer.h"
+
+#include <QFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+namespace {
+// 下载响应头一行的最大长度
+constexpr int kMaxHeaderBytes = 4096;
+}
+
+QString sha256OfFile(const QString &path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return QString();
+    }
+    QCryptographicHash hash(QCryptographicHash::Sha256);
+    if (!hash.addData(&file)) {
+        return QString();
+    }
+    return QString::fromLatin1(hash.result().toHex());
+}
+
+AttachmentDownload::AttachmentDownload(const QString &host, quint16 port, const QString &hash,
+                                       const QString &token, qint64 expires,
+                                       const QString &savePath, QObject *parent)
+    : QObject(parent)
+    , host(host)
+    , port(port)
+    , hash(hash)
+    , token(token)
+    , expires(expires)
+    , file(savePath)
+    , digest(QCryptographicHash::Sha256)
+{
+    connect(&socket, &QSslSocket::connected, this, [this]() {
+        if (!tls) {
+            onConnected();
+        }
+    });
+    connect(&socket, &QSslSocket::encrypted, this, &AttachmentDownload::onConnected);
+    connect(&socket, &QSslSocket::readyRead, this, &AttachmentDownload::onReadyRead);
+    connect(&socket, &QSslSocket::disconnected, this, &AttachmentDownload::onDisconnected);
+    connect(&socket, &QSslSocket::errorOccurred, this, [this]() {
+        if (socket.error() != QAbstractSocket::RemoteHostClosedError) {
+            finish(false, socket.errorString());
+        }
+    });
+}
+
+void AttachmentDownload::setTls(const QSslConfiguration &configuration)
+{
+    tls = true;
+    socket.setSslConfiguration(configuration);
+}
+
+void AttachmentDownload::start()
+{
+    if (tls) {
+        socket.connectToHostEncrypted(host, port);
+    } else {
+        socket.connectToHost(host, port);
+    }
+}
+
+void AttachmentDownload::onConnected()
+{
+    QJsonObject obj;
+    obj["type"] = "download";
+    obj["hash"] = hash;
+    obj["token"] = token;
+    obj["expires"] = expires;
+    QByteArray data = QJsonDocument(obj).toJson(QJsonDocument::Compact);
+    data.append('\n');
+    socket.write(data);
+}
+
+void AttachmentDownload::onReadyRead()
+{
+    if (done) {
+        return;
+    }
+    if (total >= 0) {
+        writePayload(socket.readAll());
+        return;
+    }
+
+    header.append(socket.readAll());
+    const int idx = header.indexOf('\n');
+    if (idx < 0) {
+        if (header.size() > kMaxHeaderBytes) {
+            finish(false, "服务器响应格式错误");
+        }
+        return;
+    }
+
+    const QJsonObject obj = QJsonDocument::fromJson(header.left(idx)).object();
+    if (obj.value("type").toString() != "download_begin") {
+        finish(false, obj.value("message").toString("下载失败"));
+        return;
+    }
+    total = obj.value("size").toInteger();
+    if (!file.open(QIODevice::WriteOnly)) {
+        finish(false, "无法写入文件: " + file.errorString());
+        return;
+    }
+    const QByteArray rest = header.mid(idx + 1);
+    header.clear();
+    writePayload(rest);
+}
+
+void AttachmentDownload::writePayload(const QByteArray &data)
+{
+    if (data.isEmpty()) {
+        if (received == total) {
+            finish(true, QString());
+        }
+        return;
+    }
+    if (file.write(data) != data.size()) {
+        finish(false, "无法写入文件: " + file.errorString());
+        return;
+    }
+    digest.addData(data);
+    received += data.size();
+    emit progress(received, total);
+    if (received >= total) {
+        finish(true, QString());
+    }
+}
+
+void AttachmentDownload::onDisconnected()
+{
+    if (!done) {
+        finish(received == total && total >= 0, "连接中断");
+    }
+}
+
+void AttachmentDownload::finish(bool ok, const QString &message)
+{
+    if (done) {
+        return;
+    }
+    done = true;
+    socket.abort();
+
+    QString result = message;
+    if (ok && (received != total || QString::fromLatin1(digest.result().toHex()) != hash)) {
+        ok = false;
+        result = "文件校验失败";
+    }
+    if (ok && !file.commit()) {
+        ok = false;
+        result = "无法保存文件: " + file.errorString();
+    }
+    if (!ok) {
+        file.cancelWriting();
+    }
+
+    emit finished(ok, result);
+    deleteLater();
+}
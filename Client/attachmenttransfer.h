@@ -0,0 +1,54 @@
+#ifndef ATTACHMENTTRANSFER_H
+#define ATTACHMENTTRANSFER_H
+
+#include <QObject>
+#include <QSslSocket>
+#include <QSaveFile>
+#include <QCryptographicHash>
+
+// 计算文件的 SHA-256（十六进制），失败返回空字符串
+QString sha256OfFile(const QString &path);
+
+// 通过单独的连接下载一个附件：服务器先回一行 download_begin，随后是原始字节。
+// token / expires 是先在聊天连接上用 download_grant 申请到的下载凭证
+class AttachmentDownload : public QObject
+{
+    Q_OBJECT
+public:
+    AttachmentDownload(const QString &host, quint16 port, const QString &hash,
+                       const QString &token, qint64 expires,
+                       const QString &savePath, QObject *parent = nullptr);
+
+    // 聊天连接启用了 TLS 时，下载连接也加密；不带重连票据，每次都做证书握手
+    void setTls(const QSslConfiguration &configuration);
+    void start();
+
+signals:
+    void progress(qint64 received, qint64 total);
+    void finished(bool ok, const QString &message);
+
+private slots:
+    void onConnected();
+    void onReadyRead();
+    void onDisconnected();
+
+private:
+    void writePayload(const QByteArray &data);
+    void finish(bool ok, const QString &message);
+
+    QSslSocket socket;
+    bool tls = false;
+    QString host;
+    quint16 port;
+    QString hash;
+    QString token;
+    qint64 expires;
+    QSaveFile file;
+    QCryptographicHash digest;
+    QByteArray header;
+    qint64 total = -1;
+    qint64 received = 0;
+    bool done = false;
+};
+
+#endif // ATTACHMENTTRANSFER_H
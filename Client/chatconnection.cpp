@@ -0,0 +1,130 @@
+#include "chatconnection.h"
+#include "connectionworker.h"
+#include "trace.h"
+
+#include <QThread>
+
+ChatConnection::ChatConnection(QObject *parent)
+    : QObject(parent)
+    , thread(new QThread(this))
+    , worker(new ConnectionWorker)
+{
+    qRegisterMetaType<ChatEvent>();
+    qRegisterMetaType<QList<ChatEvent>>();
+
+    thread->setObjectName("ChatConnection");
+    worker->moveToThread(thread);
+    connect(thread, &QThread::finished, worker, &QObject::deleteLater);
+    connect(worker, &ConnectionWorker::stateChanged, this, &ChatConnection::onWorkerStateChanged);
+    connect(worker, &ConnectionWorker::eventsReady, this, &ChatConnection::onEventsReady);
+    connect(worker, &ConnectionWorker::errorOccurred, this, &ChatConnection::errorOccurred);
+    connect(worker, &ConnectionWorker::reconnectScheduled, this, &ChatConnection::reconnectScheduled);
+    thread->start();
+}
+
+ChatConnection::~ChatConnection()
+{
+    thread->quit();
+    thread->wait();
+}
+
+void ChatConnection::connectToServer(const QString &serverHost, quint16 serverPort)
+{
+    host = serverHost;
+    port = serverPort;
+    QMetaObject::invokeMethod(worker, [worker = worker, serverHost, serverPort]() {
+        worker->connectToServer(serverHost, serverPort);
+    }, Qt::QueuedConnection);
+}
+
+void ChatConnection::setTls(bool enabled, const QSslConfiguration &sslConfiguration)
+{
+    tls = enabled;
+    configuration = sslConfiguration;
+    QMetaObject::invokeMethod(worker, [worker = worker, enabled, sslConfiguration]() {
+        worker->setTls(enabled, sslConfiguration);
+    }, Qt::QueuedConnection);
+}
+
+void ChatConnection::disconnectFromServer()
+{
+    // 之后的 send 直接返回 false；不在这里发 stateChanged，调用方可能正在析构
+    currentState = Disconnected;
+    QMetaObject::invokeMethod(worker, &ConnectionWorker::disconnectFromServer, Qt::QueuedConnection);
+}
+
+void ChatConnection::login(const QString &account, const QString &password, const QString &name)
+{
+    QMetaObject::invokeMethod(worker, [worker = worker, account, password, name]() {
+        worker->login(account, password, name);
+    }, Qt::QueuedConnection);
+}
+
+void ChatConnection::reconnectNow()
+{
+    QMetaObject::invokeMethod(worker, &ConnectionWorker::reconnectNow, Qt::QueuedConnection);
+}
+
+bool ChatConnection::send(const QJsonObject &obj)
+{
+    // 状态是连接线程发来的快照；投递途中断线的消息会被丢弃，与写入已断开的 socket 相同
+    if (currentState != Connected && currentState != Online) {
+        return false;
+    }
+    QMetaObject::invokeMethod(worker, [worker = worker, obj]() {
+        worker->send(obj);
+    }, Qt::QueuedConnection);
+    return true;
+}
+
+bool ChatConnection::sendBatch(const QList<QJsonObject> &objs)
+{
+    if (currentState != Connected && currentState != Online) {
+        return false;
+    }
+    QMetaObject::invokeMethod(worker, [worker = worker, objs]() {
+        worker->sendBatch(objs);
+    }, Qt::QueuedConnection);
+    return true;
+}
+
+void ChatConnection::suspendDelivery()
+{
+    suspended = true;
+}
+
+void ChatConnection::resumeDelivery()
+{
+    suspended = false;
+    // 调用方通常还在构造中，留到下一轮事件循环再分发
+    QMetaObject::invokeMethod(this, &ChatConnection::deliverPending, Qt::QueuedConnection);
+}
+
+void ChatConnection::onWorkerStateChanged(ChatConnection::State state)
+{
+    if (currentState != state) {
+        currentState = state;
+        emit stateChanged(state);
+    }
+}
+
+void ChatConnection::onEventsReady(const QList<ChatEvent> &events)
+{
+    pending += events;
+    deliverPending();
+}
+
+void ChatConnection::deliverPending()
+{
+    TRACE_SCOPE("client.deliverEvents");
+    // 处理过程中可能被 suspendDelivery 打断，剩下的保留在 pending 里
+    while (!suspended && delivered < pending.size()) {
+        emit eventReceived(pending.at(delivered++));
+    }
+    if (suspended || pending.isEmpty()) {
+        return;
+    }
+    pending.clear();
+    delivered = 0;
+    QMetaObject::invokeMethod(worker, &ConnectionWorker::takeMore, Qt::QueuedConnection);
+}
@@ -0,0 +1,86 @@
+#ifndef CHATCONNECTION_H
+#define CHATCONNECTION_H
+
+#include <QObject>
+#include <QJsonObject>
+#include <QList>
+#include <QSslConfiguration>
+
+#include "chatevent.h"
+
+class QThread;
+class ConnectionWorker;
+
+// 与聊天服务器的长连接。socket 读写、分帧和 JSON 解析都在独立的连接线程里完成
+// （见 ConnectionWorker），本类只在界面线程转发调用、缓存状态、分发消息。
+// 登录成功过一次之后，断线会按带抖动的指数退避自动重连并用同一份凭据重新登录。
+// 解析好的消息按批到达，逐条通过 eventReceived 发出；一批处理完才向连接线程要下一批。
+class ChatConnection : public QObject
+{
+    Q_OBJECT
+public:
+    enum State {
+        Disconnected,   // 未连接，也不会自动重连
+        Connecting,
+        Connected,      // TCP 已连上，尚未登录
+        Online,         // 已登录
+        Backoff         // 断线后等待下一次重连
+    };
+    Q_ENUM(State)
+
+    explicit ChatConnection(QObject *parent = nullptr);
+    ~ChatConnection();
+
+    void connectToServer(const QString &host, quint16 port);
+    // 在 connectToServer 之前调用。启用后首次连接做证书握手，登录成功后服务器下发重连票据，
+    // 断线重连时用票据做 PSK 握手；票据被拒时自动改走证书握手
+    void setTls(bool enabled, const QSslConfiguration &configuration = QSslConfiguration::defaultConfiguration());
+    bool isTls() const { return tls; }
+    // 附件下载连接沿用同一份配置
+    QSslConfiguration tlsConfiguration() const { return configuration; }
+    // 主动断开，之后不再自动重连
+    void disconnectFromServer();
+    // 发送登录请求并记住凭据，重连后自动重新登录
+    void login(const QString &account, const QString &password, const QString &name);
+    // 退避等待中跳过剩余时间立即重连
+    void reconnectNow();
+
+    State state() const { return currentState; }
+    bool isOnline() const { return currentState == Online; }
+    QString serverHost() const { return host; }
+    quint16 serverPort() const { return port; }
+
+    // 未连接时返回 false，数据直接丢弃，需要重发的由调用方自己排队
+    bool send(const QJsonObject &obj);
+    // 多条消息合成一次写入
+    bool sendBatch(const QList<QJsonObject> &objs);
+
+    // 暂停分发消息，未处理的留到 resumeDelivery 之后；用于登录对话框把连接交给主窗口
+    void suspendDelivery();
+    void resumeDelivery();
+
+signals:
+    void stateChanged(ChatConnection::State state);
+    void eventReceived(const ChatEvent &event);
+    // 建连失败、断线或自动登录被拒，message 可以直接显示
+    void errorOccurred(const QString &message);
+    void reconnectScheduled(int attempt, int delayMs);
+
+private:
+    void onWorkerStateChanged(ChatConnection::State state);
+    void onEventsReady(const QList<ChatEvent> &events);
+    void deliverPending();
+
+    QThread *thread;
+    ConnectionWorker *worker;
+    State currentState = Disconnected;
+    QString host;
+    quint16 port = 0;
+    bool tls = false;
+    QSslConfiguration configuration;
+    QList<ChatEvent> pending;    // 已收到、尚未分发的消息
+    qsizetype delivered = 0;     // pending 中已分发的条数
+    bool suspended = false;
+};
+
+#endif // CHATCONNECTION_H
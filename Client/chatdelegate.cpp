@@ -0,0 +1,118 @@
+#include "chatdelegate.h"
+#include "chatmodel.h"
+
+#include <QAbstractItemView>
+#include <QPainter>
+#include <QTextLayout>
+#include <QtMath>
+
+namespace {
+constexpr int kPaddingX = 8;
+constexpr int kPaddingY = 3;
+constexpr int kMinTextWidth = 80;
+// 行高缓存超过这个数量就整体清空，换出的消息不会一直占着缓存
+constexpr int kMaxCachedHeights = 8192;
+
+const QColor kTextColor(0xd0, 0xd0, 0xd0);
+const QColor kTimeColor(0x88, 0x88, 0x88);
+const QColor kAccentColor(0x5a, 0xc2, 0xc6);
+const QColor kSelectedColor(0x4a, 0x4d, 0x50);
+}
+
+ChatDelegate::ChatDelegate(QAbstractItemView *view)
+    : QStyledItemDelegate(view)
+    , view(view)
+{
+}
+
+void ChatDelegate::paint(QPainter *painter, const QStyleOptionViewItem &option, const QModelIndex &index) const
+{
+    painter->save();
+    if (option.state & QStyle::State_Selected) {
+        painter->fillRect(option.rect, kSelectedColor);
+    }
+    QTextLayout layout;
+    layoutRow(&layout, index, option.font, qMax(kMinTextWidth, option.rect.width() - 2 * kPaddingX));
+    painter->setPen(kTextColor);
+    layout.draw(painter, QPointF(option.rect.left() + kPaddingX, option.rect.top() + kPaddingY));
+    painter->restore();
+}
+
+QSize ChatDelegate::sizeHint(const QStyleOptionViewItem &option, const QModelIndex &index) const
+{
+    const int width = qMax(kMinTextWidth, view->viewport()->width() - 2 * kPaddingX);
+    if (width != cachedWidth || heights.size() > kMaxCachedHeights) {
+        heights.clear();
+        cachedWidth = width;
+    }
+
+    const qint64 id = index.data(ChatModel::IdRole).toLongLong();
+    auto it = heights.constFind(id);
+    if (it == heights.cend()) {
+        QTextLayout layout;
+        it = heights.insert(id, layoutRow(&layout, index, option.font, width) + 2 * kPaddingY);
+    }
+    return QSize(width + 2 * kPaddingX, it.value());
+}
+
+void ChatDelegate::clearCache()
+{
+    heights = QHash<qint64, int>();
+    cachedWidth = -1;
+}
+
+int ChatDelegate::layoutRow(QTextLayout *layout, const QModelIndex &index, const QFont &font, int width) const
+{
+    const auto kind = ChatModel::Kind(index.data(ChatModel::KindRole).toInt());
+    QString text;
+    QList<QTextLayout::FormatRange> formats;
+
+    if (kind == ChatModel::System) {
+        text = index.data(ChatModel::TextRole).toString();
+        QTextCharFormat format;
+        format.setForeground(kTimeColor);
+        format.setFontItalic(true);
+        formats.append({0, int(text.size()), format});
+    } else {
+        const QString head = "[" + index.data(ChatModel::TimeRole).toString() + "] ";
+        const QString from = index.data(ChatModel::FromRole).toString() + ": ";
+        text = head + from;
+
+        QTextCharFormat timeFormat;
+        timeFormat.setForeground(kTimeColor);
+        formats.append({0, int(head.size()), timeFormat});
+        QTextCharFormat fromFormat;
+        fromFormat.setForeground(kAccentColor);
+        formats.append({int(head.size()), int(from.size()), fromFormat});
+
+        if (kind == ChatModel::Attachment) {
+            const int start = int(text.size());
+            text += QString("📎 %1 (%2)").arg(index.data(ChatModel::TextRole).toString(),
+                                             ChatModel::formatSize(index.data(ChatModel::SizeRole).toLongLong()));
+            QTextCharFormat linkFormat;
+            linkFormat.setForeground(kAccentColor);
+            linkFormat.setFontUnderline(true);
+            formats.append({start, int(text.size()) - start, linkFormat});
+        } else {
+            text += index.data(ChatModel::TextRole).toString();
+        }
+    }
+    text.replace('\n', QChar::LineSeparator);
+
+    QTextOption textOption;
+    textOption.setWrapMode(QTextOption::WrapAtWordBoundaryOrAnywhere);
+    layout->setText(text);
+    layout->setFont(font);
+    layout->setTextOption(textOption);
+    layout->setFormats(formats);
+
+    qreal height = 0;
+    layout->beginLayout();
+    for (QTextLine line = layout->createLine(); line.isValid(); line = layout->createLine()) {
+        line.setLineWidth(width);
+        line.setPosition(QPointF(0, height));
+        height += line.height();
+    }
+    layout->endLayout();
+    return qCeil(height);
+}
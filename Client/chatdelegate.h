@@ -0,0 +1,31 @@
+#ifndef CHATDELEGATE_H
+#define CHATDELEGATE_H
+
+#include <QStyledItemDelegate>
+#include <QHash>
+
+class QAbstractItemView;
+class QTextLayout;
+
+// 绘制一行聊天记录。行高按视图宽度和消息序号缓存，
+// 视图只对可见行调用 paint，窗口里其余行的布局只在宽度变化时重算。
+class ChatDelegate : public QStyledItemDelegate
+{
+    Q_OBJECT
+public:
+    explicit ChatDelegate(QAbstractItemView *view);
+
+    void paint(QPainter *painter, const QStyleOptionViewItem &option, const QModelIndex &index) const override;
+    QSize sizeHint(const QStyleOptionViewItem &option, const QModelIndex &index) const override;
+    // 丢掉行高缓存，下次绘制时按需重算
+    void clearCache();
+
+private:
+    int layoutRow(QTextLayout *layout, const QModelIndex &index, const QFont &font, int width) const;
+
+    QAbstractItemView *view;
+    mutable QHash<qint64, int> heights;   // 消息序号 -> 行高
+    mutable int cachedWidth = -1;
+};
+
+#endif // CHATDELEGATE_H
@@ -0,0 +1,71 @@
+#ifndef CHATEVENT_H
+#define CHATEVENT_H
+
+#include <QHash>
+#include <QJsonObject>
+#include <QMetaType>
+#include <QString>
+
+// 连接线程解析好的一条服务器消息：类型已从字符串映射成枚举，界面线程直接 switch 分发
+struct ChatEvent
+{
+    enum Type {
+        Other,
+        LoginOk,
+        LoginFail,
+        RoomList,
+        RoomUpdate,
+        CreateRoomOk,
+        CreateRoomFail,
+        JoinRoomOk,
+        JoinRoomFail,
+        Chat,
+        ChatAck,
+        ChatRejected,
+        System,
+        Attachment,
+        RoomClosed,
+        AIReply,
+        Upload,      // upload_ready / upload_challenge / upload_ack / upload_done / upload_fail
+        Download,    // download_granted / download_fail
+        ResendGap,
+        History
+    };
+
+    Type type = Other;
+    QString room;
+    QJsonObject data;   // 完整的消息对象
+
+    static Type typeOf(const QString &name)
+    {
+        static const QHash<QString, Type> types = {
+            {QStringLiteral("login_ok"), LoginOk},
+            {QStringLiteral("login_fail"), LoginFail},
+            {QStringLiteral("room_list"), RoomList},
+            {QStringLiteral("room_update"), RoomUpdate},
+            {QStringLiteral("create_room_ok"), CreateRoomOk},
+            {QStringLiteral("create_room_fail"), CreateRoomFail},
+            {QStringLiteral("join_room_ok"), JoinRoomOk},
+            {QStringLiteral("join_room_fail"), JoinRoomFail},
+            {QStringLiteral("chat"), Chat},
+            {QStringLiteral("chat_ack"), ChatAck},
+            {QStringLiteral("chat_rejected"), ChatRejected},
+            {QStringLiteral("system"), System},
+            {QStringLiteral("attachment"), Attachment},
+            {QStringLiteral("room_closed"), RoomClosed},
+            {QStringLiteral("ai_reply"), AIReply},
+            {QStringLiteral("resend_gap"), ResendGap},
+            {QStringLiteral("history"), History},
+            {QStringLiteral("download_granted"), Download},
+            {QStringLiteral("download_fail"), Download},
+        };
+        if (name.startsWith(QLatin1String("upload_"))) {
+            return Upload;
+        }
+        return types.value(name, Other);
+    }
+};
+
+Q_DECLARE_METATYPE(ChatEvent)
+
+#endif // CHATEVENT_H
@@ -0,0 +1,276 @@
+#include "chatmodel.h"
+
+#include <QDataStream>
+#include <QDir>
+#include <QTemporaryFile>
+
+#include <utility>
+
+namespace {
+// 默认在内存中保留的消息条数
+constexpr int kDefaultWindowRows = 1000;
+constexpr int kMinWindowRows = 100;
+
+void writeEntry(QDataStream &out, const ChatModel::Entry &entry)
+{
+    out << quint8(entry.kind) << entry.time << entry.from << entry.text << entry.hash << entry.size;
+}
+
+void readEntry(QDataStream &in, ChatModel::Entry *entry)
+{
+    quint8 kind = 0;
+    in >> kind >> entry->time >> entry->from >> entry->text >> entry->hash >> entry->size;
+    entry->kind = ChatModel::Kind(kind);
+}
+}
+
+ChatModel::ChatModel(QObject *parent)
+    : QAbstractListModel(parent)
+    , windowRows(kDefaultWindowRows)
+{
+}
+
+int ChatModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : int(entries.size());
+}
+
+QVariant ChatModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= entries.size()) {
+        return QVariant();
+    }
+    const Entry &entry = entries.at(index.row());
+    switch (role) {
+    case Qt::DisplayRole:
+        return plainText(entry);
+    case KindRole:
+        return int(entry.kind);
+    case TimeRole:
+        return entry.time;
+    case FromRole:
+        return entry.from;
+    case TextRole:
+        return entry.text;
+    case HashRole:
+        return entry.hash;
+    case SizeRole:
+        return entry.size;
+    case IdRole:
+        return firstIndex + index.row();
+    default:
+        return QVariant();
+    }
+}
+
+void ChatModel::append(Entry entry)
+{
+    const int row = int(entries.size());
+    beginInsertRows(QModelIndex(), row, row);
+    entries.append(std::move(entry));
+    endInsertRows();
+}
+
+void ChatModel::append(QList<Entry> batch)
+{
+    if (batch.isEmpty()) {
+        return;
+    }
+    const int row = int(entries.size());
+    beginInsertRows(QModelIndex(), row, row + int(batch.size()) - 1);
+    entries.append(std::move(batch));
+    endInsertRows();
+}
+
+void ChatModel::clear()
+{
+    beginResetModel();
+    entries.clear();
+    frozen = QByteArray();
+    frozenRows = 0;
+    hibernated = false;
+    firstIndex = 0;
+    dropSpill();
+    spillBase = 0;
+    endResetModel();
+}
+
+void ChatModel::setWindowSize(int rows)
+{
+    windowRows = qMax(kMinWindowRows, rows);
+}
+
+bool ChatModel::trim()
+{
+    const int excess = int(entries.size()) - windowRows;
+    if (excess <= 0) {
+        return false;
+    }
+    for (int i = 0; i < excess; ++i) {
+        const qint64 index = firstIndex + i;
+        // 读回过的消息已经在文件里，不必重写
+        if (index < spillBase + spillOffsets.size()) {
+            continue;
+        }
+        if (!spill(entries.at(i))) {
+            // 写盘失败就放弃这之前的历史，只保证之后的序号连续
+            dropSpill();
+            spillBase = index + 1;
+        }
+    }
+
+    beginRemoveRows(QModelIndex(), 0, excess - 1);
+    entries.remove(0, excess);
+    firstIndex += excess;
+    endRemoveRows();
+    return true;
+}
+
+int ChatModel::loadOlder(int count)
+{
+    const qint64 from = qMax(spillBase, firstIndex - count);
+    const int n = int(firstIndex - from);
+    if (n <= 0) {
+        return 0;
+    }
+
+    QList<Entry> older;
+    older.reserve(n + entries.size());
+    for (qint64 index = from; index < firstIndex; ++index) {
+        Entry entry;
+        if (!readSpilled(index, &entry)) {
+            dropSpill();
+            spillBase = firstIndex;
+            return 0;
+        }
+        older.append(std::move(entry));
+    }
+
+    beginInsertRows(QModelIndex(), 0, n - 1);
+    older.append(std::move(entries));
+    entries = std::move(older);
+    firstIndex = from;
+    endInsertRows();
+    return n;
+}
+
+void ChatModel::hibernate()
+{
+    if (hibernated) {
+        return;
+    }
+    QByteArray raw;
+    QDataStream out(&raw, QIODevice::WriteOnly);
+    for (const Entry &entry : std::as_const(entries)) {
+        writeEntry(out, entry);
+    }
+    frozen = qCompress(raw);
+    frozenRows = int(entries.size());
+    hibernated = true;
+
+    beginResetModel();
+    // 赋一个新列表才会释放原来的容量
+    entries = QList<Entry>();
+    endResetModel();
+}
+
+void ChatModel::wake()
+{
+    if (!hibernated) {
+        return;
+    }
+    const QByteArray raw = qUncompress(frozen);
+    QList<Entry> restored;
+    restored.reserve(frozenRows);
+    QDataStream in(raw);
+    for (int i = 0; i < frozenRows; ++i) {
+        Entry entry;
+        readEntry(in, &entry);
+        if (in.status() != QDataStream::Ok) {
+            break;
+        }
+        restored.append(std::move(entry));
+    }
+    frozen = QByteArray();
+    frozenRows = 0;
+    hibernated = false;
+
+    beginResetModel();
+    entries = std::move(restored);
+    endResetModel();
+}
+
+qint64 ChatModel::memoryBytes() const
+{
+    qint64 bytes = entries.capacity() * qint64(sizeof(Entry));
+    for (const Entry &entry : entries) {
+        bytes += (entry.time.capacity() + entry.from.capacity() + entry.text.capacity()
+                  + entry.hash.capacity()) * qint64(sizeof(QChar));
+    }
+    return bytes;
+}
+
+QString ChatModel::plainText(const Entry &entry)
+{
+    switch (entry.kind) {
+    case System:
+        return "[系统] " + entry.text;
+    case Attachment:
+        return QString("[%1] %2: [附件] %3 (%4)").arg(entry.time, entry.from, entry.text, formatSize(entry.size));
+    case Message:
+    default:
+        return QString("[%1] %2: %3").arg(entry.time, entry.from, entry.text);
+    }
+}
+
+QString ChatModel::formatSize(qint64 bytes)
+{
+    if (bytes < 1024) {
+        return QString("%1 B").arg(bytes);
+    }
+    if (bytes < 1024 * 1024) {
+        return QString("%1 KB").arg(bytes / 1024.0, 0, 'f', 1);
+    }
+    return QString("%1 MB").arg(bytes / (1024.0 * 1024.0), 0, 'f', 1);
+}
+
+bool ChatModel::spill(const Entry &entry)
+{
+    if (!spillFile) {
+        spillFile = new QTemporaryFile(QDir::temp().filePath("ai-chatroom-XXXXXX.history"), this);
+        if (!spillFile->open()) {
+            delete spillFile;
+            spillFile = nullptr;
+            return false;
+        }
+    }
+    const qint64 offset = spillFile->size();
+    if (!spillFile->seek(offset)) {
+        return false;
+    }
+    QDataStream out(spillFile);
+    writeEntry(out, entry);
+    if (out.status() != QDataStream::Ok) {
+        return false;
+    }
+    spillOffsets.append(offset);
+    return true;
+}
+
+bool ChatModel::readSpilled(qint64 index, Entry *entry)
+{
+    const qint64 slot = index - spillBase;
+    if (!spillFile || slot < 0 || slot >= spillOffsets.size() || !spillFile->seek(spillOffsets.at(slot))) {
+        return false;
+    }
+    QDataStream in(spillFile);
+    readEntry(in, entry);
+    return in.status() == QDataStream::Ok;
+}
+
+void ChatModel::dropSpill()
+{
+    delete spillFile;
+    spillFile = nullptr;
+    spillOffsets.clear();
+}
@@ -0,0 +1,91 @@
+#ifndef CHATMODEL_H
+#define CHATMODEL_H
+
+#include <QAbstractListModel>
+#include <QList>
+
+class QTemporaryFile;
+
+// 聊天记录模型：内存里只保留最近的一段窗口，更早的消息换出到临时文件，
+// 用户翻到顶部时再按需读回。行号之外每条消息还有一个全局序号（IdRole），
+// 换出、读回都不会改变，委托用它缓存行高。
+class ChatModel : public QAbstractListModel
+{
+    Q_OBJECT
+public:
+    enum Kind {
+        Message,
+        System,
+        Attachment
+    };
+
+    enum Roles {
+        KindRole = Qt::UserRole + 1,
+        TimeRole,
+        FromRole,
+        TextRole,   // 消息正文；附件为文件名
+        HashRole,
+        SizeRole,
+        IdRole
+    };
+
+    struct Entry {
+        Kind kind = Message;
+        QString time;
+        QString from;
+        QString text;
+        QString hash;
+        qint64 size = 0;
+    };
+
+    explicit ChatModel(QObject *parent = nullptr);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+
+    void append(Entry entry);
+    // 一次插入多行，只通知视图一次
+    void append(QList<Entry> batch);
+    void clear();
+
+    void setWindowSize(int rows);
+    int windowSize() const { return windowRows; }
+    // 把超出窗口的最早几行换出到磁盘，返回是否有行被移除
+    bool trim();
+    bool hasOlder() const { return firstIndex > spillBase; }
+    // 从磁盘读回最多 count 条更早的消息插到开头，返回读回的条数
+    int loadOlder(int count);
+
+    // 休眠：内存窗口里的消息压缩成一块，视图看到空模型；wake 时解压恢复。
+    // 休眠期间不能插入或读回消息，需要先 wake
+    void hibernate();
+    void wake();
+    bool isHibernated() const { return hibernated; }
+    int hibernatedRows() const { return frozenRows; }
+    qint64 hibernatedBytes() const { return frozen.size(); }
+    // 内存窗口里消息的大致占用
+    qint64 memoryBytes() const;
+
+    static QString plainText(const Entry &entry);
+    static QString formatSize(qint64 bytes);
+
+private:
+    bool spill(const Entry &entry);
+    bool readSpilled(qint64 index, Entry *entry);
+    void dropSpill();
+
+    QList<Entry> entries;
+    qint64 firstIndex = 0;   // entries[0] 的全局序号
+    int windowRows;
+
+    // 临时文件保存序号 [spillBase, spillBase + spillOffsets.size()) 的消息
+    QTemporaryFile *spillFile = nullptr;
+    QList<qint64> spillOffsets;
+    qint64 spillBase = 0;
+
+    QByteArray frozen;       // 休眠时压缩后的内存窗口
+    int frozenRows = 0;
+    bool hibernated = false;
+};
+
+#endif // CHATMODEL_H
@@ -2,10 +2,35 @@
 
 #include <QVBoxLayout>
 #include <QHBoxLayout>
+#include <QScrollBar>
+#include <QTimer>
+
+#include <utility>
+
+#include "chatdelegate.h"
+#include "trace.h"
+
+namespace {
+// 翻到顶部时每次从磁盘读回的消息条数
+constexpr int kLoadOlderRows = 200;
+// 距底部不超过这么多像素时视为停在底部
+constexpr int kTailSlackPx = 4;
+// 合并刷新的间隔，约一帧（60 Hz）
+constexpr int kFrameIntervalMs = 16;
+// 不可见时最多攒这么多条，超过后直接交给模型（由模型换出到磁盘）
+constexpr int kMaxHiddenPending = 1000;
+}
 
 ChatWidget::ChatWidget(QWidget *parent)
     : QWidget(parent)
+    , flushTimer(new QTimer(this))
+    , hibernateTimer(new QTimer(this))
 {
+    flushTimer->setSingleShot(true);
+    flushTimer->setInterval(kFrameIntervalMs);
+    connect(flushTimer, &QTimer::timeout, this, &ChatWidget::flushPending);
+    hibernateTimer->setSingleShot(true);
+    connect(hibernateTimer, &QTimer::timeout, this, &ChatWidget::hibernate);
     setupUI();
 }
 
@@ -21,7 +46,7 @@ void ChatWidget::setupUI()
             font-size: 12pt;
             font-weight: bold;
         }
-        QTextEdit {
+        QListView {
             border: 1px solid #5a5a5a;
             border-radius: 6px;
             background-color: #3c3f41;
@@ -67,9 +92,17 @@ void ChatWidget::setupUI()
     roomLabel = new QLabel("请先加入聊天室", this);
     layout->addWidget(roomLabel);
 
-    chatDisplay = new QTextEdit(this);
-    chatDisplay->setReadOnly(true);
-    layout->addWidget(chatDisplay, 1);
+    // 只绘制可见行，内存中的行数由模型的窗口限制
+    chatModel = new ChatModel(this);
+    chatView = new QListView(this);
+    chatView->setModel(chatModel);
+    chatDelegate = new ChatDelegate(chatView);
+    chatView->setItemDelegate(chatDelegate);
+    chatView->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    chatView->setVerticalScrollMode(QAbstractItemView::ScrollPerPixel);
+    chatView->setHorizontalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
+    chatView->setResizeMode(QListView::Adjust);
+    layout->addWidget(chatView, 1);
 
     auto *inputLayout = new QHBoxLayout();
     messageEdit = new QLineEdit(this);
@@ -77,6 +110,10 @@ void ChatWidget::setupUI()
     messageEdit->setEnabled(false);
     inputLayout->addWidget(messageEdit, 1);
 
+    attachButton = new QPushButton("附件", this);
+    attachButton->setEnabled(false);
+    inputLayout->addWidget(attachButton);
+
     sendButton = new QPushButton("发送", this);
     sendButton->setEnabled(false);
     inputLayout->addWidget(sendButton);
@@ -85,6 +122,9 @@ void ChatWidget::setupUI()
 
     connect(sendButton, &QPushButton::clicked, this, &ChatWidget::onSendClicked);
     connect(messageEdit, &QLineEdit::returnPressed, this, &ChatWidget::onSendClicked);
+    connect(attachButton, &QPushButton::clicked, this, &ChatWidget::attachFileRequested);
+    connect(chatView, &QListView::clicked, this, &ChatWidget::onItemClicked);
+    connect(chatView->verticalScrollBar(), &QScrollBar::valueChanged, this, &ChatWidget::onScrolled);
 }
 
 void ChatWidget::setRoomName(const QString &name)
@@ -94,22 +134,145 @@ void ChatWidget::setRoomName(const QString &name)
 
 void ChatWidget::appendMessage(const QString &from, const QString &message, const QString &time)
 {
-    QString formatted = QString("[%1] %2: %3").arg(time, from, message);
-    chatDisplay->append(formatted);
-    chatHistory += formatted + "\n";
+    TRACE_SCOPE("client.appendMessage");
+    ChatModel::Entry entry;
+    entry.kind = ChatModel::Message;
+    entry.time = time;
+    entry.from = from;
+    entry.text = message;
+    appendEntry(std::move(entry));
 }
 
 void ChatWidget::appendSystemMessage(const QString &message)
 {
-    QString formatted = QString("<i style='color:#888;'>%1</i>").arg(message);
-    chatDisplay->append(formatted);
-    chatHistory += "[系统] " + message + "\n";
+    ChatModel::Entry entry;
+    entry.kind = ChatModel::System;
+    entry.text = message;
+    appendEntry(std::move(entry));
+}
+
+void ChatWidget::appendAttachment(const QString &from, const QString &name, qint64 size,
+                                  const QString &hash, const QString &time)
+{
+    ChatModel::Entry entry;
+    entry.kind = ChatModel::Attachment;
+    entry.time = time;
+    entry.from = from;
+    entry.text = name;
+    entry.hash = hash;
+    entry.size = size;
+    appendEntry(std::move(entry));
+}
+
+void ChatWidget::appendEntries(QList<ChatModel::Entry> entries)
+{
+    pending.append(std::move(entries));
+    scheduleFlush();
+}
+
+void ChatWidget::appendEntry(ChatModel::Entry entry)
+{
+    if (!isVisible() && entry.kind != ChatModel::System) {
+        emit unreadChanged(++unread);
+    }
+    pending.append(std::move(entry));
+    scheduleFlush();
+}
+
+void ChatWidget::scheduleFlush()
+{
+    if (isVisible()) {
+        // 同一帧内到达的消息合并成一次插入和一次重绘
+        if (!flushTimer->isActive()) {
+            flushTimer->start();
+        }
+    } else if (pending.size() >= kMaxHiddenPending) {
+        flushPending();
+    }
+}
+
+void ChatWidget::flushPending()
+{
+    flushTimer->stop();
+    if (pending.isEmpty()) {
+        return;
+    }
+    TRACE_SCOPE("client.flushMessages");
+    // 休眠中的后台标签页积压太多时，解压、合并、裁剪后重新压缩
+    const bool wasHibernated = chatModel->isHibernated();
+    chatModel->wake();
+    chatModel->append(std::exchange(pending, {}));
+    if (followTail || wasHibernated) {
+        chatModel->trim();
+        chatView->scrollToBottom();
+    }
+    if (wasHibernated) {
+        hibernate();
+    }
+}
+
+void ChatWidget::setHibernateAfter(int ms)
+{
+    hibernateTimer->setInterval(ms);
+    if (ms <= 0) {
+        hibernateTimer->stop();
+    } else if (!isVisible()) {
+        hibernateTimer->start();
+    }
+}
+
+void ChatWidget::hibernate()
+{
+    if (isVisible()) {
+        return;
+    }
+    // 窗口之外的行已经换出到磁盘，只压缩保留的窗口
+    chatModel->trim();
+    const qint64 rawBytes = chatModel->memoryBytes();
+    chatModel->hibernate();
+    chatDelegate->clearCache();
+    followTail = true;
+    emit hibernated(chatModel->hibernatedRows(), rawBytes, chatModel->hibernatedBytes());
+}
+
+void ChatWidget::showEvent(QShowEvent *event)
+{
+    QWidget::showEvent(event);
+    hibernateTimer->stop();
+    if (chatModel->isHibernated()) {
+        chatModel->wake();
+        chatView->scrollToBottom();
+        emit woke();
+    }
+    // 切回标签页时在第一次绘制前补上积压的消息
+    flushPending();
+    if (unread > 0) {
+        unread = 0;
+        emit unreadChanged(0);
+    }
+}
+
+void ChatWidget::hideEvent(QHideEvent *event)
+{
+    QWidget::hideEvent(event);
+    if (hibernateTimer->interval() > 0) {
+        hibernateTimer->start();
+    }
+}
+
+void ChatWidget::setHistoryWindow(int rows)
+{
+    chatModel->setWindowSize(rows);
+    if (followTail) {
+        chatModel->trim();
+    }
 }
 
 void ChatWidget::setEnabled(bool enabled)
 {
     messageEdit->setEnabled(enabled);
     sendButton->setEnabled(enabled);
+    attachButton->setEnabled(enabled);
     if (enabled) {
         messageEdit->setFocus();
     }
@@ -117,16 +280,14 @@ void ChatWidget::setEnabled(bool enabled)
 
 void ChatWidget::clear()
 {
-    chatDisplay->clear();
-    chatHistory.clear();
+    flushTimer->stop();
+    pending.clear();
+    unread = 0;
+    chatModel->clear();
+    followTail = true;
     roomLabel->setText("请先加入聊天室");
 }
 
-QString ChatWidget::getChatHistory() const
-{
-    return chatHistory;
-}
-
 void ChatWidget::onSendClicked()
 {
     QString msg = messageEdit->text().trimmed();
@@ -136,3 +297,31 @@ void ChatWidget::onSendClicked()
         messageEdit->setFocus();
     }
 }
+
+void ChatWidget::onItemClicked(const QModelIndex &index)
+{
+    if (index.data(ChatModel::KindRole).toInt() == ChatModel::Attachment) {
+        emit attachmentClicked(index.data(ChatModel::HashRole).toString(), index.data(ChatModel::TextRole).toString());
+    }
+}
+
+void ChatWidget::onScrolled(int value)
+{
+    if (loadingOlder) {
+        return;
+    }
+    QScrollBar *bar = chatView->verticalScrollBar();
+    followTail = value >= bar->maximum() - kTailSlackPx;
+    if (followTail) {
+        // 回到底部后把翻看时读回的旧消息重新换出
+        if (chatModel->trim()) {
+            chatView->scrollToBottom();
+        }
+    } else if (value == bar->minimum() && chatModel->hasOlder()) {
+        loadingOlder = true;
+        const int loaded = chatModel->loadOlder(kLoadOlderRows);
+        // 保持原来顶部那条消息的位置，否则会连续触发读回
+        chatView->scrollTo(chatModel->index(loaded), QAbstractItemView::PositionAtTop);
+        loadingOlder = false;
+    }
+}
@@ -2,11 +2,16 @@
 #define CHATWIDGET_H
 
 #include <QWidget>
-#include <QTextEdit>
+#include <QListView>
 #include <QLineEdit>
 #include <QPushButton>
 #include <QLabel>
 
+#include "chatmodel.h"
+
+class ChatDelegate;
+class QTimer;
+
 class ChatWidget : public QWidget
 {
     Q_OBJECT
@@ -16,24 +21,60 @@ public:
     void setRoomName(const QString &name);
     void appendMessage(const QString &from, const QString &message, const QString &time);
     void appendSystemMessage(const QString &message);
+    void appendAttachment(const QString &from, const QString &name, qint64 size,
+                          const QString &hash, const QString &time);
+    // 本地缓存或服务器补发的一批消息
+    void appendEntries(QList<ChatModel::Entry> entries);
     void setEnabled(bool enabled);
     void clear();
-    QString getChatHistory() const;
+    // 内存中保留的消息条数，更早的换出到磁盘
+    void setHistoryWindow(int rows);
+    int unreadCount() const { return unread; }
+    // 不可见超过 ms 毫秒后自动休眠，0 表示不休眠
+    void setHibernateAfter(int ms);
+    // 释放渲染缓存，内存窗口里的消息压缩保存；再次显示时恢复
+    void hibernate();
+    bool isHibernated() const { return chatModel->isHibernated(); }
 
 signals:
     void sendMessageRequested(const QString &message);
+    void attachFileRequested();
+    void attachmentClicked(const QString &hash, const QString &name);
+    // 不可见时收到的消息条数，重新显示后归零
+    void unreadChanged(int count);
+    // 休眠后内存窗口的条数、原占用和压缩后的大小
+    void hibernated(int rows, qint64 rawBytes, qint64 compressedBytes);
+    void woke();
+
+protected:
+    void showEvent(QShowEvent *event) override;
+    void hideEvent(QHideEvent *event) override;
 
 private slots:
     void onSendClicked();
+    void onItemClicked(const QModelIndex &index);
+    void onScrolled(int value);
 
 private:
     void setupUI();
+    void appendEntry(ChatModel::Entry entry);
+    void scheduleFlush();
+    void flushPending();
 
     QLabel *roomLabel;
-    QTextEdit *chatDisplay;
+    QListView *chatView;
+    ChatModel *chatModel;
+    ChatDelegate *chatDelegate;
     QLineEdit *messageEdit;
     QPushButton *sendButton;
-    QString chatHistory;
+    QPushButton *attachButton;
+    // 收到的消息先攒在这里，每帧最多插入模型一次；不可见时等到重新显示
+    QList<ChatModel::Entry> pending;
+    QTimer *flushTimer;
+    int unread = 0;
+    QTimer *hibernateTimer;
+    bool followTail = true;   // 停在底部时新消息自动滚动并换出旧消息
+    bool loadingOlder = false;
 };
 
 #endif // CHATWIDGET_H
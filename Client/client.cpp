@@ -1,17 +1,36 @@
 //made by kevinwu06
 #include "client.h"
 #include "ui_client.h"
+#include "roomlistmodel.h"
 
 #include <QJsonArray>
 #include <QJsonDocument>
 #include <QJsonObject>
 #include <QJsonParseError>
 
+namespace {
+// 房间列表页中的每一项是 {name, members}
+QStringList pageRoomNames(const QJsonObject &page)
+{
+    QStringList rooms;
+    const QJsonArray arr = page.value("rooms").toArray();
+    for (const QJsonValue &val : arr) {
+        rooms.append(val.toObject().value("name").toString());
+    }
+    return rooms;
+}
+}
+
 Client::Client(QWidget *parent)
     : QWidget(parent)
     , ui(new Ui::Client)
+    , roomModel(new RoomListModel(this))
 {
     ui->setupUi(this);
+    // 房间列表更新时只增删变化的项，不打断当前选择
+    ui->roomCombo->setModel(roomModel);
+    ui->roomCombo->setPlaceholderText("请选择聊天室");
+    ui->roomCombo->setCurrentIndex(-1);
     this->setWindowTitle("DuckChat客户端");
     ui->receive->setText(text);
 
@@ -26,6 +45,8 @@ Client::Client(QWidget *parent)
     connect(ui->joinButton, SIGNAL(clicked()), this, SLOT(on_joinButton_clicked()));
     connect(ui->createRoomButton, SIGNAL(clicked()), this, SLOT(on_createRoomButton_clicked()));
     connect(&socket, SIGNAL(readyRead()), this, SLOT(receiveData()));
+    connect(&socket, SIGNAL(connected()), this, SLOT(onConnected()));
+    connect(&socket, SIGNAL(errorOccurred(QAbstractSocket::SocketError)), this, SLOT(onSocketError()));
 
     ui->loginButton->setEnabled(false);
     ui->joinButton->setEnabled(false);
@@ -60,13 +81,25 @@ void Client::receiveData()
 
 void Client::on_connectButton_clicked()
 {
+    // 异步连接，结果由 connected / errorOccurred 信号通知，不阻塞界面
+    if (socket.state() != QAbstractSocket::UnconnectedState) {
+        return;
+    }
     socket.connectToHost(ui->ip->text(), ui->port->text().toInt());
-    if (socket.waitForConnected(1000)) {
-        connected = true;
-        appendSystemMessage("成功连接服务器...");
-        ui->loginButton->setEnabled(true);
-        ui->accountEdit->setFocus();
-    } else {
+}
+
+void Client::onConnected()
+{
+    connected = true;
+    appendSystemMessage("成功连接服务器...");
+    ui->loginButton->setEnabled(true);
+    ui->accountEdit->setFocus();
+}
+
+void Client::onSocketError()
+{
+    if (!connected) {
+        socket.abort();
         appendSystemMessage("连接失败...");
     }
 }
@@ -185,6 +218,8 @@ void Client::handleMessage(const QJsonObject &obj)
         appendSystemMessage(obj.value("message").toString());
         ui->joinButton->setEnabled(true);
         ui->createRoomButton->setEnabled(true);
+        // 登录成功时带回房间列表的第一页
+        updateRoomList(pageRoomNames(obj));
         return;
     }
     if (type == "login_fail") {
@@ -193,9 +228,15 @@ void Client::handleMessage(const QJsonObject &obj)
         return;
     }
     if (type == "room_list") {
-        QStringList rooms;
-        const QJsonArray arr = obj.value("rooms").toArray();
-        for (const QJsonValue &val : arr) {
+        updateRoomList(pageRoomNames(obj));
+        return;
+    }
+    if (type == "room_update") {
+        QStringList rooms = roomModel->rooms();
+        for (const QJsonValue &val : obj.value("removed").toArray()) {
+            rooms.removeAll(val.toString());
+        }
+        for (const QJsonValue &val : obj.value("added").toArray()) {
             rooms.append(val.toString());
         }
         updateRoomList(rooms);
@@ -237,11 +278,7 @@ void Client::handleMessage(const QJsonObject &obj)
 
 void Client::updateRoomList(const QStringList &rooms)
 {
-    ui->roomCombo->clear();
-    ui->roomCombo->addItem("请选择聊天室");
-    for (const QString &room : rooms) {
-        ui->roomCombo->addItem(room);
-    }
+    roomModel->setRooms(rooms);
 }
 
 void Client::setChatEnabled(bool enabled)
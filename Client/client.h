@@ -12,6 +12,8 @@ QT_BEGIN_NAMESPACE
 namespace Ui { class Client; }
 QT_END_NAMESPACE
 
+class RoomListModel;
+
 class Client : public QWidget
 {
     Q_OBJECT
@@ -22,6 +24,8 @@ public:
 private slots:
     void receiveData();
     void on_connectButton_clicked();
+    void onConnected();
+    void onSocketError();
     void on_loginButton_clicked();
     void on_joinButton_clicked();
     void on_createRoomButton_clicked();
@@ -36,6 +40,7 @@ private:
 
     QTcpSocket socket;
     Ui::Client *ui;
+    RoomListModel *roomModel;
     QString text;
     QByteArray buffer;
     QString currentRoom;
@@ -0,0 +1,288 @@
+#include "connectionworker.h"
+#include "trace.h"
+
+#include <QJsonDocument>
+#include <QJsonParseError>
+#include <QRandomGenerator>
+#include <QSslPreSharedKeyAuthenticator>
+#include <QSslSocket>
+#include <QTimer>
+
+namespace {
+// 建连超时，超时后按失败处理
+constexpr int kConnectTimeoutMs = 5000;
+// 重连退避：首次约 0.5 s，每次翻倍，最长 30 s
+constexpr int kInitialRetryMs = 500;
+constexpr int kMaxRetryMs = 30000;
+// 界面线程来不及处理时，积压到这么多条就暂停读 socket
+constexpr int kMaxQueuedEvents = 5000;
+// socket 内部读缓冲的上限，暂停读取后剩余数据留在内核缓冲里
+constexpr qint64 kReadBufferBytes = 1024 * 1024;
+}
+
+ConnectionWorker::ConnectionWorker(QObject *parent)
+    : QObject(parent)
+    , socket(new QSslSocket(this))
+    , connectTimer(new QTimer(this))
+    , retryTimer(new QTimer(this))
+{
+    socket->setReadBufferSize(kReadBufferBytes);
+    connectTimer->setSingleShot(true);
+    connectTimer->setInterval(kConnectTimeoutMs);
+    retryTimer->setSingleShot(true);
+
+    // 加密连接要等握手完成才算连上
+    connect(socket, &QSslSocket::connected, this, [this]() {
+        if (tls) {
+            handshaking = true;
+        } else {
+            onConnected();
+        }
+    });
+    connect(socket, &QSslSocket::encrypted, this, &ConnectionWorker::onConnected);
+    connect(socket, &QSslSocket::preSharedKeyAuthenticationRequired, this,
+            [this](QSslPreSharedKeyAuthenticator *authenticator) {
+        ticket.answer(authenticator);
+        ticket = TlsTicket();
+    });
+    connect(socket, &QSslSocket::disconnected, this, &ConnectionWorker::onDisconnected);
+    connect(socket, &QSslSocket::errorOccurred, this, &ConnectionWorker::onSocketError);
+    connect(socket, &QSslSocket::readyRead, this, &ConnectionWorker::onReadyRead);
+    connect(connectTimer, &QTimer::timeout, this, [this]() {
+        socket->abort();
+        connectionLost("连接超时");
+    });
+    connect(retryTimer, &QTimer::timeout, this, &ConnectionWorker::startConnect);
+}
+
+void ConnectionWorker::connectToServer(const QString &serverHost, quint16 serverPort)
+{
+    host = serverHost;
+    port = serverPort;
+    attempt = 0;
+    // 票据只对签发它的服务器有效
+    ticket = TlsTicket();
+    retryTimer->stop();
+    startConnect();
+}
+
+void ConnectionWorker::setTls(bool enabled, const QSslConfiguration &configuration)
+{
+    tls = enabled;
+    tlsConfiguration = configuration;
+    ticket = TlsTicket();
+}
+
+void ConnectionWorker::disconnectFromServer()
+{
+    autoReconnect = false;
+    retryTimer->stop();
+    connectTimer->stop();
+    setState(ChatConnection::Disconnected);
+    socket->disconnectFromHost();
+}
+
+void ConnectionWorker::login(const QString &account, const QString &password, const QString &name)
+{
+    credentials = QJsonObject();
+    credentials["type"] = "login";
+    credentials["account"] = account;
+    credentials["password"] = password;
+    credentials["name"] = name;
+    autoLogin = false;
+    send(credentials);
+}
+
+void ConnectionWorker::reconnectNow()
+{
+    if (currentState == ChatConnection::Backoff) {
+        retryTimer->stop();
+        startConnect();
+    }
+}
+
+bool ConnectionWorker::canWrite() const
+{
+    return currentState == ChatConnection::Connected || currentState == ChatConnection::Online;
+}
+
+void ConnectionWorker::send(const QJsonObject &obj)
+{
+    if (canWrite()) {
+        socket->write(encode(obj));
+    }
+}
+
+void ConnectionWorker::sendBatch(const QList<QJsonObject> &objs)
+{
+    if (!canWrite()) {
+        return;
+    }
+    QByteArray data;
+    for (const QJsonObject &obj : objs) {
+        data += encode(obj);
+    }
+    if (!data.isEmpty()) {
+        socket->write(data);
+    }
+}
+
+QByteArray ConnectionWorker::encode(const QJsonObject &obj)
+{
+    QByteArray data = QJsonDocument(obj).toJson(QJsonDocument::Compact);
+    data.append('\n');
+    return data;
+}
+
+void ConnectionWorker::setState(ChatConnection::State state)
+{
+    if (currentState != state) {
+        currentState = state;
+        emit stateChanged(state);
+    }
+}
+
+void ConnectionWorker::startConnect()
+{
+    // 上一次连接残留的半帧不能拼到新连接的数据前面
+    socket->abort();
+    fallback = false;
+    handshaking = false;
+    buffer.clear();
+    setState(ChatConnection::Connecting);
+    connectTimer->start();
+    if (!tls) {
+        socket->connectToHost(host, port);
+        return;
+    }
+    // 有票据时用 PSK 握手重连，省掉证书传输、校验和签名
+    resuming = ticket.isValid() && !TlsTicket::pskCiphers().isEmpty();
+    socket->setSslConfiguration(resuming ? TlsTicket::resumeConfiguration(tlsConfiguration) : tlsConfiguration);
+    socket->connectToHostEncrypted(host, port);
+}
+
+void ConnectionWorker::onConnected()
+{
+    handshaking = false;
+    connectTimer->stop();
+    socket->setSocketOption(QAbstractSocket::KeepAliveOption, 1);
+    setState(ChatConnection::Connected);
+    // 重连成功后用原来的凭据重新登录，结果在 onReadyRead 里处理
+    if (autoReconnect && !credentials.isEmpty()) {
+        autoLogin = true;
+        socket->write(encode(credentials));
+    }
+}
+
+void ConnectionWorker::onDisconnected()
+{
+    connectionLost("与服务器的连接已断开");
+}
+
+void ConnectionWorker::onSocketError(QAbstractSocket::SocketError error)
+{
+    // 正常关闭随后会触发 disconnected，统一在那里处理
+    if (error == QAbstractSocket::RemoteHostClosedError && currentState != ChatConnection::Connecting) {
+        return;
+    }
+    connectionLost(socket->errorString());
+}
+
+void ConnectionWorker::connectionLost(const QString &reason)
+{
+    // 同一次断线会先后收到 errorOccurred 和 disconnected，只处理一次
+    if (fallback || currentState == ChatConnection::Disconnected || currentState == ChatConnection::Backoff) {
+        return;
+    }
+    connectTimer->stop();
+    if (resuming && handshaking && currentState == ChatConnection::Connecting) {
+        // 票据被拒（过期、服务器重启或连到了另一个 worker），不计入退避，马上改走证书握手
+        resuming = false;
+        ticket = TlsTicket();
+        fallback = true;
+        retryTimer->start(0);
+        return;
+    }
+    if (!autoReconnect) {
+        setState(ChatConnection::Disconnected);
+        emit errorOccurred(reason);
+        return;
+    }
+
+    // 抖动取退避上限的后一半，避免大量客户端在服务器恢复时同时重连
+    const int ceiling = qMin(kMaxRetryMs, kInitialRetryMs << qMin(attempt, 16));
+    const int delay = ceiling / 2 + int(QRandomGenerator::global()->bounded(ceiling / 2 + 1));
+    ++attempt;
+    setState(ChatConnection::Backoff);
+    emit errorOccurred(reason);
+    emit reconnectScheduled(attempt, delay);
+    retryTimer->start(delay);
+}
+
+void ConnectionWorker::onReadyRead()
+{
+    TRACE_SCOPE("client.onSocketReadyRead");
+    // 界面线程积压太多时先不读，等 takeMore 再继续
+    if (queued.size() >= kMaxQueuedEvents) {
+        return;
+    }
+    buffer.append(socket->readAll());
+    QByteArray line;
+    bool valid = false;
+    while (buffer.next(&line, &valid)) {
+        // 编码不合法的帧直接丢弃
+        if (!valid || line.trimmed().isEmpty()) continue;
+
+        QJsonParseError err;
+        QJsonDocument doc = QJsonDocument::fromJson(line, &err);
+        if (err.error != QJsonParseError::NoError || !doc.isObject()) {
+            continue;
+        }
+        ChatEvent event;
+        event.data = doc.object();
+        if (event.data.value("type").toString() == QLatin1String("tls_ticket")) {
+            // 只有连接层用得到，不交给界面线程
+            ticket = TlsTicket::fromJson(event.data);
+            continue;
+        }
+        event.type = ChatEvent::typeOf(event.data.value("type").toString());
+        event.room = event.data.value("room").toString();
+        if (event.type == ChatEvent::LoginOk) {
+            attempt = 0;
+            autoReconnect = true;
+            autoLogin = false;
+            setState(ChatConnection::Online);
+        } else if (event.type == ChatEvent::LoginFail) {
+            credentials = QJsonObject();
+            if (autoLogin) {
+                // 凭据已失效，继续重连也没有意义
+                autoLogin = false;
+                emit errorOccurred("自动登录失败: " + event.data.value("message").toString());
+                disconnectFromServer();
+            }
+        }
+        queued.append(std::move(event));
+    }
+    flushEvents();
+}
+
+void ConnectionWorker::flushEvents()
+{
+    // 同一时间只有一批在界面线程的事件队列里，其余的在这里合并成下一批
+    if (batchInFlight || queued.isEmpty()) {
+        return;
+    }
+    batchInFlight = true;
+    emit eventsReady(queued);
+    queued.clear();
+}
+
+void ConnectionWorker::takeMore()
+{
+    batchInFlight = false;
+    flushEvents();
+    // 之前因积压暂停了读取，补读 socket 缓冲里剩下的数据
+    if (queued.size() < kMaxQueuedEvents && socket->bytesAvailable() > 0) {
+        onReadyRead();
+    }
+}
@@ -0,0 +1,81 @@
+#ifndef CONNECTIONWORKER_H
+#define CONNECTIONWORKER_H
+
+#include <QObject>
+#include <QAbstractSocket>
+#include <QJsonObject>
+#include <QList>
+#include <QSslConfiguration>
+
+#include "chatconnection.h"
+#include "chatevent.h"
+#include "framescanner.h"
+#include "tlsticket.h"
+
+class QSslSocket;
+class QTimer;
+
+// ChatConnection 在连接线程上的实际实现：socket 读写、分帧、JSON 解析、重连状态机。
+// 解析好的消息攒成一批发给界面线程；上一批处理完（takeMore）之前不发下一批，
+// 积压过多时暂停读 socket，由 TCP 窗口把压力传回服务器。
+class ConnectionWorker : public QObject
+{
+    Q_OBJECT
+public:
+    explicit ConnectionWorker(QObject *parent = nullptr);
+
+public slots:
+    void connectToServer(const QString &host, quint16 port);
+    void setTls(bool enabled, const QSslConfiguration &configuration);
+    void disconnectFromServer();
+    void login(const QString &account, const QString &password, const QString &name);
+    void reconnectNow();
+    void send(const QJsonObject &obj);
+    void sendBatch(const QList<QJsonObject> &objs);
+    // 界面线程处理完上一批后调用
+    void takeMore();
+
+signals:
+    void stateChanged(ChatConnection::State state);
+    void eventsReady(const QList<ChatEvent> &events);
+    void errorOccurred(const QString &message);
+    void reconnectScheduled(int attempt, int delayMs);
+
+private slots:
+    void onConnected();
+    void onDisconnected();
+    void onSocketError(QAbstractSocket::SocketError error);
+    void onReadyRead();
+
+private:
+    void setState(ChatConnection::State state);
+    void startConnect();
+    void connectionLost(const QString &reason);
+    void flushEvents();
+    bool canWrite() const;
+    static QByteArray encode(const QJsonObject &obj);
+
+    QSslSocket *socket;
+    QTimer *connectTimer;
+    QTimer *retryTimer;
+    FrameScanner buffer;
+    ChatConnection::State currentState = ChatConnection::Disconnected;
+    QString host;
+    quint16 port = 0;
+    QJsonObject credentials;     // 最近一次登录请求，重连时原样发送
+    bool autoReconnect = false;  // 登录成功后才开启
+    bool autoLogin = false;      // 当前的登录请求是重连时自动发的
+    int attempt = 0;             // 连续重连失败的次数
+
+    bool tls = false;
+    QSslConfiguration tlsConfiguration;
+    TlsTicket ticket;            // 服务器下发的重连票据，用一次就作废
+    bool resuming = false;       // 本次连接在用票据做 PSK 握手
+    bool handshaking = false;    // TCP 已连上，TLS 握手未完成
+    bool fallback = false;       // 票据被拒，正在改走证书握手
+
+    QList<ChatEvent> queued;     // 还没交给界面线程的消息
+    bool batchInFlight = false;
+};
+
+#endif // CONNECTIONWORKER_H
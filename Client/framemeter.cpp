@@ -0,0 +1,68 @@
+#include "framemeter.h"
+
+#include <QTimer>
+
+#include <algorithm>
+
+namespace {
+constexpr int kFrameIntervalMs = 16;
+}
+
+FrameMeter::FrameMeter(QObject *parent)
+    : QObject(parent)
+    , timer(new QTimer(this))
+{
+    timer->setTimerType(Qt::PreciseTimer);
+    timer->setInterval(kFrameIntervalMs);
+    connect(timer, &QTimer::timeout, this, &FrameMeter::onTick);
+}
+
+void FrameMeter::start()
+{
+    intervalsNs.clear();
+    lastNs = -1;
+    clock.start();
+    timer->start();
+}
+
+void FrameMeter::stop()
+{
+    timer->stop();
+}
+
+bool FrameMeter::isRunning() const
+{
+    return timer->isActive();
+}
+
+void FrameMeter::onTick()
+{
+    const qint64 now = clock.nsecsElapsed();
+    if (lastNs >= 0) {
+        intervalsNs.append(now - lastNs);
+    }
+    lastNs = now;
+}
+
+FrameMeter::Summary FrameMeter::summary() const
+{
+    Summary result;
+    if (intervalsNs.isEmpty()) {
+        return result;
+    }
+    QList<qint64> sorted = intervalsNs;
+    std::sort(sorted.begin(), sorted.end());
+    auto percentile = [&sorted](double p) {
+        const qsizetype index = qMin(sorted.size() - 1, qsizetype(p * sorted.size()));
+        return sorted.at(index) / 1e6;
+    };
+    result.frames = int(sorted.size());
+    result.p50Ms = percentile(0.50);
+    result.p95Ms = percentile(0.95);
+    result.p99Ms = percentile(0.99);
+    result.maxMs = sorted.last() / 1e6;
+    result.slowFrames = int(std::count_if(sorted.begin(), sorted.end(), [](qint64 ns) {
+        return ns > 2 * kFrameIntervalMs * 1000000LL;
+    }));
+    return result;
+}
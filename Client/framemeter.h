@@ -0,0 +1,41 @@
+#ifndef FRAMEMETER_H
+#define FRAMEMETER_H
+
+#include <QObject>
+#include <QElapsedTimer>
+#include <QList>
+
+class QTimer;
+
+// 界面帧时间测量：运行期间每帧（约 16 ms）请求一次计时回调，
+// 相邻两次回调的实际间隔就是界面线程一帧的耗时，被消息处理或重绘卡住时会变长。
+class FrameMeter : public QObject
+{
+    Q_OBJECT
+public:
+    struct Summary {
+        int frames = 0;
+        double p50Ms = 0;
+        double p95Ms = 0;
+        double p99Ms = 0;
+        double maxMs = 0;
+        int slowFrames = 0;   // 超过两帧时间的次数
+    };
+
+    explicit FrameMeter(QObject *parent = nullptr);
+
+    void start();
+    void stop();
+    bool isRunning() const;
+    Summary summary() const;
+
+private:
+    void onTick();
+
+    QTimer *timer;
+    QElapsedTimer clock;
+    qint64 lastNs = -1;
+    QList<qint64> intervalsNs;
+};
+
+#endif // FRAMEMETER_H
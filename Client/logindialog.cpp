@@ -1,26 +1,65 @@
 #include "logindialog.h"
 
-#include <QJsonDocument>
 #include <QJsonObject>
 #include <QJsonArray>
-#include <QJsonParseError>
 #include <QMessageBox>
 #include <QHBoxLayout>
 #include <QFormLayout>
 #include <QGroupBox>
+#include <QCoreApplication>
+#include <QDir>
+#include <QFile>
+#include <QSslCertificate>
+#include <QSslSocket>
+#include <QTextStream>
+
+namespace {
+// config/api.conf 中的 TLS_CA_FILE：服务器使用自签名证书时信任的 CA 证书（PEM），相对路径按 config 目录解析
+bool loadTlsConfiguration(QSslConfiguration *configuration, QString *error)
+{
+    *configuration = QSslConfiguration::defaultConfiguration();
+    const QDir configDir(QDir(QCoreApplication::applicationDirPath()).filePath("config"));
+    QFile file(configDir.filePath("api.conf"));
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        return true;
+    }
+    QString caPath;
+    QTextStream in(&file);
+    while (!in.atEnd()) {
+        const QString line = in.readLine().trimmed();
+        if (line.startsWith("TLS_CA_FILE=")) {
+            caPath = line.mid(12).trimmed();
+        }
+    }
+    if (caPath.isEmpty()) {
+        return true;
+    }
+    const QList<QSslCertificate> certificates = QSslCertificate::fromPath(configDir.absoluteFilePath(caPath));
+    if (certificates.isEmpty()) {
+        *error = "无法读取 CA 证书 " + caPath;
+        return false;
+    }
+    configuration->addCaCertificates(certificates);
+    return true;
+}
+}
 
 LoginDialog::LoginDialog(QWidget *parent)
     : QDialog(parent)
-    , socket(new QTcpSocket(this))
+    , connection(new ChatConnection(this))
 {
     setupUI();
-    connect(socket, &QTcpSocket::readyRead, this, &LoginDialog::onSocketReadyRead);
+    connect(connection, &ChatConnection::eventReceived, this, &LoginDialog::handleEvent);
+    connect(connection, &ChatConnection::stateChanged, this, &LoginDialog::onConnectionStateChanged);
+    connect(connection, &ChatConnection::errorOccurred, this, [this](const QString &message) {
+        statusLabel->setText("连接失败，请检查服务器（" + message + "）");
+    });
 }
 
 void LoginDialog::setupUI()
 {
     setWindowTitle("AI-ChatRoom - 登录");
-    setFixedSize(360, 320);
+    setFixedSize(360, 350);
     setStyleSheet(R"(
         QDialog {
             background-color: #2b2d30;
@@ -79,7 +118,8 @@ void LoginDialog::setupUI()
 
     // 服务器连接区域
     auto *serverGroup = new QGroupBox("服务器连接", this);
-    auto *serverLayout = new QHBoxLayout(serverGroup);
+    auto *serverGroupLayout = new QVBoxLayout(serverGroup);
+    auto *serverLayout = new QHBoxLayout();
     ipEdit = new QLineEdit(this);
     ipEdit->setPlaceholderText("服务器IP");
     ipEdit->setText("127.0.0.1");
@@ -91,6 +131,11 @@ void LoginDialog::setupUI()
     serverLayout->addWidget(ipEdit);
     serverLayout->addWidget(portEdit);
     serverLayout->addWidget(connectButton);
+    serverGroupLayout->addLayout(serverLayout);
+    tlsCheck = new QCheckBox("加密连接 (TLS)", this);
+    tlsCheck->setStyleSheet("color: #d0d0d0;");
+    tlsCheck->setEnabled(QSslSocket::supportsSsl());
+    serverGroupLayout->addWidget(tlsCheck);
     mainLayout->addWidget(serverGroup);
 
     // 登录区域
@@ -124,21 +169,44 @@ void LoginDialog::setupUI()
 
 void LoginDialog::onConnectClicked()
 {
-    socket->connectToHost(ipEdit->text(), portEdit->text().toInt());
-    if (socket->waitForConnected(2000)) {
-        connected = true;
+    QSslConfiguration configuration;
+    if (tlsCheck->isChecked()) {
+        QString error;
+        if (!loadTlsConfiguration(&configuration, &error)) {
+            statusLabel->setText(error);
+            return;
+        }
+    }
+    connection->setTls(tlsCheck->isChecked(), configuration);
+    // 异步建连，结果在 onConnectionStateChanged 里处理
+    connection->connectToServer(ipEdit->text(), quint16(portEdit->text().toUInt()));
+}
+
+void LoginDialog::onConnectionStateChanged(ChatConnection::State state)
+{
+    switch (state) {
+    case ChatConnection::Connecting:
+        statusLabel->setText("正在连接服务器...");
+        connectButton->setEnabled(false);
+        loginButton->setEnabled(false);
+        break;
+    case ChatConnection::Connected:
         statusLabel->setText("已连接服务器，请登录");
         loginButton->setEnabled(true);
         accountEdit->setFocus();
-        connectButton->setEnabled(false);
-    } else {
-        statusLabel->setText("连接失败，请检查服务器");
+        break;
+    case ChatConnection::Disconnected:
+        connectButton->setEnabled(true);
+        loginButton->setEnabled(false);
+        break;
+    default:
+        break;
     }
 }
 
 void LoginDialog::onLoginClicked()
 {
-    if (!connected) {
+    if (connection->state() != ChatConnection::Connected) {
         statusLabel->setText("请先连接服务器");
         return;
     }
@@ -149,63 +217,28 @@ void LoginDialog::onLoginClicked()
         return;
     }
 
-    QJsonObject obj;
-    obj["type"] = "login";
-    obj["account"] = account;
-    obj["password"] = password;
-    obj["name"] = nicknameEdit->text().trimmed().isEmpty() ? account : nicknameEdit->text().trimmed();
-    sendJson(obj);
+    connection->login(account, password, getNickname());
     statusLabel->setText("登录中...");
 }
 
-void LoginDialog::onSocketReadyRead()
-{
-    buffer.append(socket->readAll());
-    while (true) {
-        int idx = buffer.indexOf('\n');
-        if (idx < 0) break;
-        QByteArray line = buffer.left(idx);
-        buffer.remove(0, idx + 1);
-        if (line.trimmed().isEmpty()) continue;
-
-        QJsonParseError err;
-        QJsonDocument doc = QJsonDocument::fromJson(line, &err);
-        if (err.error == QJsonParseError::NoError && doc.isObject()) {
-            handleMessage(doc.object());
-        }
-    }
-}
-
-void LoginDialog::handleMessage(const QJsonObject &obj)
+void LoginDialog::handleEvent(const ChatEvent &event)
 {
-    QString type = obj.value("type").toString();
-    if (type == "login_ok") {
+    const QJsonObject &obj = event.data;
+    if (event.type == ChatEvent::LoginOk) {
         loginSuccess = true;
+        aiGateway = obj.value("ai_gateway").toBool();
         QString nickname = obj.value("name").toString();
         emit loginSuccessful(accountEdit->text().trimmed(), nickname);
-        // 不立即关闭，等待接收room_list
-        statusLabel->setText("正在加载聊天室列表...");
-    } else if (type == "login_fail") {
-        statusLabel->setText(obj.value("message").toString());
-    } else if (type == "room_list" && loginSuccess) {
-        // 接收到房间列表后才关闭对话框
-        const QJsonArray arr = obj.value("rooms").toArray();
-        roomList.clear();
-        for (const QJsonValue &val : arr) {
-            roomList.append(val.toString());
-        }
+        // login_ok 已带回房间列表的第一页，不必再等 room_list
+        roomPage = obj;
+        // 之后到达的消息留给主窗口，主窗口接好信号后再继续分发
+        connection->suspendDelivery();
         accept();
+    } else if (event.type == ChatEvent::LoginFail) {
+        statusLabel->setText(obj.value("message").toString());
     }
 }
 
-void LoginDialog::sendJson(const QJsonObject &obj)
-{
-    QJsonDocument doc(obj);
-    QByteArray data = doc.toJson(QJsonDocument::Compact);
-    data.append('\n');
-    socket->write(data);
-}
-
 QString LoginDialog::getAccount() const { return accountEdit->text().trimmed(); }
 QString LoginDialog::getPassword() const { return passwordEdit->text(); }
 QString LoginDialog::getNickname() const { 
@@ -213,5 +246,6 @@ QString LoginDialog::getNickname() const {
 }
 QString LoginDialog::getServerIp() const { return ipEdit->text(); }
 int LoginDialog::getServerPort() const { return portEdit->text().toInt(); }
-QTcpSocket* LoginDialog::getSocket() { return socket; }
-QStringList LoginDialog::getRoomList() const { return roomList; }
+ChatConnection* LoginDialog::getConnection() { return connection; }
+QJsonObject LoginDialog::getRoomPage() const { return roomPage; }
+bool LoginDialog::hasAIGateway() const { return aiGateway; }
@@ -2,13 +2,15 @@
 #define LOGINDIALOG_H
 
 #include <QDialog>
+#include <QCheckBox>
 #include <QLineEdit>
 #include <QPushButton>
 #include <QVBoxLayout>
 #include <QLabel>
-#include <QTcpSocket>
 #include <QJsonObject>
 
+#include "chatconnection.h"
+
 class LoginDialog : public QDialog
 {
     Q_OBJECT
@@ -20,8 +22,10 @@ public:
     QString getNickname() const;
     QString getServerIp() const;
     int getServerPort() const;
-    QTcpSocket* getSocket();
-    QStringList getRoomList() const;
+    ChatConnection* getConnection();
+    // login_ok 中带回的第一页房间列表
+    QJsonObject getRoomPage() const;
+    bool hasAIGateway() const;
 
 signals:
     void loginSuccessful(const QString &account, const QString &nickname);
@@ -29,27 +33,26 @@ signals:
 private slots:
     void onConnectClicked();
     void onLoginClicked();
-    void onSocketReadyRead();
+    void onConnectionStateChanged(ChatConnection::State state);
 
 private:
-    void sendJson(const QJsonObject &obj);
-    void handleMessage(const QJsonObject &obj);
+    void handleEvent(const ChatEvent &event);
     void setupUI();
 
     QLineEdit *ipEdit;
     QLineEdit *portEdit;
     QPushButton *connectButton;
+    QCheckBox *tlsCheck;
     QLineEdit *accountEdit;
     QLineEdit *passwordEdit;
     QLineEdit *nicknameEdit;
     QPushButton *loginButton;
     QLabel *statusLabel;
 
-    QTcpSocket *socket;
-    QByteArray buffer;
-    QStringList roomList;
-    bool connected = false;
+    ChatConnection *connection;
+    QJsonObject roomPage;
     bool loginSuccess = false;
+    bool aiGateway = false;
 };
 
 #endif // LOGINDIALOG_H
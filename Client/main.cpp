@@ -1,20 +1,24 @@
 #include "logindialog.h"
 #include "mainwindow.h"
+#include "trace.h"
 
 #include <QApplication>
+#include <QDir>
 
 int main(int argc, char *argv[])
 {
     QApplication a(argc, argv);
+    Trace::installDumpSignal(QDir(QCoreApplication::applicationDirPath()).filePath("traces"));
     
     LoginDialog loginDialog;
     if (loginDialog.exec() == QDialog::Accepted) {
         MainWindow *mainWindow = new MainWindow(
-            loginDialog.getSocket(),
+            loginDialog.getConnection(),
             loginDialog.getAccount(),
             loginDialog.getNickname(),
-            loginDialog.getRoomList()
+            loginDialog.getRoomPage()
         );
+        mainWindow->setServerAIGateway(loginDialog.hasAIGateway());
         mainWindow->setAttribute(Qt::WA_DeleteOnClose);
         mainWindow->show();
         return a.exec();
@@ -2,17 +2,17 @@
 #include "roommanager.h"
 #include "chatwidget.h"
 #include "aiassistant.h"
+#include "attachmenttransfer.h"
+#include "framemeter.h"
+#include "trace.h"
 
 #include <QHBoxLayout>
 #include <QVBoxLayout>
 #include <QSplitter>
 #include <QTabWidget>
-#include <QJsonDocument>
 #include <QJsonObject>
 #include <QJsonArray>
-#include <QJsonParseError>
 #include <QMessageBox>
-#include <QNetworkRequest>
 #include <QUrl>
 #include <QFile>
 #include <QDir>
@@ -20,37 +20,152 @@
 #include <QTextStream>
 #include <QCoreApplication>
 #include <QFileInfo>
+#include <QUuid>
+#include <QFileDialog>
+#include <QShortcut>
+#include <QStatusBar>
+#include <QLabel>
+#include <QPushButton>
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDebug>
 
-MainWindow::MainWindow(QTcpSocket *socket, const QString &account, const QString &nickname, 
-                       const QStringList &initialRoomList, QWidget *parent)
+#include <algorithm>
+
+namespace {
+// 累计确认的发送间隔，确认合并发送以减少小包
+constexpr int kAckIntervalMs = 500;
+// 每个上传最多同时在途的分片数，其余消息可以穿插发送
+constexpr int kUploadWindow = 2;
+// 重新打开房间时从本地缓存显示的消息条数
+constexpr int kCachedTailRows = 200;
+// 合成消息洪峰：速率（条/秒）和持续时间，消息轮流发到所有打开的房间
+constexpr int kBurstRate = 500;
+constexpr int kBurstDurationMs = 5000;
+
+// 本地消息缓存按服务器地址和账号分目录，换账号或服务器时互不干扰
+QString messageStoreDir(const ChatConnection *connection, const QString &account)
+{
+    const QString key = QString("%1:%2\n%3").arg(connection->serverHost()).arg(connection->serverPort()).arg(account);
+    const QByteArray name = QCryptographicHash::hash(key.toUtf8(), QCryptographicHash::Sha1).toHex().left(16);
+    return QDir(QCoreApplication::applicationDirPath()).filePath("cache/" + QString::fromLatin1(name));
+}
+
+// 从缺口区间中去掉一个序号，序号不在任何缺口里时返回 false
+bool takeMissing(QMap<quint64, quint64> &missing, quint64 seq)
+{
+    auto it = missing.upperBound(seq);
+    if (it == missing.begin()) {
+        return false;
+    }
+    --it;
+    const quint64 from = it.key();
+    const quint64 to = it.value();
+    if (seq > to) {
+        return false;
+    }
+    missing.erase(it);
+    if (from < seq) {
+        missing.insert(from, seq - 1);
+    }
+    if (seq < to) {
+        missing.insert(seq + 1, to);
+    }
+    return true;
+}
+
+// 从缺口区间中去掉 [from, to]
+void dropMissing(QMap<quint64, quint64> &missing, quint64 from, quint64 to)
+{
+    QList<QPair<quint64, quint64>> kept;
+    for (auto it = missing.begin(); it != missing.end();) {
+        if (it.key() > to || it.value() < from) {
+            ++it;
+            continue;
+        }
+        if (it.key() < from) {
+            kept.append({it.key(), from - 1});
+        }
+        if (it.value() > to) {
+            kept.append({to + 1, it.value()});
+        }
+        it = missing.erase(it);
+    }
+    for (const auto &range : kept) {
+        missing.insert(range.first, range.second);
+    }
+}
+
+// chat / attachment 帧对应的聊天记录
+ChatModel::Entry frameEntry(const QJsonObject &frame)
+{
+    ChatModel::Entry entry;
+    entry.time = frame.value("time").toString();
+    entry.from = frame.value("from").toString();
+    if (frame.value("type").toString() == "attachment") {
+        entry.kind = ChatModel::Attachment;
+        entry.text = frame.value("name").toString();
+        entry.hash = frame.value("hash").toString();
+        entry.size = frame.value("size").toInteger();
+    } else {
+        entry.kind = ChatModel::Message;
+        entry.text = frame.value("message").toString();
+    }
+    return entry;
+}
+
+// 写进 AI 上下文的一行
+QString contextLine(const ChatModel::Entry &entry)
+{
+    if (entry.kind == ChatModel::Attachment) {
+        return QString("[%1] %2: [附件] %3").arg(entry.time, entry.from, entry.text);
+    }
+    return QString("[%1] %2: %3").arg(entry.time, entry.from, entry.text);
+}
+}
+
+MainWindow::MainWindow(ChatConnection *connection, const QString &account, const QString &nickname, 
+                       const QJsonObject &initialRooms, QWidget *parent)
     : QMainWindow(parent)
-    , socket(socket)
+    , connection(connection)
     , account(account)
     , nickname(nickname)
-    , currentReply(nullptr)
+    , messageStore(messageStoreDir(connection, account))
 {
-    networkManager = new QNetworkAccessManager(this);
+    ackTimer = new QTimer(this);
+    ackTimer->setInterval(kAckIntervalMs);
+    connect(ackTimer, &QTimer::timeout, this, &MainWindow::sendPendingAcks);
+    ackTimer->start();
     
     // 从配置文件加载API密钥
     loadApiKey();
     
     setupUI();
+    setupAIScheduler();
     
-    // 重新连接socket的readyRead信号到本窗口
-    disconnect(socket, &QTcpSocket::readyRead, nullptr, nullptr);
-    connect(socket, &QTcpSocket::readyRead, this, &MainWindow::onSocketReadyRead);
+    // 断开登录对话框的信号连接，改由本窗口接收
+    connection->disconnect();
+    connect(connection, &ChatConnection::eventReceived, this, &MainWindow::handleEvent);
+    connect(connection, &ChatConnection::stateChanged, this, &MainWindow::onConnectionStateChanged);
+    connect(connection, &ChatConnection::reconnectScheduled, this, [this](int attempt, int delayMs) {
+        connectionLabel->setText(QString("连接已断开，%1 秒后第 %2 次重连").arg((delayMs + 999) / 1000).arg(attempt));
+    });
+    onConnectionStateChanged(connection->state());
+    connection->resumeDelivery();
     
-    // 显示初始房间列表
-    if (!initialRoomList.isEmpty()) {
-        roomManager->updateRoomList(initialRoomList);
-    }
+    // 显示登录时带回的第一页房间
+    roomManager->applyLoginPage(initialRooms);
 }
 
 MainWindow::~MainWindow()
 {
-    if (socket) {
-        socket->disconnectFromHost();
-    }
+    connection->disconnectFromServer();
+}
+
+void MainWindow::setServerAIGateway(bool available)
+{
+    // 本地密钥优先，直接请求；否则交给服务器
+    aiAssistant->setGatewayMode(available && apiKey.isEmpty());
 }
 
 void MainWindow::setupUI()
@@ -122,65 +237,187 @@ void MainWindow::setupUI()
 
     mainLayout->addWidget(splitter);
 
+    // 状态栏显示与服务器的连接状态，断线等待重连时可以立即重试
+    connectionLabel = new QLabel(this);
+    connectionLabel->setStyleSheet("color: #d0d0d0; padding: 0 8px;");
+    reconnectButton = new QPushButton("立即重连", this);
+    reconnectButton->setFlat(true);
+    reconnectButton->setStyleSheet("color: #5ac2c6; padding: 0 8px;");
+    reconnectButton->hide();
+    statusBar()->setStyleSheet("QStatusBar { background-color: #2b2d30; }");
+    statusBar()->addWidget(connectionLabel, 1);
+    statusBar()->addPermanentWidget(reconnectButton);
+    connect(reconnectButton, &QPushButton::clicked, connection, &ChatConnection::reconnectNow);
+
     // 连接信号
     connect(roomManager, &RoomManager::createRoomRequested, this, &MainWindow::onRoomCreated);
     connect(roomManager, &RoomManager::joinRoomRequested, this, &MainWindow::onRoomJoined);
+    connect(roomManager, &RoomManager::roomQueryRequested, this, [this](const QString &prefix, const QString &cursor) {
+        QJsonObject obj;
+        obj["type"] = "list_rooms";
+        obj["prefix"] = prefix;
+        obj["cursor"] = cursor;
+        sendJson(obj);
+    });
     connect(aiAssistant, &AIAssistant::aiRequestSent, this, &MainWindow::onAIRequest);
+    connect(aiAssistant, &AIAssistant::gatewayRequestSent, this, &MainWindow::onGatewayRequest);
     connect(chatTabs, &QTabWidget::tabCloseRequested, this, &MainWindow::onTabCloseRequested);
     connect(chatTabs, &QTabWidget::currentChanged, this, &MainWindow::onTabChanged);
+
+    // Ctrl+Shift+B 合成一段消息洪峰，结束后在状态栏报告界面帧时间
+    frameMeter = new FrameMeter(this);
+    burstTimer = new QTimer(this);
+    burstTimer->setInterval(1);
+    connect(burstTimer, &QTimer::timeout, this, &MainWindow::onBurstTick);
+    auto *burstShortcut = new QShortcut(QKeySequence("Ctrl+Shift+B"), this);
+    connect(burstShortcut, &QShortcut::activated, this, &MainWindow::startSyntheticBurst);
+
+    // Ctrl+Shift+T 导出性能追踪（启动前设置 AICHAT_TRACE=1 开启）
+    auto *traceShortcut = new QShortcut(QKeySequence("Ctrl+Shift+T"), this);
+    connect(traceShortcut, &QShortcut::activated, this, [this]() {
+        const QString path = Trace::dumpToFile(QDir(QCoreApplication::applicationDirPath()).filePath("traces"));
+        QMessageBox::information(this, "性能追踪", path.isEmpty() ? "导出失败" : "已导出到:\n" + path);
+    });
 }
 
-void MainWindow::onSocketReadyRead()
+void MainWindow::onConnectionStateChanged(ChatConnection::State state)
 {
-    buffer.append(socket->readAll());
-    while (true) {
-        int idx = buffer.indexOf('\n');
-        if (idx < 0) break;
-        QByteArray line = buffer.left(idx);
-        buffer.remove(0, idx + 1);
-        if (line.trimmed().isEmpty()) continue;
+    reconnectButton->setVisible(state == ChatConnection::Backoff);
+    switch (state) {
+    case ChatConnection::Online:
+        connectionLabel->setText(QString("已连接 %1:%2").arg(connection->serverHost()).arg(connection->serverPort()));
+        if (!wasOnline) {
+            wasOnline = true;
+            resumeSession();
+        }
+        return;
+    case ChatConnection::Connecting:
+        connectionLabel->setText("正在连接服务器...");
+        break;
+    case ChatConnection::Connected:
+        connectionLabel->setText("正在重新登录...");
+        break;
+    case ChatConnection::Disconnected:
+        connectionLabel->setText("已离线");
+        break;
+    case ChatConnection::Backoff:
+        // 等待时间由 reconnectScheduled 显示
+        break;
+    }
 
-        QJsonParseError err;
-        QJsonDocument doc = QJsonDocument::fromJson(line, &err);
-        if (err.error == QJsonParseError::NoError && doc.isObject()) {
-            handleMessage(doc.object());
+    if (wasOnline) {
+        wasOnline = false;
+        // 上传状态跟随旧连接，无法续传
+        for (const PendingUpload &upload : std::as_const(uploads)) {
+            if (chatWidgets.contains(upload.room)) {
+                chatWidgets[upload.room]->appendSystemMessage(QString("附件 %1 上传中断").arg(upload.name));
+            }
+        }
+        uploads.clear();
+        rejoining.clear();
+        for (ChatWidget *chatWidget : std::as_const(chatWidgets)) {
+            chatWidget->appendSystemMessage("与服务器的连接已断开，重连前发送的消息会暂存");
         }
     }
 }
 
-void MainWindow::handleMessage(const QJsonObject &obj)
+void MainWindow::resumeSession()
 {
-    QString type = obj.value("type").toString();
-    
-    if (type == "room_list") {
-        QStringList rooms;
-        const QJsonArray arr = obj.value("rooms").toArray();
-        for (const QJsonValue &val : arr) {
-            rooms.append(val.toString());
+    // 先重新加入房间，再补发暂存的消息，合成一次写入；服务器按顺序处理，发消息时已经在房间里
+    QList<QJsonObject> batch;
+    for (auto it = chatWidgets.cbegin(); it != chatWidgets.cend(); ++it) {
+        // 已被关闭的房间不再加入
+        if (!it.value()->isEnabled()) {
+            continue;
+        }
+        batch.append(joinRequest(it.key()));
+        rejoining.insert(it.key());
+    }
+    outbox.removeIf([this](const QJsonObject &obj) { return !rejoining.contains(obj.value("room").toString()); });
+    batch.append(outbox);
+    connection->sendBatch(batch);
+}
+
+void MainWindow::handleEvent(const ChatEvent &event)
+{
+    TRACE_SCOPE("client.handleEvent");
+    const QJsonObject &obj = event.data;
+
+    switch (event.type) {
+    case ChatEvent::LoginOk: {
+        // 重连后自动登录成功，房间可能在断线期间有增删
+        roomManager->applyLoginPage(obj);
+        break;
+    }
+    case ChatEvent::RoomList: {
+        roomManager->applyRoomPage(obj);
+        break;
+    }
+    case ChatEvent::RoomUpdate: {
+        QStringList added;
+        QStringList removed;
+        for (const QJsonValue &val : obj.value("added").toArray()) {
+            added.append(val.toString());
+        }
+        for (const QJsonValue &val : obj.value("removed").toArray()) {
+            removed.append(val.toString());
         }
-        roomManager->updateRoomList(rooms);
+        roomManager->applyRoomChanges(added, removed);
+        break;
     }
-    else if (type == "create_room_ok") {
+    case ChatEvent::CreateRoomOk: {
         // Room created successfully, will join it next
+        break;
     }
-    else if (type == "create_room_fail") {
+    case ChatEvent::CreateRoomFail: {
         QMessageBox::warning(this, "创建失败", obj.value("message").toString());
+        break;
     }
-    else if (type == "join_room_ok") {
+    case ChatEvent::JoinRoomOk: {
         QString room = obj.value("room").toString();
+        if (rejoining.remove(room)) {
+            resyncRoom(room, obj);
+            return;
+        }
         
         // Create new ChatWidget if not exists
         if (!chatWidgets.contains(room)) {
             ChatWidget *chatWidget = new ChatWidget(this);
             chatWidget->setRoomName(room);
+            if (historyWindow > 0) {
+                chatWidget->setHistoryWindow(historyWindow);
+            }
+            chatWidget->setHibernateAfter(hibernateMinutes * 60 * 1000);
             
             // Connect send message signal
-            connect(chatWidget, &ChatWidget::sendMessageRequested, this, [this, room](const QString &msg) {
+            connect(chatWidget, &ChatWidget::sendMessageRequested, this, [this, room, chatWidget](const QString &msg) {
                 QJsonObject obj;
                 obj["type"] = "chat";
                 obj["room"] = room;
                 obj["message"] = msg;
-                sendJson(obj);
+                obj["client_id"] = QUuid::createUuid().toString(QUuid::WithoutBraces);
+                // 收到回显前一直留在待发送队列里，离线时重连后一起发出
+                outbox.append(obj);
+                if (!sendJson(obj)) {
+                    chatWidget->appendSystemMessage("当前离线，消息将在重新连接后发送");
+                }
+            });
+            connect(chatWidget, &ChatWidget::attachFileRequested, this, [this, room]() {
+                onAttachFileRequested(room);
+            });
+            connect(chatWidget, &ChatWidget::attachmentClicked, this, &MainWindow::onAttachmentClicked);
+            connect(chatWidget, &ChatWidget::unreadChanged, this, [this, room](int count) {
+                updateTabTitle(room, count);
+            });
+            connect(chatWidget, &ChatWidget::hibernated, this, [this, room, chatWidget](int rows, qint64 rawBytes, qint64 compressedBytes) {
+                // 鼠标停在标签上可以看到休眠后的内存占用
+                const QString report = QString("已休眠：%1 条消息，%2 压缩为 %3")
+                    .arg(rows).arg(ChatModel::formatSize(rawBytes), ChatModel::formatSize(compressedBytes));
+                chatTabs->setTabToolTip(chatTabs->indexOf(chatWidget), report);
+                qInfo().noquote() << room << report;
+            });
+            connect(chatWidget, &ChatWidget::woke, this, [this, chatWidget]() {
+                chatTabs->setTabToolTip(chatTabs->indexOf(chatWidget), QString());
             });
             
             chatWidgets[room] = chatWidget;
@@ -189,6 +426,8 @@ void MainWindow::handleMessage(const QJsonObject &obj)
             // Add tab
             int index = chatTabs->addTab(chatWidget, room);
             chatTabs->setCurrentIndex(index);
+            // 先显示本地缓存的最近消息，缺的部分服务器紧接着补发
+            loadCachedMessages(room);
         } else {
             // Switch to existing tab
             int index = chatTabs->indexOf(chatWidgets[room]);
@@ -197,31 +436,59 @@ void MainWindow::handleMessage(const QJsonObject &obj)
             }
         }
         
+        if (obj.contains("seq")) {
+            RoomSeqState &state = roomSeq[room];
+            const quint64 seq = quint64(obj.value("seq").toInteger());
+            if (state.highest == 0) {
+                state.contiguous = state.highest = state.acked = seq;
+                state.epoch = obj.value("epoch").toInteger();
+            }
+        }
+
         chatWidgets[room]->appendSystemMessage("成功加入聊天室: " + room);
         currentRoom = room;
         aiAssistant->setEnabled(true);
-        aiAssistant->setChatContext(chatWidgets[room]->getChatHistory());
+        aiAssistant->setRoom(room);
+        aiScheduler->setWarm(true);
+        if (!aiContexts.contains(room)) {
+            aiContexts.insert(room, ChatContext(aiContextTokens));
+        }
+        break;
     }
-    else if (type == "join_room_fail") {
+    case ChatEvent::JoinRoomFail: {
+        // 重连时房间已经不存在：停用它并丢弃暂存的消息
+        const QString room = obj.value("room").toString();
+        if (rejoining.remove(room)) {
+            outbox.removeIf([&room](const QJsonObject &msg) { return msg.value("room").toString() == room; });
+            chatWidgets[room]->appendSystemMessage("重新加入失败: " + obj.value("message").toString());
+            chatWidgets[room]->setEnabled(false);
+            return;
+        }
         QMessageBox::warning(this, "加入失败", obj.value("message").toString());
+        break;
     }
-    else if (type == "chat") {
+    case ChatEvent::Chat: {
         QString room = obj.value("room").toString();
         QString from = obj.value("from").toString();
         QString message = obj.value("message").toString();
         QString time = obj.value("time").toString();
+        // 自己发出的消息已经送达
+        confirmSent(obj.value("client_id").toString());
+
+        // 重复帧（重传或重试）直接丢弃
+        if (obj.contains("seq") && !acceptSequenced(room, quint64(obj.value("seq").toInteger()))) {
+            return;
+        }
         
         // Route message to correct chat widget
         if (chatWidgets.contains(room)) {
             chatWidgets[room]->appendMessage(from, message, time);
-            
-            // Update AI context if this is current room
-            if (room == currentRoom) {
-                aiAssistant->setChatContext(chatWidgets[room]->getChatHistory());
-            }
+            aiContexts[room].append(QString("[%1] %2: %3").arg(time, from, message));
+            persistFrame(room, obj);
         }
+        break;
     }
-    else if (type == "system") {
+    case ChatEvent::System: {
         QString room = obj.value("room").toString();
         QString message = obj.value("message").toString();
         
@@ -229,15 +496,406 @@ void MainWindow::handleMessage(const QJsonObject &obj)
         if (chatWidgets.contains(room)) {
             chatWidgets[room]->appendSystemMessage(message);
         }
+        break;
+    }
+    case ChatEvent::Attachment: {
+        QString room = obj.value("room").toString();
+        if (obj.contains("seq") && !acceptSequenced(room, quint64(obj.value("seq").toInteger()))) {
+            return;
+        }
+        if (chatWidgets.contains(room)) {
+            chatWidgets[room]->appendAttachment(obj.value("from").toString(), obj.value("name").toString(),
+                                                obj.value("size").toInteger(), obj.value("hash").toString(),
+                                                obj.value("time").toString());
+            aiContexts[room].append(QString("[%1] %2: [附件] %3").arg(obj.value("time").toString(),
+                                                                    obj.value("from").toString(),
+                                                                    obj.value("name").toString()));
+            persistFrame(room, obj);
+        }
+        break;
+    }
+    case ChatEvent::RoomClosed: {
+        QString room = obj.value("room").toString();
+        roomSeq.remove(room);
+        if (chatWidgets.contains(room)) {
+            chatWidgets[room]->appendSystemMessage(obj.value("message").toString());
+            chatWidgets[room]->setEnabled(false);
+        }
+        break;
+    }
+    case ChatEvent::AIReply: {
+        // 回复发回提问的房间，切换标签页后仍能看到
+        const QString room = obj.value("room").toString();
+        if (chatWidgets.contains(room)) {
+            if (obj.value("ok").toBool()) {
+                const QString source = obj.value("cached").toBool() ? "🤖 AI回复（服务器缓存）:\n\n" : "🤖 AI回复:\n\n";
+                aiAssistant->appendResponse(room, source + obj.value("content").toString());
+            } else {
+                aiAssistant->appendResponse(room, "❌ AI网关错误:\n\n" + obj.value("message").toString());
+            }
+        }
+        break;
+    }
+    case ChatEvent::History: {
+        // 加入房间时按本地缓存位置补发的消息
+        const QString room = obj.value("room").toString();
+        if (chatWidgets.contains(room)) {
+            appendRecentFrames(room, obj.value("frames").toArray(), obj.value("complete").toBool());
+        }
+        break;
+    }
+    case ChatEvent::ChatAck: {
+        // 重发的消息服务器之前已经收到过
+        confirmSent(obj.value("client_id").toString());
+        break;
+    }
+    case ChatEvent::ChatRejected: {
+        // 被内容过滤拦截，不再重发
+        confirmSent(obj.value("client_id").toString());
+        const QString room = obj.value("room").toString();
+        if (chatWidgets.contains(room)) {
+            chatWidgets[room]->appendSystemMessage(obj.value("message").toString());
+        }
+        break;
+    }
+    case ChatEvent::Upload: {
+        handleUploadReply(obj.value("type").toString(), obj);
+        break;
+    }
+    case ChatEvent::Download: {
+        handleDownloadReply(obj);
+        break;
+    }
+    case ChatEvent::ResendGap: {
+        // 服务器已丢弃这些帧，不再等待
+        QString room = obj.value("room").toString();
+        if (roomSeq.contains(room)) {
+            RoomSeqState &state = roomSeq[room];
+            const quint64 from = quint64(obj.value("from").toInteger());
+            const quint64 to = quint64(obj.value("to").toInteger());
+            dropMissing(state.missing, from, to);
+            acceptSequenced(room, 0);
+            if (chatWidgets.contains(room)) {
+                chatWidgets[room]->appendSystemMessage(QString("有 %1 条消息已无法获取").arg(to - from + 1));
+            }
+        }
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+bool MainWindow::acceptSequenced(const QString &room, quint64 seq)
+{
+    RoomSeqState &state = roomSeq[room];
+    if (seq != 0) {
+        if (seq <= state.highest && !takeMissing(state.missing, seq)) {
+            return false;
+        }
+        if (seq > state.highest + 1) {
+            // 发现缺口，请求服务器只补发缺失部分
+            requestResend(room, state.highest + 1, seq - 1);
+        }
+        state.highest = qMax(state.highest, seq);
+    }
+
+    if (state.missing.isEmpty()) {
+        state.contiguous = state.highest;
+    } else {
+        // 确认只推进到第一个缺口之前，缺口再大也不会确认没收到的帧
+        state.contiguous = state.missing.firstKey() - 1;
+    }
+    return true;
+}
+
+void MainWindow::requestResend(const QString &room, quint64 from, quint64 to)
+{
+    roomSeq[room].missing.insert(from, to);
+    QJsonObject resend;
+    resend["type"] = "resend";
+    resend["room"] = room;
+    resend["from"] = qint64(from);
+    resend["to"] = qint64(to);
+    sendJson(resend);
+}
+
+void MainWindow::resyncRoom(const QString &room, const QJsonObject &obj)
+{
+    if (!chatWidgets.contains(room)) {
+        return;
+    }
+    if (obj.contains("seq")) {
+        // 断线前收到的消息都在本地缓存里，之后错过的由服务器按缓存位置随 join_room_ok 补发
+        RoomSeqState &state = roomSeq[room];
+        state.contiguous = state.highest = state.acked = quint64(obj.value("seq").toInteger());
+        state.missing.clear();
+        state.epoch = obj.value("epoch").toInteger();
+    }
+    chatWidgets[room]->appendSystemMessage("已重新连接");
+}
+
+QJsonObject MainWindow::joinRequest(const QString &room)
+{
+    QJsonObject obj;
+    obj["type"] = "join_room";
+    obj["room"] = room;
+    // 带上本地缓存最后一条的位置，服务器只补发之后的消息
+    const QList<MessageStore::Record> last = messageStore.tail(room, 1);
+    if (!last.isEmpty()) {
+        QJsonObject since;
+        since["epoch"] = last.first().epoch;
+        since["seq"] = qint64(last.first().seq);
+        since["ts"] = last.first().ts;
+        obj["since"] = since;
+    }
+    return obj;
+}
+
+void MainWindow::loadCachedMessages(const QString &room)
+{
+    const QList<MessageStore::Record> records = messageStore.tail(room, kCachedTailRows);
+    if (!aiContexts.contains(room)) {
+        aiContexts.insert(room, ChatContext(aiContextTokens));
+    }
+    if (records.isEmpty()) {
+        return;
+    }
+    QList<ChatModel::Entry> entries;
+    entries.reserve(records.size());
+    ChatContext &context = aiContexts[room];
+    for (const MessageStore::Record &record : records) {
+        context.append(contextLine(record.entry));
+        entries.append(record.entry);
+    }
+    chatWidgets[room]->appendEntries(std::move(entries));
+    chatWidgets[room]->appendSystemMessage(QString("以上 %1 条为本地缓存的消息").arg(records.size()));
+}
+
+void MainWindow::appendRecentFrames(const QString &room, const QJsonArray &frames, bool complete)
+{
+    if (!complete) {
+        chatWidgets[room]->appendSystemMessage("部分较早的消息服务器已不再保留，无法补齐");
+    }
+    QList<ChatModel::Entry> entries;
+    entries.reserve(frames.size());
+    ChatContext &context = aiContexts[room];
+    for (const QJsonValue &value : frames) {
+        const QJsonObject frame = value.toObject();
+        // 断线时发出的消息可能已经送达，只是没看到回显
+        confirmSent(frame.value("client_id").toString());
+        ChatModel::Entry entry = frameEntry(frame);
+        context.append(contextLine(entry));
+        persistFrame(room, frame);
+        entries.append(std::move(entry));
+    }
+    chatWidgets[room]->appendEntries(std::move(entries));
+}
+
+void MainWindow::persistFrame(const QString &room, const QJsonObject &frame)
+{
+    MessageStore::Record record;
+    record.epoch = roomSeq.value(room).epoch;
+    record.seq = quint64(frame.value("seq").toInteger());
+    record.ts = frame.value("ts").toInteger();
+    record.entry = frameEntry(frame);
+    messageStore.append(room, record);
+}
+
+void MainWindow::confirmSent(const QString &clientId)
+{
+    if (clientId.isEmpty() || outbox.isEmpty()) {
+        return;
+    }
+    for (auto it = outbox.begin(); it != outbox.end(); ++it) {
+        if (it->value("client_id").toString() == clientId) {
+            outbox.erase(it);
+            return;
+        }
     }
 }
 
-void MainWindow::sendJson(const QJsonObject &obj)
+void MainWindow::onAttachFileRequested(const QString &room)
 {
-    QJsonDocument doc(obj);
-    QByteArray data = doc.toJson(QJsonDocument::Compact);
-    data.append('\n');
-    socket->write(data);
+    if (!connection->isOnline()) {
+        statusBar()->showMessage("当前离线，暂时不能上传附件", 3000);
+        return;
+    }
+    const QString path = QFileDialog::getOpenFileName(this, "选择附件");
+    if (path.isEmpty()) {
+        return;
+    }
+
+    PendingUpload upload;
+    upload.room = room;
+    upload.name = QFileInfo(path).fileName();
+    upload.file = QSharedPointer<QFile>::create(path);
+    if (!upload.file->open(QIODevice::ReadOnly)) {
+        QMessageBox::warning(this, "上传失败", "无法读取文件: " + upload.file->errorString());
+        return;
+    }
+    upload.size = upload.file->size();
+
+    const QString clientId = QUuid::createUuid().toString(QUuid::WithoutBraces);
+    QJsonObject obj;
+    obj["type"] = "upload_begin";
+    obj["room"] = room;
+    obj["name"] = upload.name;
+    obj["size"] = upload.size;
+    obj["hash"] = sha256OfFile(path);
+    obj["client_id"] = clientId;
+    sendJson(obj);
+
+    uploads.insert(clientId, upload);
+    if (chatWidgets.contains(room)) {
+        chatWidgets[room]->appendSystemMessage("正在上传附件: " + upload.name);
+    }
+}
+
+void MainWindow::handleUploadReply(const QString &type, const QJsonObject &obj)
+{
+    // 先按 client_id 找，分片阶段的回复只带 upload_id
+    QString key = obj.value("client_id").toString();
+    if (!uploads.contains(key)) {
+        const QString uploadId = obj.value("upload_id").toString();
+        key.clear();
+        for (auto it = uploads.cbegin(); it != uploads.cend(); ++it) {
+            if (!uploadId.isEmpty() && it->uploadId == uploadId) {
+                key = it.key();
+                break;
+            }
+        }
+        if (key.isEmpty()) {
+            return;
+        }
+    }
+
+    PendingUpload &upload = uploads[key];
+    if (type == "upload_ready") {
+        upload.uploadId = obj.value("upload_id").toString();
+        upload.chunkSize = obj.value("chunk_size").toInt();
+        sendUploadChunks(upload);
+    } else if (type == "upload_challenge") {
+        // 服务器已有相同内容：对盐加上文件中指定的一段求哈希作答，证明确实持有这个文件
+        upload.uploadId = obj.value("upload_id").toString();
+        const QByteArray salt = QByteArray::fromBase64(obj.value("salt").toString().toLatin1());
+        QByteArray range;
+        if (upload.file->seek(obj.value("offset").toInteger())) {
+            range = upload.file->read(obj.value("length").toInteger());
+        }
+        QCryptographicHash digest(QCryptographicHash::Sha256);
+        digest.addData(salt);
+        digest.addData(range);
+        QJsonObject proof;
+        proof["type"] = "upload_proof";
+        proof["upload_id"] = upload.uploadId;
+        proof["proof"] = QString::fromLatin1(digest.result().toHex());
+        sendJson(proof);
+    } else if (type == "upload_ack") {
+        upload.acked = qMax(upload.acked, obj.value("offset").toInteger());
+        sendUploadChunks(upload);
+    } else if (type == "upload_done" || type == "upload_fail") {
+        if (type == "upload_fail" && chatWidgets.contains(upload.room)) {
+            chatWidgets[upload.room]->appendSystemMessage(
+                QString("附件 %1 上传失败: %2").arg(upload.name, obj.value("message").toString()));
+        }
+        uploads.remove(key);
+    }
+}
+
+void MainWindow::sendUploadChunks(PendingUpload &upload)
+{
+    if (upload.chunkSize <= 0) {
+        return;
+    }
+    while (upload.sent < upload.size && upload.sent - upload.acked < qint64(kUploadWindow) * upload.chunkSize) {
+        const QByteArray chunk = upload.file->read(upload.chunkSize);
+        if (chunk.isEmpty()) {
+            break;
+        }
+        QJsonObject obj;
+        obj["type"] = "upload_chunk";
+        obj["upload_id"] = upload.uploadId;
+        obj["offset"] = upload.sent;
+        obj["data"] = QString::fromLatin1(chunk.toBase64());
+        sendJson(obj);
+        upload.sent += chunk.size();
+    }
+}
+
+void MainWindow::onAttachmentClicked(const QString &hash, const QString &name)
+{
+    const QString savePath = QFileDialog::getSaveFileName(this, "保存附件", name);
+    if (savePath.isEmpty()) {
+        return;
+    }
+
+    // 先在聊天连接上申请下载凭证，拿到后再建下载连接
+    QJsonObject grant;
+    grant["type"] = "download_grant";
+    grant["room"] = currentRoom;
+    grant["hash"] = hash;
+    if (!sendJson(grant)) {
+        if (chatWidgets.contains(currentRoom)) {
+            chatWidgets[currentRoom]->appendSystemMessage(QString("附件 %1 下载失败: 未连接服务器").arg(name));
+        }
+        return;
+    }
+    downloads.insert(hash, PendingDownload{currentRoom, name, savePath});
+}
+
+void MainWindow::handleDownloadReply(const QJsonObject &obj)
+{
+    const QString hash = obj.value("hash").toString();
+    if (!downloads.contains(hash)) {
+        return;
+    }
+    const PendingDownload pending = downloads.take(hash);
+    const QString room = pending.room;
+    const QString name = pending.name;
+    if (obj.value("type").toString() == "download_fail") {
+        if (chatWidgets.contains(room)) {
+            chatWidgets[room]->appendSystemMessage(
+                QString("附件 %1 下载失败: %2").arg(name, obj.value("message").toString()));
+        }
+        return;
+    }
+
+    auto *download = new AttachmentDownload(connection->serverHost(), connection->serverPort(), hash,
+                                            obj.value("token").toString(), obj.value("expires").toInteger(),
+                                            pending.savePath, this);
+    if (connection->isTls()) {
+        download->setTls(connection->tlsConfiguration());
+    }
+    connect(download, &AttachmentDownload::finished, this, [this, room, name](bool ok, const QString &message) {
+        if (chatWidgets.contains(room)) {
+            chatWidgets[room]->appendSystemMessage(ok ? "附件已保存: " + name
+                                                      : QString("附件 %1 下载失败: %2").arg(name, message));
+        }
+    });
+    download->start();
+}
+
+void MainWindow::sendPendingAcks()
+{
+    if (!connection->isOnline()) {
+        return;
+    }
+    for (auto it = roomSeq.begin(); it != roomSeq.end(); ++it) {
+        if (it->contiguous > it->acked) {
+            QJsonObject ack;
+            ack["type"] = "ack";
+            ack["room"] = it.key();
+            ack["seq"] = qint64(it->contiguous);
+            sendJson(ack);
+            it->acked = it->contiguous;
+        }
+    }
+}
+
+bool MainWindow::sendJson(const QJsonObject &obj)
+{
+    return connection->send(obj);
 }
 
 void MainWindow::onRoomCreated(const QString &roomName)
@@ -245,20 +903,21 @@ void MainWindow::onRoomCreated(const QString &roomName)
     QJsonObject obj;
     obj["type"] = "create_room";
     obj["room"] = roomName;
-    sendJson(obj);
+    if (!sendJson(obj)) {
+        statusBar()->showMessage("当前离线，请重新连接后再试", 3000);
+    }
 }
 
 void MainWindow::onRoomJoined(const QString &roomName)
 {
-    QJsonObject obj;
-    obj["type"] = "join_room";
-    obj["room"] = roomName;
-    sendJson(obj);
+    if (!sendJson(joinRequest(roomName))) {
+        statusBar()->showMessage("当前离线，请重新连接后再试", 3000);
+    }
 }
 
 void MainWindow::onTabCloseRequested(int index)
 {
-    QString roomName = chatTabs->tabText(index);
+    QString roomName = roomAt(index);
     
     // Send leave_room message to server
     QJsonObject obj;
@@ -270,18 +929,25 @@ void MainWindow::onTabCloseRequested(int index)
     QWidget *widget = chatTabs->widget(index);
     chatTabs->removeTab(index);
     chatWidgets.remove(roomName);
+    roomSeq.remove(roomName);
+    messageStore.close(roomName);
+    rejoining.remove(roomName);
+    outbox.removeIf([&roomName](const QJsonObject &msg) { return msg.value("room").toString() == roomName; });
+    aiContexts.remove(roomName);
+    aiScheduler->cancel(roomName);
+    aiAssistant->removeRoom(roomName);
     widget->deleteLater();
     
     // Update current room
     if (currentRoom == roomName) {
         if (chatTabs->count() > 0) {
-            currentRoom = chatTabs->tabText(chatTabs->currentIndex());
-            if (chatWidgets.contains(currentRoom)) {
-                aiAssistant->setChatContext(chatWidgets[currentRoom]->getChatHistory());
-            }
+            currentRoom = roomAt(chatTabs->currentIndex());
+            aiAssistant->setRoom(currentRoom);
         } else {
             currentRoom.clear();
+            aiAssistant->setRoom(QString());
             aiAssistant->setEnabled(false);
+            aiScheduler->setWarm(false);
         }
     }
 }
@@ -289,14 +955,78 @@ void MainWindow::onTabCloseRequested(int index)
 void MainWindow::onTabChanged(int index)
 {
     if (index >= 0) {
-        currentRoom = chatTabs->tabText(index);
-        if (chatWidgets.contains(currentRoom)) {
-            aiAssistant->setChatContext(chatWidgets[currentRoom]->getChatHistory());
-        }
+        currentRoom = roomAt(index);
+        aiAssistant->setRoom(currentRoom);
+    }
+}
+
+QString MainWindow::roomAt(int index) const
+{
+    // 标签页标题可能带有未读数，房间名以 chatWidgets 为准
+    return chatWidgets.key(static_cast<ChatWidget *>(chatTabs->widget(index)));
+}
+
+void MainWindow::updateTabTitle(const QString &room, int unread)
+{
+    const int index = chatTabs->indexOf(chatWidgets.value(room));
+    if (index >= 0) {
+        chatTabs->setTabText(index, unread > 0 ? QString("%1 (%2)").arg(room).arg(unread) : room);
+    }
+}
+
+void MainWindow::startSyntheticBurst()
+{
+    if (burstTimer->isActive()) {
+        return;
+    }
+    if (chatWidgets.isEmpty()) {
+        statusBar()->showMessage("请先加入聊天室再开始洪峰测试", 3000);
+        return;
+    }
+    burstSent = 0;
+    burstClock.start();
+    frameMeter->start();
+    burstTimer->start();
+    statusBar()->showMessage(QString("洪峰测试中：%1 条/秒，持续 %2 秒").arg(kBurstRate).arg(kBurstDurationMs / 1000));
+}
+
+void MainWindow::onBurstTick()
+{
+    TRACE_SCOPE("client.syntheticBurst");
+    const qint64 elapsed = burstClock.elapsed();
+    const int due = int(qMin<qint64>(elapsed, kBurstDurationMs) * kBurstRate / 1000);
+    const QList<QString> rooms = chatWidgets.keys();
+    if (rooms.isEmpty()) {
+        finishSyntheticBurst();
+        return;
+    }
+    // 走与真实聊天消息相同的界面路径，但不写本地缓存
+    const QString time = QDateTime::currentDateTime().toString("hh:mm:ss");
+    for (; burstSent < due; ++burstSent) {
+        const QString &room = rooms.at(burstSent % rooms.size());
+        const QString message = QString("合成消息 #%1").arg(burstSent);
+        chatWidgets[room]->appendMessage("burst", message, time);
+        aiContexts[room].append(QString("[%1] %2: %3").arg(time, "burst", message));
+    }
+    if (elapsed >= kBurstDurationMs) {
+        finishSyntheticBurst();
     }
 }
 
-void MainWindow::onAIRequest(const QString &prompt)
+void MainWindow::finishSyntheticBurst()
+{
+    burstTimer->stop();
+    frameMeter->stop();
+    const FrameMeter::Summary stats = frameMeter->summary();
+    const QString report = QString("洪峰测试：%1 条消息 / %2 个房间，界面帧时间 p50 %3 ms · p95 %4 ms · p99 %5 ms · 最长 %6 ms，超过两帧 %7 次")
+        .arg(burstSent).arg(chatWidgets.size())
+        .arg(stats.p50Ms, 0, 'f', 1).arg(stats.p95Ms, 0, 'f', 1).arg(stats.p99Ms, 0, 'f', 1)
+        .arg(stats.maxMs, 0, 'f', 1).arg(stats.slowFrames);
+    qInfo().noquote() << report;
+    statusBar()->showMessage(report);
+}
+
+void MainWindow::onAIRequest(const QString &kind, const QString &question)
 {
     if (apiKey.isEmpty()) {
         QString configPath = getConfigFilePath();
@@ -308,89 +1038,87 @@ void MainWindow::onAIRequest(const QString &prompt)
                                    "配置后重启客户端即可");
         return;
     }
-    
-    callAI(prompt);
-}
 
-void MainWindow::callAI(const QString &prompt)
-{
-    // 如果有正在进行的请求，先取消
-    if (currentReply) {
-        currentReply->abort();
-        currentReply->deleteLater();
-        currentReply = nullptr;
+    if (currentRoom.isEmpty()) {
+        return;
     }
-    
-    // 构建SiliconFlow API请求
-    QUrl url("https://api.siliconflow.cn/v1/chat/completions");
-    QNetworkRequest request(url);
-    
-    request.setHeader(QNetworkRequest::ContentTypeHeader, "application/json");
-    request.setRawHeader("Authorization", QString("Bearer %1").arg(apiKey).toUtf8());
-    
-    // 构建请求体
-    QJsonObject messageObj;
-    messageObj["role"] = "user";
-    messageObj["content"] = prompt;
-    
-    QJsonArray messages;
-    messages.append(messageObj);
-    
-    QJsonObject requestBody;
-    // SiliconFlow模型，可以根据需要更改
-    requestBody["model"] = "Qwen/Qwen2.5-7B-Instruct";
-    requestBody["messages"] = messages;
-    requestBody["temperature"] = 0.7;
-    requestBody["max_tokens"] = 1000;
-    
-    QJsonDocument doc(requestBody);
-    QByteArray data = doc.toJson();
-    
-    // 发送请求
-    aiAssistant->appendResponse("⏳ 正在请求AI，请稍候...");
-    currentReply = networkManager->post(request, data);
-    
-    // 连接响应信号
-    connect(currentReply, &QNetworkReply::finished, this, &MainWindow::onAIReplyReceived);
+
+    // 上下文只在真正发请求时拼接一次
+    const QString prompt = ChatContext::buildPrompt(kind, aiContexts.value(currentRoom).render(), question);
+    if (prompt.isEmpty()) {
+        aiAssistant->appendResponse(kind == "summarize" ? "暂无聊天内容可总结" : "暂无聊天内容");
+        return;
+    }
+    aiScheduler->submit(currentRoom, kind, prompt);
 }
 
-void MainWindow::onAIReplyReceived()
+void MainWindow::setupAIScheduler()
 {
-    if (!currentReply) {
-        return;
+    aiScheduler = new AIScheduler(QDir(QCoreApplication::applicationDirPath()).filePath("config/ai_cache.bin"), this);
+    AIScheduler::Config config;
+    config.apiKey = apiKey;
+    config.maxConcurrent = aiConcurrency;
+    config.h2c = aiH2c;
+    if (!aiEndpoint.isEmpty()) {
+        config.endpoint = QUrl(aiEndpoint);
     }
-    
-    if (currentReply->error() == QNetworkReply::NoError) {
-        QByteArray responseData = currentReply->readAll();
-        QJsonDocument doc = QJsonDocument::fromJson(responseData);
-        QJsonObject obj = doc.object();
-        
-        if (obj.contains("choices")) {
-            QJsonArray choices = obj["choices"].toArray();
-            if (!choices.isEmpty()) {
-                QJsonObject firstChoice = choices[0].toObject();
-                QJsonObject message = firstChoice["message"].toObject();
-                QString content = message["content"].toString();
-                
-                aiAssistant->appendResponse("🤖 AI回复:\n\n" + content);
-            } else {
-                aiAssistant->appendResponse("❌ 错误: API返回为空");
+    aiScheduler->setConfig(config);
+    aiScheduler->loadCache(qint64(aiCacheMb) * 1024 * 1024);
+
+    connect(aiScheduler, &AIScheduler::jobStarted, this, [this](const QString &room) {
+        aiAssistant->appendResponse(room, "⏳ 正在请求AI，请稍候...");
+    });
+    connect(aiScheduler, &AIScheduler::streamStarted, this, [this](const QString &room) {
+        aiAssistant->beginStream(room, "🤖 AI回复:\n\n");
+    });
+    connect(aiScheduler, &AIScheduler::streamDelta, aiAssistant, &AIAssistant::appendStreamText);
+    connect(aiScheduler, &AIScheduler::streamStats, this, [this](const QString &room, const AIScheduler::Timing &timing) {
+        // 建连耗时与模型首字耗时分开显示，复用预热连接时前者接近 0
+        const QString setup = timing.setupMs >= 0 ? QString("%1 ms").arg(timing.setupMs) : QString("-");
+        const QString stats = QString("建连 %1（%2 · %3） · 模型首字 %4 ms · %5 tokens · %6 tokens/s")
+                                  .arg(setup, timing.newConnection ? "新连接" : "复用",
+                                       timing.http2 ? "HTTP/2" : "HTTP/1.1")
+                                  .arg(timing.firstTokenMs).arg(timing.tokens)
+                                  .arg(timing.tokensPerSecond, 0, 'f', 1);
+        aiAssistant->setStreamStats(room, stats);
+    });
+    connect(aiScheduler, &AIScheduler::busyChanged, aiAssistant, &AIAssistant::setBusy);
+    connect(aiScheduler, &AIScheduler::jobFinished, this,
+            [this](const QString &room, bool ok, const QString &text, bool streamed, bool cached) {
+        if (cached) {
+            aiAssistant->appendResponse(room, "🤖 AI回复（本地缓存）:\n\n" + text);
+        } else if (streamed) {
+            if (!ok) {
+                aiAssistant->appendStreamText(room, "\n\n❌ 回复中断: " + text);
             }
-        } else if (obj.contains("error")) {
-            QJsonObject error = obj["error"].toObject();
-            QString errorMsg = error["message"].toString();
-            aiAssistant->appendResponse("❌ API错误:\n\n" + errorMsg);
+            aiAssistant->finishStream(room);
         } else {
-            aiAssistant->appendResponse("❌ 错误: 无法解析API响应");
+            aiAssistant->appendResponse(room, ok ? "🤖 AI回复:\n\n" + text : text);
         }
-    } else {
-        QString errorString = currentReply->errorString();
-        aiAssistant->appendResponse("❌ 网络错误:\n\n" + errorString + 
-                                   "\n\n提示: 请检查网络连接和API密钥是否正确");
+    });
+    // 只有用户点取消时才中止请求
+    connect(aiAssistant, &AIAssistant::cancelRequested, this, [this](const QString &room) {
+        if (aiScheduler->isBusy(room)) {
+            aiScheduler->cancel(room);
+            aiAssistant->appendResponse(room, "已取消");
+        }
+    });
+}
+
+void MainWindow::onGatewayRequest(const QString &kind, const QString &question)
+{
+    if (currentRoom.isEmpty()) {
+        return;
+    }
+    QJsonObject obj;
+    obj["type"] = "ai_request";
+    obj["room"] = currentRoom;
+    obj["kind"] = kind;
+    obj["prompt"] = question;
+    obj["client_id"] = QUuid::createUuid().toString(QUuid::WithoutBraces);
+    if (!sendJson(obj)) {
+        aiAssistant->appendResponse(currentRoom, "❌ 当前未连接服务器，请重连后再试");
     }
-    
-    currentReply->deleteLater();
-    currentReply = nullptr;
 }
 
 void MainWindow::loadApiKey()
@@ -409,6 +1137,22 @@ void MainWindow::loadApiKey()
             out << "# Get your API key from: https://cloud.siliconflow.cn/\n";
             out << "# This file is ignored by git and won't be uploaded to GitHub\n\n";
             out << "SILICONFLOW_API_KEY=\n";
+            out << "# 每个聊天室在内存中保留的消息条数（可选）\n";
+            out << "# CHAT_HISTORY_WINDOW=1000\n";
+            out << "# 发给 AI 的聊天上下文上限（近似 token 数，可选）\n";
+            out << "# AI_CONTEXT_TOKENS=3000\n";
+            out << "# OpenAI 兼容接口地址，可指向本地模拟服务器（可选）\n";
+            out << "# AI_ENDPOINT=http://127.0.0.1:18080/v1/chat/completions\n";
+            out << "# AI 回复本地缓存上限（MB，0 表示不缓存，可选）\n";
+            out << "# AI_CACHE_MB=8\n";
+            out << "# 同时进行的 AI 请求数（可选）\n";
+            out << "# AI_CONCURRENCY=2\n";
+            out << "# AI_ENDPOINT 是 http:// 地址时直接用 HTTP/2（h2c，可选）\n";
+            out << "# AI_H2C=1\n";
+            out << "# 标签页在后台多少分钟后休眠（0 表示不休眠，可选）\n";
+            out << "# CHAT_HIBERNATE_MINUTES=10\n";
+            out << "# 服务器使用自签名证书时信任的 CA 证书，相对 config 目录（可选）\n";
+            out << "# TLS_CA_FILE=ca.pem\n";
             exampleFile.close();
         }
         
@@ -427,7 +1171,24 @@ void MainWindow::loadApiKey()
         // 解析 KEY=VALUE 格式
         if (line.startsWith("SILICONFLOW_API_KEY=")) {
             apiKey = line.mid(20).trimmed();  // 20是"SILICONFLOW_API_KEY="的长度
-            break;
+        } else if (line.startsWith("AI_ENDPOINT=")) {
+            aiEndpoint = line.mid(12).trimmed();
+        } else if (line.startsWith("AI_CACHE_MB=")) {
+            aiCacheMb = qMax(0, line.mid(12).trimmed().toInt());
+        } else if (line.startsWith("AI_CONCURRENCY=")) {
+            aiConcurrency = qMax(1, line.mid(15).trimmed().toInt());
+        } else if (line.startsWith("AI_H2C=")) {
+            const QString value = line.mid(7).trimmed().toLower();
+            aiH2c = value == "1" || value == "true";
+        } else if (line.startsWith("CHAT_HISTORY_WINDOW=")) {
+            historyWindow = line.mid(20).trimmed().toInt();
+        } else if (line.startsWith("CHAT_HIBERNATE_MINUTES=")) {
+            hibernateMinutes = qMax(0, line.mid(23).trimmed().toInt());
+        } else if (line.startsWith("AI_CONTEXT_TOKENS=")) {
+            const int tokens = line.mid(18).trimmed().toInt();
+            if (tokens > 0) {
+                aiContextTokens = tokens;
+            }
         }
     }
     file.close();
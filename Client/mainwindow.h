@@ -2,55 +2,139 @@
 #define MAINWINDOW_H
 
 #include <QMainWindow>
-#include <QTcpSocket>
 #include <QTabWidget>
 #include <QHash>
-#include <QNetworkAccessManager>
-#include <QNetworkReply>
+#include <QMap>
+#include <QSet>
+#include <QTimer>
+#include <QFile>
+#include <QSharedPointer>
+#include <QElapsedTimer>
+
+#include "chatconnection.h"
+#include "chatcontext.h"
+#include "aischeduler.h"
+#include "messagestore.h"
 
 class RoomManager;
 class ChatWidget;
 class AIAssistant;
+class FrameMeter;
+class QLabel;
+class QPushButton;
 
 class MainWindow : public QMainWindow
 {
     Q_OBJECT
 public:
-    explicit MainWindow(QTcpSocket *socket, const QString &account, const QString &nickname, 
-                       const QStringList &initialRoomList = QStringList(), QWidget *parent = nullptr);
+    explicit MainWindow(ChatConnection *connection, const QString &account, const QString &nickname, 
+                       const QJsonObject &initialRooms = QJsonObject(), QWidget *parent = nullptr);
     ~MainWindow();
 
+    // 服务器提供 AI 网关时，本地没有配置密钥也能使用 AI 助手
+    void setServerAIGateway(bool available);
+
 private slots:
-    void onSocketReadyRead();
+    void onConnectionStateChanged(ChatConnection::State state);
     void onRoomCreated(const QString &roomName);
     void onRoomJoined(const QString &roomName);
-    void onAIRequest(const QString &prompt);
+    void onAIRequest(const QString &kind, const QString &question);
+    void onGatewayRequest(const QString &kind, const QString &question);
     void onTabCloseRequested(int index);
     void onTabChanged(int index);
-    void onAIReplyReceived();
+    void sendPendingAcks();
+    void onAttachFileRequested(const QString &room);
+    void onAttachmentClicked(const QString &hash, const QString &name);
+    void onBurstTick();
 
 private:
-    void handleMessage(const QJsonObject &obj);
-    void sendJson(const QJsonObject &obj);
+    // 每个房间的接收序号状态，用于去重、发现缺口和累计确认
+    struct RoomSeqState {
+        quint64 contiguous = 0;   // 此序号及之前的帧都已收到
+        quint64 highest = 0;
+        quint64 acked = 0;        // 最近一次发给服务器的确认
+        QMap<quint64, quint64> missing;   // 尚未收到的序号区间：起始 -> 结束（含），大缺口也只占一项
+        qint64 epoch = 0;         // 服务器房间日志的 epoch，写入本地缓存时使用
+    };
+
+    // 进行中的附件上传，按服务器给的分片大小分块发送
+    struct PendingUpload {
+        QString room;
+        QString name;
+        QString uploadId;
+        qint64 size = 0;
+        qint64 sent = 0;
+        qint64 acked = 0;
+        int chunkSize = 0;
+        QSharedPointer<QFile> file;
+    };
+
+    // 等待服务器发下载凭证的附件
+    struct PendingDownload {
+        QString room;
+        QString name;
+        QString savePath;
+    };
+
+    bool acceptSequenced(const QString &room, quint64 seq);
+    void handleDownloadReply(const QJsonObject &obj);
+    void handleUploadReply(const QString &type, const QJsonObject &obj);
+    void sendUploadChunks(PendingUpload &upload);
+    void requestResend(const QString &room, quint64 from, quint64 to);
+    void resumeSession();
+    void resyncRoom(const QString &room, const QJsonObject &obj);
+    QJsonObject joinRequest(const QString &room);
+    void loadCachedMessages(const QString &room);
+    void appendRecentFrames(const QString &room, const QJsonArray &frames, bool complete);
+    void persistFrame(const QString &room, const QJsonObject &frame);
+    void handleEvent(const ChatEvent &event);
+    bool sendJson(const QJsonObject &obj);
+    void confirmSent(const QString &clientId);
+    QString roomAt(int index) const;
+    void updateTabTitle(const QString &room, int unread);
+    void startSyntheticBurst();
+    void finishSyntheticBurst();
     void setupUI();
-    void callAI(const QString &prompt);
+    void setupAIScheduler();
     void loadApiKey();
     QString getConfigFilePath() const;
 
-    QTcpSocket *socket;
+    ChatConnection *connection;
     QString account;
     QString nickname;
     QString currentRoom;
-    QByteArray buffer;
+    MessageStore messageStore;   // 每个房间收到的消息的本地缓存
+    // 已发出但还没在房间里看到回显的消息，断线重连后带着原 client_id 重发，由服务器去重
+    QList<QJsonObject> outbox;
+    QSet<QString> rejoining;   // 重连后正在重新加入的房间
+    bool wasOnline = true;
+    QLabel *connectionLabel;
+    QPushButton *reconnectButton;
 
     RoomManager *roomManager;
     QTabWidget *chatTabs;
     QHash<QString, ChatWidget*> chatWidgets;
+    QHash<QString, RoomSeqState> roomSeq;
+    QHash<QString, ChatContext> aiContexts;  // 每个房间的 AI 上下文窗口
+    QTimer *ackTimer;
+    QHash<QString, PendingUpload> uploads;  // client_id -> 上传
+    QHash<QString, PendingDownload> downloads;  // 哈希 -> 等待凭证的下载
     AIAssistant *aiAssistant;
-    
-    QNetworkAccessManager *networkManager;
-    QNetworkReply *currentReply;
+    AIScheduler *aiScheduler;
+    // Ctrl+Shift+B 本地合成的消息洪峰，用来测量界面帧时间
+    FrameMeter *frameMeter;
+    QTimer *burstTimer;
+    QElapsedTimer burstClock;
+    int burstSent = 0;
+
     QString apiKey;  // API密钥从配置文件加载
+    QString aiEndpoint;      // 配置文件中的 AI_ENDPOINT，留空使用默认接口
+    int aiCacheMb = 8;       // 配置文件中的 AI_CACHE_MB
+    int aiConcurrency = 2;   // 配置文件中的 AI_CONCURRENCY
+    bool aiH2c = false;      // 配置文件中的 AI_H2C，明文地址直接用 HTTP/2
+    int historyWindow = 0;  // 配置文件中的 CHAT_HISTORY_WINDOW，0 表示使用默认值
+    int hibernateMinutes = 10;  // 配置文件中的 CHAT_HIBERNATE_MINUTES，0 表示不休眠
+    int aiContextTokens = ChatContext::kDefaultTokenBudget;  // 配置文件中的 AI_CONTEXT_TOKENS
 };
 
 #endif // MAINWINDOW_H
@@ -0,0 +1,218 @@
+#include "messagestore.h"
+
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDir>
+#include <QFile>
+#include <QSaveFile>
+#include <QtEndian>
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+const QByteArray kMagic("ROOMLOG1");
+constexpr qint64 kLengthBytes = 4;
+// 单条记录的上限，防止损坏的长度字段被当成有效记录
+constexpr quint32 kMaxRecordBytes = 1024 * 1024;
+// 单个房间文件超过该大小时重写，只保留较新的一半
+constexpr qint64 kMaxFileBytes = 4 * 1024 * 1024;
+
+QByteArray encodeRecord(const MessageStore::Record &record)
+{
+    QByteArray payload;
+    QDataStream out(&payload, QIODevice::WriteOnly);
+    const ChatModel::Entry &entry = record.entry;
+    out << record.epoch << record.seq << record.ts << quint8(entry.kind)
+        << entry.time << entry.from << entry.text << entry.hash << entry.size;
+
+    QByteArray length(kLengthBytes, Qt::Uninitialized);
+    qToLittleEndian<quint32>(quint32(payload.size()), length.data());
+    return length + payload + length;
+}
+
+bool decodeRecord(const uchar *data, quint32 length, MessageStore::Record *record)
+{
+    const QByteArray payload = QByteArray::fromRawData(reinterpret_cast<const char *>(data), length);
+    QDataStream in(payload);
+    ChatModel::Entry &entry = record->entry;
+    quint8 kind = 0;
+    in >> record->epoch >> record->seq >> record->ts >> kind
+       >> entry.time >> entry.from >> entry.text >> entry.hash >> entry.size;
+    entry.kind = ChatModel::Kind(kind);
+    return in.status() == QDataStream::Ok;
+}
+
+// 以 end 结尾的那条记录的起始位置，结构不完整时返回 -1
+qint64 recordBefore(const uchar *data, qint64 end)
+{
+    if (end - 2 * kLengthBytes < kMagic.size()) {
+        return -1;
+    }
+    const quint32 length = qFromLittleEndian<quint32>(data + end - kLengthBytes);
+    const qint64 begin = end - 2 * kLengthBytes - length;
+    if (length > kMaxRecordBytes || begin < kMagic.size()
+        || qFromLittleEndian<quint32>(data + begin) != length) {
+        return -1;
+    }
+    return begin;
+}
+
+// 文件中完整记录的结尾位置；魔数不对时返回 -1
+qint64 validEnd(QFile *file)
+{
+    const qint64 size = file->size();
+    if (size < kMagic.size()) {
+        return -1;
+    }
+    uchar *data = file->map(0, size);
+    if (!data) {
+        return -1;
+    }
+    qint64 good = -1;
+    if (std::memcmp(data, kMagic.constData(), kMagic.size()) == 0) {
+        // 正常关闭的文件最后一条记录完整，不必从头扫描
+        if (size == kMagic.size() || recordBefore(data, size) >= 0) {
+            good = size;
+        } else {
+            good = kMagic.size();
+            while (good + 2 * kLengthBytes <= size) {
+                const quint32 length = qFromLittleEndian<quint32>(data + good);
+                const qint64 end = good + 2 * kLengthBytes + length;
+                if (length > kMaxRecordBytes || end > size
+                    || qFromLittleEndian<quint32>(data + end - kLengthBytes) != length) {
+                    break;
+                }
+                good = end;
+            }
+        }
+    }
+    file->unmap(data);
+    return good;
+}
+}
+
+MessageStore::MessageStore(const QString &directory)
+    : dir(directory)
+{
+}
+
+MessageStore::~MessageStore()
+{
+    qDeleteAll(writers);
+}
+
+QString MessageStore::pathFor(const QString &room) const
+{
+    // 房间名可能含有文件名不允许的字符
+    const QByteArray name = QCryptographicHash::hash(room.toUtf8(), QCryptographicHash::Sha1).toHex();
+    return QDir(dir).filePath(QString::fromLatin1(name) + ".log");
+}
+
+QFile *MessageStore::writerFor(const QString &room)
+{
+    if (QFile *file = writers.value(room)) {
+        return file;
+    }
+    QDir().mkpath(dir);
+    auto *file = new QFile(pathFor(room));
+    if (!file->open(QIODevice::ReadWrite)) {
+        delete file;
+        return nullptr;
+    }
+    // 崩溃时可能留下半条记录，截掉后继续追加
+    const qint64 good = validEnd(file);
+    if (good < 0) {
+        file->resize(0);
+        file->write(kMagic);
+    } else if (good < file->size()) {
+        file->resize(good);
+    }
+    file->seek(file->size());
+    writers.insert(room, file);
+    return file;
+}
+
+bool MessageStore::append(const QString &room, const Record &record)
+{
+    QFile *file = writerFor(room);
+    if (!file) {
+        return false;
+    }
+    const QByteArray data = encodeRecord(record);
+    if (file->write(data) != data.size() || !file->flush()) {
+        return false;
+    }
+    if (file->size() > kMaxFileBytes) {
+        compact(room);
+    }
+    return true;
+}
+
+QList<MessageStore::Record> MessageStore::tail(const QString &room, int count)
+{
+    QList<Record> records;
+    QFile file(pathFor(room));
+    if (count <= 0 || !file.open(QIODevice::ReadOnly) || file.size() <= kMagic.size()) {
+        return records;
+    }
+    const qint64 size = file.size();
+    uchar *data = file.map(0, size);
+    if (!data) {
+        return records;
+    }
+    if (std::memcmp(data, kMagic.constData(), kMagic.size()) == 0) {
+        // 从文件尾部往前只解码需要的几条，与文件总长度无关
+        qint64 end = size;
+        while (records.size() < count) {
+            const qint64 begin = recordBefore(data, end);
+            Record record;
+            if (begin < 0 || !decodeRecord(data + begin + kLengthBytes, quint32(end - begin - 2 * kLengthBytes), &record)) {
+                break;
+            }
+            records.append(std::move(record));
+            end = begin;
+        }
+    }
+    file.unmap(data);
+    std::reverse(records.begin(), records.end());
+    return records;
+}
+
+void MessageStore::close(const QString &room)
+{
+    delete writers.take(room);
+}
+
+void MessageStore::compact(const QString &room)
+{
+    close(room);
+    QFile in(pathFor(room));
+    if (!in.open(QIODevice::ReadOnly)) {
+        return;
+    }
+    const qint64 size = in.size();
+    uchar *data = in.map(0, size);
+    if (!data) {
+        return;
+    }
+    // 从尾部往前找到保留一半大小的记录边界
+    qint64 cut = size;
+    while (size - cut < kMaxFileBytes / 2) {
+        const qint64 begin = recordBefore(data, cut);
+        if (begin < 0) {
+            break;
+        }
+        cut = begin;
+    }
+    QSaveFile out(in.fileName());
+    if (out.open(QIODevice::WriteOnly)) {
+        out.write(kMagic);
+        out.write(reinterpret_cast<const char *>(data + cut), size - cut);
+        in.unmap(data);
+        in.close();
+        out.commit();
+    } else {
+        in.unmap(data);
+    }
+}
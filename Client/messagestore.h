@@ -0,0 +1,46 @@
+#ifndef MESSAGESTORE_H
+#define MESSAGESTORE_H
+
+#include <QHash>
+#include <QList>
+#include <QString>
+
+#include "chatmodel.h"
+
+class QFile;
+
+// 本地的分房间消息缓存。每个房间一个只追加的文件，记录收到的聊天和附件消息；
+// 重新打开房间时用内存映射从文件尾部往前读出最近若干条直接显示，
+// 再用最后一条的位置（房间 epoch + 序号，或时间戳）只向服务器要缺的部分。
+//
+// 文件为 8 字节魔数加一串记录，每条记录是 [长度][QDataStream 序列化的内容][长度]，
+// 末尾的长度用来从后往前遍历；写到一半的记录在下次打开时截掉。
+class MessageStore
+{
+public:
+    struct Record {
+        qint64 epoch = 0;   // 服务器房间日志的 epoch，不同 epoch 的序号不能比较
+        quint64 seq = 0;
+        qint64 ts = 0;      // 服务器时间戳（毫秒）
+        ChatModel::Entry entry;
+    };
+
+    explicit MessageStore(const QString &directory);
+    ~MessageStore();
+
+    bool append(const QString &room, const Record &record);
+    // 最近的 count 条，按先后顺序排列
+    QList<Record> tail(const QString &room, int count);
+    // 关闭房间文件的写句柄，下次追加时重新打开
+    void close(const QString &room);
+
+private:
+    QString pathFor(const QString &room) const;
+    QFile *writerFor(const QString &room);
+    void compact(const QString &room);
+
+    QString dir;
+    QHash<QString, QFile *> writers;
+};
+
+#endif // MESSAGESTORE_H
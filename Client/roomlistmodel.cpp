@@ -0,0 +1,309 @@
+#include "roomlistmodel.h"
+
+#include <algorithm>
+#include <iterator>
+#include <utility>
+
+namespace {
+// 三元组倒排索引覆盖的最短查询
+constexpr int kGramLength = 3;
+// 一次更新拆成的插入 / 删除段超过这么多时直接重置模型
+constexpr int kMaxDiffOps = 256;
+// 已删除房间残留在索引里的条目超过存活条目时重建索引
+constexpr qsizetype kMinStalePostings = 1024;
+
+quint64 gramAt(const QString &key, qsizetype pos)
+{
+    return (quint64(key.at(pos).unicode()) << 32)
+         | (quint64(key.at(pos + 1).unicode()) << 16)
+         | quint64(key.at(pos + 2).unicode());
+}
+
+QList<quint64> gramsOf(const QString &key)
+{
+    QList<quint64> grams;
+    for (qsizetype pos = 0; pos + kGramLength <= key.size(); ++pos) {
+        grams.append(gramAt(key, pos));
+    }
+    std::sort(grams.begin(), grams.end());
+    grams.erase(std::unique(grams.begin(), grams.end()), grams.end());
+    return grams;
+}
+}
+
+RoomListModel::RoomListModel(QObject *parent)
+    : QAbstractListModel(parent)
+{
+}
+
+int RoomListModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : int(rows.size());
+}
+
+QVariant RoomListModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= rows.size()) {
+        return QVariant();
+    }
+    const Room &room = roomSlots.at(rows.at(index.row()));
+    if (role == Qt::DisplayRole) {
+        return room.members >= 0 ? QString("%1 (%2)").arg(room.name).arg(room.members) : room.name;
+    }
+    if (role == Qt::EditRole) {
+        return room.name;
+    }
+    return QVariant();
+}
+
+void RoomListModel::setMemberCounts(const QHash<QString, int> &counts)
+{
+    for (auto it = counts.cbegin(); it != counts.cend(); ++it) {
+        const int id = idByName.value(it.key(), -1);
+        if (id >= 0) {
+            roomSlots[id].members = it.value();
+        }
+    }
+    if (!rows.isEmpty()) {
+        emit dataChanged(index(0), index(int(rows.size()) - 1), {Qt::DisplayRole});
+    }
+}
+
+QStringList RoomListModel::rooms() const
+{
+    QStringList names;
+    names.reserve(sorted.size());
+    for (int id : sorted) {
+        names.append(roomSlots.at(id).name);
+    }
+    return names;
+}
+
+QString RoomListModel::roomAt(int row) const
+{
+    return row >= 0 && row < rows.size() ? roomSlots.at(rows.at(row)).name : QString();
+}
+
+bool RoomListModel::lessThan(int a, int b) const
+{
+    const Room &left = roomSlots.at(a);
+    const Room &right = roomSlots.at(b);
+    const int order = left.key.compare(right.key);
+    return order != 0 ? order < 0 : left.name < right.name;
+}
+
+void RoomListModel::setRooms(const QStringList &rooms)
+{
+    // 标出仍在列表中的房间，新出现的房间分配编号
+    for (int id : std::as_const(sorted)) {
+        roomSlots[id].listed = false;
+    }
+    QList<int> added;
+    for (const QString &name : rooms) {
+        if (name.isEmpty()) {
+            continue;
+        }
+        const int id = idByName.value(name, -1);
+        if (id < 0) {
+            added.append(addRoom(name));
+        } else if (!roomSlots.at(id).listed) {
+            roomSlots[id].listed = true;
+        }
+    }
+
+    QList<int> removed;
+    QList<int> kept;
+    kept.reserve(sorted.size());
+    for (int id : std::as_const(sorted)) {
+        (roomSlots.at(id).listed ? kept : removed).append(id);
+    }
+    // 已有的房间本来就有序，只需给新房间排序后归并
+    const QList<int> fresh = sortedIds(added);
+    QList<int> merged;
+    merged.reserve(kept.size() + fresh.size());
+    std::merge(kept.cbegin(), kept.cend(), fresh.cbegin(), fresh.cend(), std::back_inserter(merged),
+               [this](int a, int b) { return lessThan(a, b); });
+    sorted = std::move(merged);
+
+    applyRows(filterText.isEmpty() ? sorted : matchAll(filterText));
+
+    // 比较时还要用到被删除房间的名称，最后再释放
+    for (int id : std::as_const(removed)) {
+        removeRoom(id);
+    }
+}
+
+void RoomListModel::setFilter(const QString &text)
+{
+    const QString folded = text.trimmed().toCaseFolded();
+    if (folded == filterText) {
+        return;
+    }
+    QList<int> next;
+    if (folded.isEmpty()) {
+        next = sorted;
+    } else if (!filterText.isEmpty() && folded.contains(filterText)) {
+        // 新查询包含旧查询，结果一定在当前显示的行里
+        next = refine(rows, folded);
+    } else {
+        next = matchAll(folded);
+    }
+    filterText = folded;
+    applyRows(std::move(next));
+}
+
+int RoomListModel::addRoom(const QString &name)
+{
+    int id;
+    if (freeSlots.isEmpty()) {
+        id = int(roomSlots.size());
+        roomSlots.append(Room());
+    } else {
+        id = freeSlots.takeLast();
+    }
+    Room &room = roomSlots[id];
+    room.name = name;
+    room.key = name.toCaseFolded();
+    room.listed = true;
+    idByName.insert(name, id);
+    indexRoom(id);
+    return id;
+}
+
+void RoomListModel::removeRoom(int id)
+{
+    Room &room = roomSlots[id];
+    idByName.remove(room.name);
+    // 索引里的条目不逐个删除，查询时按名称校验；残留过多时整体重建
+    livePostings -= room.grams;
+    stalePostings += room.grams;
+    room = Room();
+    freeSlots.append(id);
+    if (stalePostings > qMax(livePostings, kMinStalePostings)) {
+        rebuildIndex();
+    }
+}
+
+void RoomListModel::indexRoom(int id)
+{
+    Room &room = roomSlots[id];
+    const QList<quint64> grams = gramsOf(room.key);
+    for (quint64 gram : grams) {
+        trigrams[gram].append(id);
+    }
+    room.grams = int(grams.size());
+    livePostings += room.grams;
+}
+
+void RoomListModel::rebuildIndex()
+{
+    trigrams.clear();
+    livePostings = 0;
+    stalePostings = 0;
+    for (int id = 0; id < roomSlots.size(); ++id) {
+        if (!roomSlots.at(id).name.isEmpty()) {
+            indexRoom(id);
+        }
+    }
+}
+
+QList<int> RoomListModel::sortedIds(const QList<int> &ids) const
+{
+    QList<int> result = ids;
+    std::sort(result.begin(), result.end(), [this](int a, int b) { return lessThan(a, b); });
+    result.erase(std::unique(result.begin(), result.end()), result.end());
+    return result;
+}
+
+QList<int> RoomListModel::matchAll(const QString &needle) const
+{
+    if (needle.size() < kGramLength) {
+        return refine(sorted, needle);
+    }
+    // 取查询里出现次数最少的三元组，只校验它的倒排列表
+    const QList<int> *shortest = nullptr;
+    for (qsizetype pos = 0; pos + kGramLength <= needle.size(); ++pos) {
+        auto it = trigrams.constFind(gramAt(needle, pos));
+        if (it == trigrams.cend()) {
+            return {};
+        }
+        if (!shortest || it->size() < shortest->size()) {
+            shortest = &it.value();
+        }
+    }
+    QList<int> matches;
+    for (int id : *shortest) {
+        const Room &room = roomSlots.at(id);
+        if (room.listed && room.key.contains(needle)) {
+            matches.append(id);
+        }
+    }
+    return sortedIds(matches);
+}
+
+QList<int> RoomListModel::refine(const QList<int> &candidates, const QString &needle) const
+{
+    QList<int> matches;
+    for (int id : candidates) {
+        const Room &room = roomSlots.at(id);
+        if (room.listed && room.key.contains(needle)) {
+            matches.append(id);
+        }
+    }
+    return matches;
+}
+
+void RoomListModel::applyRows(QList<int> next)
+{
+    // 两个列表按同一顺序排列，归并一遍得到需要删除和插入的连续段
+    struct Op {
+        bool insert;
+        int pos;
+        int from;
+        int count;
+    };
+    QList<Op> ops;
+    int i = 0;
+    int j = 0;
+    int pos = 0;
+    while ((i < rows.size() || j < next.size()) && ops.size() <= kMaxDiffOps) {
+        if (i < rows.size() && j < next.size() && rows.at(i) == next.at(j)) {
+            ++i;
+            ++j;
+            ++pos;
+        } else if (j == next.size() || (i < rows.size() && lessThan(rows.at(i), next.at(j)))) {
+            const int start = i;
+            while (i < rows.size() && (j == next.size() || lessThan(rows.at(i), next.at(j)))) {
+                ++i;
+            }
+            ops.append({false, pos, 0, i - start});
+        } else {
+            const int start = j;
+            while (j < next.size() && (i == rows.size() || lessThan(next.at(j), rows.at(i)))) {
+                ++j;
+            }
+            ops.append({true, pos, start, j - start});
+            pos += j - start;
+        }
+    }
+
+    if (ops.size() > kMaxDiffOps) {
+        // 变化太分散时逐段通知反而更慢，视图的选中项由调用方按名称恢复
+        beginResetModel();
+        rows = std::move(next);
+        endResetModel();
+        return;
+    }
+    for (const Op &op : std::as_const(ops)) {
+        if (op.insert) {
+            beginInsertRows(QModelIndex(), op.pos, op.pos + op.count - 1);
+            rows.insert(op.pos, op.count, 0);
+            std::copy(next.cbegin() + op.from, next.cbegin() + op.from + op.count, rows.begin() + op.pos);
+            endInsertRows();
+        } else {
+            beginRemoveRows(QModelIndex(), op.pos, op.pos + op.count - 1);
+            rows.remove(op.pos, op.count);
+            endRemoveRows();
+        }
+    }
+}
@@ -0,0 +1,65 @@
+#ifndef ROOMLISTMODEL_H
+#define ROOMLISTMODEL_H
+
+#include <QAbstractListModel>
+#include <QHash>
+#include <QList>
+#include <QStringList>
+
+// 聊天室列表模型，按名称（忽略大小写）排序。
+// 新的房间列表到达时与当前列表逐项比较，只插入和删除变化的行，
+// 视图的选中项和滚动位置不受影响。
+// 搜索按子串过滤：三个字符起用三元组倒排索引找候选，
+// 更短的查询直接扫描；输入在上一次查询基础上加长时只在上次结果里筛。
+class RoomListModel : public QAbstractListModel
+{
+    Q_OBJECT
+public:
+    explicit RoomListModel(QObject *parent = nullptr);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+
+    void setRooms(const QStringList &rooms);
+    // 服务器给出的成员数，显示在名称后面；不在表里的房间不显示
+    void setMemberCounts(const QHash<QString, int> &counts);
+    // 所有房间，按显示顺序
+    QStringList rooms() const;
+    void setFilter(const QString &text);
+    QString filter() const { return filterText; }
+
+    QString roomAt(int row) const;
+    int totalCount() const { return int(sorted.size()); }
+
+private:
+    struct Room {
+        QString name;        // 空表示编号空闲，可以复用
+        QString key;         // 折叠大小写后的名称，用于排序和搜索
+        int grams = 0;       // 写进倒排索引的三元组个数
+        int members = -1;    // 未知时为 -1
+        bool listed = false; // 在当前房间列表中
+    };
+
+    bool lessThan(int a, int b) const;
+    int addRoom(const QString &name);
+    void removeRoom(int id);
+    void indexRoom(int id);
+    void rebuildIndex();
+    QList<int> sortedIds(const QList<int> &ids) const;
+    QList<int> matchAll(const QString &needle) const;
+    QList<int> refine(const QList<int> &candidates, const QString &needle) const;
+    void applyRows(QList<int> next);
+
+    QList<Room> roomSlots;                   // 编号 -> 房间，编号在房间存在期间不变
+    QList<int> freeSlots;
+    QHash<QString, int> idByName;
+    QList<int> sorted;                       // 所有房间，按 key 排序
+    QHash<quint64, QList<int>> trigrams;     // 三元组 -> 房间编号，可能含已删除的编号
+    qsizetype livePostings = 0;
+    qsizetype stalePostings = 0;
+
+    QString filterText;                      // 已折叠大小写
+    QList<int> rows;                         // 当前显示的房间编号
+};
+
+#endif // ROOMLISTMODEL_H
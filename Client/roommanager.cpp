@@ -3,10 +3,23 @@
 #include <QVBoxLayout>
 #include <QLabel>
 #include <QGroupBox>
+#include <QJsonArray>
+#include <QScrollBar>
+#include <QTimer>
+
+#include "roomlistmodel.h"
+
+namespace {
+// 停止输入这么久之后才向服务器查询新的前缀
+constexpr int kSearchDelayMs = 250;
+}
 
 RoomManager::RoomManager(QWidget *parent)
     : QWidget(parent)
+    , searchTimer(new QTimer(this))
 {
+    searchTimer->setSingleShot(true);
+    searchTimer->setInterval(kSearchDelayMs);
     setupUI();
 }
 
@@ -21,7 +34,7 @@ void RoomManager::setupUI()
             font-family: "Microsoft YaHei";
             font-size: 10pt;
         }
-        QListWidget {
+        QListView {
             border: 1px solid #5a5a5a;
             border-radius: 6px;
             background-color: #3c3f41;
@@ -29,7 +42,7 @@ void RoomManager::setupUI()
             font-family: "Microsoft YaHei";
             font-size: 10pt;
         }
-        QListWidget::item:selected {
+        QListView::item:selected {
             background-color: #5ac2c6;
             color: white;
         }
@@ -69,10 +82,20 @@ void RoomManager::setupUI()
     titleLabel->setStyleSheet("font-size: 12pt; font-weight: bold; color: #5ac2c6;");
     layout->addWidget(titleLabel);
 
-    auto *listLabel = new QLabel("可用聊天室:", this);
+    listLabel = new QLabel("可用聊天室:", this);
     layout->addWidget(listLabel);
 
-    roomList = new QListWidget(this);
+    searchEdit = new QLineEdit(this);
+    searchEdit->setPlaceholderText("搜索聊天室");
+    searchEdit->setClearButtonEnabled(true);
+    layout->addWidget(searchEdit);
+
+    // 行高一致时视图不必逐行测量，十万个房间也能立即滚动
+    roomModel = new RoomListModel(this);
+    roomList = new QListView(this);
+    roomList->setModel(roomModel);
+    roomList->setUniformItemSizes(true);
+    roomList->setEditTriggers(QAbstractItemView::NoEditTriggers);
     roomList->setMaximumHeight(150);
     layout->addWidget(roomList);
 
@@ -95,21 +118,118 @@ void RoomManager::setupUI()
 
     connect(createButton, &QPushButton::clicked, this, &RoomManager::onCreateClicked);
     connect(joinButton, &QPushButton::clicked, this, &RoomManager::onJoinClicked);
-    connect(roomList, &QListWidget::itemDoubleClicked, this, &RoomManager::onJoinClicked);
+    connect(roomList, &QListView::doubleClicked, this, &RoomManager::onJoinClicked);
     connect(newRoomEdit, &QLineEdit::returnPressed, this, &RoomManager::onCreateClicked);
+    // 已加载的房间在本地即时过滤，停止输入后再按前缀向服务器要完整结果
+    connect(searchEdit, &QLineEdit::textChanged, this, [this](const QString &text) {
+        roomModel->setFilter(text);
+        updateCountLabel();
+        searchTimer->start();
+    });
+    connect(searchTimer, &QTimer::timeout, this, [this]() {
+        const QString prefix = searchEdit->text().trimmed();
+        if (prefix != queryPrefix) {
+            queryPrefix = prefix;
+            nextCursor.clear();
+            loadingPage = true;
+            emit roomQueryRequested(prefix, QString());
+        }
+    });
+    connect(roomList->verticalScrollBar(), &QScrollBar::valueChanged, this, &RoomManager::onListScrolled);
+    connect(searchEdit, &QLineEdit::returnPressed, this, &RoomManager::onJoinClicked);
 }
 
 void RoomManager::updateRoomList(const QStringList &rooms)
 {
-    roomList->clear();
-    for (const QString &room : rooms) {
-        roomList->addItem(room);
+    // 模型只插入 / 删除变化的行；变化太多被重置时按名称恢复选中项
+    const QString selected = roomModel->roomAt(roomList->currentIndex().row());
+    roomModel->setRooms(rooms);
+    if (!selected.isEmpty() && !roomList->currentIndex().isValid()) {
+        for (int row = 0; row < roomModel->rowCount(); ++row) {
+            if (roomModel->roomAt(row) == selected) {
+                roomList->setCurrentIndex(roomModel->index(row));
+                roomList->scrollTo(roomModel->index(row));
+                break;
+            }
+        }
+    }
+    updateCountLabel();
+}
+
+void RoomManager::applyRoomPage(const QJsonObject &page)
+{
+    // 输入已经变了，旧前缀的结果不再需要
+    if (page.value("prefix").toString() != queryPrefix) {
+        return;
+    }
+    const bool firstPage = page.value("cursor").toString().isEmpty();
+    QStringList names = firstPage ? QStringList() : roomModel->rooms();
+    QHash<QString, int> members;
+    const QJsonArray arr = page.value("rooms").toArray();
+    for (const QJsonValue &val : arr) {
+        const QJsonObject room = val.toObject();
+        names.append(room.value("name").toString());
+        members.insert(room.value("name").toString(), room.value("members").toInt());
+    }
+    nextCursor = page.value("next").toString();
+    serverTotal = page.value("total").toInt();
+    loadingPage = false;
+    updateRoomList(names);
+    roomModel->setMemberCounts(members);
+}
+
+void RoomManager::applyRoomChanges(const QStringList &added, const QStringList &removed)
+{
+    QStringList names = roomModel->rooms();
+    // 只有落在当前前缀里的房间才影响列表和总数，被删的房间可能还没翻到
+    const QString folded = queryPrefix.toCaseFolded();
+    for (const QString &room : removed) {
+        names.removeOne(room);
+        if (room.toCaseFolded().startsWith(folded)) {
+            serverTotal = qMax(0, serverTotal - 1);
+        }
+    }
+    for (const QString &room : added) {
+        if (room.toCaseFolded().startsWith(folded)) {
+            names.append(room);
+            ++serverTotal;
+        }
+    }
+    updateRoomList(names);
+}
+
+void RoomManager::applyLoginPage(const QJsonObject &page)
+{
+    if (queryPrefix.isEmpty()) {
+        applyRoomPage(page);
+        return;
     }
+    nextCursor.clear();
+    loadingPage = true;
+    emit roomQueryRequested(queryPrefix, QString());
+}
+
+void RoomManager::onListScrolled(int value)
+{
+    if (loadingPage || nextCursor.isEmpty() || value < roomList->verticalScrollBar()->maximum()) {
+        return;
+    }
+    loadingPage = true;
+    emit roomQueryRequested(queryPrefix, nextCursor);
+}
+
+void RoomManager::updateCountLabel()
+{
+    const int total = qMax(roomModel->totalCount(), serverTotal);
+    const int shown = roomModel->rowCount();
+    listLabel->setText(shown == total ? QString("可用聊天室 (%1):").arg(total)
+                                      : QString("可用聊天室 (%1/%2):").arg(shown).arg(total));
 }
 
 void RoomManager::setEnabled(bool enabled)
 {
     roomList->setEnabled(enabled);
+    searchEdit->setEnabled(enabled);
     newRoomEdit->setEnabled(enabled);
     createButton->setEnabled(enabled);
     joinButton->setEnabled(enabled);
@@ -126,8 +246,10 @@ void RoomManager::onCreateClicked()
 
 void RoomManager::onJoinClicked()
 {
-    auto *item = roomList->currentItem();
-    if (item) {
-        emit joinRoomRequested(item->text());
+    const QModelIndex current = roomList->currentIndex();
+    // 搜索框回车时没有选中项就加入第一个匹配的房间
+    const QString room = roomModel->roomAt(current.isValid() ? current.row() : 0);
+    if (!room.isEmpty()) {
+        emit joinRoomRequested(room);
     }
 }
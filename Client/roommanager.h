@@ -2,9 +2,14 @@
 #define ROOMMANAGER_H
 
 #include <QWidget>
-#include <QListWidget>
+#include <QListView>
 #include <QLineEdit>
 #include <QPushButton>
+#include <QLabel>
+#include <QJsonObject>
+
+class RoomListModel;
+class QTimer;
 
 class RoomManager : public QWidget
 {
@@ -13,11 +18,19 @@ public:
     explicit RoomManager(QWidget *parent = nullptr);
 
     void updateRoomList(const QStringList &rooms);
+    // 服务器返回的一页房间（login_ok 或 room_list）；cursor 为空时替换列表，否则追加
+    void applyRoomPage(const QJsonObject &page);
+    // room_update：其他用户创建或删除了房间
+    void applyRoomChanges(const QStringList &added, const QStringList &removed);
+    // 登录（包括重连后的自动登录）带回的第一页没有前缀；正在搜索时改为重新查询
+    void applyLoginPage(const QJsonObject &page);
     void setEnabled(bool enabled);
 
 signals:
     void createRoomRequested(const QString &roomName);
     void joinRoomRequested(const QString &roomName);
+    // 需要向服务器请求房间列表：新的搜索前缀，或翻到底部时的下一页
+    void roomQueryRequested(const QString &prefix, const QString &cursor);
 
 private slots:
     void onCreateClicked();
@@ -25,8 +38,18 @@ private slots:
 
 private:
     void setupUI();
-
-    QListWidget *roomList;
+    void updateCountLabel();
+    void onListScrolled(int value);
+
+    QLabel *listLabel;
+    QLineEdit *searchEdit;
+    QListView *roomList;
+    RoomListModel *roomModel;
+    QTimer *searchTimer;
+    QString queryPrefix;     // 当前列表对应的服务器端前缀
+    QString nextCursor;      // 下一页的游标，为空表示已经取完
+    bool loadingPage = false;
+    int serverTotal = 0;     // 服务器上匹配前缀的房间总数
     QLineEdit *newRoomEdit;
     QPushButton *createButton;
     QPushButton *joinButton;
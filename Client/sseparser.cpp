@@ -0,0 +1,62 @@
+#include "sseparser.h"
+
+void SseParser::feed(const QByteArray &data)
+{
+    buffer.append(data);
+    for (qsizetype nl = buffer.indexOf('\n', pos); nl >= 0; nl = buffer.indexOf('\n', pos)) {
+        QByteArrayView line(buffer.constData() + pos, nl - pos);
+        pos = nl + 1;
+        if (line.endsWith('\r')) {
+            line.chop(1);
+        }
+        if (line.isEmpty()) {
+            if (hasData) {
+                events.append(eventData);
+            }
+            eventData.clear();
+            hasData = false;
+        } else if (line.startsWith("data:")) {
+            QByteArrayView value = line.sliced(5);
+            if (value.startsWith(' ')) {
+                value = value.sliced(1);
+            }
+            if (hasData) {
+                eventData.append('\n');
+            }
+            eventData.append(value);
+            hasData = true;
+        }
+        // 注释（以冒号开头）和 event / id / retry 字段不需要
+    }
+    // 已解析的部分攒够一半再整体移走，避免每次都搬动缓冲
+    if (pos > 4096 && pos * 2 > buffer.size()) {
+        buffer.remove(0, pos);
+        pos = 0;
+    }
+}
+
+bool SseParser::next(QByteArray *data)
+{
+    if (nextEvent >= events.size()) {
+        events.clear();
+        nextEvent = 0;
+        return false;
+    }
+    *data = std::move(events[nextEvent++]);
+    return true;
+}
+
+void SseParser::finish()
+{
+    feed("\n\n");
+}
+
+void SseParser::clear()
+{
+    buffer.clear();
+    pos = 0;
+    eventData.clear();
+    hasData = false;
+    events.clear();
+    nextEvent = 0;
+}
@@ -0,0 +1,28 @@
+#ifndef SSEPARSER_H
+#define SSEPARSER_H
+
+#include <QByteArray>
+#include <QList>
+
+// 增量解析 text/event-stream。数据可以在任意位置被切开，
+// 每个事件以空行结束，只收集 data 字段（多行 data 以换行拼接）。
+class SseParser
+{
+public:
+    void feed(const QByteArray &data);
+    // 取出下一个完整事件的 data，没有时返回 false
+    bool next(QByteArray *data);
+    // 连接结束时把没有以空行结尾的最后一个事件也交出来
+    void finish();
+    void clear();
+
+private:
+    QByteArray buffer;
+    qsizetype pos = 0;
+    QByteArray eventData;
+    bool hasData = false;
+    QList<QByteArray> events;
+    qsizetype nextEvent = 0;
+};
+
+#endif // SSEPARSER_H
@@ -0,0 +1,111 @@
+#include "capturefile.h"
+
+namespace Capture {
+
+namespace {
+const QByteArray kMagic("AICHCAP1");
+// 单帧上限，防止损坏的文件让读取方分配过大的内存
+constexpr quint64 kMaxPayload = 64 * 1024 * 1024;
+
+void appendVarint(QByteArray &out, quint64 value)
+{
+    while (value >= 0x80) {
+        out.append(char((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    out.append(char(value));
+}
+}
+
+bool Writer::open(const QString &path)
+{
+    file.setFileName(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        return false;
+    }
+    file.write(kMagic);
+    lastTimeUs = 0;
+    return true;
+}
+
+void Writer::write(const Event &event)
+{
+    QByteArray record;
+    record.reserve(event.payload.size() + 16);
+    record.append(char(event.type));
+    appendVarint(record, event.connection);
+    appendVarint(record, quint64(qMax<qint64>(0, event.timeUs - lastTimeUs)));
+    appendVarint(record, quint64(event.payload.size()));
+    record.append(event.payload);
+    file.write(record);
+    lastTimeUs = qMax(lastTimeUs, event.timeUs);
+}
+
+void Writer::flush()
+{
+    file.flush();
+}
+
+void Writer::close()
+{
+    file.close();
+}
+
+bool Reader::open(const QString &path)
+{
+    file.setFileName(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        error = file.errorString();
+        return false;
+    }
+    if (file.read(kMagic.size()) != kMagic) {
+        error = "not a capture file";
+        return false;
+    }
+    lastTimeUs = 0;
+    return true;
+}
+
+bool Reader::readVarint(quint64 *value)
+{
+    *value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        char byte;
+        if (!file.getChar(&byte)) {
+            return false;
+        }
+        *value |= quint64(quint8(byte) & 0x7F) << shift;
+        if (!(quint8(byte) & 0x80)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool Reader::next(Event *event)
+{
+    char type;
+    if (!file.getChar(&type)) {
+        return false;
+    }
+    quint64 connection = 0;
+    quint64 delta = 0;
+    quint64 size = 0;
+    if (type < Connect || type > Disconnect || !readVarint(&connection) || !readVarint(&delta)
+        || !readVarint(&size) || size > kMaxPayload) {
+        error = "corrupt record";
+        return false;
+    }
+    event->payload = file.read(qint64(size));
+    if (quint64(event->payload.size()) != size) {
+        error = "truncated record";
+        return false;
+    }
+    lastTimeUs += qint64(delta);
+    event->type = EventType(type);
+    event->connection = connection;
+    event->timeUs = lastTimeUs;
+    return true;
+}
+
+} // namespace Capture
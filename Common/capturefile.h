@@ -0,0 +1,59 @@
+#ifndef CAPTUREFILE_H
+#define CAPTUREFILE_H
+
+#include <QByteArray>
+#include <QFile>
+#include <QString>
+
+// 流量抓包文件：服务器记录的入站帧，供 Tools/replay 回放。
+// 文件头之后每条事件为：类型(1 字节) + 连接编号 + 距上一事件的微秒数 + 负载长度 + 负载，
+// 数值都用 LEB128 变长编码。
+namespace Capture {
+
+enum EventType : quint8 {
+    Connect = 1,
+    Frame = 2,      // 客户端发来的一行（不含换行）
+    Disconnect = 3
+};
+
+struct Event {
+    EventType type = Frame;
+    quint64 connection = 0;
+    qint64 timeUs = 0;      // 距抓包开始的微秒数
+    QByteArray payload;
+};
+
+class Writer
+{
+public:
+    bool open(const QString &path);
+    bool isOpen() const { return file.isOpen(); }
+    void write(const Event &event);
+    void flush();
+    void close();
+    QString errorString() const { return file.errorString(); }
+
+private:
+    QFile file;
+    qint64 lastTimeUs = 0;
+};
+
+class Reader
+{
+public:
+    bool open(const QString &path);
+    // 读到文件末尾或遇到损坏的记录时返回 false
+    bool next(Event *event);
+    QString errorString() const { return error; }
+
+private:
+    bool readVarint(quint64 *value);
+
+    QFile file;
+    qint64 lastTimeUs = 0;
+    QString error;
+};
+
+} // namespace Capture
+
+#endif // CAPTUREFILE_H
@@ -0,0 +1,112 @@
+#include "chatcontext.h"
+
+namespace {
+// 每行的换行和格式开销
+constexpr int kLineOverheadTokens = 1;
+constexpr int kMinTokenBudget = 64;
+}
+
+ChatContext::ChatContext(int tokenBudget)
+    : budget(qMax(kMinTokenBudget, tokenBudget))
+{
+}
+
+void ChatContext::append(const QString &line)
+{
+    Line entry{line, estimateTokens(line) + kLineOverheadTokens};
+    if (entry.tokens > budget) {
+        // 单条消息就超出预算时只保留开头
+        int used = kLineOverheadTokens;
+        int ascii = 0;
+        qsizetype cut = 0;
+        for (; cut < line.size(); ++cut) {
+            if (line.at(cut).unicode() < 0x80) {
+                if (ascii++ % 4 == 0) {
+                    ++used;
+                }
+            } else {
+                ++used;
+            }
+            if (used > budget) {
+                break;
+            }
+        }
+        entry.text = line.left(cut) + "…";
+        entry.tokens = qMin(budget, used);
+    }
+
+    lines.append(std::move(entry));
+    tokens += lines.last().tokens;
+    while (tokens > budget && head < lines.size()) {
+        tokens -= lines.at(head).tokens;
+        lines[head].text.clear();
+        ++head;
+    }
+    if (head > 64 && head * 2 > lines.size()) {
+        lines.remove(0, head);
+        head = 0;
+    }
+}
+
+void ChatContext::clear()
+{
+    lines.clear();
+    head = 0;
+    tokens = 0;
+}
+
+void ChatContext::setTokenBudget(int tokenBudget)
+{
+    budget = qMax(kMinTokenBudget, tokenBudget);
+    // 按新预算重新淘汰
+    QList<Line> kept = lines.mid(head);
+    clear();
+    for (const Line &line : std::as_const(kept)) {
+        append(line.text);
+    }
+}
+
+QString ChatContext::render() const
+{
+    qsizetype size = 0;
+    for (qsizetype i = head; i < lines.size(); ++i) {
+        size += lines.at(i).text.size() + 1;
+    }
+    QString text;
+    text.reserve(size);
+    for (qsizetype i = head; i < lines.size(); ++i) {
+        if (i > head) {
+            text += '\n';
+        }
+        text += lines.at(i).text;
+    }
+    return text;
+}
+
+int ChatContext::estimateTokens(QStringView text)
+{
+    int ascii = 0;
+    int other = 0;
+    for (const QChar c : text) {
+        if (c.unicode() < 0x80) {
+            ++ascii;
+        } else if (!c.isLowSurrogate()) {
+            ++other;
+        }
+    }
+    return (ascii + 3) / 4 + other;
+}
+
+QString ChatContext::buildPrompt(const QString &kind, const QString &context, const QString &question)
+{
+    if (kind == "summarize") {
+        return context.isEmpty() ? QString() : "请总结以下聊天内容的要点:\n\n" + context;
+    }
+    if (kind == "suggest") {
+        return context.isEmpty() ? QString() : "基于以下聊天内容，建议我如何回复最后一条消息:\n\n" + context;
+    }
+    if (question.isEmpty()) {
+        return QString();
+    }
+    return context.isEmpty() ? question : "聊天上下文:\n" + context + "\n\n用户问题: " + question;
+}
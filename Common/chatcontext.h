@@ -0,0 +1,43 @@
+#ifndef CHATCONTEXT_H
+#define CHATCONTEXT_H
+
+#include <QString>
+#include <QStringView>
+#include <QList>
+
+// 发给 AI 的聊天上下文：按近似 token 数限长的滑动窗口。
+// 每来一条消息只追加一行并从头部淘汰，拼接成字符串只在真正发请求时做一次。
+class ChatContext
+{
+public:
+    explicit ChatContext(int tokenBudget = kDefaultTokenBudget);
+
+    void append(const QString &line);
+    void clear();
+    void setTokenBudget(int tokenBudget);
+
+    bool isEmpty() const { return lines.size() == head; }
+    int tokenCount() const { return tokens; }
+    // 拼接成一段文本，每行一条消息
+    QString render() const;
+
+    // 粗略估算：ASCII 约 4 个字符一个 token，其他字符（中文等）各算一个
+    static int estimateTokens(QStringView text);
+    // 按 kind（summarize / suggest / ask）组装提示词，服务器网关与客户端直连共用
+    static QString buildPrompt(const QString &kind, const QString &context, const QString &question);
+
+    static constexpr int kDefaultTokenBudget = 3000;
+
+private:
+    struct Line {
+        QString text;
+        int tokens;
+    };
+
+    QList<Line> lines;
+    qsizetype head = 0;   // 已淘汰的行数，攒够一半再整体移除
+    int tokens = 0;
+    int budget;
+};
+
+#endif // CHATCONTEXT_H
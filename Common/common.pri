@@ -0,0 +1,18 @@
+# 服务器与客户端共用的代码
+INCLUDEPATH += $$PWD
+# tlsticket 用到 QSslConfiguration
+QT += network
+
+SOURCES += \
+    $$PWD/capturefile.cpp \
+    $$PWD/chatcontext.cpp \
+    $$PWD/framescanner.cpp \
+    $$PWD/tlsticket.cpp \
+    $$PWD/trace.cpp
+
+HEADERS += \
+    $$PWD/capturefile.h \
+    $$PWD/chatcontext.h \
+    $$PWD/framescanner.h \
+    $$PWD/tlsticket.h \
+    $$PWD/trace.h
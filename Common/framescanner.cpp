@@ -0,0 +1,377 @@
+#include "framescanner.h"
+
+#include <QtGlobal>
+
+#if (defined(Q_CC_GNU) || defined(Q_CC_CLANG)) && (defined(Q_PROCESSOR_X86_64) || defined(Q_PROCESSOR_X86_32))
+#define FRAMESCANNER_X86
+#include <immintrin.h>
+#endif
+
+namespace {
+
+using FrameEnd = FrameScanner::FrameEnd;
+using State = FrameScanner::State;
+using Kernel = void (*)(const char *data, qsizetype size, qsizetype base, State &state, QList<FrameEnd> &ends);
+
+// 逐字节推进 UTF-8 状态机。换行不会出现在多字节序列内部，所以遇到换行时
+// 未完成的序列一定是错误，状态在每一帧开始时都是干净的。
+inline void step(unsigned char c, qsizetype offset, State &s, QList<FrameEnd> &ends)
+{
+    if (s.need > 0) {
+        if ((c & 0xC0) == 0x80) {
+            s.codePoint = (s.codePoint << 6) | (c & 0x3F);
+            // 过长编码、代理区和超出 Unicode 范围的码点都不合法
+            if (--s.need == 0 && (s.codePoint < s.minCodePoint || s.codePoint > 0x10FFFF
+                                  || (s.codePoint >= 0xD800 && s.codePoint <= 0xDFFF))) {
+                s.bad = true;
+            }
+            return;
+        }
+        // 序列被截断，当前字节按新字符重新处理
+        s.bad = true;
+        s.need = 0;
+    }
+
+    if (c < 0x80) {
+        if (c == '\n') {
+            ends.append(FrameEnd{offset, !s.bad});
+            s.bad = false;
+        }
+    } else if ((c & 0xE0) == 0xC0) {
+        s.need = 1;
+        s.minCodePoint = 0x80;
+        s.codePoint = c & 0x1F;
+    } else if ((c & 0xF0) == 0xE0) {
+        s.need = 2;
+        s.minCodePoint = 0x800;
+        s.codePoint = c & 0x0F;
+    } else if ((c & 0xF8) == 0xF0) {
+        s.need = 3;
+        s.minCodePoint = 0x10000;
+        s.codePoint = c & 0x07;
+    } else {
+        s.bad = true;
+    }
+}
+
+void scanScalar(const char *data, qsizetype size, qsizetype base, State &state, QList<FrameEnd> &ends)
+{
+    for (qsizetype i = 0; i < size; ++i) {
+        step(static_cast<unsigned char>(data[i]), base + i, state, ends);
+    }
+}
+
+#ifdef FRAMESCANNER_X86
+// 向量校验用 Keiser 与 Lemire 的查表法：前一字节的高、低半字节和当前字节的高半字节
+// 各查一张表，三者按位与不为 0 即为非法的两字节组合（截断、过长编码、代理区、超出范围等）
+constexpr quint8 kTooShort = 1 << 0;      // 引导字节后面不是续字节
+constexpr quint8 kTooLong = 1 << 1;       // ASCII 后面是续字节
+constexpr quint8 kOverlong3 = 1 << 2;
+constexpr quint8 kTooLarge = 1 << 3;
+constexpr quint8 kSurrogate = 1 << 4;
+constexpr quint8 kOverlong2 = 1 << 5;
+constexpr quint8 kTooLarge1000 = 1 << 6;
+constexpr quint8 kOverlong4 = 1 << 6;
+constexpr quint8 kTwoConts = 1 << 7;      // 连续两个续字节，只在三、四字节序列里合法
+constexpr quint8 kCarry = kTooShort | kTooLong | kTwoConts;
+
+// 按前一字节的高半字节查
+constexpr quint8 kByte1High[16] = {
+    kTooLong, kTooLong, kTooLong, kTooLong, kTooLong, kTooLong, kTooLong, kTooLong,
+    kTwoConts, kTwoConts, kTwoConts, kTwoConts,
+    kTooShort | kOverlong2,
+    kTooShort,
+    kTooShort | kOverlong3 | kSurrogate,
+    kTooShort | kTooLarge | kTooLarge1000 | kOverlong4,
+};
+// 按前一字节的低半字节查
+constexpr quint8 kByte1Low[16] = {
+    kCarry | kOverlong3 | kOverlong2 | kOverlong4,
+    kCarry | kOverlong2,
+    kCarry,
+    kCarry,
+    kCarry | kTooLarge,
+    kCarry | kTooLarge | kTooLarge1000,
+    kCarry | kTooLarge | kTooLarge1000,
+    kCarry | kTooLarge | kTooLarge1000,
+    kCarry | kTooLarge | kTooLarge1000,
+    kCarry | kTooLarge | kTooLarge1000,
+    kCarry | kTooLarge | kTooLarge1000,
+    kCarry | kTooLarge | kTooLarge1000,
+    kCarry | kTooLarge | kTooLarge1000,
+    kCarry | kTooLarge | kTooLarge1000 | kSurrogate,
+    kCarry | kTooLarge | kTooLarge1000,
+    kCarry | kTooLarge | kTooLarge1000,
+};
+// 按当前字节的高半字节查
+constexpr quint8 kByte2High[16] = {
+    kTooShort, kTooShort, kTooShort, kTooShort, kTooShort, kTooShort, kTooShort, kTooShort,
+    kTooLong | kOverlong2 | kTwoConts | kOverlong3 | kTooLarge1000 | kOverlong4,
+    kTooLong | kOverlong2 | kTwoConts | kOverlong3 | kTooLarge,
+    kTooLong | kOverlong2 | kTwoConts | kSurrogate | kTooLarge,
+    kTooLong | kOverlong2 | kTwoConts | kSurrogate | kTooLarge,
+    kTooShort, kTooShort, kTooShort, kTooShort,
+};
+// 块末尾三个字节的上限，超过说明最后一个字符还没结束
+constexpr quint8 kIncompleteMax[32] = {
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xEF, 0xDF, 0xBF,
+};
+
+// 把块内的换行逐个记成帧尾。errors 的第 n 位表示第 n 个字节处查出错误：
+// 截断的字符在下一个字节（可能正是换行）处报错，所以错误归属于位置不早于它的第一个换行
+inline void markFrames(quint32 newlines, quint32 errors, qsizetype offset, State &s, QList<FrameEnd> &ends)
+{
+    while (newlines) {
+        const int bit = __builtin_ctz(newlines);
+        const quint32 upTo = quint32((quint64(2) << bit) - 1);
+        ends.append(FrameEnd{offset + bit, !s.bad && !(errors & upTo)});
+        s.bad = false;
+        errors &= ~upTo;
+        newlines &= newlines - 1;
+    }
+    if (errors) {
+        s.bad = true;
+    }
+}
+
+// 先用状态机走完上次留下的半个字符，向量部分从字符边界开始，不需要上一块的内容
+inline qsizetype drain(const char *data, qsizetype size, qsizetype base, State &state, QList<FrameEnd> &ends)
+{
+    qsizetype i = 0;
+    for (; i < size && state.need > 0; ++i) {
+        step(static_cast<unsigned char>(data[i]), base + i, state, ends);
+    }
+    return i;
+}
+
+// 向量部分结束在字符中间时，把末尾的半个字符重新交给状态机，剩下的字节接着逐个处理。
+// end 之前至少有 4 个已经向量扫描过的字节；这些字节都不是换行，重放不会重复记帧尾
+inline void settle(const char *end, State &state, QList<FrameEnd> &ends)
+{
+    state.need = 0;
+    int continuations = 0;
+    while (continuations < 3 && (static_cast<unsigned char>(end[-1 - continuations]) & 0xC0) == 0x80) {
+        ++continuations;
+    }
+    const char *lead = end - 1 - continuations;
+    if (static_cast<unsigned char>(*lead) >= 0xC0) {
+        for (const char *p = lead; p < end; ++p) {
+            step(static_cast<unsigned char>(*p), 0, state, ends);
+        }
+    }
+}
+
+// 一块中每个字节的错误位。previous 是上一块，取它的末尾三个字节作为跨块的前缀
+__attribute__((target("ssse3")))
+inline quint32 errorsSsse3(__m128i input, __m128i previous)
+{
+    const __m128i nibble = _mm_set1_epi8(0x0F);
+    const __m128i prev1 = _mm_alignr_epi8(input, previous, 15);
+    const __m128i prev2 = _mm_alignr_epi8(input, previous, 14);
+    const __m128i prev3 = _mm_alignr_epi8(input, previous, 13);
+
+    const __m128i byte1High = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(kByte1High)),
+                                               _mm_and_si128(_mm_srli_epi16(prev1, 4), nibble));
+    const __m128i byte1Low = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(kByte1Low)),
+                                              _mm_and_si128(prev1, nibble));
+    const __m128i byte2High = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(kByte2High)),
+                                               _mm_and_si128(_mm_srli_epi16(input, 4), nibble));
+    const __m128i special = _mm_and_si128(_mm_and_si128(byte1High, byte1Low), byte2High);
+
+    // 三、四字节序列的第三、四个字节必须是续字节。只在前一字节也是续字节时检查：
+    // 否则序列在更早的位置已经报错，这样换行前的截断字符不会把错误带进下一帧
+    const __m128i third = _mm_subs_epu8(prev2, _mm_set1_epi8(char(0xE0 - 0x80)));
+    const __m128i fourth = _mm_subs_epu8(prev3, _mm_set1_epi8(char(0xF0 - 0x80)));
+    const __m128i afterContinuation = _mm_cmpeq_epi8(_mm_and_si128(prev1, _mm_set1_epi8(char(0xC0))),
+                                                     _mm_set1_epi8(char(0x80)));
+    const __m128i must = _mm_and_si128(_mm_and_si128(_mm_or_si128(third, fourth), _mm_set1_epi8(char(0x80))),
+                                       afterContinuation);
+    const __m128i error = _mm_xor_si128(special, must);
+    return ~quint32(_mm_movemask_epi8(_mm_cmpeq_epi8(error, _mm_setzero_si128()))) & 0xFFFF;
+}
+
+__attribute__((target("ssse3")))
+void scanSsse3(const char *data, qsizetype size, qsizetype base, State &state, QList<FrameEnd> &ends)
+{
+    const __m128i newline = _mm_set1_epi8('\n');
+    const __m128i incompleteMax = _mm_loadu_si128(reinterpret_cast<const __m128i *>(kIncompleteMax + 16));
+    const qsizetype start = drain(data, size, base, state, ends);
+    __m128i previous = _mm_setzero_si128();
+    bool pending = false;   // 上一块以未结束的字符收尾
+    qsizetype i = start;
+    for (; i + 16 <= size; i += 16) {
+        const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+        quint32 errors = 0;
+        if (_mm_movemask_epi8(block) == 0) {
+            // 纯 ASCII 的块只有在上一块留下半个字符时才可能出错
+            if (pending) {
+                errors = errorsSsse3(block, previous);
+                pending = false;
+            }
+        } else {
+            errors = errorsSsse3(block, previous);
+            pending = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_subs_epu8(block, incompleteMax),
+                                                       _mm_setzero_si128())) != 0xFFFF;
+        }
+        markFrames(quint32(_mm_movemask_epi8(_mm_cmpeq_epi8(block, newline))), errors, base + i, state, ends);
+        previous = block;
+    }
+    if (i > start) {
+        settle(data + i, state, ends);
+    }
+    scanScalar(data + i, size - i, base + i, state, ends);
+}
+
+__attribute__((target("avx2")))
+inline quint32 errorsAvx2(__m256i input, __m256i previous)
+{
+    const __m256i nibble = _mm256_set1_epi8(0x0F);
+    // 跨 128 位通道的错位：先拼出 [上一块高半, 本块低半]，再在通道内错位
+    const __m256i carried = _mm256_permute2x128_si256(previous, input, 0x21);
+    const __m256i prev1 = _mm256_alignr_epi8(input, carried, 15);
+    const __m256i prev2 = _mm256_alignr_epi8(input, carried, 14);
+    const __m256i prev3 = _mm256_alignr_epi8(input, carried, 13);
+
+    const __m256i byte1High = _mm256_shuffle_epi8(
+        _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i *>(kByte1High))),
+        _mm256_and_si256(_mm256_srli_epi16(prev1, 4), nibble));
+    const __m256i byte1Low = _mm256_shuffle_epi8(
+        _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i *>(kByte1Low))),
+        _mm256_and_si256(prev1, nibble));
+    const __m256i byte2High = _mm256_shuffle_epi8(
+        _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i *>(kByte2High))),
+        _mm256_and_si256(_mm256_srli_epi16(input, 4), nibble));
+    const __m256i special = _mm256_and_si256(_mm256_and_si256(byte1High, byte1Low), byte2High);
+
+    const __m256i third = _mm256_subs_epu8(prev2, _mm256_set1_epi8(char(0xE0 - 0x80)));
+    const __m256i fourth = _mm256_subs_epu8(prev3, _mm256_set1_epi8(char(0xF0 - 0x80)));
+    const __m256i afterContinuation = _mm256_cmpeq_epi8(_mm256_and_si256(prev1, _mm256_set1_epi8(char(0xC0))),
+                                                        _mm256_set1_epi8(char(0x80)));
+    const __m256i must = _mm256_and_si256(
+        _mm256_and_si256(_mm256_or_si256(third, fourth), _mm256_set1_epi8(char(0x80))), afterContinuation);
+    const __m256i error = _mm256_xor_si256(special, must);
+    return ~quint32(_mm256_movemask_epi8(_mm256_cmpeq_epi8(error, _mm256_setzero_si256())));
+}
+
+__attribute__((target("avx2")))
+void scanAvx2(const char *data, qsizetype size, qsizetype base, State &state, QList<FrameEnd> &ends)
+{
+    const __m256i newline = _mm256_set1_epi8('\n');
+    const __m256i incompleteMax = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(kIncompleteMax));
+    const qsizetype start = drain(data, size, base, state, ends);
+    __m256i previous = _mm256_setzero_si256();
+    bool pending = false;
+    qsizetype i = start;
+    for (; i + 32 <= size; i += 32) {
+        const __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + i));
+        quint32 errors = 0;
+        if (_mm256_movemask_epi8(block) == 0) {
+            if (pending) {
+                errors = errorsAvx2(block, previous);
+                pending = false;
+            }
+        } else {
+            errors = errorsAvx2(block, previous);
+            pending = quint32(_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_subs_epu8(block, incompleteMax),
+                                                                     _mm256_setzero_si256()))) != 0xFFFFFFFFu;
+        }
+        markFrames(quint32(_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, newline))), errors, base + i, state, ends);
+        previous = block;
+    }
+    if (i > start) {
+        settle(data + i, state, ends);
+    }
+    scanSsse3(data + i, size - i, base + i, state, ends);
+}
+#endif
+
+struct Selected {
+    Kernel kernel;
+    const char *name;
+};
+
+// AICHAT_SIMD=scalar|ssse3 可以强制使用较低的实现，方便对比
+Selected selectKernel()
+{
+    const QByteArray forced = qgetenv("AICHAT_SIMD");
+#ifdef FRAMESCANNER_X86
+    __builtin_cpu_init();
+    if (forced.isEmpty() && __builtin_cpu_supports("avx2")) {
+        return {scanAvx2, "avx2"};
+    }
+    if (forced != "scalar" && __builtin_cpu_supports("ssse3")) {
+        return {scanSsse3, "ssse3"};
+    }
+#endif
+    return {scanScalar, "scalar"};
+}
+
+const Selected selected = selectKernel();
+
+} // namespace
+
+void FrameScanner::append(const QByteArray &data)
+{
+    compact();
+    const qsizetype from = buffer.size();
+    buffer.append(data);
+    selected.kernel(buffer.constData() + from, buffer.size() - from, from, state, ends);
+}
+
+bool FrameScanner::next(QByteArray *frame, bool *valid)
+{
+    if (nextEnd >= ends.size()) {
+        return false;
+    }
+    const FrameEnd end = ends.at(nextEnd++);
+    *frame = buffer.mid(head, end.offset - head);
+    *valid = end.valid;
+    head = end.offset + 1;
+    return true;
+}
+
+void FrameScanner::compact()
+{
+    // 取帧时只移动 head，等下一次 append 时再一次性挪动剩余数据
+    if (head == 0) {
+        return;
+    }
+    buffer.remove(0, head);
+    ends.remove(0, nextEnd);
+    for (FrameEnd &end : ends) {
+        end.offset -= head;
+    }
+    nextEnd = 0;
+    head = 0;
+}
+
+void FrameScanner::clear()
+{
+    buffer.clear();
+    ends.clear();
+    head = 0;
+    nextEnd = 0;
+    state = State{};
+}
+
+const char *FrameScanner::kernelName()
+{
+    return selected.name;
+}
+
+bool isValidUtf8(QByteArrayView data)
+{
+    State state;
+    QList<FrameEnd> ends;
+    selected.kernel(data.data(), data.size(), 0, state, ends);
+    if (state.bad || state.need > 0) {
+        return false;
+    }
+    for (const FrameEnd &end : ends) {
+        if (!end.valid) {
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,52 @@
+#ifndef FRAMESCANNER_H
+#define FRAMESCANNER_H
+
+#include <QByteArray>
+#include <QByteArrayView>
+#include <QList>
+
+// 按换行分帧的接收缓冲。每次 append 只扫描新到的字节，同一遍里找出所有换行
+// 并校验 UTF-8；扫描核心在运行时按 CPU 选择 AVX2 / SSSE3 / 标量实现，向量实现用查表法整块校验。
+class FrameScanner
+{
+public:
+    // 追加新收到的数据并扫描
+    void append(const QByteArray &data);
+    // 取出下一帧（不含换行），没有完整的帧时返回 false；valid 表示该帧是否为合法 UTF-8
+    bool next(QByteArray *frame, bool *valid);
+
+    bool hasFrame() const { return nextEnd < ends.size(); }
+    // 尚未取走的字节数
+    qsizetype bufferedBytes() const { return buffer.size() - head; }
+    qsizetype capacity() const { return buffer.capacity() + ends.capacity() * qsizetype(sizeof(FrameEnd)); }
+    void clear();
+
+    // 当前使用的扫描实现："avx2"、"ssse3" 或 "scalar"
+    static const char *kernelName();
+
+    // 以下是扫描核心使用的内部结构
+    struct FrameEnd {
+        qsizetype offset;  // 换行在缓冲区中的位置
+        bool valid;
+    };
+    // 跨 append 保留的 UTF-8 解码状态，属于当前未结束的帧
+    struct State {
+        quint32 codePoint = 0;
+        quint32 minCodePoint = 0;
+        int need = 0;       // 还差几个续字节
+        bool bad = false;   // 当前帧已经出现非法编码
+    };
+
+private:
+    void compact();
+
+    QByteArray buffer;
+    qsizetype head = 0;     // 已取走的前缀长度
+    QList<FrameEnd> ends;   // 已扫描到、尚未取走的换行
+    qsizetype nextEnd = 0;
+    State state;
+};
+
+bool isValidUtf8(QByteArrayView data);
+
+#endif // FRAMESCANNER_H
@@ -0,0 +1,68 @@
+#include "tlsticket.h"
+
+#include <QDateTime>
+#include <QSslPreSharedKeyAuthenticator>
+#include <QSslSocket>
+
+namespace {
+// 优先带 ECDHE 的套件，保留前向保密；后端都不支持时退回纯 PSK
+const char *const kPskCipherNames[] = {
+    "ECDHE-PSK-CHACHA20-POLY1305",
+    "ECDHE-PSK-AES128-CBC-SHA256",
+    "PSK-AES128-GCM-SHA256",
+};
+// 客户端提前这么久视票据为过期，避免握手途中恰好到期
+constexpr qint64 kExpiryMarginMs = 60 * 1000;
+}
+
+bool TlsTicket::isValid() const
+{
+    return !identity.isEmpty() && !key.isEmpty() && QDateTime::currentMSecsSinceEpoch() < expiresAt;
+}
+
+QJsonObject TlsTicket::toJson(qint64 lifetimeSecs) const
+{
+    QJsonObject obj;
+    obj["type"] = "tls_ticket";
+    obj["identity"] = QString::fromLatin1(identity);
+    obj["key"] = QString::fromLatin1(key.toBase64());
+    obj["lifetime"] = lifetimeSecs;
+    return obj;
+}
+
+TlsTicket TlsTicket::fromJson(const QJsonObject &obj)
+{
+    TlsTicket ticket;
+    ticket.identity = obj.value("identity").toString().toLatin1();
+    ticket.key = QByteArray::fromBase64(obj.value("key").toString().toLatin1());
+    // 客户端和服务器的时钟可能不一致，按收到时刻加有效期计算
+    ticket.expiresAt = QDateTime::currentMSecsSinceEpoch()
+                     + obj.value("lifetime").toInteger() * 1000 - kExpiryMarginMs;
+    return ticket;
+}
+
+QList<QSslCipher> TlsTicket::pskCiphers()
+{
+    QList<QSslCipher> ciphers;
+    for (const char *name : kPskCipherNames) {
+        const QSslCipher cipher(QString::fromLatin1(name));
+        if (!cipher.isNull()) {
+            ciphers.append(cipher);
+        }
+    }
+    return ciphers;
+}
+
+QSslConfiguration TlsTicket::resumeConfiguration(QSslConfiguration config)
+{
+    config.setProtocol(QSsl::TlsV1_2);
+    config.setCiphers(pskCiphers());
+    config.setPeerVerifyMode(QSslSocket::VerifyNone);
+    return config;
+}
+
+void TlsTicket::answer(QSslPreSharedKeyAuthenticator *authenticator) const
+{
+    authenticator->setIdentity(identity);
+    authenticator->setPreSharedKey(key);
+}
@@ -0,0 +1,33 @@
+#ifndef TLSTICKET_H
+#define TLSTICKET_H
+
+#include <QByteArray>
+#include <QJsonObject>
+#include <QList>
+#include <QSslCipher>
+#include <QSslConfiguration>
+
+class QSslPreSharedKeyAuthenticator;
+
+// TLS 重连票据。服务器在证书握手并登录成功后，通过已加密的连接下发一张票据（tls_ticket），
+// 客户端重连时用它做 TLS-PSK 握手：不传证书、不做签名，只剩一次 ECDHE 和对称运算。
+// Qt 为每个 QSslSocket 单独创建 OpenSSL 上下文，服务器端用不上 OpenSSL 自带的会话缓存和票据密钥，
+// 所以票据由服务器自己签发和核对；每张票据只能用一次，每次登录成功后换发新的。
+struct TlsTicket {
+    QByteArray identity;    // 十六进制文本，OpenSSL 按 C 字符串处理 PSK 身份
+    QByteArray key;
+    qint64 expiresAt = 0;   // 毫秒时间戳
+
+    bool isValid() const;
+    QJsonObject toJson(qint64 lifetimeSecs) const;
+    static TlsTicket fromJson(const QJsonObject &obj);
+
+    // 用票据重连时的配置：只留 TLS 1.2 的 PSK 套件（Qt 只提供旧式 PSK 回调）。
+    // PSK 握手中服务器不出示证书，能算出同一把密钥本身就证明了对方是签发票据的服务器
+    static QSslConfiguration resumeConfiguration(QSslConfiguration config);
+    // 服务器端需要在证书套件之外接受的 PSK 套件，当前 TLS 后端不支持时为空
+    static QList<QSslCipher> pskCiphers();
+    void answer(QSslPreSharedKeyAuthenticator *authenticator) const;
+};
+
+#endif // TLSTICKET_H
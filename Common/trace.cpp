@@ -0,0 +1,196 @@
+#include "trace.h"
+
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QSocketNotifier>
+#include <QTextStream>
+
+#include <chrono>
+#include <vector>
+
+#ifdef Q_OS_UNIX
+#include <csignal>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace Trace {
+
+std::atomic<bool> g_enabled{qEnvironmentVariableIntValue("AICHAT_TRACE") != 0};
+
+namespace {
+
+// 每个线程保留最近的事件数，必须是 2 的幂
+constexpr quint64 kRingSize = 1 << 14;
+
+struct Event {
+    std::atomic<const char *> name{nullptr};
+    std::atomic<qint64> start{0};
+    std::atomic<qint64> end{0};
+};
+
+// 单生产者环形缓冲：只有所属线程写，导出线程读，读时丢弃可能被覆盖的槽位
+struct Ring {
+    Event events[kRingSize];
+    std::atomic<quint64> head{0};
+    quint64 tid = 0;
+};
+
+QMutex registryMutex;
+std::vector<Ring *> registry;
+std::atomic<quint64> nextTid{1};
+
+Ring *threadRing()
+{
+    thread_local Ring *ring = nullptr;
+    if (!ring) {
+        // 线程退出后缓冲区仍然保留，导出时还能看到它的事件
+        ring = new Ring;
+        ring->tid = nextTid.fetch_add(1);
+        QMutexLocker locker(&registryMutex);
+        registry.push_back(ring);
+    }
+    return ring;
+}
+
+#ifdef Q_OS_UNIX
+int signalPipe[2] = {-1, -1};
+
+void onDumpSignal(int)
+{
+    const char c = 1;
+    const ssize_t n = ::write(signalPipe[1], &c, 1);
+    (void)n;
+}
+#endif
+
+} // namespace
+
+void setEnabled(bool enabled)
+{
+    g_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+qint64 nowNs()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void record(const char *name, qint64 startNs, qint64 endNs)
+{
+    Ring *ring = threadRing();
+    const quint64 index = ring->head.load(std::memory_order_relaxed);
+    Event &event = ring->events[index & (kRingSize - 1)];
+    event.name.store(name, std::memory_order_relaxed);
+    event.start.store(startNs, std::memory_order_relaxed);
+    event.end.store(endNs, std::memory_order_relaxed);
+    ring->head.store(index + 1, std::memory_order_release);
+}
+
+QByteArray dumpChromeJson()
+{
+    std::vector<Ring *> rings;
+    {
+        QMutexLocker locker(&registryMutex);
+        rings = registry;
+    }
+
+    const qint64 pid = QCoreApplication::applicationPid();
+    QByteArray out;
+    out.reserve(1 << 20);
+    out.append("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+    bool first = true;
+
+    struct Copy {
+        const char *name;
+        qint64 start;
+        qint64 end;
+    };
+    for (Ring *ring : rings) {
+        const quint64 head = ring->head.load(std::memory_order_acquire);
+        const quint64 begin = head > kRingSize ? head - kRingSize : 0;
+        std::vector<Copy> events;
+        events.reserve(size_t(head - begin));
+        for (quint64 i = begin; i < head; ++i) {
+            const Event &event = ring->events[i & (kRingSize - 1)];
+            events.push_back(Copy{event.name.load(std::memory_order_relaxed),
+                                  event.start.load(std::memory_order_relaxed),
+                                  event.end.load(std::memory_order_relaxed)});
+        }
+        // 复制期间写线程可能已经绕回来覆盖了最旧的槽位；写线程先写槽位 after 再推进 head，
+        // 所以和它同槽的 after - kRingSize 也可能正写到一半，要一并丢掉
+        const quint64 after = ring->head.load(std::memory_order_acquire);
+        const quint64 valid = after >= kRingSize ? after - kRingSize + 1 : 0;
+
+        for (quint64 i = qMax(begin, valid); i < head; ++i) {
+            const Copy &event = events[size_t(i - begin)];
+            if (!event.name) {
+                continue;
+            }
+            if (!first) {
+                out.append(',');
+            }
+            first = false;
+            out.append("{\"name\":\"").append(event.name)
+               .append("\",\"ph\":\"X\",\"ts\":").append(QByteArray::number(event.start / 1000.0, 'f', 3))
+               .append(",\"dur\":").append(QByteArray::number((event.end - event.start) / 1000.0, 'f', 3))
+               .append(",\"pid\":").append(QByteArray::number(pid))
+               .append(",\"tid\":").append(QByteArray::number(ring->tid))
+               .append('}');
+        }
+    }
+    out.append("]}");
+    return out;
+}
+
+QString dumpToFile(const QString &dir)
+{
+    QDir().mkpath(dir);
+    const QString path = QDir(dir).filePath(QString("trace-%1-%2.json")
+                                                .arg(QCoreApplication::applicationPid())
+                                                .arg(QDateTime::currentDateTime().toString("yyyyMMdd-HHmmss")));
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        return QString();
+    }
+    file.write(dumpChromeJson());
+    return path;
+}
+
+void installDumpSignal(const QString &dir)
+{
+#ifdef Q_OS_UNIX
+    if (signalPipe[0] >= 0 || ::pipe(signalPipe) != 0) {
+        return;
+    }
+    for (int fd : signalPipe) {
+        ::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL) | O_NONBLOCK);
+        ::fcntl(fd, F_SETFD, FD_CLOEXEC);
+    }
+
+    // 信号处理函数里只写管道，真正的导出在事件循环中完成
+    auto *notifier = new QSocketNotifier(signalPipe[0], QSocketNotifier::Read, QCoreApplication::instance());
+    QObject::connect(notifier, &QSocketNotifier::activated, notifier, [dir]() {
+        char buf[64];
+        while (::read(signalPipe[0], buf, sizeof(buf)) > 0) {
+        }
+        const QString path = dumpToFile(dir);
+        QTextStream(stderr) << (path.isEmpty() ? QString("Failed to write trace") : "Trace written to " + path) << "\n";
+    });
+
+    struct sigaction action = {};
+    action.sa_handler = onDumpSignal;
+    sigemptyset(&action.sa_mask);
+    action.sa_flags = SA_RESTART;
+    sigaction(SIGUSR2, &action, nullptr);
+#else
+    Q_UNUSED(dir);
+#endif
+}
+
+} // namespace Trace
@@ -0,0 +1,59 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <QByteArray>
+#include <QString>
+#include <atomic>
+
+// 轻量级耗时追踪：每个线程一个无锁环形缓冲区，按需导出为 Chrome trace JSON
+// （可直接用 Perfetto / chrome://tracing 打开）。关闭时每个 span 只多一次原子读。
+namespace Trace {
+
+extern std::atomic<bool> g_enabled;
+
+inline bool isEnabled()
+{
+    return g_enabled.load(std::memory_order_relaxed);
+}
+
+void setEnabled(bool enabled);
+qint64 nowNs();
+// name 必须是字符串字面量，只保存指针
+void record(const char *name, qint64 startNs, qint64 endNs);
+
+// 导出所有线程缓冲区中的事件
+QByteArray dumpChromeJson();
+// 写入 dir 下的 trace-<pid>-<时间>.json，返回文件路径，失败返回空
+QString dumpToFile(const QString &dir);
+// Unix 下收到 SIGUSR2 时导出到 dir；需要在事件循环所在线程调用
+void installDumpSignal(const QString &dir);
+
+class Scope
+{
+public:
+    explicit Scope(const char *name)
+        : name(name)
+        , start(isEnabled() ? nowNs() : -1)
+    {
+    }
+    ~Scope()
+    {
+        if (start >= 0) {
+            record(name, start, nowNs());
+        }
+    }
+    Scope(const Scope &) = delete;
+    Scope &operator=(const Scope &) = delete;
+
+private:
+    const char *name;
+    qint64 start;
+};
+
+} // namespace Trace
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+#define TRACE_SCOPE(name) Trace::Scope TRACE_CONCAT(traceScope_, __LINE__)(name)
+
+#endif // TRACE_H
@@ -9,11 +9,37 @@ CONFIG -= app_bundle
 #DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
 
 SOURCES += \
+    adminconsole.cpp \
+    aigateway.cpp \
+    blobsender.cpp \
+    blobstore.cpp \
+    chatframe.cpp \
+    contentfilter.cpp \
+    keywordmatcher.cpp \
     main.cpp \
-    server.cpp
+    roomdirectory.cpp \
+    server.cpp \
+    sharedregistry.cpp \
+    tlsacceptor.cpp \
+    trafficcapture.cpp \
+    workersupervisor.cpp
 
 HEADERS += \
-    server.h
+    adminconsole.h \
+    aigateway.h \
+    blobsender.h \
+    blobstore.h \
+    chatframe.h \
+    contentfilter.h \
+    keywordmatcher.h \
+    roomdirectory.h \
+    server.h \
+    sharedregistry.h \
+    tlsacceptor.h \
+    trafficcapture.h \
+    workersupervisor.h
+
+include(../Common/common.pri)
 
 RC_FILE=Images/duckicon.rc
 
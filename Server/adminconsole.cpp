@@ -0,0 +1,299 @@
+#include "adminconsole.h"
+#include "trace.h"
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QMutexLocker>
+#include <QTextStream>
+
+#include <algorithm>
+
+namespace {
+constexpr int kDefaultTopN = 10;
+
+const char *kHelp =
+    "commands:\n"
+    "  rooms [members|rate] [N]   top rooms by member count or message rate\n"
+    "  conns [N]                  connections with the largest buffers\n"
+    "  mem [N]                    largest memory consumers (connections and rooms)\n"
+    "  kick <id>                  disconnect a connection\n"
+    "  close <room>               close a room and remove its members\n"
+    "  trace on|off|dump          toggle tracing or write a Chrome trace file\n"
+    "  capture start [file]|stop  record anonymized inbound traffic for Tools/replay\n"
+    "  filter [reload]            keyword filter counters, or rebuild from the rules file\n"
+    "  tls                        handshake counts and latency, full vs resumed\n"
+    "  stats                      totals\n"
+    "  help\n";
+}
+
+AdminConsole::AdminConsole(const QString &socketName, QObject *parent)
+    : QObject(parent)
+    , socketName(socketName)
+    , snapshot(std::make_shared<AdminSnapshot>())
+{
+}
+
+void AdminConsole::publish(std::shared_ptr<const AdminSnapshot> newSnapshot)
+{
+    QMutexLocker locker(&mutex);
+    snapshot = std::move(newSnapshot);
+}
+
+std::shared_ptr<const AdminSnapshot> AdminConsole::currentSnapshot() const
+{
+    QMutexLocker locker(&mutex);
+    return snapshot;
+}
+
+void AdminConsole::start()
+{
+    server = new QLocalServer(this);
+    server->setSocketOptions(QLocalServer::UserAccessOption);
+    // 上次异常退出可能留下 socket 文件
+    QLocalServer::removeServer(socketName);
+    if (!server->listen(socketName)) {
+        QTextStream(stderr) << "Admin console failed to listen on " << socketName
+                            << ": " << server->errorString() << "\n";
+        return;
+    }
+    connect(server, &QLocalServer::newConnection, this, &AdminConsole::onNewConnection);
+    QTextStream(stdout) << "Admin console listening on " << server->fullServerName() << "\n";
+}
+
+void AdminConsole::onNewConnection()
+{
+    while (QLocalSocket *socket = server->nextPendingConnection()) {
+        connect(socket, &QLocalSocket::disconnected, socket, &QObject::deleteLater);
+        connect(socket, &QLocalSocket::readyRead, this, [this, socket]() {
+            while (socket->canReadLine()) {
+                const QString line = QString::fromUtf8(socket->readLine()).trimmed();
+                if (line.isEmpty()) {
+                    continue;
+                }
+                socket->write(handleCommand(line).toUtf8());
+            }
+        });
+        socket->write("AI-ChatRoom admin console. Type 'help'.\n");
+    }
+}
+
+QString AdminConsole::handleCommand(const QString &line)
+{
+    QStringList args = line.split(' ', Qt::SkipEmptyParts);
+    const QString command = args.takeFirst().toLower();
+
+    if (command == "help") {
+        return QString::fromLatin1(kHelp);
+    }
+    if (command == "rooms") {
+        return listRooms(args);
+    }
+    if (command == "conns") {
+        return listConnections(args);
+    }
+    if (command == "mem") {
+        return listMemory(args);
+    }
+    if (command == "trace") {
+        return traceCommand(args);
+    }
+    if (command == "capture") {
+        return captureCommand(args);
+    }
+    if (command == "filter") {
+        return filterCommand(args);
+    }
+    if (command == "tls") {
+        return tlsCommand();
+    }
+    if (command == "stats") {
+        const auto snap = currentSnapshot();
+        qint64 inbound = 0;
+        qint64 outbound = 0;
+        for (const auto &conn : snap->connections) {
+            inbound += conn.inbound;
+            outbound += conn.outbound;
+        }
+        return QString("connections %1, rooms %2, inbound %3 B, outbound %4 B, snapshot %5\n"
+                       "memory %6 B (limit %7), shed connections %8, shed rooms %9\n")
+            .arg(snap->connections.size()).arg(snap->rooms.size()).arg(inbound).arg(outbound)
+            .arg(snap->takenAt.toString("HH:mm:ss.zzz"))
+            .arg(snap->memory).arg(snap->memoryLimit > 0 ? QString::number(snap->memoryLimit) : QString("none"))
+            .arg(snap->shedConnections).arg(snap->shedRooms);
+    }
+    if (command == "kick" && !args.isEmpty()) {
+        bool ok = false;
+        const quint64 id = args.first().toULongLong(&ok);
+        if (!ok) {
+            return "invalid connection id\n";
+        }
+        emit kickRequested(id);
+        return QString("kick %1 requested\n").arg(id);
+    }
+    if (command == "close" && !args.isEmpty()) {
+        const QString room = args.join(' ');
+        emit closeRoomRequested(room);
+        return QString("close '%1' requested\n").arg(room);
+    }
+    return "unknown command, type 'help'\n";
+}
+
+QString AdminConsole::listRooms(const QStringList &args) const
+{
+    const auto snap = currentSnapshot();
+    const bool byRate = !args.isEmpty() && args.first() == "rate";
+    int limit = kDefaultTopN;
+    if (!args.isEmpty()) {
+        bool ok = false;
+        const int n = args.last().toInt(&ok);
+        if (ok && n > 0) {
+            limit = n;
+        }
+    }
+
+    QList<AdminSnapshot::Room> rooms = snap->rooms;
+    std::sort(rooms.begin(), rooms.end(), [byRate](const auto &a, const auto &b) {
+        return byRate ? a.rate > b.rate : a.members > b.members;
+    });
+
+    QString out;
+    QTextStream stream(&out);
+    stream << "members\tmsg/s\tmessages\tframes\tbytes\troom\n";
+    for (int i = 0; i < rooms.size() && i < limit; ++i) {
+        const auto &room = rooms.at(i);
+        stream << room.members << '\t' << QString::number(room.rate, 'f', 1) << '\t' << room.messages
+               << '\t' << room.bufferedFrames << '\t' << room.bufferedBytes << '\t' << room.name << '\n';
+    }
+    return out;
+}
+
+QString AdminConsole::listConnections(const QStringList &args) const
+{
+    const auto snap = currentSnapshot();
+    int limit = kDefaultTopN;
+    if (!args.isEmpty() && args.first().toInt() > 0) {
+        limit = args.first().toInt();
+    }
+
+    QList<AdminSnapshot::Connection> conns = snap->connections;
+    std::sort(conns.begin(), conns.end(), [](const auto &a, const auto &b) {
+        return a.inbound + a.outbound > b.inbound + b.outbound;
+    });
+
+    QString out;
+    QTextStream stream(&out);
+    stream << "id\tinbound\toutbound\tmemory\trooms\tpeer\taccount\n";
+    for (int i = 0; i < conns.size() && i < limit; ++i) {
+        const auto &conn = conns.at(i);
+        stream << conn.id << '\t' << conn.inbound << '\t' << conn.outbound << '\t' << conn.memory << '\t' << conn.rooms
+               << '\t' << conn.peer << '\t' << (conn.account.isEmpty() ? "-" : conn.account) << '\n';
+    }
+    return out;
+}
+
+QString AdminConsole::listMemory(const QStringList &args) const
+{
+    const auto snap = currentSnapshot();
+    int limit = kDefaultTopN;
+    if (!args.isEmpty() && args.first().toInt() > 0) {
+        limit = args.first().toInt();
+    }
+
+    struct Entry {
+        qint64 bytes;
+        QString what;
+    };
+    QList<Entry> entries;
+    entries.reserve(snap->connections.size() + snap->rooms.size());
+    for (const auto &conn : snap->connections) {
+        entries.append(Entry{conn.memory, QString("conn %1 %2").arg(conn.id).arg(conn.account)});
+    }
+    for (const auto &room : snap->rooms) {
+        entries.append(Entry{room.memory, "room " + room.name});
+    }
+    std::sort(entries.begin(), entries.end(), [](const Entry &a, const Entry &b) {
+        return a.bytes > b.bytes;
+    });
+
+    QString out;
+    QTextStream stream(&out);
+    stream << "total " << snap->memory << " B\n";
+    for (int i = 0; i < entries.size() && i < limit; ++i) {
+        stream << entries.at(i).bytes << '\t' << entries.at(i).what << '\n';
+    }
+    return out;
+}
+
+QString AdminConsole::traceCommand(const QStringList &args)
+{
+    const QString sub = args.value(0);
+    if (sub == "on" || sub == "off") {
+        Trace::setEnabled(sub == "on");
+        return QString("tracing %1\n").arg(sub);
+    }
+    if (sub == "dump") {
+        // 导出只读取各线程的环形缓冲区，在本线程完成
+        const QString path = Trace::dumpToFile(QDir(QCoreApplication::applicationDirPath()).filePath("traces"));
+        return path.isEmpty() ? "failed to write trace\n" : "trace written to " + path + "\n";
+    }
+    return QString("tracing is %1\n").arg(Trace::isEnabled() ? "on" : "off");
+}
+
+QString AdminConsole::captureCommand(const QStringList &args)
+{
+    const QString sub = args.value(0);
+    if (sub == "start") {
+        QString path = args.value(1);
+        if (path.isEmpty()) {
+            const QString dir = QDir(QCoreApplication::applicationDirPath()).filePath("captures");
+            QDir().mkpath(dir);
+            path = QDir(dir).filePath(QString("capture-%1-%2.bin")
+                                          .arg(QCoreApplication::applicationPid())
+                                          .arg(QDateTime::currentDateTime().toString("yyyyMMdd-HHmmss")));
+        }
+        emit captureRequested(path);
+        return "capture to " + path + " requested\n";
+    }
+    if (sub == "stop") {
+        emit captureRequested(QString());
+        return "capture stop requested\n";
+    }
+    const auto snap = currentSnapshot();
+    return snap->capturePath.isEmpty()
+               ? QString("not capturing\n")
+               : QString("capturing to %1, %2 events\n").arg(snap->capturePath).arg(snap->captureEvents);
+}
+
+QString AdminConsole::filterCommand(const QStringList &args)
+{
+    const auto snap = currentSnapshot();
+    if (snap->filterPatterns < 0) {
+        return "keyword filter is off (start the server with --filter-file)\n";
+    }
+    if (args.value(0) == "reload") {
+        emit filterReloadRequested();
+        return "filter reload requested\n";
+    }
+    return QString("patterns %1, automaton %2 B, checked %3, blocked %4, masked %5, flagged %6\n")
+        .arg(snap->filterPatterns).arg(snap->filterMemory).arg(snap->filterChecked)
+        .arg(snap->filterBlocked).arg(snap->filterMasked).arg(snap->filterFlagged);
+}
+
+QString AdminConsole::tlsCommand() const
+{
+    const auto snap = currentSnapshot();
+    if (!snap->tls) {
+        return "TLS is off (start the server with --tls-cert and --tls-key)\n";
+    }
+    const TlsAcceptor::Stats &stats = snap->tlsStats;
+    const auto average = [](qint64 us, quint64 count) {
+        return count ? QString::number(double(us) / count / 1000.0, 'f', 2) : QString("-");
+    };
+    return QString("full %1 (avg %2 ms, max %3 ms), resumed %4 (avg %5 ms, max %6 ms), failed %7\n"
+                   "tickets issued %8, redeemed here %9, misses %10\n")
+        .arg(stats.full).arg(average(stats.fullUs, stats.full)).arg(stats.maxFullUs / 1000.0, 0, 'f', 2)
+        .arg(stats.resumed).arg(average(stats.resumedUs, stats.resumed)).arg(stats.maxResumedUs / 1000.0, 0, 'f', 2)
+        .arg(stats.failed).arg(stats.ticketsIssued).arg(stats.redeemed).arg(stats.ticketMisses);
+}
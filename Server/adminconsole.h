@@ -0,0 +1,99 @@
+#ifndef ADMINCONSOLE_H
+#define ADMINCONSOLE_H
+
+#include <QObject>
+#include <QDateTime>
+#include <QList>
+#include <QMutex>
+#include <QString>
+#include <memory>
+
+#include "tlsacceptor.h"
+
+class QLocalServer;
+class QLocalSocket;
+
+// 聊天线程定期发布的只读快照，管理命令只读快照，不会阻塞聊天事件循环
+struct AdminSnapshot {
+    struct Room {
+        QString name;
+        int members = 0;
+        quint64 messages = 0;     // 累计消息数
+        double rate = 0.0;        // 最近一个周期的消息/秒
+        int bufferedFrames = 0;   // 重传窗口中的帧数
+        qint64 bufferedBytes = 0;
+        qint64 memory = 0;        // 成员、历史与重传窗口的估算字节数
+    };
+    struct Connection {
+        quint64 id = 0;
+        QString account;
+        QString name;
+        QString peer;
+        qint64 inbound = 0;       // 未成帧的输入缓冲
+        qint64 outbound = 0;      // 等待写出的字节
+        int rooms = 0;
+        qint64 memory = 0;        // 缓冲区与 ClientInfo 的估算字节数
+    };
+
+    QDateTime takenAt;
+    qint64 memory = 0;
+    qint64 memoryLimit = 0;
+    quint64 shedConnections = 0;
+    quint64 shedRooms = 0;
+    QString capturePath;          // 为空表示没有在录制
+    quint64 captureEvents = 0;
+    int filterPatterns = -1;      // -1 表示没有启用关键词过滤
+    qint64 filterMemory = 0;
+    quint64 filterChecked = 0;
+    quint64 filterBlocked = 0;
+    quint64 filterMasked = 0;
+    quint64 filterFlagged = 0;
+    bool tls = false;             // 是否启用 TLS
+    TlsAcceptor::Stats tlsStats;
+    QList<Room> rooms;
+    QList<Connection> connections;
+};
+
+// 管理控制台：在独立线程上监听本地 socket（Unix 域 socket / Windows 命名管道），
+// 一行一条命令，返回纯文本
+class AdminConsole : public QObject
+{
+    Q_OBJECT
+public:
+    explicit AdminConsole(const QString &socketName, QObject *parent = nullptr);
+
+    // 任意线程调用
+    void publish(std::shared_ptr<const AdminSnapshot> snapshot);
+
+public slots:
+    void start();
+
+signals:
+    // 控制命令在聊天线程上执行
+    void kickRequested(quint64 connectionId);
+    void closeRoomRequested(const QString &room);
+    // path 为空表示停止录制
+    void captureRequested(const QString &path);
+    void filterReloadRequested();
+
+private slots:
+    void onNewConnection();
+
+private:
+    std::shared_ptr<const AdminSnapshot> currentSnapshot() const;
+    QString handleCommand(const QString &line);
+    QString listRooms(const QStringList &args) const;
+    QString listConnections(const QStringList &args) const;
+    QString listMemory(const QStringList &args) const;
+    QString traceCommand(const QStringList &args);
+    QString captureCommand(const QStringList &args);
+    QString filterCommand(const QStringList &args);
+    QString tlsCommand() const;
+
+    QString socketName;
+    QLocalServer *server = nullptr;
+    mutable QMutex mutex;
+    std::shared_ptr<const AdminSnapshot> snapshot;
+};
+
+#endif // ADMINCONSOLE_H
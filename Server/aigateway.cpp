@@ -0,0 +1,128 @@
+#include "aigateway.h"
+
+#include <QCryptographicHash>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QNetworkReply>
+#include <QNetworkRequest>
+
+namespace {
+// 去掉大小写、多余空白和结尾标点，让几乎相同的提问合并到一次调用
+QString normalizePrompt(const QString &prompt)
+{
+    QString normalized = prompt.simplified().toCaseFolded();
+    while (!normalized.isEmpty() && (normalized.back().isPunct() || normalized.back().isSpace())) {
+        normalized.chop(1);
+    }
+    return normalized;
+}
+}
+
+AIGateway::AIGateway(QObject *parent)
+    : QObject(parent)
+    , network(new QNetworkAccessManager(this))
+{
+    cache.setMaxCost(config.cacheEntries);
+}
+
+void AIGateway::setConfig(const Config &newConfig)
+{
+    config = newConfig;
+    config.maxConcurrent = qMax(1, config.maxConcurrent);
+    cache.setMaxCost(qMax(1, config.cacheEntries));
+    startNext();
+}
+
+bool AIGateway::isEnabled() const
+{
+    return !config.apiKey.isEmpty() && config.endpoint.isValid();
+}
+
+QByteArray AIGateway::cacheKey(const QString &room, quint64 fromSeq, quint64 toSeq, const QString &prompt) const
+{
+    QCryptographicHash hash(QCryptographicHash::Sha256);
+    hash.addData(config.model.toUtf8());
+    hash.addData(QByteArray(1, '\0'));
+    hash.addData(room.toUtf8());
+    hash.addData(QString("\n%1-%2\n").arg(fromSeq).arg(toSeq).toUtf8());
+    hash.addData(normalizePrompt(prompt).toUtf8());
+    return hash.result();
+}
+
+void AIGateway::request(const QString &room, quint64 fromSeq, quint64 toSeq,
+                        const QString &prompt, const Callback &callback)
+{
+    if (!isEnabled()) {
+        callback(false, "服务器未配置 AI 网关", false);
+        return;
+    }
+
+    const QByteArray key = cacheKey(room, fromSeq, toSeq, prompt);
+    if (const QString *hit = cache.object(key)) {
+        callback(true, *hit, true);
+        return;
+    }
+
+    // 同一快照上的相同请求已经在路上：挂在它后面等结果
+    auto it = waiters.find(key);
+    if (it != waiters.end()) {
+        it->append(callback);
+        return;
+    }
+
+    waiters.insert(key, QList<Callback>{callback});
+    queue.append(PendingCall{key, prompt});
+    startNext();
+}
+
+void AIGateway::startNext()
+{
+    while (active < config.maxConcurrent && !queue.isEmpty()) {
+        const PendingCall call = queue.takeFirst();
+
+        QNetworkRequest request(config.endpoint);
+        request.setHeader(QNetworkRequest::ContentTypeHeader, "application/json");
+        request.setRawHeader("Authorization", QString("Bearer %1").arg(config.apiKey).toUtf8());
+
+        QJsonObject messageObj;
+        messageObj["role"] = "user";
+        messageObj["content"] = call.prompt;
+
+        QJsonObject body;
+        body["model"] = config.model;
+        body["messages"] = QJsonArray{messageObj};
+        body["temperature"] = 0.7;
+        body["max_tokens"] = 1000;
+
+        ++active;
+        QNetworkReply *reply = network->post(request, QJsonDocument(body).toJson(QJsonDocument::Compact));
+        const QByteArray key = call.key;
+        connect(reply, &QNetworkReply::finished, this, [this, reply, key]() {
+            reply->deleteLater();
+            --active;
+
+            const QJsonObject obj = QJsonDocument::fromJson(reply->readAll()).object();
+            const QJsonArray choices = obj.value("choices").toArray();
+            if (reply->error() == QNetworkReply::NoError && !choices.isEmpty()) {
+                const QString content = choices.first().toObject().value("message").toObject()
+                                            .value("content").toString();
+                cache.insert(key, new QString(content));
+                deliver(key, true, content);
+            } else if (obj.contains("error")) {
+                deliver(key, false, obj.value("error").toObject().value("message").toString());
+            } else {
+                deliver(key, false, reply->errorString());
+            }
+            startNext();
+        });
+    }
+}
+
+void AIGateway::deliver(const QByteArray &key, bool ok, const QString &text)
+{
+    const QList<Callback> callbacks = waiters.take(key);
+    for (const Callback &callback : callbacks) {
+        callback(ok, text, false);
+    }
+}
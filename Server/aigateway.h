@@ -0,0 +1,58 @@
+#ifndef AIGATEWAY_H
+#define AIGATEWAY_H
+
+#include <QObject>
+#include <QUrl>
+#include <QHash>
+#include <QCache>
+#include <QList>
+#include <QNetworkAccessManager>
+#include <functional>
+
+// 服务器端 AI 网关：相同房间快照上的相同请求只调用一次上游，结果按房间和序号区间缓存
+class AIGateway : public QObject
+{
+    Q_OBJECT
+public:
+    struct Config {
+        QUrl endpoint = QUrl("https://api.siliconflow.cn/v1/chat/completions");
+        QString apiKey;
+        QString model = "Qwen/Qwen2.5-7B-Instruct";
+        int maxConcurrent = 2;
+        int cacheEntries = 256;
+    };
+
+    // ok 为 false 时 text 是错误信息
+    using Callback = std::function<void(bool ok, const QString &text, bool cached)>;
+
+    explicit AIGateway(QObject *parent = nullptr);
+
+    void setConfig(const Config &config);
+    bool isEnabled() const;
+
+    // fromSeq/toSeq 标识房间历史快照，prompt 是已经拼好上下文的完整提示词
+    void request(const QString &room, quint64 fromSeq, quint64 toSeq,
+                 const QString &prompt, const Callback &callback);
+
+    int activeCount() const { return active; }
+    int queuedCount() const { return queue.size(); }
+
+private:
+    struct PendingCall {
+        QByteArray key;
+        QString prompt;
+    };
+
+    QByteArray cacheKey(const QString &room, quint64 fromSeq, quint64 toSeq, const QString &prompt) const;
+    void startNext();
+    void deliver(const QByteArray &key, bool ok, const QString &text);
+
+    Config config;
+    QNetworkAccessManager *network;
+    QCache<QByteArray, QString> cache;
+    QHash<QByteArray, QList<Callback>> waiters;  // 正在进行或排队中的请求
+    QList<PendingCall> queue;
+    int active = 0;
+};
+
+#endif // AIGATEWAY_H
@@ -0,0 +1,225 @@
+#include "blobsender.h"
+
+#include <QSslSocket>
+#include <QTimer>
+
+#ifdef Q_OS_LINUX
+#include <sys/sendfile.h>
+#include <sys/socket.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+namespace {
+// 单次 sendfile 的最大字节数，避免一个大文件长时间占住事件循环
+constexpr qint64 kSendfileChunk = 1024 * 1024;
+// 分块发送（非 Linux 平台或 TLS 连接）：socket 待发送数据低于该值时继续读文件
+constexpr qint64 kLowWater = 256 * 1024;
+constexpr qint64 kReadChunk = 64 * 1024;
+// 这么久一个字节都没有发出去（下载方不再读取）就断开
+constexpr int kStallTimeoutMs = 30000;
+}
+
+BlobSender::BlobSender(QTcpSocket *socket, const QString &path, qint64 size,
+                       const QByteArray &header, QObject *parent)
+    : QObject(parent)
+    , socket(socket)
+    , path(path)
+    , size(size)
+    , header(header)
+    , stallTimer(new QTimer(this))
+{
+    stallTimer->setSingleShot(true);
+    stallTimer->setInterval(kStallTimeoutMs);
+    connect(stallTimer, &QTimer::timeout, this, &BlobSender::stalled);
+#ifdef Q_OS_LINUX
+    auto *secure = qobject_cast<QSslSocket*>(socket);
+    zeroCopy = !(secure && secure->isEncrypted());
+#endif
+}
+
+BlobSender::~BlobSender()
+{
+#ifdef Q_OS_LINUX
+    if (socketFd >= 0) {
+        ::close(socketFd);
+    }
+    if (fileFd >= 0) {
+        ::close(fileFd);
+    }
+#endif
+}
+
+void BlobSender::start()
+{
+    stallTimer->start();
+#ifdef Q_OS_LINUX
+    if (zeroCopy) {
+        startZeroCopy();
+        return;
+    }
+#endif
+    startBuffered();
+}
+
+void BlobSender::pump()
+{
+    if (done) {
+        return;
+    }
+#ifdef Q_OS_LINUX
+    if (zeroCopy) {
+        pumpZeroCopy();
+        return;
+    }
+#endif
+    pumpBuffered();
+}
+
+void BlobSender::startBuffered()
+{
+    socket->setParent(this);
+    // 有数据写进内核说明下载方还在读
+    connect(socket, &QTcpSocket::bytesWritten, stallTimer, qOverload<>(&QTimer::start));
+    connect(socket, &QTcpSocket::bytesWritten, this, &BlobSender::pump);
+    connect(socket, &QTcpSocket::disconnected, this, [this]() { finish(false); });
+
+    file.setFileName(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        finish(false);
+        return;
+    }
+    socket->write(header);
+    headerSent = header.size();
+    pump();
+}
+
+void BlobSender::pumpBuffered()
+{
+    while (offset < size && socket->bytesToWrite() < kLowWater) {
+        const QByteArray chunk = file.read(qMin(size - offset, kReadChunk));
+        if (chunk.isEmpty()) {
+            finish(false);
+            return;
+        }
+        socket->write(chunk);
+        offset += chunk.size();
+    }
+    if (offset >= size && socket->bytesToWrite() == 0) {
+        finish(true);
+    }
+}
+
+#ifdef Q_OS_LINUX
+void BlobSender::startZeroCopy()
+{
+    // 接管描述符：dup 一份自己管理，QTcpSocket 关闭它那一份后连接仍然保持
+    socketFd = ::dup(int(socket->socketDescriptor()));
+    socket->abort();
+    socket->deleteLater();
+    socket = nullptr;
+
+    fileFd = ::open(QFile::encodeName(path).constData(), O_RDONLY | O_CLOEXEC);
+    if (socketFd < 0 || fileFd < 0) {
+        finish(false);
+        return;
+    }
+
+    notifier = new QSocketNotifier(socketFd, QSocketNotifier::Write, this);
+    connect(notifier, &QSocketNotifier::activated, this, &BlobSender::pump);
+    pump();
+}
+
+void BlobSender::pumpZeroCopy()
+{
+    while (headerSent < header.size()) {
+        const ssize_t n = ::send(socketFd, header.constData() + headerSent,
+                                 size_t(header.size() - headerSent), MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                finish(false);
+            }
+            return;
+        }
+        headerSent += n;
+        stallTimer->start();
+    }
+
+    // 每次只发一块就回到事件循环；socket 仍然可写时写通知会马上再次触发
+    if (offset < size) {
+        off_t pos = off_t(offset);
+        ssize_t n;
+        do {
+            n = ::sendfile(socketFd, fileFd, &pos, size_t(qMin(size - offset, kSendfileChunk)));
+        } while (n < 0 && errno == EINTR);
+        if (n < 0) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                finish(false);
+            }
+            return;
+        }
+        if (n == 0) {
+            // 文件比记录的短
+            finish(false);
+            return;
+        }
+        offset = qint64(pos);
+        stallTimer->start();
+    }
+    if (offset >= size) {
+        finish(true);
+    }
+}
+#endif
+
+void BlobSender::stalled()
+{
+    // 关闭描述符或中止 socket，不等残留的数据发完
+    if (socket) {
+        socket->abort();
+    }
+#ifdef Q_OS_LINUX
+    if (socketFd >= 0) {
+        // linger 为 0 时 close 直接发 RST，内核也不再替对方保留没发出的数据
+        const linger reset{1, 0};
+        ::setsockopt(socketFd, SOL_SOCKET, SO_LINGER, &reset, sizeof(reset));
+    }
+#endif
+    finish(false);
+}
+
+void BlobSender::finish(bool ok)
+{
+    if (done) {
+        return;
+    }
+    done = true;
+    stallTimer->stop();
+
+#ifdef Q_OS_LINUX
+    if (notifier) {
+        notifier->setEnabled(false);
+    }
+    if (socketFd >= 0) {
+        ::close(socketFd);
+        socketFd = -1;
+    }
+    if (fileFd >= 0) {
+        ::close(fileFd);
+        fileFd = -1;
+    }
+#endif
+    // 走 sendfile 时 socket 已经交出
+    if (socket) {
+        file.close();
+        socket->disconnect(this);
+        socket->disconnectFromHost();
+    }
+
+    emit finished(ok);
+    deleteLater();
+}
@@ -0,0 +1,60 @@
+#ifndef BLOBSENDER_H
+#define BLOBSENDER_H
+
+#include <QObject>
+#include <QTcpSocket>
+#include <QFile>
+#include <QSocketNotifier>
+
+class QTimer;
+
+// 在独立的下载连接上发送一个附件：先发一行 JSON 头，再发原始字节，然后关闭连接。
+// Linux 下接管 socket 描述符并用 sendfile 发送，文件内容不经过用户态；
+// TLS 连接的数据要经过 QSslSocket 加密，不能绕过它，和其他平台一样分块读文件写入 socket。
+// 下载方长时间不取数据时断开连接，不让它一直占着描述符和打开的文件。
+class BlobSender : public QObject
+{
+    Q_OBJECT
+public:
+    BlobSender(QTcpSocket *socket, const QString &path, qint64 size,
+               const QByteArray &header, QObject *parent = nullptr);
+    ~BlobSender();
+
+    void start();
+
+signals:
+    void finished(bool ok);
+
+private slots:
+    void pump();
+
+private:
+    void finish(bool ok);
+    void stalled();
+    void startBuffered();
+    void pumpBuffered();
+
+#ifdef Q_OS_LINUX
+    void startZeroCopy();
+    void pumpZeroCopy();
+#endif
+
+    QTcpSocket *socket;
+    QString path;
+    qint64 size;
+    QByteArray header;
+    qint64 headerSent = 0;
+    qint64 offset = 0;
+    bool done = false;
+    bool zeroCopy = false;
+    QFile file;
+    QTimer *stallTimer;
+
+#ifdef Q_OS_LINUX
+    int socketFd = -1;
+    int fileFd = -1;
+    QSocketNotifier *notifier = nullptr;
+#endif
+};
+
+#endif // BLOBSENDER_H
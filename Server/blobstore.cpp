@@ -0,0 +1,283 @@
+#include "blobstore.h"
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QFileInfo>
+#include <QRandomGenerator>
+
+#ifdef Q_OS_UNIX
+#include <csignal>
+#include <cerrno>
+#endif
+
+namespace {
+// 认领挑战覆盖的字节数上限，文件更小时覆盖整个文件
+constexpr qint64 kChallengeBytes = 64 * 1024;
+constexpr int kSaltBytes = 16;
+
+bool processAlive(qint64 pid)
+{
+#ifdef Q_OS_UNIX
+    return pid > 0 && (::kill(pid_t(pid), 0) == 0 || errno != ESRCH);
+#else
+    return pid == QCoreApplication::applicationPid();
+#endif
+}
+}
+
+BlobStore::BlobStore(const QString &rootDir)
+    : root(rootDir)
+{
+    QDir().mkpath(QDir(root).filePath("tmp"));
+    // 上次异常退出留下的半截上传没有用处；多进程模式下其他 worker 的临时文件要保留
+    QDir tmp(QDir(root).filePath("tmp"));
+    for (const QString &name : tmp.entryList(QDir::Files)) {
+        if (!processAlive(name.section('-', 0, 0).toLongLong())) {
+            tmp.remove(name);
+        }
+    }
+}
+
+void BlobStore::setQuota(qint64 bytesPerAccount)
+{
+    quota = bytesPerAccount;
+}
+
+void BlobStore::setMaxBlobSize(qint64 bytes)
+{
+    maxBlobSize = bytes;
+}
+
+bool BlobStore::isValidHash(const QString &hash)
+{
+    if (hash.size() != 64) {
+        return false;
+    }
+    for (QChar c : hash) {
+        if (!((c >= '0' && c <= '9') || (c >= 'a' && c <= 'f'))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool BlobStore::contains(const QString &hash) const
+{
+    return isValidHash(hash) && QFileInfo::exists(pathFor(hash));
+}
+
+QString BlobStore::pathFor(const QString &hash) const
+{
+    // 两级目录，避免单个目录下文件过多
+    return QDir(root).filePath(hash.left(2) + "/" + hash.mid(2));
+}
+
+qint64 BlobStore::sizeOf(const QString &hash) const
+{
+    return QFileInfo(pathFor(hash)).size();
+}
+
+qint64 BlobStore::usage(const QString &account) const
+{
+    return accountUsage.value(account);
+}
+
+QString BlobStore::tempPathFor(const QString &uploadId) const
+{
+    // 文件名带上进程号，共用同一目录的 worker 之间不会冲突
+    return QDir(root).filePath(QString("tmp/%1-%2.part").arg(QCoreApplication::applicationPid()).arg(uploadId));
+}
+
+qint64 BlobStore::reservedBy(const QString &account) const
+{
+    qint64 reserved = 0;
+    for (const Upload &upload : uploads) {
+        if (upload.account == account) {
+            reserved += upload.size;
+        }
+    }
+    return reserved;
+}
+
+QString BlobStore::beginUpload(const QString &account, const QString &room, const QString &name,
+                               const QString &hash, qint64 size, QString *error)
+{
+    if (!isValidHash(hash)) {
+        *error = "无效的文件哈希";
+        return QString();
+    }
+    if (size <= 0 || size > maxBlobSize) {
+        *error = QString("文件大小必须在 1 字节到 %1 MB 之间").arg(maxBlobSize / (1024 * 1024));
+        return QString();
+    }
+    if (usage(account) + reservedBy(account) + size > quota) {
+        *error = "附件空间已用完";
+        return QString();
+    }
+
+    const QString uploadId = QString::number(nextUploadId++);
+    Upload upload;
+    upload.account = account;
+    upload.room = room;
+    upload.name = name;
+    upload.hash = hash;
+    upload.size = size;
+    upload.file = QSharedPointer<QFile>::create(tempPathFor(uploadId));
+    upload.digest = QSharedPointer<QCryptographicHash>::create(QCryptographicHash::Sha256);
+    if (!upload.file->open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        *error = "服务器无法保存附件";
+        return QString();
+    }
+    uploads.insert(uploadId, upload);
+    return uploadId;
+}
+
+bool BlobStore::writeChunk(const QString &uploadId, qint64 offset, const QByteArray &data, QString *error)
+{
+    auto it = uploads.find(uploadId);
+    if (it == uploads.end()) {
+        *error = "上传不存在";
+        return false;
+    }
+    Upload &upload = it.value();
+    if (!upload.file) {
+        *error = "上传不存在";
+        return false;
+    }
+    if (offset != upload.received || data.isEmpty() || data.size() > kChunkSize
+        || upload.received + data.size() > upload.size) {
+        *error = "分片偏移或大小不正确";
+        return false;
+    }
+    if (upload.file->write(data) != data.size()) {
+        *error = "服务器写入附件失败";
+        return false;
+    }
+    upload.digest->addData(data);
+    upload.received += data.size();
+    return true;
+}
+
+bool BlobStore::isComplete(const QString &uploadId) const
+{
+    auto it = uploads.constFind(uploadId);
+    return it != uploads.cend() && it->file && it->received == it->size;
+}
+
+bool BlobStore::finishUpload(const QString &uploadId, Upload *done, QString *error)
+{
+    auto it = uploads.find(uploadId);
+    if (it == uploads.end() || !it->file) {
+        *error = "上传不存在";
+        return false;
+    }
+    Upload upload = it.value();
+    uploads.erase(it);
+    upload.file->close();
+
+    const QString actual = QString::fromLatin1(upload.digest->result().toHex());
+    if (actual != upload.hash) {
+        upload.file->remove();
+        *error = "文件校验失败";
+        return false;
+    }
+
+    const QString target = pathFor(upload.hash);
+    if (QFileInfo::exists(target)) {
+        // 并发上传了同样的内容，保留已有的那份
+        upload.file->remove();
+    } else {
+        QDir().mkpath(QFileInfo(target).absolutePath());
+        if (!upload.file->rename(target)) {
+            upload.file->remove();
+            *error = "服务器保存附件失败";
+            return false;
+        }
+    }
+    // 内容已存在时也计入上传者的配额，重新上传不能绕过认领的计费
+    accountUsage[upload.account] += upload.size;
+
+    upload.file.clear();
+    upload.digest.clear();
+    *done = upload;
+    return true;
+}
+
+void BlobStore::cancelUpload(const QString &uploadId)
+{
+    auto it = uploads.find(uploadId);
+    if (it == uploads.end()) {
+        return;
+    }
+    if (it->file) {
+        it->file->close();
+        it->file->remove();
+    }
+    uploads.erase(it);
+}
+
+QString BlobStore::beginClaim(const QString &account, const QString &room, const QString &name,
+                              const QString &hash, qint64 size, Upload *challenge, QString *error)
+{
+    if (!contains(hash) || sizeOf(hash) != size) {
+        *error = "附件不存在";
+        return QString();
+    }
+    if (usage(account) + reservedBy(account) + size > quota) {
+        *error = "附件空间已用完";
+        return QString();
+    }
+
+    Upload claim;
+    claim.account = account;
+    claim.room = room;
+    claim.name = name;
+    claim.hash = hash;
+    claim.size = size;
+    // 随机的盐和位置，只知道哈希的人答不出来，也不能拿以前的答案重放
+    quint32 salt[kSaltBytes / 4];
+    QRandomGenerator::system()->fillRange(salt);
+    claim.salt = QByteArray(reinterpret_cast<const char *>(salt), kSaltBytes);
+    claim.challengeLength = qMin(size, kChallengeBytes);
+    claim.challengeOffset = QRandomGenerator::system()->bounded(size - claim.challengeLength + 1);
+
+    const QString claimId = QString::number(nextUploadId++);
+    uploads.insert(claimId, claim);
+    *challenge = claim;
+    return claimId;
+}
+
+bool BlobStore::finishClaim(const QString &claimId, const QString &proof, Upload *done, QString *error)
+{
+    auto it = uploads.find(claimId);
+    if (it == uploads.end() || it->file || it->salt.isEmpty()) {
+        *error = "上传不存在";
+        return false;
+    }
+    Upload claim = it.value();
+    uploads.erase(it);
+
+    QFile file(pathFor(claim.hash));
+    if (!file.open(QIODevice::ReadOnly) || !file.seek(claim.challengeOffset)) {
+        *error = "附件不存在";
+        return false;
+    }
+    const QByteArray range = file.read(claim.challengeLength);
+    if (range.size() != claim.challengeLength || proofFor(claim.salt, range) != proof.toLower()) {
+        *error = "文件校验失败";
+        return false;
+    }
+
+    // 内容只存一份，但每次认领都计入认领者的配额，和重新上传一样
+    accountUsage[claim.account] += claim.size;
+    *done = claim;
+    return true;
+}
+
+QString BlobStore::proofFor(const QByteArray &salt, const QByteArray &range)
+{
+    QCryptographicHash digest(QCryptographicHash::Sha256);
+    digest.addData(salt);
+    digest.addData(range);
+    return QString::fromLatin1(digest.result().toHex());
+}
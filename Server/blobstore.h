@@ -0,0 +1,72 @@
+#ifndef BLOBSTORE_H
+#define BLOBSTORE_H
+
+#include <QString>
+#include <QHash>
+#include <QFile>
+#include <QCryptographicHash>
+#include <QSharedPointer>
+
+// 按内容寻址的附件存储：文件以 SHA-256 命名，相同内容只保存一份
+class BlobStore
+{
+public:
+    // 单个上传分片的最大字节数（base64 之前），保证一帧不会太大
+    static constexpr int kChunkSize = 48 * 1024;
+
+    struct Upload {
+        QString account;
+        QString room;
+        QString name;
+        QString hash;
+        qint64 size = 0;
+        qint64 received = 0;
+        QSharedPointer<QFile> file;
+        QSharedPointer<QCryptographicHash> digest;
+        // 认领已有内容时的挑战：对 salt 加上文件中 [challengeOffset, challengeOffset + challengeLength) 的字节求 SHA-256
+        QByteArray salt;
+        qint64 challengeOffset = 0;
+        qint64 challengeLength = 0;
+    };
+
+    explicit BlobStore(const QString &rootDir);
+
+    void setQuota(qint64 bytesPerAccount);
+    void setMaxBlobSize(qint64 bytes);
+
+    static bool isValidHash(const QString &hash);
+    bool contains(const QString &hash) const;
+    QString pathFor(const QString &hash) const;
+    qint64 sizeOf(const QString &hash) const;
+    qint64 usage(const QString &account) const;
+
+    // 成功返回上传 id；失败返回空字符串并写入 error
+    QString beginUpload(const QString &account, const QString &room, const QString &name,
+                        const QString &hash, qint64 size, QString *error);
+    bool writeChunk(const QString &uploadId, qint64 offset, const QByteArray &data, QString *error);
+    bool isComplete(const QString &uploadId) const;
+    // 校验哈希并把临时文件移入存储，返回完成的上传信息
+    bool finishUpload(const QString &uploadId, Upload *done, QString *error);
+    void cancelUpload(const QString &uploadId);
+
+    // 内容已在存储中时不必重传，但要证明确实持有这份内容：返回认领 id，challenge 中带挑战参数。
+    // 认领和上传一样先占用配额，作答正确后计入账号用量
+    QString beginClaim(const QString &account, const QString &room, const QString &name,
+                       const QString &hash, qint64 size, Upload *challenge, QString *error);
+    bool finishClaim(const QString &claimId, const QString &proof, Upload *done, QString *error);
+    // 客户端与服务器共用的作答算法
+    static QString proofFor(const QByteArray &salt, const QByteArray &range);
+
+private:
+    QString tempPathFor(const QString &uploadId) const;
+    qint64 reservedBy(const QString &account) const;
+
+    QString root;
+    qint64 quota = 200LL * 1024 * 1024;
+    qint64 maxBlobSize = 100LL * 1024 * 1024;
+    quint64 nextUploadId = 1;
+    QHash<QString, Upload> uploads;
+    QHash<QString, qint64> accountUsage;
+};
+
+#endif // BLOBSTORE_H
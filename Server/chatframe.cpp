@@ -0,0 +1,226 @@
+#include "chatframe.h"
+
+namespace {
+
+inline const char *skipWhitespace(const char *p, const char *end)
+{
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n')) {
+        ++p;
+    }
+    return p;
+}
+
+inline bool isHexDigit(char c)
+{
+    return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F');
+}
+
+inline int hexValue(char c)
+{
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    return (c | 0x20) - 'a' + 10;
+}
+
+// p 指向开引号之后；返回闭引号的位置，格式不合法返回 nullptr
+const char *scanString(const char *p, const char *end, bool *escaped)
+{
+    while (p < end) {
+        const unsigned char c = static_cast<unsigned char>(*p);
+        if (c == '"') {
+            return p;
+        }
+        if (c < 0x20) {
+            return nullptr;
+        }
+        if (c == '\\') {
+            *escaped = true;
+            if (++p >= end) {
+                return nullptr;
+            }
+            switch (*p) {
+            case '"': case '\\': case '/': case 'b': case 'f': case 'n': case 'r': case 't':
+                break;
+            case 'u':
+                if (end - p < 5 || !isHexDigit(p[1]) || !isHexDigit(p[2]) || !isHexDigit(p[3]) || !isHexDigit(p[4])) {
+                    return nullptr;
+                }
+                p += 4;
+                break;
+            default:
+                return nullptr;
+            }
+        }
+        ++p;
+    }
+    return nullptr;
+}
+
+} // namespace
+
+bool scanChatFrame(QByteArrayView line, RawChatFrame *frame)
+{
+    *frame = RawChatFrame{};
+    const char *p = line.data();
+    const char *end = p + line.size();
+
+    p = skipWhitespace(p, end);
+    if (p == end || *p != '{') {
+        return false;
+    }
+    ++p;
+
+    bool first = true;
+    while (true) {
+        p = skipWhitespace(p, end);
+        if (p == end) {
+            return false;
+        }
+        if (*p == '}') {
+            ++p;
+            break;
+        }
+        if (!first) {
+            if (*p != ',') {
+                return false;
+            }
+            p = skipWhitespace(p + 1, end);
+            if (p == end) {
+                return false;
+            }
+        }
+        first = false;
+
+        if (*p != '"') {
+            return false;
+        }
+        bool keyEscaped = false;
+        const char *keyBegin = p + 1;
+        const char *keyEnd = scanString(keyBegin, end, &keyEscaped);
+        if (!keyEnd || keyEscaped) {
+            return false;
+        }
+
+        p = skipWhitespace(keyEnd + 1, end);
+        if (p == end || *p != ':') {
+            return false;
+        }
+        // 只认字符串值，数字、对象等交给完整解析
+        p = skipWhitespace(p + 1, end);
+        if (p == end || *p != '"') {
+            return false;
+        }
+        bool valueEscaped = false;
+        const char *valueBegin = p + 1;
+        const char *valueEnd = scanString(valueBegin, end, &valueEscaped);
+        if (!valueEnd) {
+            return false;
+        }
+        p = valueEnd + 1;
+
+        const QByteArrayView key(keyBegin, keyEnd - keyBegin);
+        const QByteArrayView value(valueBegin, valueEnd - valueBegin);
+        QByteArrayView *slot = nullptr;
+        if (key == "type") {
+            slot = &frame->type;
+            frame->typeEscaped = valueEscaped;
+        } else if (key == "room") {
+            slot = &frame->room;
+            frame->roomEscaped = valueEscaped;
+        } else if (key == "message") {
+            slot = &frame->message;
+        } else if (key == "client_id") {
+            slot = &frame->clientId;
+            frame->clientIdEscaped = valueEscaped;
+        }
+        if (slot) {
+            // 重复的键按 QJsonDocument 的语义处理太麻烦，直接走慢路径
+            if (!slot->isNull()) {
+                return false;
+            }
+            *slot = value;
+        }
+    }
+
+    return skipWhitespace(p, end) == end;
+}
+
+QByteArray jsonEscape(const QString &str)
+{
+    return jsonEscape(QByteArrayView(str.toUtf8()));
+}
+
+QByteArray jsonEscape(QByteArrayView utf8)
+{
+    static const char hex[] = "0123456789abcdef";
+    QByteArray out;
+    out.reserve(utf8.size() + 8);
+    for (char ch : utf8) {
+        const unsigned char c = static_cast<unsigned char>(ch);
+        switch (c) {
+        case '"': out.append("\\\""); break;
+        case '\\': out.append("\\\\"); break;
+        case '\b': out.append("\\b"); break;
+        case '\f': out.append("\\f"); break;
+        case '\n': out.append("\\n"); break;
+        case '\r': out.append("\\r"); break;
+        case '\t': out.append("\\t"); break;
+        default:
+            if (c < 0x20) {
+                out.append("\\u00");
+                out.append(hex[c >> 4]);
+                out.append(hex[c & 0xF]);
+            } else {
+                out.append(ch);
+            }
+        }
+    }
+    return out;
+}
+
+QString jsonUnescape(QByteArrayView raw)
+{
+    if (!raw.contains('\\')) {
+        return QString::fromUtf8(raw);
+    }
+
+    QString out;
+    out.reserve(raw.size());
+    qsizetype runStart = 0;
+    qsizetype i = 0;
+    while (i < raw.size()) {
+        if (raw[i] != '\\') {
+            ++i;
+            continue;
+        }
+        out.append(QString::fromUtf8(raw.sliced(runStart, i - runStart)));
+        if (i + 1 >= raw.size()) {
+            break;
+        }
+        const char esc = raw[i + 1];
+        i += 2;
+        switch (esc) {
+        case 'b': out.append(QChar('\b')); break;
+        case 'f': out.append(QChar('\f')); break;
+        case 'n': out.append(QChar('\n')); break;
+        case 'r': out.append(QChar('\r')); break;
+        case 't': out.append(QChar('\t')); break;
+        case 'u':
+            if (i + 4 <= raw.size()) {
+                // 代理对会以两个 \u 出现，按 UTF-16 码元依次追加即可
+                const char16_t unit = char16_t((hexValue(raw[i]) << 12) | (hexValue(raw[i + 1]) << 8)
+                                               | (hexValue(raw[i + 2]) << 4) | hexValue(raw[i + 3]));
+                out.append(QChar(unit));
+                i += 4;
+            }
+            break;
+        default:
+            out.append(QChar::fromLatin1(esc));
+            break;
+        }
+        runStart = i;
+    }
+    out.append(QString::fromUtf8(raw.sliced(runStart)));
+    return out;
+}
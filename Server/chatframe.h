@@ -0,0 +1,30 @@
+#ifndef CHATFRAME_H
+#define CHATFRAME_H
+
+#include <QByteArray>
+#include <QByteArrayView>
+#include <QString>
+
+// chat 帧的快速路径：只扫描顶层的字符串字段，取出路由需要的 type / room，
+// message 保持 JSON 转义后的原始字节，校验后直接拼进广播帧，不解码成 QString
+struct RawChatFrame {
+    QByteArrayView type;
+    QByteArrayView room;
+    QByteArrayView message;     // 引号内的原始内容，仍是 JSON 转义形式
+    QByteArrayView clientId;
+    bool typeEscaped = false;
+    bool roomEscaped = false;
+    bool clientIdEscaped = false;
+};
+
+// 扁平的、值全是字符串的 JSON 对象才返回 true；其他情况交给 QJsonDocument。
+// line 必须已经由 FrameScanner 校验过 UTF-8，message 会被原样转发
+bool scanChatFrame(QByteArrayView line, RawChatFrame *frame);
+
+// 转义成 JSON 字符串内容（不含两侧引号）
+QByteArray jsonEscape(const QString &str);
+QByteArray jsonEscape(QByteArrayView utf8);
+// jsonEscape 的逆操作；raw 必须是合法的 JSON 字符串内容
+QString jsonUnescape(QByteArrayView raw);
+
+#endif // CHATFRAME_H
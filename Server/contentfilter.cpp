@@ -0,0 +1,236 @@
+#include "contentfilter.h"
+
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QFileSystemWatcher>
+#include <QHash>
+#include <QThread>
+#include <QTimer>
+
+#include <algorithm>
+
+#include "chatframe.h"
+#include "trace.h"
+
+namespace {
+// 保存文件时常常连续触发多次变化通知，停下来这么久之后再重建
+constexpr int kReloadDelayMs = 500;
+}
+
+ContentFilter::ContentFilter(QObject *parent)
+    : QObject(parent)
+    , watcher(new QFileSystemWatcher(this))
+    , reloadTimer(new QTimer(this))
+{
+    reloadTimer->setSingleShot(true);
+    reloadTimer->setInterval(kReloadDelayMs);
+    connect(reloadTimer, &QTimer::timeout, this, &ContentFilter::reload);
+    connect(watcher, &QFileSystemWatcher::fileChanged, this, [this]() {
+        watch();
+        reloadTimer->start();
+    });
+    connect(watcher, &QFileSystemWatcher::directoryChanged, this, [this]() {
+        // 编辑器常用“写临时文件再改名”的方式保存，原文件的监视随之失效，这里重新加上
+        if (!watcher->files().contains(filePath) && QFileInfo::exists(filePath)) {
+            watch();
+            reloadTimer->start();
+        }
+    });
+}
+
+ContentFilter::~ContentFilter()
+{
+    if (buildThread) {
+        buildThread->wait();
+        delete buildThread;
+    }
+}
+
+bool ContentFilter::load(const QString &path, QString *error)
+{
+    std::shared_ptr<const Rules> compiled = compile(path, error);
+    if (!compiled) {
+        return false;
+    }
+    rules = std::move(compiled);
+    filePath = path;
+    watch();
+    return true;
+}
+
+void ContentFilter::watch()
+{
+    if (QFileInfo::exists(filePath) && !watcher->files().contains(filePath)) {
+        watcher->addPath(filePath);
+    }
+    const QString dir = QFileInfo(filePath).absolutePath();
+    if (!watcher->directories().contains(dir)) {
+        watcher->addPath(dir);
+    }
+}
+
+void ContentFilter::reload()
+{
+    if (filePath.isEmpty()) {
+        return;
+    }
+    if (buildThread) {
+        reloadPending = true;
+        return;
+    }
+    // 构建在后台线程进行，完成后回到本线程替换规则；替换只是换一个指针，不会打断正在转发的消息
+    auto compiled = std::make_shared<std::shared_ptr<const Rules>>();
+    auto error = std::make_shared<QString>();
+    const QString path = filePath;
+    buildThread = QThread::create([path, compiled, error]() {
+        *compiled = compile(path, error.get());
+    });
+    connect(buildThread, &QThread::finished, this, [this, compiled, error]() {
+        buildThread->deleteLater();
+        buildThread = nullptr;
+        if (*compiled) {
+            rules = std::move(*compiled);
+            ++counters.reloads;
+            emit reloaded(rules->matcher.patternCount(), rules->buildMs);
+        } else {
+            emit reloadFailed(*error);
+        }
+        if (reloadPending) {
+            reloadPending = false;
+            reload();
+        }
+    });
+    buildThread->start(QThread::LowPriority);
+}
+
+std::shared_ptr<const ContentFilter::Rules> ContentFilter::compile(const QString &path, QString *error)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        *error = path + ": " + file.errorString();
+        return nullptr;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    auto compiled = std::make_shared<Rules>();
+    QHash<QByteArray, int> index;   // 折叠大小写后的关键词 -> 下标
+    Action action = Block;
+    int lineNumber = 0;
+    while (!file.atEnd()) {
+        ++lineNumber;
+        const QByteArray line = file.readLine().trimmed();
+        if (line.isEmpty() || line.startsWith('#')) {
+            continue;
+        }
+        if (line.startsWith('[') && line.endsWith(']')) {
+            const QByteArray section = line.mid(1, line.size() - 2).trimmed().toLower();
+            if (section == "block") {
+                action = Block;
+            } else if (section == "mask") {
+                action = Mask;
+            } else if (section == "flag") {
+                action = Flag;
+            } else {
+                *error = QString("%1:%2: unknown section %3").arg(path).arg(lineNumber).arg(QString::fromUtf8(line));
+                return nullptr;
+            }
+            continue;
+        }
+        // 同一个关键词出现在多个分段里时取最严格的处理
+        const QByteArray key = KeywordMatcher::foldCase(line);
+        auto it = index.constFind(key);
+        if (it != index.cend()) {
+            compiled->actions[it.value()] = qMax(compiled->actions.at(it.value()), action);
+            continue;
+        }
+        index.insert(key, int(compiled->words.size()));
+        compiled->words.append(line);
+        compiled->actions.append(action);
+    }
+    compiled->matcher.build(compiled->words);
+    compiled->buildMs = timer.elapsed();
+    return compiled;
+}
+
+ContentFilter::Result ContentFilter::check(QByteArrayView message)
+{
+    Result result;
+    if (!rules) {
+        return result;
+    }
+    TRACE_SCOPE("server.filterMessage");
+    ++counters.checked;
+
+    // 带转义的正文（例如 \uXXXX 形式的中文）先解码再匹配；大多数消息没有反斜杠，直接扫描原始字节
+    const bool escaped = message.contains('\\');
+    QByteArray decoded;
+    if (escaped) {
+        decoded = jsonUnescape(message).toUtf8();
+    }
+    const QByteArrayView text = escaped ? QByteArrayView(decoded) : message;
+    const QList<KeywordMatcher::Hit> hits = rules->matcher.findAll(text);
+    if (hits.isEmpty()) {
+        return result;
+    }
+
+    for (const KeywordMatcher::Hit &hit : hits) {
+        result.action = qMax(result.action, rules->actions.at(hit.pattern));
+        const QString word = QString::fromUtf8(rules->words.at(hit.pattern));
+        if (!result.matched.contains(word)) {
+            result.matched.append(word);
+        }
+    }
+    if (result.action == Block) {
+        ++counters.blocked;
+        return result;
+    }
+    if (result.action == Flag) {
+        ++counters.flagged;
+        return result;
+    }
+
+    // 只替换需要打码的关键词；命中区间可能重叠，按起点排序后合并，每个字符换成一个 *
+    ++counters.masked;
+    QList<QPair<qsizetype, qsizetype>> ranges;
+    for (const KeywordMatcher::Hit &hit : hits) {
+        if (rules->actions.at(hit.pattern) == Mask) {
+            ranges.append({hit.begin, hit.end});
+        }
+    }
+    std::sort(ranges.begin(), ranges.end());
+    QByteArray masked;
+    masked.reserve(text.size());
+    qsizetype pos = 0;
+    for (qsizetype i = 0; i < ranges.size();) {
+        const qsizetype begin = qMax(pos, ranges.at(i).first);
+        qsizetype end = ranges.at(i).second;
+        for (++i; i < ranges.size() && ranges.at(i).first < end; ++i) {
+            end = qMax(end, ranges.at(i).second);
+        }
+        masked.append(text.sliced(pos, begin - pos));
+        for (qsizetype j = begin; j < end; ++j) {
+            // UTF-8 的后续字节不单独算一个字符
+            if ((uchar(text[j]) & 0xC0) != 0x80) {
+                masked.append('*');
+            }
+        }
+        pos = end;
+    }
+    masked.append(text.sliced(pos));
+    result.message = escaped ? jsonEscape(QByteArrayView(masked)) : masked;
+    return result;
+}
+
+ContentFilter::Stats ContentFilter::stats() const
+{
+    Stats result = counters;
+    if (rules) {
+        result.patterns = rules->matcher.patternCount();
+        result.states = rules->matcher.stateCount();
+        result.memory = rules->matcher.memoryBytes();
+        result.buildMs = rules->buildMs;
+    }
+    return result;
+}
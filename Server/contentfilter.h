@@ -0,0 +1,87 @@
+#ifndef CONTENTFILTER_H
+#define CONTENTFILTER_H
+
+#include <QObject>
+#include <QByteArray>
+#include <QByteArrayView>
+#include <QStringList>
+
+#include "keywordmatcher.h"
+
+#include <memory>
+
+class QFileSystemWatcher;
+class QThread;
+class QTimer;
+
+// 聊天内容过滤。关键词文件为 UTF-8 文本，每行一个关键词（中文、英文、网址都可以），
+// 用 [block] / [mask] / [flag] 分段指定命中后的处理，# 开头的行是注释，没有分段标题的关键词按 [block] 处理。
+// 文件改动后在后台线程重新构建自动机，建好后整体替换；构建期间消息照常用旧规则过滤。
+class ContentFilter : public QObject
+{
+    Q_OBJECT
+public:
+    // 越往后越严格，一条消息命中多个关键词时取最严格的
+    enum Action {
+        Allow,
+        Flag,    // 照常发送，记录日志
+        Mask,    // 命中的部分替换成 *
+        Block    // 不发送
+    };
+
+    struct Result {
+        Action action = Allow;
+        QByteArray message;     // Mask 时为替换后的文本，仍是 JSON 转义形式
+        QStringList matched;    // 命中的关键词
+    };
+
+    struct Stats {
+        int patterns = 0;
+        int states = 0;
+        qint64 memory = 0;
+        qint64 buildMs = 0;
+        quint64 reloads = 0;
+        quint64 checked = 0;
+        quint64 blocked = 0;
+        quint64 masked = 0;
+        quint64 flagged = 0;
+    };
+
+    explicit ContentFilter(QObject *parent = nullptr);
+    ~ContentFilter();
+
+    // 同步加载并开始监视文件变化
+    bool load(const QString &path, QString *error);
+    // 在后台线程重新加载；已有构建在进行时，完成后再来一次
+    void reload();
+    bool isActive() const { return rules != nullptr; }
+
+    // message 是 JSON 转义形式的消息正文
+    Result check(QByteArrayView message);
+    Stats stats() const;
+
+signals:
+    void reloaded(int patterns, qint64 buildMs);
+    void reloadFailed(const QString &error);
+
+private:
+    struct Rules {
+        KeywordMatcher matcher;
+        QList<QByteArray> words;    // UTF-8
+        QList<Action> actions;
+        qint64 buildMs = 0;
+    };
+
+    static std::shared_ptr<const Rules> compile(const QString &path, QString *error);
+    void watch();
+
+    std::shared_ptr<const Rules> rules;
+    QString filePath;
+    QFileSystemWatcher *watcher;
+    QTimer *reloadTimer;
+    QThread *buildThread = nullptr;
+    bool reloadPending = false;
+    Stats counters;
+};
+
+#endif // CONTENTFILTER_H
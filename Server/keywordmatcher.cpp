@@ -0,0 +1,247 @@
+#include "keywordmatcher.h"
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+namespace {
+// 空槽放置失败这么多次后不再作为候选，免得在已经填满的区域里反复试探
+constexpr int kMaxSlotTrials = 16;
+
+struct FoldTable {
+    uchar map[256];
+    constexpr FoldTable() : map()
+    {
+        for (int c = 0; c < 256; ++c) {
+            map[c] = uchar(c >= 'A' && c <= 'Z' ? c + ('a' - 'A') : c);
+        }
+    }
+};
+constexpr FoldTable kFold;
+}
+
+QByteArray KeywordMatcher::foldCase(QByteArrayView text)
+{
+    QByteArray folded(text.size(), Qt::Uninitialized);
+    for (qsizetype i = 0; i < text.size(); ++i) {
+        folded[i] = char(kFold.map[uchar(text[i])]);
+    }
+    return folded;
+}
+
+inline qint32 KeywordMatcher::step(qint32 state, uchar c) const
+{
+    // 末尾留了 256 个槽，叶子状态的 base 为 0，下标不会越界
+    const Unit *data = units.constData();
+    const qint32 next = data[state].base + c;
+    return data[next].check == state ? next : -1;
+}
+
+inline qint32 KeywordMatcher::next(qint32 state, uchar c) const
+{
+    // 根的转移是完整的 256 项表，不用再走失败链
+    while (state != 0) {
+        const qint32 target = step(state, c);
+        if (target >= 0) {
+            return target;
+        }
+        state = units.constData()[state].fail;
+    }
+    return rootNext[c];
+}
+
+void KeywordMatcher::build(const QList<QByteArray> &patterns)
+{
+    // 先建普通的字典树，子节点按字节排序
+    struct Node {
+        std::vector<std::pair<uchar, int>> children;
+        int pattern = -1;
+    };
+    std::vector<Node> trie(1);
+    lengths.clear();
+    lengths.reserve(patterns.size());
+    for (int i = 0; i < patterns.size(); ++i) {
+        const QByteArray &pattern = patterns.at(i);
+        lengths.append(qint32(pattern.size()));
+        if (pattern.isEmpty()) {
+            continue;
+        }
+        int node = 0;
+        for (char ch : pattern) {
+            const uchar c = kFold.map[uchar(ch)];
+            auto &children = trie[node].children;
+            auto it = std::lower_bound(children.begin(), children.end(), c,
+                                       [](const std::pair<uchar, int> &child, uchar value) { return child.first < value; });
+            if (it != children.end() && it->first == c) {
+                node = it->second;
+                continue;
+            }
+            const int next = int(trie.size());
+            children.insert(it, {c, next});
+            trie.emplace_back();   // 之后 children 引用失效，不再使用
+            node = next;
+        }
+        if (trie[node].pattern < 0) {
+            trie[node].pattern = i;
+        }
+    }
+
+    // 按层放进双数组：为每个状态找一个 base，使它所有子节点落在空槽上。
+    // 空槽串成双向链表，找位置时跳过已经占用的区域
+    units = QList<Unit>(1);
+    units[0].check = 0;
+    std::vector<qint32> nextFree(1, -1);
+    std::vector<qint32> prevFree(1, -1);
+    std::vector<uchar> trials(1);
+    std::vector<bool> linked(1, false);
+    qint32 freeHead = -1;
+    qint32 freeTail = -1;
+    auto grow = [&](qint32 size) {
+        for (qint32 pos = qint32(units.size()); pos < size; ++pos) {
+            units.append(Unit());
+            nextFree.push_back(-1);
+            prevFree.push_back(freeTail);
+            trials.push_back(0);
+            linked.push_back(true);
+            if (freeTail >= 0) {
+                nextFree[freeTail] = pos;
+            } else {
+                freeHead = pos;
+            }
+            freeTail = pos;
+        }
+    };
+    auto unlink = [&](qint32 pos) {
+        if (!linked[pos]) {
+            return;
+        }
+        linked[pos] = false;
+        (prevFree[pos] >= 0 ? nextFree[prevFree[pos]] : freeHead) = nextFree[pos];
+        (nextFree[pos] >= 0 ? prevFree[nextFree[pos]] : freeTail) = prevFree[pos];
+    };
+
+    std::vector<qint32> slotOf(trie.size(), -1);
+    std::vector<int> order;
+    order.reserve(trie.size());
+    slotOf[0] = 0;
+    order.push_back(0);
+    qint32 maxBase = 0;
+    for (size_t head = 0; head < order.size(); ++head) {
+        const Node &node = trie[order[head]];
+        if (node.children.empty()) {
+            continue;
+        }
+        const uchar first = node.children.front().first;
+        const uchar last = node.children.back().first;
+        qint32 base = 0;
+        for (qint32 pos = freeHead;;) {
+            if (pos < 0) {
+                pos = qint32(units.size());
+                grow(pos + 256);
+            }
+            const qint32 next = nextFree[pos];
+            if (pos > first) {
+                base = pos - first;
+                if (base + last >= units.size()) {
+                    grow(base + last + 1);
+                }
+                const bool fits = std::all_of(node.children.begin() + 1, node.children.end(),
+                                              [&](const std::pair<uchar, int> &child) {
+                                                  return units.at(base + child.first).check < 0;
+                                              });
+                if (fits) {
+                    break;
+                }
+                if (++trials[pos] >= kMaxSlotTrials) {
+                    unlink(pos);
+                }
+            }
+            pos = next >= 0 ? next : nextFree[pos];
+        }
+        const qint32 parent = slotOf[order[head]];
+        units[parent].base = base;
+        maxBase = qMax(maxBase, base);
+        for (const auto &child : node.children) {
+            const qint32 slot = base + child.first;
+            units[slot].check = parent;
+            unlink(slot);
+            slotOf[child.second] = slot;
+            order.push_back(child.second);
+        }
+    }
+    qint32 used = 0;
+    for (qint32 pos = 0; pos < units.size(); ++pos) {
+        if (units.at(pos).check >= 0) {
+            used = pos + 1;
+        }
+    }
+    units.resize(qMax(used, maxBase) + 256 + 1);
+    units.squeeze();
+    states = int(trie.size());
+
+    // 按层计算失败链；父状态的失败目标更浅，已经算好
+    output = QList<qint32>(units.size(), -1);
+    for (int c = 0; c < 256; ++c) {
+        const qint32 next = step(0, uchar(c));
+        rootNext[c] = next >= 0 ? next : 0;
+    }
+    for (int id : order) {
+        const qint32 parent = slotOf[id];
+        for (const auto &child : trie[id].children) {
+            const qint32 slot = slotOf[child.second];
+            qint32 target = 0;
+            if (parent != 0) {
+                qint32 state = units.at(parent).fail;
+                while (state != 0 && step(state, child.first) < 0) {
+                    state = units.at(state).fail;
+                }
+                target = state != 0 ? step(state, child.first) : rootNext[child.first];
+            }
+            Unit &unit = units[slot];
+            unit.fail = target;
+            output[slot] = trie[child.second].pattern;
+            unit.report = output.at(slot) >= 0 ? slot : units.at(target).report;
+        }
+    }
+}
+
+QList<KeywordMatcher::Hit> KeywordMatcher::findAll(QByteArrayView text) const
+{
+    QList<Hit> hits;
+    if (units.isEmpty()) {
+        return hits;
+    }
+    const Unit *data = units.constData();
+    qint32 state = 0;
+    for (qsizetype i = 0; i < text.size(); ++i) {
+        state = next(state, kFold.map[uchar(text[i])]);
+        for (qint32 s = data[state].report; s >= 0; s = data[data[s].fail].report) {
+            const int pattern = output.at(s);
+            hits.append({i + 1 - lengths.at(pattern), i + 1, pattern});
+        }
+    }
+    return hits;
+}
+
+bool KeywordMatcher::contains(QByteArrayView text) const
+{
+    if (units.isEmpty()) {
+        return false;
+    }
+    const Unit *data = units.constData();
+    qint32 state = 0;
+    for (qsizetype i = 0; i < text.size(); ++i) {
+        state = next(state, kFold.map[uchar(text[i])]);
+        if (data[state].report >= 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+qint64 KeywordMatcher::memoryBytes() const
+{
+    return qint64(units.size()) * qint64(sizeof(Unit))
+         + qint64(output.size() + lengths.size()) * qint64(sizeof(qint32))
+         + qint64(sizeof(rootNext));
+}
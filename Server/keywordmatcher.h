@@ -0,0 +1,53 @@
+#ifndef KEYWORDMATCHER_H
+#define KEYWORDMATCHER_H
+
+#include <QByteArray>
+#include <QByteArrayView>
+#include <QList>
+
+// 多关键词匹配：按字节构建的 Aho–Corasick 自动机，转移表压成双数组，
+// 一个状态的 base / check / 失败链 / 输出链放在同一个 16 字节的单元里，扫描每个字节只碰一两条缓存行。
+// 一次扫描找出所有关键词，耗时只和文本长度有关，与关键词数量无关。
+// 按 UTF-8 字节匹配，中文和英文关键词不需要区分处理；ASCII 字母不区分大小写。
+// 构建好之后只读，可以在一个线程构建、另一个线程使用。
+class KeywordMatcher
+{
+public:
+    struct Hit {
+        qsizetype begin = 0;
+        qsizetype end = 0;   // 不含
+        int pattern = 0;     // 在 build 参数中的下标
+    };
+
+    // 空的关键词被忽略；折叠大小写后重复的关键词只保留第一个
+    void build(const QList<QByteArray> &patterns);
+
+    // 按结束位置顺序返回所有命中，同一位置结束的命中长的在前
+    QList<Hit> findAll(QByteArrayView text) const;
+    bool contains(QByteArrayView text) const;
+
+    int patternCount() const { return int(lengths.size()); }
+    int stateCount() const { return states; }
+    qint64 memoryBytes() const;
+
+    static QByteArray foldCase(QByteArrayView text);
+
+private:
+    struct Unit {
+        qint32 base = 0;
+        qint32 check = -1;   // 父状态，-1 表示空槽
+        qint32 fail = 0;
+        qint32 report = -1;  // 失败链上（含自身）第一个有关键词结束的状态，-1 表示没有
+    };
+
+    inline qint32 step(qint32 state, uchar c) const;
+    inline qint32 next(qint32 state, uchar c) const;
+
+    QList<Unit> units;       // 状态 0 是根
+    QList<qint32> output;    // 在该状态结束的关键词，-1 表示没有；只在命中时访问
+    QList<qint32> lengths;   // 关键词字节数
+    qint32 rootNext[256] = {};
+    int states = 0;
+};
+
+#endif // KEYWORDMATCHER_H
@@ -1,10 +1,40 @@
 #include "server.h"
+#include "sharedregistry.h"
+#include "workersupervisor.h"
+#include "trace.h"
 
 #include <QCoreApplication>
 #include <QCommandLineParser>
 #include <QCommandLineOption>
 #include <QHostAddress>
 #include <QTextStream>
+#include <QDir>
+#include <QFile>
+
+#ifdef Q_OS_UNIX
+#include <csignal>
+#endif
+
+// 与客户端相同的 config/api.conf 格式：SILICONFLOW_API_KEY=...
+static QString loadApiKey()
+{
+    const QString fromEnv = qEnvironmentVariable("SILICONFLOW_API_KEY");
+    if (!fromEnv.isEmpty()) {
+        return fromEnv;
+    }
+    QFile file(QDir(QCoreApplication::applicationDirPath()).filePath("config/api.conf"));
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        return QString();
+    }
+    QTextStream in(&file);
+    while (!in.atEnd()) {
+        const QString line = in.readLine().trimmed();
+        if (line.startsWith("SILICONFLOW_API_KEY=")) {
+            return line.mid(20).trimmed();
+        }
+    }
+    return QString();
+}
 
 int main(int argc, char *argv[])
 {
@@ -19,8 +49,42 @@ int main(int argc, char *argv[])
 
     QCommandLineOption portOption(QStringList() << "p" << "port", "Server port", "port", "12345");
     parser.addOption(portOption);
+    QCommandLineOption quotaOption("attachment-quota", "Attachment quota per account in MB", "mb", "200");
+    parser.addOption(quotaOption);
+    QCommandLineOption aiEndpointOption("ai-endpoint", "OpenAI-compatible chat completions URL", "url");
+    parser.addOption(aiEndpointOption);
+    QCommandLineOption aiModelOption("ai-model", "Model used by the AI gateway", "model");
+    parser.addOption(aiModelOption);
+    QCommandLineOption aiConcurrencyOption("ai-concurrency", "Max concurrent upstream AI calls", "n", "2");
+    parser.addOption(aiConcurrencyOption);
+    QCommandLineOption adminOption("admin-socket", "Local socket name for the admin console (empty to disable)",
+                                   "name", "ai-chatroom-admin");
+    parser.addOption(adminOption);
+    QCommandLineOption connMemoryOption("max-connection-mb", "Memory cap per connection in MB (0 = unlimited)", "mb", "64");
+    parser.addOption(connMemoryOption);
+    QCommandLineOption totalMemoryOption("max-memory-mb", "Total memory cap for connections and rooms in MB (0 = unlimited)", "mb", "0");
+    parser.addOption(totalMemoryOption);
+    QCommandLineOption captureOption("capture", "Record anonymized inbound traffic to a file for Tools/replay", "file");
+    parser.addOption(captureOption);
+    QCommandLineOption filterOption("filter-file", "Keyword filter rules ([block]/[mask]/[flag] sections), reloaded on change", "file");
+    parser.addOption(filterOption);
+    QCommandLineOption tlsCertOption("tls-cert", "PEM certificate (chain) to serve TLS with", "file");
+    parser.addOption(tlsCertOption);
+    QCommandLineOption tlsKeyOption("tls-key", "PEM private key for --tls-cert", "file");
+    parser.addOption(tlsKeyOption);
+    QCommandLineOption workersOption("workers", "Run N worker processes sharing the port via SO_REUSEPORT (Linux)", "n", "1");
+    parser.addOption(workersOption);
+    // 监督进程启动 worker 时内部使用
+    QCommandLineOption workerIndexOption("worker-index", "Index of this worker process", "i");
+    workerIndexOption.setFlags(QCommandLineOption::HiddenFromHelp);
+    parser.addOption(workerIndexOption);
     parser.process(a);
 
+#ifdef Q_OS_UNIX
+    // 附件用 sendfile 直接写 socket，对端提前断开时不能让 SIGPIPE 杀掉进程
+    std::signal(SIGPIPE, SIG_IGN);
+#endif
+
     bool ok = false;
     int port = parser.value(portOption).toInt(&ok);
     if (!ok || port <= 0 || port > 65535) {
@@ -28,8 +92,92 @@ int main(int argc, char *argv[])
         port = 12345;
     }
 
+    const int workers = parser.value(workersOption).toInt();
+    const bool isWorker = parser.isSet(workerIndexOption);
+    if (workers > 1 && !isWorker) {
+#ifdef Q_OS_LINUX
+        // 监督进程本身不处理连接，只负责拉起和重启 worker
+        QStringList workerArguments;
+        const QStringList args = QCoreApplication::arguments().mid(1);
+        for (int i = 0; i < args.size(); ++i) {
+            if (args.at(i) == "--workers") {
+                ++i;
+            } else if (!args.at(i).startsWith("--workers=")) {
+                workerArguments.append(args.at(i));
+            }
+        }
+        WorkerSupervisor supervisor(port, workers, workerArguments);
+        if (!supervisor.start()) {
+            return 1;
+        }
+        return a.exec();
+#else
+        QTextStream(stderr) << "--workers requires Linux (SO_REUSEPORT), running a single process.\n";
+#endif
+    }
+
     Server server;
+    QString adminSocket = parser.value(adminOption);
+    QString capturePath = parser.value(captureOption);
+    if (isWorker) {
+        const int index = parser.value(workerIndexOption).toInt();
+        auto *registry = new SharedRegistry(port, &a);
+        if (!registry->attach(index)) {
+            QTextStream(stderr) << "Worker " << index << " failed to attach shared registry: "
+                                << registry->errorString() << "\n";
+            return 1;
+        }
+        server.setRegistry(registry);
+        // 每个 worker 有自己的管理控制台
+        if (!adminSocket.isEmpty()) {
+            adminSocket += QString("-%1").arg(index);
+        }
+        if (!capturePath.isEmpty()) {
+            capturePath += QString(".%1").arg(index);
+        }
+    }
+    const qint64 quotaMb = parser.value(quotaOption).toLongLong(&ok);
+    if (ok && quotaMb > 0) {
+        server.setAttachmentQuota(quotaMb * 1024 * 1024);
+    }
+
+    AIGateway::Config aiConfig;
+    aiConfig.apiKey = loadApiKey();
+    if (parser.isSet(aiEndpointOption)) {
+        aiConfig.endpoint = QUrl(parser.value(aiEndpointOption));
+    }
+    if (parser.isSet(aiModelOption)) {
+        aiConfig.model = parser.value(aiModelOption);
+    }
+    aiConfig.maxConcurrent = qMax(1, parser.value(aiConcurrencyOption).toInt());
+    server.setAIConfig(aiConfig);
+    server.setMemoryLimits(parser.value(connMemoryOption).toLongLong() * 1024 * 1024,
+                           parser.value(totalMemoryOption).toLongLong() * 1024 * 1024);
+
+    // 设置 AICHAT_TRACE=1 开启追踪，kill -USR2 <pid> 导出到 traces/ 目录
+    Trace::installDumpSignal(QDir(QCoreApplication::applicationDirPath()).filePath("traces"));
+
+    if (!capturePath.isEmpty() && !server.setCapture(capturePath)) {
+        return 1;
+    }
+    if (parser.isSet(filterOption) && !server.setFilterFile(parser.value(filterOption))) {
+        return 1;
+    }
+
+    if (parser.isSet(tlsCertOption) || parser.isSet(tlsKeyOption)) {
+        if (!parser.isSet(tlsCertOption) || !parser.isSet(tlsKeyOption)) {
+            QTextStream(stderr) << "--tls-cert and --tls-key must be given together.\n";
+            return 1;
+        }
+        if (!server.setTlsCertificate(parser.value(tlsCertOption), parser.value(tlsKeyOption))) {
+            return 1;
+        }
+    }
+
     server.Connect(port);
+    if (!adminSocket.isEmpty()) {
+        server.startAdminConsole(adminSocket);
+    }
 
     QTextStream(stdout) << "AI-ChatRoom server listening on 0.0.0.0:" << port << "\n";
     return a.exec();
@@ -0,0 +1,103 @@
+#include "roomdirectory.h"
+
+#include <QSet>
+
+#include <algorithm>
+
+namespace {
+bool itemLess(const QString &leftKey, const QString &leftName, const QString &rightKey, const QString &rightName)
+{
+    const int order = leftKey.compare(rightKey);
+    return order != 0 ? order < 0 : leftName < rightName;
+}
+}
+
+qsizetype RoomDirectory::lowerBound(const QString &key, const QString &name) const
+{
+    auto it = std::lower_bound(items.cbegin(), items.cend(), 0, [&](const Item &item, int) {
+        return itemLess(item.key, item.name, key, name);
+    });
+    return it - items.cbegin();
+}
+
+qsizetype RoomDirectory::find(const QString &name) const
+{
+    const qsizetype pos = lowerBound(name.toCaseFolded(), name);
+    return pos < items.size() && items.at(pos).name == name ? pos : -1;
+}
+
+bool RoomDirectory::insert(const QString &name)
+{
+    const QString key = name.toCaseFolded();
+    const qsizetype pos = lowerBound(key, name);
+    if (pos < items.size() && items.at(pos).name == name) {
+        return false;
+    }
+    items.insert(pos, Item{key, name, 0});
+    return true;
+}
+
+bool RoomDirectory::remove(const QString &name)
+{
+    const qsizetype pos = find(name);
+    if (pos < 0) {
+        return false;
+    }
+    items.remove(pos);
+    return true;
+}
+
+void RoomDirectory::setMembers(const QString &name, int members)
+{
+    const qsizetype pos = find(name);
+    if (pos >= 0) {
+        items[pos].members = members;
+    }
+}
+
+void RoomDirectory::sync(const QStringList &names, QStringList *added, QStringList *removed)
+{
+    const QSet<QString> wanted(names.cbegin(), names.cend());
+    for (qsizetype i = items.size() - 1; i >= 0; --i) {
+        if (!wanted.contains(items.at(i).name)) {
+            removed->append(items.at(i).name);
+            items.remove(i);
+        }
+    }
+    for (const QString &name : names) {
+        if (insert(name)) {
+            added->append(name);
+        }
+    }
+}
+
+RoomDirectory::Page RoomDirectory::list(const QString &prefix, const QString &cursor, int limit) const
+{
+    Page page;
+    const QString folded = prefix.toCaseFolded();
+    // 同一前缀的房间在数组里连续，两次二分得到整个范围
+    const qsizetype first = lowerBound(folded, QString());
+    const auto end = std::partition_point(items.cbegin() + first, items.cend(), [&folded](const Item &item) {
+        return item.key.startsWith(folded);
+    });
+    const qsizetype last = end - items.cbegin();
+    page.total = int(last - first);
+
+    qsizetype pos = first;
+    if (!cursor.isEmpty()) {
+        // 游标所在的房间即使已被删除，也从它原来的位置之后继续
+        pos = qMax(first, lowerBound(cursor.toCaseFolded(), cursor));
+        if (pos < last && items.at(pos).name == cursor) {
+            ++pos;
+        }
+    }
+    const qsizetype stop = qMin(last, pos + qMax(0, limit));
+    page.rooms.reserve(stop - pos);
+    for (; pos < stop; ++pos) {
+        page.rooms.append(Entry{items.at(pos).name, items.at(pos).members});
+    }
+    if (stop < last && !page.rooms.isEmpty()) {
+        page.next = page.rooms.last().name;
+    }
+    return page;
+}
@@ -0,0 +1,48 @@
+#ifndef ROOMDIRECTORY_H
+#define ROOMDIRECTORY_H
+
+#include <QList>
+#include <QString>
+#include <QStringList>
+
+// 房间目录：按折叠大小写后的名称排好序的数组，同一前缀的房间是连续的一段，
+// 二分查找就能定位前缀范围。分页游标是上一页最后一个房间的名称，
+// 翻页期间有房间增删也不会重复或漏掉。创建、删除房间时按位置插入 / 删除，不重建。
+class RoomDirectory
+{
+public:
+    struct Entry {
+        QString name;
+        int members = 0;
+    };
+
+    struct Page {
+        QList<Entry> rooms;
+        QString next;   // 下一页的游标，没有更多时为空
+        int total = 0;  // 匹配前缀的房间总数
+    };
+
+    bool insert(const QString &name);
+    bool remove(const QString &name);
+    void setMembers(const QString &name, int members);
+    // 与完整的房间名单对齐，返回新增和删除的名称（多进程模式下其他 worker 改动了房间表）
+    void sync(const QStringList &names, QStringList *added, QStringList *removed);
+
+    Page list(const QString &prefix, const QString &cursor, int limit) const;
+    int size() const { return int(items.size()); }
+
+private:
+    struct Item {
+        QString key;   // 折叠大小写后的名称
+        QString name;
+        int members = 0;
+    };
+
+    // 第一个不小于 (key, name) 的位置
+    qsizetype lowerBound(const QString &key, const QString &name) const;
+    qsizetype find(const QString &name) const;
+
+    QList<Item> items;
+};
+
+#endif // ROOMDIRECTORY_H
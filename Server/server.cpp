@@ -5,31 +5,292 @@
 #include <QJsonArray>
 #include <QDateTime>
 #include <QTextStream>
+#include <QCoreApplication>
+#include <QDir>
+#include <QMessageAuthenticationCode>
+#include <QPointer>
+#include <QRandomGenerator>
+#include <QSslSocket>
+#include <QTimer>
+
+#include <algorithm>
+
+#ifdef Q_OS_LINUX
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+#include "blobsender.h"
+#include "trace.h"
+#include "chatframe.h"
+#include "chatcontext.h"
+
+namespace {
+// 每个房间最多缓存的未确认帧数，超过后最旧的帧直接丢弃
+constexpr int kMaxRetransmitFrames = 1024;
+// 每个房间记住的幂等键数量
+constexpr int kMaxRecentKeys = 1024;
+// 每个房间为 AI 保留的最近聊天行数
+constexpr int kMaxHistoryLines = 200;
+// 房间机器人的显示名，聊天以 "@ai" 开头时由它回答
+const QString kBotName = QStringLiteral("AI");
+// 内存估算：QHash/QSet/QList 每个元素的大致额外开销
+constexpr qint64 kNodeOverhead = 32;
+// 内存上限检查周期
+constexpr int kMemoryCheckIntervalMs = 1000;
+// 房间列表分页：默认每页条数和单页上限
+constexpr int kDefaultRoomPage = 100;
+constexpr int kMaxRoomPage = 500;
+// 下载凭证的有效期
+constexpr qint64 kDownloadGrantSecs = 300;
+
+qint64 stringBytes(const QString &str)
+{
+    return qint64(str.capacity()) * qint64(sizeof(QChar)) + 24;
+}
+
+// 房间历史按 token 预算截取最近的部分，作为 AI 上下文
+QString renderContext(const QList<QPair<quint64, QByteArray>> &history)
+{
+    ChatContext context;
+    for (const auto &entry : history) {
+        context.append(jsonUnescape(entry.second));
+    }
+    return context.render();
+}
+}
 
 Server::Server(QObject *parent)
     : QTcpServer{parent}
+    , blobs(QDir(QCoreApplication::applicationDirPath()).filePath("blobs"))
+    , aiGateway(new AIGateway(this))
+    , capture(new TrafficCapture(this))
+    , filter(new ContentFilter(this))
+    , tls(new TlsAcceptor(this))
+{
+    downloadSecret = QByteArray::fromHex(qgetenv("AICHAT_DOWNLOAD_SECRET"));
+    if (downloadSecret.isEmpty()) {
+        quint32 random[8];
+        QRandomGenerator::system()->fillRange(random);
+        downloadSecret = QByteArray(reinterpret_cast<const char *>(random), sizeof(random));
+    }
+    // 未设置时 TlsAcceptor 自己生成随机票据密钥
+    tls->setTicketSecret(QByteArray::fromHex(qgetenv("AICHAT_TICKET_SECRET")));
+    memoryTimer = new QTimer(this);
+    memoryTimer->setInterval(kMemoryCheckIntervalMs);
+    connect(memoryTimer, &QTimer::timeout, this, &Server::enforceMemoryLimits);
+}
+
+Server::~Server()
 {
+    if (adminThread) {
+        adminThread->quit();
+        adminThread->wait();
+    }
 }
 
 void Server::Connect(int port)
 {
-    if (!listen(QHostAddress::Any, port)) {
+    if (registry) {
+        if (!listenShared(port)) {
+            return;
+        }
+    } else if (!listen(QHostAddress::Any, port)) {
         QTextStream(stderr) << "Failed to start server: " << errorString() << "\n";
         return;
     }
     QTextStream(stdout) << "Server successfully bound to port " << port << "\n";
 }
 
-void Server::incomingConnection(qintptr handle)
+bool Server::listenShared(int port)
+{
+#ifdef Q_OS_LINUX
+    // QTcpServer 没法在 bind 之前设置 SO_REUSEPORT，自己建好监听 socket 再交给它；
+    // 所有 worker 绑定同一端口，由内核在它们之间分配新连接
+    int fd = ::socket(AF_INET6, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    const bool ipv6 = fd >= 0;
+    if (!ipv6) {
+        fd = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    }
+    const int on = 1;
+    const int off = 0;
+    bool ok = fd >= 0
+              && ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on)) == 0
+              && ::setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &on, sizeof(on)) == 0;
+    if (ok && ipv6) {
+        // 与 QHostAddress::Any 一样同时接受 IPv4
+        ::setsockopt(fd, IPPROTO_IPV6, IPV6_V6ONLY, &off, sizeof(off));
+        sockaddr_in6 addr = {};
+        addr.sin6_family = AF_INET6;
+        addr.sin6_addr = in6addr_any;
+        addr.sin6_port = htons(quint16(port));
+        ok = ::bind(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) == 0;
+    } else if (ok) {
+        sockaddr_in addr = {};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_ANY);
+        addr.sin_port = htons(quint16(port));
+        ok = ::bind(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) == 0;
+    }
+    ok = ok && ::listen(fd, SOMAXCONN) == 0;
+    const int error = errno;
+    if (!ok || !setSocketDescriptor(fd)) {
+        QTextStream(stderr) << "Failed to start server: " << (ok ? errorString() : qt_error_string(error)) << "\n";
+        if (fd >= 0) {
+            ::close(fd);
+        }
+        return false;
+    }
+    return true;
+#else
+    QTextStream(stderr) << "Shared listening (SO_REUSEPORT) requires Linux\n";
+    Q_UNUSED(port);
+    return false;
+#endif
+}
+
+bool Server::setCapture(const QString &path)
+{
+    if (path.isEmpty()) {
+        if (capture->isActive()) {
+            capture->stop();
+            emit logMessage(QString("Capture stopped, %1 events written to %2")
+                                .arg(capture->eventCount()).arg(capture->path()));
+        }
+        return true;
+    }
+    if (!capture->start(path)) {
+        QTextStream(stderr) << "Failed to open capture file " << path << "\n";
+        return false;
+    }
+    // 已经在线的连接补一条连接事件，回放时才能为它们建立连接
+    for (auto it = clients.cbegin(); it != clients.cend(); ++it) {
+        capture->connectionOpened(it->id);
+    }
+    emit logMessage("Capturing inbound traffic to " + path);
+    return true;
+}
+
+bool Server::setFilterFile(const QString &path)
+{
+    QString error;
+    if (!filter->load(path, &error)) {
+        QTextStream(stderr) << "Failed to load filter rules: " << error << "\n";
+        return false;
+    }
+    connect(filter, &ContentFilter::reloaded, this, [this](int patterns, qint64 buildMs) {
+        emit logMessage(QString("Filter rules reloaded, %1 patterns built in %2 ms").arg(patterns).arg(buildMs));
+    }, Qt::UniqueConnection);
+    connect(filter, &ContentFilter::reloadFailed, this, [this](const QString &message) {
+        emit logMessage("Filter reload failed, keeping previous rules: " + message);
+    }, Qt::UniqueConnection);
+    const ContentFilter::Stats stats = filter->stats();
+    emit logMessage(QString("Filter rules loaded from %1, %2 patterns").arg(path).arg(stats.patterns));
+    return true;
+}
+
+bool Server::setTlsCertificate(const QString &certificatePath, const QString &keyPath)
+{
+    if (!QSslSocket::supportsSsl()) {
+        QTextStream(stderr) << "TLS is not available: " << QSslSocket::sslLibraryVersionString() << "\n";
+        return false;
+    }
+    QString error;
+    if (!tls->load(certificatePath, keyPath, &error)) {
+        QTextStream(stderr) << "Failed to load TLS certificate: " << error << "\n";
+        return false;
+    }
+    if (TlsTicket::pskCiphers().isEmpty()) {
+        emit logMessage("TLS backend has no PSK cipher suites, reconnects will use full handshakes");
+    }
+    emit logMessage("TLS enabled with certificate " + certificatePath);
+    return true;
+}
+
+void Server::setRegistry(SharedRegistry *sharedRegistry)
+{
+    registry = sharedRegistry;
+    connect(registry, &SharedRegistry::readyRead, this, &Server::drainRegistry);
+    connect(registry, &SharedRegistry::roomsChanged, this, &Server::broadcastRoomChanges);
+    // 其他 worker 已经创建的房间直接写入目录，不需要通知
+    QStringList added;
+    QStringList removed;
+    directory.sync(registry->roomNames(), &added, &removed);
+    connect(registry, &SharedRegistry::recordsLost, this, [this](quint64 bytes) {
+        emit logMessage(QString("Shared broadcast ring overrun, %1 bytes lost").arg(bytes));
+    });
+}
+
+void Server::setAttachmentQuota(qint64 bytesPerAccount)
+{
+    blobs.setQuota(bytesPerAccount);
+}
+
+void Server::setAIConfig(const AIGateway::Config &config)
+{
+    aiGateway->setConfig(config);
+}
+
+void Server::setMemoryLimits(qint64 perConnection, qint64 total)
+{
+    connectionMemoryLimit = perConnection;
+    totalMemoryLimit = total;
+    if (connectionMemoryLimit > 0 || totalMemoryLimit > 0) {
+        memoryTimer->start();
+    } else {
+        memoryTimer->stop();
+    }
+}
+
+void Server::startAdminConsole(const QString &socketName)
 {
-    auto *client = new QTcpSocket(this);
-    if (!client->setSocketDescriptor(handle)) {
-        client->deleteLater();
+    if (adminThread) {
         return;
     }
+    adminThread = new QThread(this);
+    adminConsole = new AdminConsole(socketName);
+    adminConsole->moveToThread(adminThread);
+    connect(adminThread, &QThread::started, adminConsole, &AdminConsole::start);
+    connect(adminThread, &QThread::finished, adminConsole, &QObject::deleteLater);
+    connect(adminConsole, &AdminConsole::kickRequested, this, &Server::kickConnection);
+    connect(adminConsole, &AdminConsole::closeRoomRequested, this, &Server::closeRoom);
+    connect(adminConsole, &AdminConsole::captureRequested, this, &Server::setCapture);
+    connect(adminConsole, &AdminConsole::filterReloadRequested, filter, &ContentFilter::reload);
+
+    // 每秒发布一次快照，控制台线程只读快照
+    snapshotTimer = new QTimer(this);
+    snapshotTimer->setInterval(1000);
+    connect(snapshotTimer, &QTimer::timeout, this, &Server::publishSnapshot);
+    snapshotTimer->start();
+    publishSnapshot();
+
+    adminThread->start();
+}
+
+void Server::incomingConnection(qintptr handle)
+{
+    QTcpSocket *client = nullptr;
+    if (tls->isActive()) {
+        // 握手完成前 readyRead 不会触发，下面的处理不需要区分是否加密
+        client = tls->accept(handle, this);
+        if (!client) {
+            return;
+        }
+    } else {
+        client = new QTcpSocket(this);
+        if (!client->setSocketDescriptor(handle)) {
+            client->deleteLater();
+            return;
+        }
+    }
 
-    clients.insert(client, ClientInfo{});
-    buffers.insert(client, QByteArray{});
+    ClientInfo info;
+    info.id = nextConnectionId++;
+    clients.insert(client, info);
+    buffers.insert(client, FrameScanner{});
+    capture->connectionOpened(info.id);
 
     connect(client, &QTcpSocket::readyRead, this, [this, client]() {
         onReadyRead(client);
@@ -47,24 +308,62 @@ void Server::onReadyRead(QTcpSocket *client)
         return;
     }
 
-    QByteArray &buffer = buffers[client];
-    buffer.append(client->readAll());
-
-    while (true) {
-        int newlineIndex = buffer.indexOf('\n');
-        if (newlineIndex < 0) {
-            break;
-        }
+    TRACE_SCOPE("server.onReadyRead");
+    FrameScanner &buffer = buffers[client];
+    {
+        TRACE_SCOPE("server.frame");
+        buffer.append(client->readAll());
+    }
 
-        QByteArray line = buffer.left(newlineIndex);
-        buffer.remove(0, newlineIndex + 1);
+    // 一直等不到换行的超大帧会无限占用内存，超过单连接上限直接断开
+    if (connectionMemoryLimit > 0 && buffer.bufferedBytes() > connectionMemoryLimit && !buffer.hasFrame()) {
+        emit logMessage(QString("Connection %1 exceeded memory limit, disconnecting").arg(clients[client].id));
+        buffer.clear();
+        ++shedConnections;
+        QTimer::singleShot(0, client, [client]() { client->abort(); });
+        return;
+    }
 
+    QByteArray line;
+    bool valid = false;
+    while (buffer.next(&line, &valid)) {
         if (line.trimmed().isEmpty()) {
             continue;
         }
+        if (capture->isActive()) {
+            capture->frame(clients[client].id, line);
+        }
+        // 编码错误在分帧时就已经查出，不必再交给 JSON 解析
+        if (!valid) {
+            QJsonObject fail;
+            fail["type"] = "system";
+            fail["message"] = "Invalid message format.";
+            sendJson(client, fail);
+            continue;
+        }
+
+        // 快速路径：已登录用户的 chat 帧只取路由字段，消息体原样转发
+        if (clients[client].loggedIn) {
+            RawChatFrame frame;
+            bool scanned;
+            {
+                TRACE_SCOPE("server.scanFrame");
+                scanned = scanChatFrame(line, &frame);
+            }
+            if (scanned && !frame.typeEscaped && frame.type == "chat" && !frame.message.isNull()) {
+                const QString room = (frame.roomEscaped ? jsonUnescape(frame.room) : QString::fromUtf8(frame.room)).trimmed();
+                const QString clientId = frame.clientIdEscaped ? jsonUnescape(frame.clientId) : QString::fromUtf8(frame.clientId);
+                handleChat(client, room, frame.message, clientId);
+                continue;
+            }
+        }
 
         QJsonParseError error{};
-        QJsonDocument doc = QJsonDocument::fromJson(line, &error);
+        QJsonDocument doc;
+        {
+            TRACE_SCOPE("server.jsonParse");
+            doc = QJsonDocument::fromJson(line, &error);
+        }
         if (error.error != QJsonParseError::NoError || !doc.isObject()) {
             QJsonObject fail;
             fail["type"] = "system";
@@ -93,7 +392,11 @@ void Server::onDisconnected(QTcpSocket *client)
             leaveMsg["message"] = info.name.isEmpty() ? "用户离开聊天室" : info.name + " 离开聊天室";
             broadcastToRoom(room, leaveMsg);
         }
+        for (const QString &uploadId : info.uploads) {
+            blobs.cancelUpload(uploadId);
+        }
         removeFromAllRooms(client);
+        capture->connectionClosed(info.id);
         clients.remove(client);
     }
 
@@ -104,6 +407,7 @@ void Server::onDisconnected(QTcpSocket *client)
 
 void Server::handleMessage(QTcpSocket *client, const QJsonObject &obj)
 {
+    TRACE_SCOPE("server.handleMessage");
     const QString type = obj.value("type").toString();
     if (type == "login") {
         const QString account = obj.value("account").toString().trimmed();
@@ -121,15 +425,39 @@ void Server::handleMessage(QTcpSocket *client, const QJsonObject &obj)
         ClientInfo &info = clients[client];
         info.account = account;
         info.name = name.isEmpty() ? account : name;
+        info.nameJson = jsonEscape(info.name);
         info.loggedIn = true;
 
         QJsonObject ok;
         ok["type"] = "login_ok";
         ok["message"] = "登录成功";
         ok["name"] = info.name;
+        ok["ai_gateway"] = aiGateway->isEnabled();
+        // 只带第一页房间，其余由客户端按需用 list_rooms 翻页
+        const QJsonObject page = roomPage(QString(), QString(), kDefaultRoomPage);
+        for (auto it = page.constBegin(); it != page.constEnd(); ++it) {
+            ok.insert(it.key(), it.value());
+        }
         sendJson(client, ok);
+        // 加密连接换发一张重连票据，客户端断线重连时用它跳过证书握手
+        auto *secure = qobject_cast<QSslSocket*>(client);
+        if (secure && secure->isEncrypted()) {
+            sendJson(client, tls->issueTicket().toJson(tls->ticketLifetimeSecs()));
+        }
+        return;
+    }
 
-        sendRoomList(client);
+    if (type == "download") {
+        // 下载走单独的连接，按内容哈希取文件；等本轮读取处理完再接管 socket
+        const QString hash = obj.value("hash").toString().toLower();
+        const QString token = obj.value("token").toString();
+        const qint64 expires = obj.value("expires").toInteger();
+        QPointer<QTcpSocket> guard(client);
+        QTimer::singleShot(0, this, [this, guard, hash, token, expires]() {
+            if (guard) {
+                startDownload(guard, hash, token, expires);
+            }
+        });
         return;
     }
 
@@ -141,6 +469,15 @@ void Server::handleMessage(QTcpSocket *client, const QJsonObject &obj)
         return;
     }
 
+    if (type == "list_rooms") {
+        const int limit = obj.contains("limit") ? obj.value("limit").toInt() : kDefaultRoomPage;
+        QJsonObject page = roomPage(obj.value("prefix").toString().trimmed(), obj.value("cursor").toString(),
+                                    qBound(1, limit, kMaxRoomPage));
+        page["type"] = "room_list";
+        sendJson(client, page);
+        return;
+    }
+
     if (type == "create_room") {
         const QString room = obj.value("room").toString().trimmed();
         if (room.isEmpty()) {
@@ -151,18 +488,21 @@ void Server::handleMessage(QTcpSocket *client, const QJsonObject &obj)
             return;
         }
 
-        if (!rooms.contains(room)) {
-            rooms.insert(room, QSet<QTcpSocket*>{});
+        if (registry ? registry->createRoom(room) : !rooms.contains(room)) {
+            if (!registry) {
+                rooms.insert(room, QSet<QTcpSocket*>{});
+            }
+            roomCreated(room);
             QJsonObject ok;
             ok["type"] = "create_room_ok";
             ok["room"] = room;
             ok["message"] = "聊天室创建成功";
             sendJson(client, ok);
-            broadcastRoomList();
+            broadcastRoomChanges();
         } else {
             QJsonObject fail;
             fail["type"] = "create_room_fail";
-            fail["message"] = "聊天室已存在";
+            fail["message"] = roomExists(room) ? "聊天室已存在" : "聊天室数量已达上限或名称过长";
             sendJson(client, fail);
         }
         return;
@@ -170,9 +510,10 @@ void Server::handleMessage(QTcpSocket *client, const QJsonObject &obj)
 
     if (type == "join_room") {
         const QString room = obj.value("room").toString().trimmed();
-        if (room.isEmpty() || !rooms.contains(room)) {
+        if (room.isEmpty() || !roomExists(room)) {
             QJsonObject fail;
             fail["type"] = "join_room_fail";
+            fail["room"] = room;
             fail["message"] = "聊天室不存在";
             sendJson(client, fail);
             return;
@@ -188,15 +529,44 @@ void Server::handleMessage(QTcpSocket *client, const QJsonObject &obj)
             return;
         }
 
+        // 多进程模式：本进程的第一个成员，在注册表登记并从当前序号开始
+        if (registry && !rooms.contains(room)) {
+            if (!registry->join(room)) {
+                QJsonObject fail;
+                fail["type"] = "join_room_fail";
+                fail["room"] = room;
+                fail["message"] = "聊天室不存在";
+                sendJson(client, fail);
+                return;
+            }
+            RoomLog &log = roomLogs[room];
+            log.nextSeq = registry->lastSeq(room) + 1;
+            log.baseSeq = log.nextSeq;
+        }
+
         // 加入新房间（不离开其他房间）
         rooms[room].insert(client);
         clients[client].rooms.insert(room);
+        updateMembers(room);
+        // 新成员从当前序号开始接收，之前的帧不需要它确认
+        RoomLog &log = roomLogs[room];
+        if (log.epoch == 0) {
+            log.epoch = QDateTime::currentMSecsSinceEpoch();
+        }
+        const quint64 lastSeq = log.nextSeq - 1;
+        clients[client].acked.insert(room, lastSeq);
 
         QJsonObject ok;
         ok["type"] = "join_room_ok";
         ok["room"] = room;
         ok["message"] = "加入聊天室成功";
+        ok["seq"] = qint64(lastSeq);
+        ok["epoch"] = log.epoch;
         sendJson(client, ok);
+        // 客户端带着本地缓存的位置加入时，紧接着补发缺的部分，保证在之后的新消息之前到达
+        if (obj.contains("since")) {
+            sendRecentFrames(client, room, obj.value("since").toObject());
+        }
 
         QJsonObject sys;
         sys["type"] = "system";
@@ -208,25 +578,36 @@ void Server::handleMessage(QTcpSocket *client, const QJsonObject &obj)
 
     if (type == "chat") {
         const QString room = obj.value("room").toString().trimmed();
-        const QString message = obj.value("message").toString();
-        ClientInfo &info = clients[client];
-        
-        // 检查用户是否在指定的房间
-        if (room.isEmpty() || !info.rooms.contains(room)) {
-            QJsonObject fail;
-            fail["type"] = "system";
-            fail["message"] = "你不在该聊天室中";
-            sendJson(client, fail);
-            return;
-        }
+        handleChat(client, room, jsonEscape(obj.value("message").toString()),
+                   obj.value("client_id").toString());
+        return;
+    }
 
-        QJsonObject chat;
-        chat["type"] = "chat";
-        chat["room"] = room;
-        chat["from"] = info.name;
-        chat["message"] = message;
-        chat["time"] = QDateTime::currentDateTime().toString("HH:mm:ss");
-        broadcastToRoom(room, chat);
+    if (type == "ai_request") {
+        handleAIRequest(client, obj);
+        return;
+    }
+
+    if (type == "download_grant") {
+        grantDownload(client, obj.value("room").toString().trimmed(), obj.value("hash").toString().toLower());
+        return;
+    }
+
+    if (type == "upload_begin" || type == "upload_chunk" || type == "upload_cancel" || type == "upload_proof") {
+        handleUpload(client, type, obj);
+        return;
+    }
+
+    if (type == "ack") {
+        const QString room = obj.value("room").toString().trimmed();
+        handleAck(client, room, quint64(obj.value("seq").toInteger()));
+        return;
+    }
+
+    if (type == "resend") {
+        const QString room = obj.value("room").toString().trimmed();
+        handleResend(client, room, quint64(obj.value("from").toInteger()),
+                     quint64(obj.value("to").toInteger()));
         return;
     }
 
@@ -241,7 +622,9 @@ void Server::handleMessage(QTcpSocket *client, const QJsonObject &obj)
         // Remove client from room
         if (info.rooms.contains(room)) {
             info.rooms.remove(room);
+            info.acked.remove(room);
             rooms[room].remove(client);
+            updateMembers(room);
             
             // Broadcast leave message to remaining members
             QJsonObject sys;
@@ -252,8 +635,11 @@ void Server::handleMessage(QTcpSocket *client, const QJsonObject &obj)
             
             // Remove empty room
             if (rooms[room].isEmpty()) {
-                rooms.remove(room);
-                broadcastRoomList();
+                if (releaseRoom(room)) {
+                    broadcastRoomChanges();
+                }
+            } else {
+                trimRoomLog(room);
             }
         }
         return;
@@ -265,41 +651,924 @@ void Server::sendJson(QTcpSocket *client, const QJsonObject &obj)
     if (!client) {
         return;
     }
+    TRACE_SCOPE("server.sendJson");
     QJsonDocument doc(obj);
     QByteArray line = doc.toJson(QJsonDocument::Compact);
     line.append('\n');
     client->write(line);
 }
 
-void Server::sendRoomList(QTcpSocket *client)
+void Server::broadcastFrame(const QString &room, const QByteArray &line)
+{
+    if (!rooms.contains(room)) {
+        return;
+    }
+    TRACE_SCOPE("server.broadcastWrite");
+    for (QTcpSocket *client : rooms[room]) {
+        client->write(line);
+    }
+}
+
+quint64 Server::publishFrame(const QString &room, const QByteArray &history,
+                             const std::function<QByteArray(quint64)> &build)
+{
+    if (registry) {
+        const quint64 seq = registry->publishFrame(room, history, build);
+        // 自己写的帧也从广播环读回来，和其他 worker 的帧按同一顺序投递
+        drainRegistry();
+        return seq;
+    }
+    const quint64 seq = roomLogs[room].nextSeq;
+    deliverFrame(room, seq, build(seq), history);
+    return seq;
+}
+
+quint64 Server::publishJson(const QString &room, QJsonObject obj, const QByteArray &history)
+{
+    return publishFrame(room, history, [&obj](quint64 seq) {
+        TRACE_SCOPE("server.serializeFrame");
+        obj["seq"] = qint64(seq);
+        QByteArray line = QJsonDocument(obj).toJson(QJsonDocument::Compact);
+        line.append('\n');
+        return line;
+    });
+}
+
+void Server::deliverFrame(const QString &room, quint64 seq, const QByteArray &line, const QByteArray &history)
+{
+    // 多进程模式下本进程不一定有该房间的成员
+    if (!rooms.contains(room)) {
+        return;
+    }
+    RoomLog &log = roomLogs[room];
+    if (seq < log.nextSeq) {
+        // 本进程的成员加入之前就已发出的帧
+        return;
+    }
+    if (seq > log.nextSeq) {
+        // 广播环溢出丢了帧，这些序号无法补发，之后的补发请求会收到 resend_gap
+        log.frames.clear();
+        log.frameBytes = 0;
+        log.baseSeq = seq;
+    }
+    log.nextSeq = seq + 1;
+    pushFrame(room, line);
+    broadcastFrame(room, line);
+    recordHistory(room, seq, line, history);
+}
+
+void Server::drainRegistry()
+{
+    TRACE_SCOPE("server.drainRegistry");
+    SharedRegistry::Record record;
+    while (registry->read(&record)) {
+        switch (record.kind) {
+        case SharedRegistry::FrameRecord:
+            deliverFrame(record.room, record.seq, record.payload, record.history);
+            break;
+        case SharedRegistry::RoomMessageRecord:
+            broadcastFrame(record.room, record.payload);
+            break;
+        case SharedRegistry::CloseRoomRecord:
+            dropRoom(record.room);
+            break;
+        }
+    }
+}
+
+void Server::pushFrame(const QString &room, const QByteArray &line)
+{
+    RoomLog &log = roomLogs[room];
+    log.frames.append(line);
+    log.frameBytes += line.size();
+    ++log.messageCount;
+    while (log.frames.size() > kMaxRetransmitFrames) {
+        log.frameBytes -= log.frames.first().size();
+        log.frames.removeFirst();
+        ++log.baseSeq;
+    }
+}
+
+void Server::handleChat(QTcpSocket *client, const QString &room, QByteArrayView message, const QString &clientId)
 {
+    ClientInfo &info = clients[client];
+
+    // 检查用户是否在指定的房间
+    if (room.isEmpty() || !info.rooms.contains(room)) {
+        QJsonObject fail;
+        fail["type"] = "system";
+        fail["message"] = "你不在该聊天室中";
+        sendJson(client, fail);
+        return;
+    }
+
+    // 客户端生成的幂等键：重试时相同，服务器据此丢弃重复消息
+    const QString dedupKey = info.account + '\n' + clientId;
+    const RoomLog &log = roomLogs[room];
+    if (!clientId.isEmpty() && log.recentKeys.contains(dedupKey)) {
+        QJsonObject ack;
+        ack["type"] = "chat_ack";
+        ack["room"] = room;
+        ack["client_id"] = clientId;
+        ack["seq"] = qint64(log.recentKeys.value(dedupKey));
+        sendJson(client, ack);
+        return;
+    }
+
+    // 关键词过滤：拦截的消息不广播、不占序号，打码的消息广播替换后的文本
+    QByteArray maskedMessage;
+    if (filter->isActive()) {
+        const ContentFilter::Result verdict = filter->check(message);
+        if (verdict.action == ContentFilter::Block) {
+            QJsonObject reject;
+            reject["type"] = "chat_rejected";
+            reject["room"] = room;
+            reject["client_id"] = clientId;
+            reject["message"] = "消息包含违禁内容，未发送";
+            sendJson(client, reject);
+            return;
+        }
+        if (verdict.action == ContentFilter::Flag) {
+            emit logMessage(QString("Flagged message from %1 in %2: %3")
+                                .arg(info.account, room, verdict.matched.join(", ")));
+        } else if (verdict.action == ContentFilter::Mask) {
+            maskedMessage = verdict.message;
+            message = maskedMessage;
+        }
+    }
+
+    // 按 QJsonDocument 的输出格式（键按字母序）手工拼帧，message 直接拷贝原始转义字节
+    const QDateTime now = QDateTime::currentDateTime();
+    const QByteArray time = now.toString("HH:mm:ss").toLatin1();
+    const QByteArray roomJson = jsonEscape(room);
+    const QByteArray &nameJson = info.nameJson;
+    // 历史也保存转义形式，真正发给 AI 时才解码
+    const QByteArray history = "[" + time + "] " + nameJson + ": " + message.toByteArray();
+    const quint64 seq = publishFrame(room, history, [&](quint64 seq) {
+        TRACE_SCOPE("server.serializeFrame");
+        QByteArray line;
+        line.reserve(message.size() + nameJson.size() + roomJson.size() + clientId.size() + 128);
+        line.append('{');
+        if (!clientId.isEmpty()) {
+            line.append("\"client_id\":\"").append(jsonEscape(clientId)).append("\",");
+        }
+        line.append("\"from\":\"").append(nameJson)
+            .append("\",\"message\":\"").append(message)
+            .append("\",\"room\":\"").append(roomJson)
+            .append("\",\"seq\":").append(QByteArray::number(seq))
+            .append(",\"time\":\"").append(time)
+            .append("\",\"ts\":").append(QByteArray::number(now.toMSecsSinceEpoch()))
+            .append(",\"type\":\"chat\"}\n");
+        return line;
+    });
+
+    // 房间还在却没分到序号：帧超过了广播环单条记录的上限，没有发出去
+    if (seq == 0 && roomExists(room)) {
+        QJsonObject reject;
+        reject["type"] = "chat_rejected";
+        reject["room"] = room;
+        reject["client_id"] = clientId;
+        reject["message"] = "消息过长，未发送";
+        sendJson(client, reject);
+        return;
+    }
+
+    // 投递过程中房间可能已被关闭，重新查找
+    auto logIt = roomLogs.find(room);
+    if (seq == 0 || logIt == roomLogs.end()) {
+        return;
+    }
+    if (!clientId.isEmpty()) {
+        logIt->recentKeys.insert(dedupKey, seq);
+        logIt->keyOrder.append(dedupKey);
+        logIt->keyBytes += 2 * stringBytes(dedupKey) + kNodeOverhead;
+        if (logIt->keyOrder.size() > kMaxRecentKeys) {
+            const QString oldest = logIt->keyOrder.takeFirst();
+            logIt->keyBytes -= 2 * stringBytes(oldest) + kNodeOverhead;
+            logIt->recentKeys.remove(oldest);
+        }
+    }
+
+    // "@ai" 后面必须是空白或消息结尾，"@aiden" 之类的提及不触发机器人；
+    // 正文里的换行、制表符是转义形式，要解开后再判断
+    if (message.size() >= 3 && qstrnicmp(message.data(), "@ai", 3) == 0) {
+        const QString text = jsonUnescape(message);
+        if (text.size() == 3 || text.at(3).isSpace()) {
+            askRoomBot(room, text.mid(3).trimmed());
+        }
+    }
+}
+
+void Server::handleAck(QTcpSocket *client, const QString &room, quint64 seq)
+{
+    ClientInfo &info = clients[client];
+    if (!info.rooms.contains(room) || !roomLogs.contains(room)) {
+        return;
+    }
+    const quint64 lastSeq = roomLogs[room].nextSeq - 1;
+    quint64 &acked = info.acked[room];
+    acked = qMax(acked, qMin(seq, lastSeq));
+    trimRoomLog(room);
+}
+
+void Server::handleResend(QTcpSocket *client, const QString &room, quint64 from, quint64 to)
+{
+    if (!clients[client].rooms.contains(room) || !roomLogs.contains(room) || from > to) {
+        return;
+    }
+    const RoomLog &log = roomLogs[room];
+
+    // 已经移出窗口的帧无法补发，告诉客户端不要再等
+    if (from < log.baseSeq) {
+        QJsonObject gap;
+        gap["type"] = "resend_gap";
+        gap["room"] = room;
+        gap["from"] = qint64(from);
+        gap["to"] = qint64(qMin(to, log.baseSeq - 1));
+        sendJson(client, gap);
+        from = log.baseSeq;
+    }
+
+    const quint64 last = qMin(to, log.nextSeq - 1);
+    for (quint64 seq = from; seq <= last; ++seq) {
+        client->write(log.frames.at(int(seq - log.baseSeq)));
+    }
+}
+
+void Server::trimRoomLog(const QString &room)
+{
+    if (!rooms.contains(room) || !roomLogs.contains(room)) {
+        return;
+    }
+    RoomLog &log = roomLogs[room];
+
+    // 所有成员都确认过的帧可以释放
+    quint64 minAcked = log.nextSeq - 1;
+    for (QTcpSocket *member : rooms[room]) {
+        auto it = clients.constFind(member);
+        if (it != clients.cend()) {
+            minAcked = qMin(minAcked, it->acked.value(room));
+        }
+    }
+    while (!log.frames.isEmpty() && log.baseSeq <= minAcked) {
+        log.frameBytes -= log.frames.first().size();
+        log.frames.removeFirst();
+        ++log.baseSeq;
+    }
+}
+
+void Server::handleUpload(QTcpSocket *client, const QString &type, const QJsonObject &obj)
+{
+    ClientInfo &info = clients[client];
+
+    if (type == "upload_begin") {
+        const QString room = obj.value("room").toString().trimmed();
+        const QString name = obj.value("name").toString().trimmed();
+        const QString hash = obj.value("hash").toString().toLower();
+        const qint64 size = obj.value("size").toInteger();
+        if (room.isEmpty() || !info.rooms.contains(room)) {
+            sendUploadFail(client, obj, "你不在该聊天室中");
+            return;
+        }
+
+        QJsonObject reply;
+        reply["client_id"] = obj.value("client_id");
+
+        QString error;
+        // 相同内容已经在服务器上：不用再传，但要先答对挑战，证明确实持有这份文件
+        if (blobs.contains(hash) && blobs.sizeOf(hash) == size) {
+            BlobStore::Upload challenge;
+            const QString claimId = blobs.beginClaim(info.account, room, name, hash, size, &challenge, &error);
+            if (claimId.isEmpty()) {
+                sendUploadFail(client, obj, error);
+                return;
+            }
+            info.uploads.insert(claimId);
+            reply["type"] = "upload_challenge";
+            reply["upload_id"] = claimId;
+            reply["salt"] = QString::fromLatin1(challenge.salt.toBase64());
+            reply["offset"] = challenge.challengeOffset;
+            reply["length"] = challenge.challengeLength;
+            sendJson(client, reply);
+            return;
+        }
+
+        const QString uploadId = blobs.beginUpload(info.account, room, name, hash, size, &error);
+        if (uploadId.isEmpty()) {
+            sendUploadFail(client, obj, error);
+            return;
+        }
+        info.uploads.insert(uploadId);
+
+        reply["type"] = "upload_ready";
+        reply["upload_id"] = uploadId;
+        reply["chunk_size"] = BlobStore::kChunkSize;
+        sendJson(client, reply);
+        return;
+    }
+
+    const QString uploadId = obj.value("upload_id").toString();
+    if (!info.uploads.contains(uploadId)) {
+        sendUploadFail(client, obj, "上传不存在");
+        return;
+    }
+
+    if (type == "upload_cancel") {
+        info.uploads.remove(uploadId);
+        blobs.cancelUpload(uploadId);
+        return;
+    }
+
+    if (type == "upload_proof") {
+        info.uploads.remove(uploadId);
+        BlobStore::Upload done;
+        QString error;
+        if (!blobs.finishClaim(uploadId, obj.value("proof").toString(), &done, &error)) {
+            sendUploadFail(client, obj, error);
+            return;
+        }
+        QJsonObject reply;
+        reply["type"] = "upload_done";
+        reply["upload_id"] = uploadId;
+        reply["hash"] = done.hash;
+        sendJson(client, reply);
+        if (info.rooms.contains(done.room)) {
+            broadcastAttachment(done.room, info.name, done.name, done.hash, done.size);
+        }
+        return;
+    }
+
+    const qint64 offset = obj.value("offset").toInteger();
+    const QByteArray data = QByteArray::fromBase64(obj.value("data").toString().toLatin1());
+    QString error;
+    if (!blobs.writeChunk(uploadId, offset, data, &error)) {
+        info.uploads.remove(uploadId);
+        blobs.cancelUpload(uploadId);
+        sendUploadFail(client, obj, error);
+        return;
+    }
+
+    if (!blobs.isComplete(uploadId)) {
+        QJsonObject ack;
+        ack["type"] = "upload_ack";
+        ack["upload_id"] = uploadId;
+        ack["offset"] = offset + data.size();
+        sendJson(client, ack);
+        return;
+    }
+
+    info.uploads.remove(uploadId);
+    BlobStore::Upload done;
+    if (!blobs.finishUpload(uploadId, &done, &error)) {
+        sendUploadFail(client, obj, error);
+        return;
+    }
+
+    QJsonObject reply;
+    reply["type"] = "upload_done";
+    reply["upload_id"] = uploadId;
+    reply["hash"] = done.hash;
+    sendJson(client, reply);
+
+    if (info.rooms.contains(done.room)) {
+        broadcastAttachment(done.room, info.name, done.name, done.hash, done.size);
+    }
+}
+
+void Server::sendUploadFail(QTcpSocket *client, const QJsonObject &request, const QString &message)
+{
+    QJsonObject fail;
+    fail["type"] = "upload_fail";
+    fail["client_id"] = request.value("client_id");
+    fail["upload_id"] = request.value("upload_id");
+    fail["message"] = message;
+    sendJson(client, fail);
+}
+
+void Server::broadcastAttachment(const QString &room, const QString &from, const QString &name,
+                                 const QString &hash, qint64 size)
+{
+    // 房间里只广播一个很小的引用，内容由各客户端按需下载
+    const QDateTime now = QDateTime::currentDateTime();
+    QJsonObject ref;
+    ref["type"] = "attachment";
+    ref["room"] = room;
+    ref["from"] = from;
+    ref["name"] = name;
+    ref["hash"] = hash;
+    ref["size"] = size;
+    ref["time"] = now.toString("HH:mm:ss");
+    ref["ts"] = now.toMSecsSinceEpoch();
+    publishJson(room, ref, jsonEscape(QString("[%1] %2: [附件] %3").arg(ref.value("time").toString(), from, name)));
+}
+
+void Server::recordHistory(const QString &room, quint64 seq, const QByteArray &line, const QByteArray &escapedLine)
+{
+    RoomLog &log = roomLogs[room];
+    log.history.append(qMakePair(seq, escapedLine));
+    log.historyBytes += escapedLine.capacity() + kNodeOverhead;
+    while (log.history.size() > kMaxHistoryLines) {
+        log.historyBytes -= log.history.first().second.capacity() + kNodeOverhead;
+        log.history.removeFirst();
+    }
+
+    // 与重传窗口共享同一份帧数据，这里按独占估算
+    log.recent.append(RecentFrame{seq, QDateTime::currentMSecsSinceEpoch(), line});
+    log.historyBytes += line.capacity() + kNodeOverhead;
+    while (log.recent.size() > kMaxHistoryLines) {
+        log.historyBytes -= log.recent.first().line.capacity() + kNodeOverhead;
+        log.recent.removeFirst();
+    }
+}
+
+void Server::sendRecentFrames(QTcpSocket *client, const QString &room, const QJsonObject &since)
+{
+    const RoomLog &log = roomLogs[room];
+    // 同一个房间日志里按序号续传；房间重建过或换了 worker 时 epoch 不同，只能按时间
+    const bool bySeq = since.contains("seq") && since.value("epoch").toInteger() == log.epoch;
+    const quint64 afterSeq = quint64(since.value("seq").toInteger());
+    const qint64 afterTs = since.value("ts").toInteger();
+
+    auto it = std::find_if(log.recent.cbegin(), log.recent.cend(), [&](const RecentFrame &frame) {
+        return bySeq ? frame.seq > afterSeq : frame.ts > afterTs;
+    });
+    // 保留的最早一帧也晚于客户端的位置时，中间有消息已经拿不到了
+    bool complete = !bySeq || afterSeq + 1 >= log.nextSeq;
+    if (!log.recent.isEmpty()) {
+        const RecentFrame &oldest = log.recent.first();
+        complete = bySeq ? oldest.seq <= afterSeq + 1 : oldest.ts <= afterTs;
+    }
+
+    // 直接拼接已序列化的帧，不重新解析
+    QByteArray reply = "{\"complete\":" + QByteArray(complete ? "true" : "false") + ",\"frames\":[";
+    for (auto first = it; it != log.recent.cend(); ++it) {
+        if (it != first) {
+            reply.append(',');
+        }
+        reply.append(QByteArrayView(it->line).chopped(1));
+    }
+    reply.append("],\"room\":\"").append(jsonEscape(room)).append("\",\"type\":\"history\"}\n");
+    client->write(reply);
+}
+
+void Server::handleAIRequest(QTcpSocket *client, const QJsonObject &obj)
+{
+    const QString room = obj.value("room").toString().trimmed();
+    const QString kind = obj.value("kind").toString();
+    const QString question = obj.value("prompt").toString().trimmed();
+
+    QJsonObject reply;
+    reply["type"] = "ai_reply";
+    reply["room"] = room;
+    reply["client_id"] = obj.value("client_id");
+
+    const auto fail = [&](const QString &message) {
+        reply["ok"] = false;
+        reply["message"] = message;
+        sendJson(client, reply);
+    };
+
+    if (room.isEmpty() || !clients[client].rooms.contains(room)) {
+        fail("你不在该聊天室中");
+        return;
+    }
+
+    const QList<QPair<quint64, QByteArray>> history = roomLogs.value(room).history;
+    const QString prompt = ChatContext::buildPrompt(kind, renderContext(history), question);
+    if (prompt.isEmpty()) {
+        fail("暂无聊天内容");
+        return;
+    }
+
+    // 快照由历史首尾序号确定，同一快照上的同类请求会合并、命中缓存
+    const quint64 fromSeq = history.isEmpty() ? 0 : history.first().first;
+    const quint64 toSeq = history.isEmpty() ? 0 : history.last().first;
+    QPointer<QTcpSocket> guard(client);
+    aiGateway->request(room, fromSeq, toSeq, prompt, [this, guard, reply](bool ok, const QString &text, bool cached) mutable {
+        if (!guard || !clients.contains(guard)) {
+            return;
+        }
+        reply["ok"] = ok;
+        reply[ok ? "content" : "message"] = text;
+        reply["cached"] = cached;
+        sendJson(guard, reply);
+    });
+}
+
+void Server::askRoomBot(const QString &room, const QString &question)
+{
+    if (question.isEmpty() || !aiGateway->isEnabled()) {
+        return;
+    }
+
+    const QList<QPair<quint64, QByteArray>> history = roomLogs.value(room).history;
+    const QString prompt = "你是聊天室里的助手 " + kBotName + "。聊天上下文:\n" + renderContext(history)
+                           + "\n\n请回答最后一个 @ai 的问题: " + question;
+    const quint64 fromSeq = history.isEmpty() ? 0 : history.first().first;
+    const quint64 toSeq = history.isEmpty() ? 0 : history.last().first;
+
+    aiGateway->request(room, fromSeq, toSeq, prompt, [this, room](bool ok, const QString &text, bool) {
+        if (!rooms.contains(room)) {
+            return;
+        }
+        // 回答只广播一次，房间里所有人看到同一条
+        const QDateTime now = QDateTime::currentDateTime();
+        QJsonObject chat;
+        chat["type"] = "chat";
+        chat["room"] = room;
+        chat["from"] = kBotName;
+        chat["message"] = ok ? text : "抱歉，AI 暂时无法回答: " + text;
+        chat["time"] = now.toString("HH:mm:ss");
+        chat["ts"] = now.toMSecsSinceEpoch();
+        publishJson(room, chat, jsonEscape(QString("[%1] %2: %3").arg(chat.value("time").toString(), kBotName,
+                                                                     chat.value("message").toString())));
+    });
+}
+
+void Server::grantDownload(QTcpSocket *client, const QString &room, const QString &hash)
+{
+    QJsonObject reply;
+    reply["hash"] = hash;
+    if (!clients[client].rooms.contains(room) || !blobs.contains(hash)) {
+        reply["type"] = "download_fail";
+        reply["message"] = clients[client].rooms.contains(room) ? "附件不存在" : "你不在该聊天室中";
+        sendJson(client, reply);
+        return;
+    }
+    // 凭证只是对哈希和过期时间的签名，不需要保存，任何 worker 都能校验
+    const qint64 expires = QDateTime::currentSecsSinceEpoch() + kDownloadGrantSecs;
+    reply["type"] = "download_granted";
+    reply["token"] = downloadToken(hash, expires);
+    reply["expires"] = expires;
+    sendJson(client, reply);
+}
+
+QString Server::downloadToken(const QString &hash, qint64 expires) const
+{
+    const QByteArray message = hash.toLatin1() + ':' + QByteArray::number(expires);
+    return QString::fromLatin1(
+        QMessageAuthenticationCode::hash(message, downloadSecret, QCryptographicHash::Sha256).toHex());
+}
+
+void Server::startDownload(QTcpSocket *client, const QString &hash, const QString &token, qint64 expires)
+{
+    if (!clients.contains(client)) {
+        return;
+    }
+    const bool granted = expires >= QDateTime::currentSecsSinceEpoch() && token == downloadToken(hash, expires);
+    if (clients[client].loggedIn || !granted || !blobs.contains(hash)) {
+        QJsonObject fail;
+        fail["type"] = "download_fail";
+        fail["hash"] = hash;
+        fail["message"] = clients[client].loggedIn ? "请使用单独的连接下载附件"
+                        : !granted                 ? "下载凭证无效或已过期"
+                                                   : "附件不存在";
+        sendJson(client, fail);
+        if (!clients[client].loggedIn) {
+            client->disconnectFromHost();
+        }
+        return;
+    }
+
+    // 这条连接此后只用来传文件，脱离聊天逻辑
+    client->disconnect(this);
+    capture->connectionClosed(clients[client].id);
+    clients.remove(client);
+    buffers.remove(client);
+
+    const qint64 size = blobs.sizeOf(hash);
+    QJsonObject head;
+    head["type"] = "download_begin";
+    head["hash"] = hash;
+    head["size"] = size;
+    QByteArray line = QJsonDocument(head).toJson(QJsonDocument::Compact);
+    line.append('\n');
+
+    auto *sender = new BlobSender(client, blobs.pathFor(hash), size, line, this);
+    connect(sender, &BlobSender::finished, this, [this, hash](bool ok) {
+        emit logMessage(QString("Attachment %1 %2").arg(hash.left(12), ok ? "sent" : "aborted"));
+    });
+    sender->start();
+}
+
+void Server::publishSnapshot()
+{
+    if (!adminConsole) {
+        return;
+    }
+
+    auto snapshot = std::make_shared<AdminSnapshot>();
+    const QDateTime now = QDateTime::currentDateTime();
+    snapshot->takenAt = now;
+    const double seconds = lastSnapshotAt.isValid() ? qMax<qint64>(1, lastSnapshotAt.msecsTo(now)) / 1000.0 : 0.0;
+
+    QHash<QString, quint64> counts;
+    snapshot->rooms.reserve(rooms.size());
+    for (auto it = rooms.cbegin(); it != rooms.cend(); ++it) {
+        AdminSnapshot::Room room;
+        room.name = it.key();
+        room.members = it.value().size();
+        auto log = roomLogs.constFind(it.key());
+        if (log != roomLogs.cend()) {
+            room.messages = log->messageCount;
+            room.bufferedFrames = log->frames.size();
+            room.bufferedBytes = log->frameBytes;
+        }
+        if (seconds > 0) {
+            room.rate = double(room.messages - lastMessageCounts.value(room.name, room.messages)) / seconds;
+        }
+        room.memory = roomBytes(room.name);
+        snapshot->memory += room.memory;
+        counts.insert(room.name, room.messages);
+        snapshot->rooms.append(room);
+    }
+    lastMessageCounts = counts;
+    lastSnapshotAt = now;
+
+    snapshot->connections.reserve(clients.size());
+    for (auto it = clients.cbegin(); it != clients.cend(); ++it) {
+        QTcpSocket *socket = it.key();
+        AdminSnapshot::Connection conn;
+        conn.id = it->id;
+        conn.account = it->account;
+        conn.name = it->name;
+        conn.peer = QString("%1:%2").arg(socket->peerAddress().toString()).arg(socket->peerPort());
+        conn.inbound = buffers.value(socket).bufferedBytes();
+        conn.outbound = socket->bytesToWrite();
+        conn.rooms = it->rooms.size();
+        conn.memory = connectionBytes(socket);
+        snapshot->memory += conn.memory;
+        snapshot->connections.append(conn);
+    }
+    snapshot->memoryLimit = totalMemoryLimit;
+    snapshot->shedConnections = shedConnections;
+    snapshot->shedRooms = shedRooms;
+    if (capture->isActive()) {
+        snapshot->capturePath = capture->path();
+        snapshot->captureEvents = capture->eventCount();
+    }
+    if (filter->isActive()) {
+        const ContentFilter::Stats stats = filter->stats();
+        snapshot->filterPatterns = stats.patterns;
+        snapshot->filterMemory = stats.memory;
+        snapshot->filterChecked = stats.checked;
+        snapshot->filterBlocked = stats.blocked;
+        snapshot->filterMasked = stats.masked;
+        snapshot->filterFlagged = stats.flagged;
+    }
+    if (tls->isActive()) {
+        snapshot->tls = true;
+        snapshot->tlsStats = tls->stats();
+    }
+
+    adminConsole->publish(std::move(snapshot));
+}
+
+qint64 Server::connectionBytes(QTcpSocket *client) const
+{
+    auto info = clients.constFind(client);
+    if (info == clients.cend()) {
+        return 0;
+    }
+
+    qint64 bytes = qint64(sizeof(ClientInfo)) + kNodeOverhead;
+    auto buffer = buffers.constFind(client);
+    if (buffer != buffers.cend()) {
+        bytes += buffer->capacity();
+    }
+    // QTcpSocket 内部的读写缓冲
+    bytes += client->bytesToWrite() + client->bytesAvailable();
+
+    bytes += stringBytes(info->account) + stringBytes(info->name) + info->nameJson.capacity();
+    for (const QString &room : info->rooms) {
+        bytes += stringBytes(room) + kNodeOverhead;
+    }
+    bytes += qint64(info->acked.size()) * (kNodeOverhead + 32);
+    for (const QString &uploadId : info->uploads) {
+        bytes += stringBytes(uploadId) + kNodeOverhead;
+    }
+    return bytes;
+}
+
+qint64 Server::roomBytes(const QString &room) const
+{
+    qint64 bytes = stringBytes(room) + kNodeOverhead;
+    auto members = rooms.constFind(room);
+    if (members != rooms.cend()) {
+        bytes += qint64(members->size()) * (qint64(sizeof(void *)) + kNodeOverhead);
+    }
+    auto log = roomLogs.constFind(room);
+    if (log != roomLogs.cend()) {
+        bytes += qint64(sizeof(RoomLog));
+        bytes += log->frameBytes + qint64(log->frames.size()) * kNodeOverhead;
+        bytes += log->historyBytes + log->keyBytes;
+    }
+    return bytes;
+}
+
+void Server::enforceMemoryLimits()
+{
+    struct Consumer {
+        qint64 bytes;
+        QTcpSocket *client;   // 为空表示房间
+        QString room;
+    };
+
+    QList<Consumer> consumers;
+    qint64 total = 0;
+    for (auto it = clients.cbegin(); it != clients.cend(); ++it) {
+        const qint64 bytes = connectionBytes(it.key());
+        total += bytes;
+        // 慢消费者：写不出去的数据超过单连接上限
+        if (connectionMemoryLimit > 0 && bytes > connectionMemoryLimit) {
+            emit logMessage(QString("Connection %1 uses %2 bytes, disconnecting").arg(it->id).arg(bytes));
+            QTcpSocket *client = it.key();
+            QTimer::singleShot(0, client, [client]() { client->abort(); });
+            ++shedConnections;
+            total -= bytes;
+            continue;
+        }
+        consumers.append(Consumer{bytes, it.key(), QString()});
+    }
+    for (auto it = rooms.cbegin(); it != rooms.cend(); ++it) {
+        const qint64 bytes = roomBytes(it.key());
+        total += bytes;
+        consumers.append(Consumer{bytes, nullptr, it.key()});
+    }
+
+    if (totalMemoryLimit <= 0 || total <= totalMemoryLimit) {
+        return;
+    }
+
+    // 超过全局上限：从最大的开始释放，房间丢弃缓冲的历史，连接直接断开
+    std::sort(consumers.begin(), consumers.end(), [](const Consumer &a, const Consumer &b) {
+        return a.bytes > b.bytes;
+    });
+    for (const Consumer &consumer : consumers) {
+        if (total <= totalMemoryLimit) {
+            break;
+        }
+        if (consumer.client) {
+            emit logMessage(QString("Memory limit reached, shedding connection %1 (%2 bytes)")
+                                .arg(clients.value(consumer.client).id).arg(consumer.bytes));
+            QTcpSocket *client = consumer.client;
+            QTimer::singleShot(0, client, [client]() { client->abort(); });
+            ++shedConnections;
+            total -= consumer.bytes;
+        } else {
+            const qint64 before = roomBytes(consumer.room);
+            shedRoom(consumer.room);
+            total -= before - roomBytes(consumer.room);
+        }
+    }
+}
+
+void Server::shedRoom(const QString &room)
+{
+    auto log = roomLogs.find(room);
+    if (log == roomLogs.end()) {
+        return;
+    }
+    emit logMessage(QString("Memory limit reached, dropping buffered history of room %1").arg(room));
+    // 序号继续递增，之后请求补发的客户端会收到 resend_gap
+    log->baseSeq = log->nextSeq;
+    log->frames.clear();
+    log->frameBytes = 0;
+    log->history.clear();
+    log->recent.clear();
+    log->historyBytes = 0;
+    log->recentKeys.clear();
+    log->keyOrder.clear();
+    log->keyBytes = 0;
+    ++shedRooms;
+}
+
+void Server::kickConnection(quint64 id)
+{
+    for (auto it = clients.cbegin(); it != clients.cend(); ++it) {
+        if (it->id == id) {
+            emit logMessage(QString("Admin kicked connection %1").arg(id));
+            // 直接断开，不等发送缓冲写完；abort 会同步触发 disconnected 并修改 clients，之后不能再用 it
+            QTcpSocket *client = it.key();
+            client->abort();
+            return;
+        }
+    }
+}
+
+void Server::closeRoom(const QString &room)
+{
+    if (!roomExists(room)) {
+        return;
+    }
+    emit logMessage("Admin closed room " + room);
+    if (registry) {
+        // 先从房间表删除，再通知所有 worker 移出各自的成员
+        registry->removeRoom(room);
+        registry->publish(SharedRegistry::CloseRoomRecord, room, QByteArray());
+        drainRegistry();
+    } else {
+        dropRoom(room);
+    }
+    roomRemoved(room);
+    broadcastRoomChanges();
+}
+
+void Server::dropRoom(const QString &room)
+{
+    if (!rooms.contains(room)) {
+        return;
+    }
+
+    QJsonObject closed;
+    closed["type"] = "room_closed";
+    closed["room"] = room;
+    closed["message"] = "聊天室已被管理员关闭";
+
+    const QSet<QTcpSocket*> members = rooms.value(room);
+    for (QTcpSocket *member : members) {
+        sendJson(member, closed);
+        clients[member].rooms.remove(room);
+        clients[member].acked.remove(room);
+    }
+    rooms.remove(room);
+    roomLogs.remove(room);
+}
+
+QJsonObject Server::roomPage(const QString &prefix, const QString &cursor, int limit) const
+{
+    const RoomDirectory::Page page = directory.list(prefix, cursor, limit);
     QJsonArray roomArray;
-    for (auto it = rooms.constBegin(); it != rooms.constEnd(); ++it) {
-        roomArray.append(it.key());
+    for (const RoomDirectory::Entry &entry : page.rooms) {
+        QJsonObject room;
+        room["name"] = entry.name;
+        room["members"] = entry.members;
+        roomArray.append(room);
     }
-    QJsonObject list;
-    list["type"] = "room_list";
-    list["rooms"] = roomArray;
-    sendJson(client, list);
+    QJsonObject result;
+    result["prefix"] = prefix;
+    result["cursor"] = cursor;
+    result["rooms"] = roomArray;
+    result["next"] = page.next;
+    result["total"] = page.total;
+    return result;
 }
 
-void Server::broadcastRoomList()
+void Server::roomCreated(const QString &room)
 {
+    if (directory.insert(room) && !removedRooms.removeOne(room)) {
+        addedRooms.append(room);
+    }
+}
+
+void Server::roomRemoved(const QString &room)
+{
+    if (directory.remove(room) && !addedRooms.removeOne(room)) {
+        removedRooms.append(room);
+    }
+}
+
+void Server::updateMembers(const QString &room)
+{
+    directory.setMembers(room, int(rooms.value(room).size()));
+}
+
+void Server::broadcastRoomChanges()
+{
+    if (registry) {
+        // 其他 worker 创建或删除的房间
+        directory.sync(registry->roomNames(), &addedRooms, &removedRooms);
+    }
+    if (addedRooms.isEmpty() && removedRooms.isEmpty()) {
+        return;
+    }
+    QJsonObject update;
+    update["type"] = "room_update";
+    update["added"] = QJsonArray::fromStringList(addedRooms);
+    update["removed"] = QJsonArray::fromStringList(removedRooms);
+    addedRooms.clear();
+    removedRooms.clear();
+
+    // 所有连接收到的内容相同，只序列化一次
+    QByteArray line = QJsonDocument(update).toJson(QJsonDocument::Compact);
+    line.append('\n');
     for (auto it = clients.constBegin(); it != clients.constEnd(); ++it) {
         if (it.value().loggedIn) {
-            sendRoomList(it.key());
+            it.key()->write(line);
         }
     }
 }
 
 void Server::broadcastToRoom(const QString &room, const QJsonObject &obj)
 {
-    if (!rooms.contains(room)) {
+    QByteArray line = QJsonDocument(obj).toJson(QJsonDocument::Compact);
+    line.append('\n');
+    if (registry) {
+        registry->publish(SharedRegistry::RoomMessageRecord, room, line);
+        drainRegistry();
         return;
     }
-    for (QTcpSocket *client : rooms[room]) {
-        sendJson(client, obj);
-    }
+    broadcastFrame(room, line);
 }
 
 void Server::removeFromRoom(QTcpSocket *client, const QString &room)
@@ -310,9 +1579,14 @@ void Server::removeFromRoom(QTcpSocket *client, const QString &room)
     if (!room.isEmpty() && rooms.contains(room)) {
         rooms[room].remove(client);
         clients[client].rooms.remove(room);
+        clients[client].acked.remove(room);
+        updateMembers(room);
         if (rooms[room].isEmpty()) {
-            rooms.remove(room);
-            broadcastRoomList();
+            if (releaseRoom(room)) {
+                broadcastRoomChanges();
+            }
+        } else {
+            trimRoomLog(room);
         }
     }
 }
@@ -326,12 +1600,32 @@ void Server::removeFromAllRooms(QTcpSocket *client)
     for (const QString &room : qAsConst(info.rooms)) {
         if (rooms.contains(room)) {
             rooms[room].remove(client);
+            updateMembers(room);
             if (rooms[room].isEmpty()) {
-                rooms.remove(room);
+                releaseRoom(room);
+            } else {
+                trimRoomLog(room);
             }
         }
     }
     info.rooms.clear();
-    broadcastRoomList();
+    info.acked.clear();
+    broadcastRoomChanges();
 }
 
+bool Server::roomExists(const QString &room) const
+{
+    return registry ? registry->roomExists(room) : rooms.contains(room);
+}
+
+// 本进程的最后一个成员已经离开；返回房间是否因此被删除
+bool Server::releaseRoom(const QString &room)
+{
+    rooms.remove(room);
+    roomLogs.remove(room);
+    if (registry && !registry->leave(room)) {
+        return false;
+    }
+    roomRemoved(room);
+    return true;
+}
@@ -7,32 +7,156 @@
 #include <QHash>
 #include <QSet>
 #include <QJsonObject>
+#include <QThread>
+#include <QTimer>
+#include <QDateTime>
+
+#include "blobstore.h"
+#include "aigateway.h"
+#include "adminconsole.h"
+#include "contentfilter.h"
+#include "framescanner.h"
+#include "roomdirectory.h"
+#include "sharedregistry.h"
+#include "tlsacceptor.h"
+#include "trafficcapture.h"
+
+#include <functional>
 
 class Server : public QTcpServer
 {
     Q_OBJECT
 public:
     explicit Server(QObject *parent = nullptr);
+    ~Server();
     void Connect(int port);
+    void startAdminConsole(const QString &socketName);
+    // 单个连接与全服的内存上限（字节），0 表示不限制
+    void setMemoryLimits(qint64 perConnection, qint64 total);
+    void setAttachmentQuota(qint64 bytesPerAccount);
+    void setAIConfig(const AIGateway::Config &config);
+    // 多进程模式：房间表和房间广播经由共享注册表，监听时启用 SO_REUSEPORT
+    void setRegistry(SharedRegistry *sharedRegistry);
+    // 把匿名化的入站帧录制到文件，供 Tools/replay 回放；path 为空表示停止
+    bool setCapture(const QString &path);
+    // 加载关键词过滤规则，文件改动后自动重新加载
+    bool setFilterFile(const QString &path);
+    // 启用 TLS：新连接先握手，登录成功后下发重连票据
+    bool setTlsCertificate(const QString &certificatePath, const QString &keyPath);
 private:
     struct ClientInfo {
+        quint64 id = 0;       // 管理控制台中使用的连接编号
         QString account;
         QString name;
+        QByteArray nameJson;  // 已转义的昵称，拼接广播帧时直接使用
         QSet<QString> rooms;  // 用户可以加入多个房间
+        QHash<QString, quint64> acked;  // 每个房间已累计确认的序号
+        QSet<QString> uploads;          // 进行中的附件上传 id
         bool loggedIn = false;
     };
 
+    // 最近广播过的完整帧，供重新打开房间的客户端补齐本地缓存
+    struct RecentFrame {
+        quint64 seq = 0;
+        qint64 ts = 0;
+        QByteArray line;   // 含结尾换行
+    };
+
+    // 每个房间的消息序号与重传窗口
+    struct RoomLog {
+        quint64 nextSeq = 1;
+        quint64 baseSeq = 1;            // frames 第一帧的序号
+        QList<QByteArray> frames;       // 已广播、尚未被全部成员确认的帧
+        qint64 frameBytes = 0;
+        quint64 messageCount = 0;
+        QHash<QString, quint64> recentKeys;  // 幂等键 -> 序号，用于丢弃重试
+        QList<QString> keyOrder;
+        qint64 keyBytes = 0;
+        // 最近的聊天文本，供 AI 总结使用；每行带序号用来标识快照
+        QList<QPair<quint64, QByteArray>> history;  // JSON 转义形式
+        QList<RecentFrame> recent;
+        qint64 historyBytes = 0;   // history 与 recent 合计
+        // 房间日志的创建时间。房间释放后重建时序号从头开始，客户端据此判断能否按序号续传
+        qint64 epoch = 0;
+    };
+
     QHash<QTcpSocket*, ClientInfo> clients;
-    QHash<QTcpSocket*, QByteArray> buffers;
-    QHash<QString, QSet<QTcpSocket*>> rooms;
+    QHash<QTcpSocket*, FrameScanner> buffers;
+    QHash<QString, QSet<QTcpSocket*>> rooms;  // 多进程模式下只包含本进程有成员的房间
+    QHash<QString, RoomLog> roomLogs;
+    // 按名称排序的房间目录，供分页列表和前缀搜索；多进程模式下与共享房间表对齐，成员数只计本进程
+    RoomDirectory directory;
+    QStringList addedRooms;     // 尚未通知客户端的房间增删
+    QStringList removedRooms;
+    BlobStore blobs;
+    // 下载凭证的签名密钥；多进程模式下由监督进程生成，经环境变量传给所有 worker
+    QByteArray downloadSecret;
+    AIGateway *aiGateway;
+    quint64 nextConnectionId = 1;
+
+    AdminConsole *adminConsole = nullptr;
+    QThread *adminThread = nullptr;
+    QTimer *snapshotTimer = nullptr;
+    QHash<QString, quint64> lastMessageCounts;
+    QDateTime lastSnapshotAt;
+
+    qint64 connectionMemoryLimit = 0;
+    qint64 totalMemoryLimit = 0;
+    QTimer *memoryTimer;
+    quint64 shedConnections = 0;
+    quint64 shedRooms = 0;
+
+    SharedRegistry *registry = nullptr;
+    TrafficCapture *capture;
+    ContentFilter *filter;
+    TlsAcceptor *tls;
 
     void handleMessage(QTcpSocket *client, const QJsonObject &obj);
     void sendJson(QTcpSocket *client, const QJsonObject &obj);
-    void sendRoomList(QTcpSocket *client);
-    void broadcastRoomList();
+    QJsonObject roomPage(const QString &prefix, const QString &cursor, int limit) const;
+    void roomCreated(const QString &room);
+    void roomRemoved(const QString &room);
+    void updateMembers(const QString &room);
+    // 把积攒的房间增删作为一条 room_update 发给所有已登录的连接
+    void broadcastRoomChanges();
     void broadcastToRoom(const QString &room, const QJsonObject &obj);
+    void broadcastFrame(const QString &room, const QByteArray &line);
+    // 分配房间序号并广播；多进程模式下先写入共享广播环，再由各 worker 取出投递
+    quint64 publishFrame(const QString &room, const QByteArray &history,
+                         const std::function<QByteArray(quint64 seq)> &build);
+    quint64 publishJson(const QString &room, QJsonObject obj, const QByteArray &history);
+    void deliverFrame(const QString &room, quint64 seq, const QByteArray &line, const QByteArray &history);
+    void pushFrame(const QString &room, const QByteArray &line);
+    void handleChat(QTcpSocket *client, const QString &room, QByteArrayView message, const QString &clientId);
+    void handleAck(QTcpSocket *client, const QString &room, quint64 seq);
+    void handleResend(QTcpSocket *client, const QString &room, quint64 from, quint64 to);
+    void trimRoomLog(const QString &room);
+    void handleUpload(QTcpSocket *client, const QString &type, const QJsonObject &obj);
+    void sendUploadFail(QTcpSocket *client, const QJsonObject &request, const QString &message);
+    void broadcastAttachment(const QString &room, const QString &from, const QString &name,
+                             const QString &hash, qint64 size);
+    // 已登录的连接为房间里的附件申请下载凭证，下载连接凭它取文件
+    void grantDownload(QTcpSocket *client, const QString &room, const QString &hash);
+    QString downloadToken(const QString &hash, qint64 expires) const;
+    void startDownload(QTcpSocket *client, const QString &hash, const QString &token, qint64 expires);
+    void recordHistory(const QString &room, quint64 seq, const QByteArray &line, const QByteArray &escapedLine);
+    void sendRecentFrames(QTcpSocket *client, const QString &room, const QJsonObject &since);
+    void handleAIRequest(QTcpSocket *client, const QJsonObject &obj);
+    void askRoomBot(const QString &room, const QString &question);
+    void publishSnapshot();
+    void kickConnection(quint64 id);
+    void closeRoom(const QString &room);
+    void dropRoom(const QString &room);
+    qint64 connectionBytes(QTcpSocket *client) const;
+    qint64 roomBytes(const QString &room) const;
+    void enforceMemoryLimits();
+    void shedRoom(const QString &room);
     void removeFromRoom(QTcpSocket *client, const QString &room);
     void removeFromAllRooms(QTcpSocket *client);
+    bool roomExists(const QString &room) const;
+    bool releaseRoom(const QString &room);
+    void drainRegistry();
+    bool listenShared(int port);
 
 protected:
     void incomingConnection(qintptr handle) override;
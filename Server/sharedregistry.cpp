@@ -0,0 +1,499 @@
+#include "sharedregistry.h"
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QThread>
+#include <QTimer>
+#include <QUdpSocket>
+
+#include <atomic>
+#include <cstring>
+#include <new>
+
+#ifdef Q_OS_UNIX
+#include <csignal>
+#include <cerrno>
+#endif
+
+namespace {
+constexpr quint32 kMagic = 0x41435247;  // "ACRG"
+constexpr quint32 kVersion = 2;
+// 广播环大小；读得太慢的 worker 会丢掉被覆盖的记录
+constexpr quint64 kRingBytes = 4 * 1024 * 1024;
+// 兜底轮询：门铃是 UDP，丢了也能在这个间隔内补上
+constexpr int kPollIntervalMs = 50;
+// 等锁超过这个时间就检查持有者是否已经退出
+constexpr int kStaleLockMs = 200;
+
+// 记录头：总长度、类型、房间名长度、序号、历史行长度
+constexpr int kRecordHeaderBytes = 4 + 2 + 2 + 8 + 4;
+// 单条记录的上限，超过的帧不写入环
+constexpr quint64 kMaxRecordBytes = kRingBytes / 4;
+
+quint64 recordBytes(const QByteArray &room, const QByteArray &history, const QByteArray &payload)
+{
+    return quint64(kRecordHeaderBytes + room.size() + history.size() + payload.size());
+}
+}
+
+struct SharedRegistry::Layout {
+    struct Worker {
+        std::atomic<qint64> pid;
+        std::atomic<quint16> doorbellPort;
+    };
+    struct Room {
+        quint32 used;
+        quint32 nameBytes;
+        char name[kMaxRoomNameBytes];
+        quint8 present[kMaxWorkers];  // 该 worker 上是否有成员
+        quint64 nextSeq;
+    };
+
+    quint32 magic;
+    quint32 version;
+    quint32 workers;
+    std::atomic<qint64> lockOwner;      // 持锁进程的 pid，0 表示空闲
+    std::atomic<quint64> generation;    // 房间表每次增删加一
+    std::atomic<quint64> head;          // 环的写位置，只增不减，记录写完后才推进
+    std::atomic<quint64> reserved;      // 正在写入的记录的结束位置，开始复制前先推进
+    Worker workerSlots[kMaxWorkers];
+    Room rooms[kMaxRooms];
+    char ring[kRingBytes];
+};
+
+namespace {
+
+using Layout = SharedRegistry::Layout;
+
+bool processAlive(qint64 pid)
+{
+#ifdef Q_OS_UNIX
+    return ::kill(pid_t(pid), 0) == 0 || errno != ESRCH;
+#else
+    Q_UNUSED(pid);
+    return true;
+#endif
+}
+
+// 跨进程自旋锁。临界区都很短；持锁进程崩溃时由等待者接管
+class Locker
+{
+public:
+    explicit Locker(Layout *layout)
+        : owner(layout->lockOwner)
+    {
+        const qint64 self = QCoreApplication::applicationPid();
+        int spins = 0;
+        QElapsedTimer waited;
+        while (true) {
+            qint64 expected = 0;
+            if (owner.compare_exchange_weak(expected, self, std::memory_order_acquire)) {
+                return;
+            }
+            if (++spins < 100) {
+                continue;
+            }
+            if (!waited.isValid()) {
+                waited.start();
+            } else if (waited.elapsed() > kStaleLockMs && expected != 0 && !processAlive(expected)
+                       && owner.compare_exchange_strong(expected, self, std::memory_order_acquire)) {
+                return;
+            }
+            QThread::yieldCurrentThread();
+        }
+    }
+    ~Locker()
+    {
+        owner.store(0, std::memory_order_release);
+    }
+
+private:
+    std::atomic<qint64> &owner;
+};
+
+Layout::Room *findRoom(Layout *layout, const QByteArray &name)
+{
+    // 房间数量有限，线性查找即可
+    for (Layout::Room &room : layout->rooms) {
+        if (room.used && room.nameBytes == quint32(name.size())
+            && std::memcmp(room.name, name.constData(), size_t(name.size())) == 0) {
+            return &room;
+        }
+    }
+    return nullptr;
+}
+
+bool hasMembers(const Layout::Room &room)
+{
+    for (quint8 present : room.present) {
+        if (present) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void ringWrite(Layout *layout, quint64 pos, const char *data, quint64 size)
+{
+    const quint64 offset = pos % kRingBytes;
+    const quint64 first = qMin(size, kRingBytes - offset);
+    std::memcpy(layout->ring + offset, data, size_t(first));
+    std::memcpy(layout->ring, data + first, size_t(size - first));
+}
+
+void ringRead(const Layout *layout, quint64 pos, char *data, quint64 size)
+{
+    const quint64 offset = pos % kRingBytes;
+    const quint64 first = qMin(size, kRingBytes - offset);
+    std::memcpy(data, layout->ring + offset, size_t(first));
+    std::memcpy(data + first, layout->ring, size_t(size - first));
+}
+
+template <typename T>
+T takeValue(const char *&p)
+{
+    T value;
+    std::memcpy(&value, p, sizeof(T));
+    p += sizeof(T);
+    return value;
+}
+
+template <typename T>
+void putValue(QByteArray &out, T value)
+{
+    out.append(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+} // namespace
+
+SharedRegistry::SharedRegistry(int port, QObject *parent)
+    : QObject(parent)
+{
+    memory.setKey(QString("ai-chatroom-registry-%1").arg(port));
+}
+
+SharedRegistry::~SharedRegistry()
+{
+    if (layout && workerIndex >= 0) {
+        Locker locker(layout);
+        layout->workerSlots[workerIndex].doorbellPort.store(0);
+        layout->workerSlots[workerIndex].pid.store(0);
+    }
+    if (memory.isAttached()) {
+        memory.detach();
+    }
+}
+
+bool SharedRegistry::create(int workers)
+{
+    // 上次异常退出可能留下同名的共享内存，最后一个进程 detach 时会被销毁
+    if (memory.attach()) {
+        memory.detach();
+    }
+    if (!memory.create(int(sizeof(Layout)))) {
+        error = memory.errorString();
+        return false;
+    }
+    std::memset(memory.data(), 0, sizeof(Layout));
+    layout = new (memory.data()) Layout;
+    layout->version = kVersion;
+    layout->workers = quint32(qBound(1, workers, kMaxWorkers));
+    layout->magic = kMagic;
+    return true;
+}
+
+bool SharedRegistry::attach(int index)
+{
+    if (!memory.attach()) {
+        error = memory.errorString();
+        return false;
+    }
+    layout = static_cast<Layout *>(memory.data());
+    if (layout->magic != kMagic || layout->version != kVersion || index < 0 || index >= int(layout->workers)) {
+        error = "shared registry layout mismatch";
+        memory.detach();
+        layout = nullptr;
+        return false;
+    }
+    workerIndex = index;
+    cursor = layout->head.load(std::memory_order_acquire);
+    seenGeneration = layout->generation.load(std::memory_order_acquire);
+
+    // 门铃：其他 worker 写入广播环后发一个 UDP 包叫醒本进程
+    doorbell = new QUdpSocket(this);
+    doorbell->bind(QHostAddress::LocalHost, 0);
+    connect(doorbell, &QUdpSocket::readyRead, this, [this]() {
+        while (doorbell->hasPendingDatagrams()) {
+            doorbell->receiveDatagram(0);
+        }
+        poll();
+    });
+    layout->workerSlots[index].pid.store(QCoreApplication::applicationPid());
+    layout->workerSlots[index].doorbellPort.store(doorbell->localPort());
+
+    pollTimer = new QTimer(this);
+    pollTimer->setInterval(kPollIntervalMs);
+    connect(pollTimer, &QTimer::timeout, this, &SharedRegistry::poll);
+    pollTimer->start();
+    return true;
+}
+
+bool SharedRegistry::roomExists(const QString &room) const
+{
+    Locker locker(layout);
+    return findRoom(layout, room.toUtf8()) != nullptr;
+}
+
+QStringList SharedRegistry::roomNames() const
+{
+    QStringList names;
+    Locker locker(layout);
+    for (const Layout::Room &room : layout->rooms) {
+        if (room.used) {
+            names.append(QString::fromUtf8(room.name, int(room.nameBytes)));
+        }
+    }
+    return names;
+}
+
+bool SharedRegistry::createRoom(const QString &room)
+{
+    const QByteArray name = room.toUtf8();
+    if (name.isEmpty() || name.size() > kMaxRoomNameBytes) {
+        return false;
+    }
+    {
+        Locker locker(layout);
+        if (findRoom(layout, name)) {
+            return false;
+        }
+        Layout::Room *slot = nullptr;
+        for (Layout::Room &candidate : layout->rooms) {
+            if (!candidate.used) {
+                slot = &candidate;
+                break;
+            }
+        }
+        if (!slot) {
+            return false;
+        }
+        std::memset(slot, 0, sizeof(Layout::Room));
+        std::memcpy(slot->name, name.constData(), size_t(name.size()));
+        slot->nameBytes = quint32(name.size());
+        slot->nextSeq = 1;
+        slot->used = 1;
+        seenGeneration = layout->generation.fetch_add(1) + 1;
+    }
+    ringDoorbells();
+    return true;
+}
+
+bool SharedRegistry::join(const QString &room)
+{
+    Locker locker(layout);
+    Layout::Room *slot = findRoom(layout, room.toUtf8());
+    if (!slot) {
+        return false;
+    }
+    slot->present[workerIndex] = 1;
+    return true;
+}
+
+bool SharedRegistry::leave(const QString &room)
+{
+    {
+        Locker locker(layout);
+        Layout::Room *slot = findRoom(layout, room.toUtf8());
+        if (!slot) {
+            return false;
+        }
+        slot->present[workerIndex] = 0;
+        if (hasMembers(*slot)) {
+            return false;
+        }
+        slot->used = 0;
+        seenGeneration = layout->generation.fetch_add(1) + 1;
+    }
+    ringDoorbells();
+    return true;
+}
+
+bool SharedRegistry::removeRoom(const QString &room)
+{
+    {
+        Locker locker(layout);
+        Layout::Room *slot = findRoom(layout, room.toUtf8());
+        if (!slot) {
+            return false;
+        }
+        slot->used = 0;
+        seenGeneration = layout->generation.fetch_add(1) + 1;
+    }
+    ringDoorbells();
+    return true;
+}
+
+quint64 SharedRegistry::lastSeq(const QString &room) const
+{
+    Locker locker(layout);
+    const Layout::Room *slot = findRoom(layout, room.toUtf8());
+    return slot ? slot->nextSeq - 1 : 0;
+}
+
+quint64 SharedRegistry::publishFrame(const QString &room, const QByteArray &history,
+                                     const std::function<QByteArray(quint64)> &build)
+{
+    const QByteArray name = room.toUtf8();
+    quint64 seq = 0;
+    {
+        Locker locker(layout);
+        Layout::Room *slot = findRoom(layout, name);
+        if (!slot) {
+            return 0;
+        }
+        // 先按下一个序号生成，确认写得进环再占用这个序号，序号不会出现空洞
+        seq = slot->nextSeq;
+        const QByteArray payload = build(seq);
+        if (recordBytes(name, history, payload) > kMaxRecordBytes) {
+            return 0;
+        }
+        ++slot->nextSeq;
+        writeRecord(FrameRecord, name, seq, history, payload);
+    }
+    ringDoorbells();
+    return seq;
+}
+
+void SharedRegistry::publish(RecordKind kind, const QString &room, const QByteArray &payload)
+{
+    const QByteArray name = room.toUtf8();
+    if (recordBytes(name, QByteArray(), payload) > kMaxRecordBytes) {
+        return;
+    }
+    {
+        Locker locker(layout);
+        writeRecord(kind, name, 0, QByteArray(), payload);
+    }
+    ringDoorbells();
+}
+
+void SharedRegistry::writeRecord(RecordKind kind, const QByteArray &room, quint64 seq,
+                                 const QByteArray &history, const QByteArray &payload)
+{
+    // 调用方持有锁，并已确认长度不超过 kMaxRecordBytes
+    const quint64 total = recordBytes(room, history, payload);
+    QByteArray record;
+    record.reserve(qsizetype(total));
+    putValue<quint32>(record, quint32(total));
+    putValue<quint16>(record, quint16(kind));
+    putValue<quint16>(record, quint16(room.size()));
+    putValue<quint64>(record, seq);
+    putValue<quint32>(record, quint32(history.size()));
+    record.append(room).append(history).append(payload);
+
+    // 类似 seqlock：先公布要覆盖到哪里再复制，读者复制完后据此判断读到的数据是否被改写过
+    const quint64 pos = layout->head.load(std::memory_order_relaxed);
+    layout->reserved.store(pos + total, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    ringWrite(layout, pos, record.constData(), total);
+    layout->head.store(pos + total, std::memory_order_release);
+}
+
+bool SharedRegistry::read(Record *record)
+{
+    const quint64 head = layout->head.load(std::memory_order_acquire);
+    if (cursor == head) {
+        return false;
+    }
+    if (head - cursor > kRingBytes) {
+        emit recordsLost(head - cursor);
+        cursor = head;
+        return false;
+    }
+
+    // 长度字段可能已经被覆盖成任意值，先校验再按它分配和复制
+    quint32 total = 0;
+    ringRead(layout, cursor, reinterpret_cast<char *>(&total), sizeof(total));
+    QByteArray bytes;
+    if (total >= kRecordHeaderBytes && total <= head - cursor) {
+        bytes.resize(qsizetype(total));
+        ringRead(layout, cursor, bytes.data(), total);
+    }
+    // 复制期间写入方可能已经绕回来：只要它预留的范围没有越过 cursor + kRingBytes，读到的就是完整的记录
+    std::atomic_thread_fence(std::memory_order_acquire);
+    const quint64 reserved = layout->reserved.load(std::memory_order_relaxed);
+    if (bytes.isEmpty() || reserved - cursor > kRingBytes) {
+        const quint64 after = layout->head.load(std::memory_order_acquire);
+        emit recordsLost(after - cursor);
+        cursor = after;
+        return false;
+    }
+    cursor += total;
+
+    const char *p = bytes.constData() + sizeof(quint32);
+    record->kind = RecordKind(takeValue<quint16>(p));
+    const quint16 roomBytes = takeValue<quint16>(p);
+    record->seq = takeValue<quint64>(p);
+    const quint32 historyBytes = takeValue<quint32>(p);
+    record->room = QString::fromUtf8(p, roomBytes);
+    p += roomBytes;
+    record->history = QByteArray(p, historyBytes);
+    p += historyBytes;
+    record->payload = QByteArray(p, bytes.constData() + total - p);
+    return true;
+}
+
+void SharedRegistry::resetWorker(int index)
+{
+    if (index < 0 || index >= kMaxWorkers) {
+        return;
+    }
+    {
+        Locker locker(layout);
+        layout->workerSlots[index].doorbellPort.store(0);
+        layout->workerSlots[index].pid.store(0);
+        bool changed = false;
+        for (Layout::Room &room : layout->rooms) {
+            if (room.used && room.present[index]) {
+                room.present[index] = 0;
+                if (!hasMembers(room)) {
+                    room.used = 0;
+                    changed = true;
+                }
+            }
+        }
+        if (changed) {
+            layout->generation.fetch_add(1);
+        }
+    }
+    ringDoorbells();
+}
+
+void SharedRegistry::ringDoorbells()
+{
+    // 监督进程没有门铃，靠 worker 自己的轮询发现变化
+    QUdpSocket sender;
+    QUdpSocket *socket = doorbell ? doorbell : &sender;
+    for (int i = 0; i < int(layout->workers); ++i) {
+        const quint16 port = layout->workerSlots[i].doorbellPort.load();
+        if (port != 0 && i != workerIndex) {
+            socket->writeDatagram("\x01", 1, QHostAddress::LocalHost, port);
+        }
+    }
+    if (workerIndex >= 0) {
+        // 本进程写入的记录也要读回来，放到事件循环里处理
+        QTimer::singleShot(0, this, &SharedRegistry::poll);
+    }
+}
+
+void SharedRegistry::poll()
+{
+    const quint64 generation = layout->generation.load(std::memory_order_acquire);
+    if (generation != seenGeneration) {
+        seenGeneration = generation;
+        emit roomsChanged();
+    }
+    if (cursor != layout->head.load(std::memory_order_acquire)) {
+        emit readyRead();
+    }
+}
@@ -0,0 +1,94 @@
+#ifndef SHAREDREGISTRY_H
+#define SHAREDREGISTRY_H
+
+#include <QObject>
+#include <QSharedMemory>
+#include <QStringList>
+#include <functional>
+
+class QTimer;
+class QUdpSocket;
+
+// 多进程（--workers）模式下各 worker 共享的房间表和跨进程广播环，放在同一块共享内存里。
+// 房间是否存在、哪些 worker 上有成员、房间序号都由这里统一管理；发给整个房间的帧
+// 写进环形缓冲，每个 worker 按自己的读位置取出，再发给本进程内的成员。
+class SharedRegistry : public QObject
+{
+    Q_OBJECT
+public:
+    static constexpr int kMaxWorkers = 16;
+    static constexpr int kMaxRooms = 1024;
+    static constexpr int kMaxRoomNameBytes = 120;
+
+    enum RecordKind : quint16 {
+        FrameRecord = 1,        // 带序号的房间帧（聊天、附件、机器人回复）
+        RoomMessageRecord = 2,  // 不占序号的房间通知（加入、离开）
+        CloseRoomRecord = 3     // 管理员关闭房间
+    };
+
+    struct Record {
+        RecordKind kind = FrameRecord;
+        QString room;
+        quint64 seq = 0;
+        QByteArray history;  // FrameRecord 对应的历史行，JSON 转义形式
+        QByteArray payload;  // 发给客户端的完整一行
+    };
+
+    explicit SharedRegistry(int port, QObject *parent = nullptr);
+    ~SharedRegistry();
+
+    // 监督进程负责创建；worker 以自己的编号连接
+    bool create(int workers);
+    bool attach(int workerIndex);
+    QString errorString() const { return error; }
+
+    bool roomExists(const QString &room) const;
+    QStringList roomNames() const;
+    // 房间已存在或房间表已满时返回 false
+    bool createRoom(const QString &room);
+    // 本进程出现第一个成员；房间已不存在时返回 false
+    bool join(const QString &room);
+    // 本进程最后一个成员离开；返回房间是否因为所有 worker 都没有成员而被删除
+    bool leave(const QString &room);
+    bool removeRoom(const QString &room);
+    quint64 lastSeq(const QString &room) const;
+
+    // 分配序号并写入广播环；build 在锁内调用，保证环里的顺序就是序号顺序。
+    // 房间不存在或记录超过单条上限（环的 1/4）时返回 0，且不占用序号
+    quint64 publishFrame(const QString &room, const QByteArray &history,
+                         const std::function<QByteArray(quint64 seq)> &build);
+    void publish(RecordKind kind, const QString &room, const QByteArray &payload);
+    // 取出下一条记录，包括本进程自己写入的
+    bool read(Record *record);
+
+    // worker 退出后清除它在房间表里的成员标记
+    void resetWorker(int workerIndex);
+
+signals:
+    // 广播环里有新记录
+    void readyRead();
+    // 房间被创建或删除
+    void roomsChanged();
+    void recordsLost(quint64 bytes);
+
+public:
+    // 共享内存的布局，定义在 sharedregistry.cpp
+    struct Layout;
+
+private:
+    void writeRecord(RecordKind kind, const QByteArray &room, quint64 seq,
+                     const QByteArray &history, const QByteArray &payload);
+    void ringDoorbells();
+    void poll();
+
+    QSharedMemory memory;
+    Layout *layout = nullptr;
+    int workerIndex = -1;
+    quint64 cursor = 0;
+    quint64 seenGeneration = 0;
+    QUdpSocket *doorbell = nullptr;
+    QTimer *pollTimer = nullptr;
+    QString error;
+};
+
+#endif // SHAREDREGISTRY_H
@@ -0,0 +1,219 @@
+#include "tlsacceptor.h"
+
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QMessageAuthenticationCode>
+#include <QRandomGenerator>
+#include <QtEndian>
+#include <QSslCertificate>
+#include <QSslKey>
+#include <QSslPreSharedKeyAuthenticator>
+#include <QSslSocket>
+#include <QTimer>
+
+#include <memory>
+
+namespace {
+// 票据有效期，覆盖常见的断网和休眠后重连
+constexpr qint64 kTicketLifetimeSecs = 3600;
+// 记住的已用票据上限，超过后淘汰最早用掉的
+constexpr int kMaxRedeemed = 100000;
+// 票据身份：随机数 16 字节 + 过期时间 8 字节 + 校验 16 字节，十六进制后 80 个字符，
+// 在 OpenSSL 的 PSK 身份长度限制之内
+constexpr int kNonceBytes = 16;
+constexpr int kBodyBytes = kNonceBytes + 8;
+constexpr int kTagBytes = 16;
+// 握手超时，迟迟不完成握手的连接直接断开
+constexpr int kHandshakeTimeoutMs = 10000;
+
+struct Handshake {
+    QElapsedTimer timer;
+    bool resumed = false;
+    bool settled = false;
+};
+}
+
+TlsAcceptor::TlsAcceptor(QObject *parent)
+    : QObject(parent)
+{
+    quint32 random[8];
+    QRandomGenerator::system()->fillRange(random);
+    ticketSecret = QByteArray(reinterpret_cast<const char *>(random), sizeof(random));
+}
+
+void TlsAcceptor::setTicketSecret(const QByteArray &secret)
+{
+    if (!secret.isEmpty()) {
+        ticketSecret = secret;
+    }
+}
+
+bool TlsAcceptor::load(const QString &certificatePath, const QString &keyPath, QString *error)
+{
+    QFile certificateFile(certificatePath);
+    if (!certificateFile.open(QIODevice::ReadOnly)) {
+        *error = certificatePath + ": " + certificateFile.errorString();
+        return false;
+    }
+    const QList<QSslCertificate> chain = QSslCertificate::fromDevice(&certificateFile, QSsl::Pem);
+    if (chain.isEmpty()) {
+        *error = certificatePath + ": no PEM certificate";
+        return false;
+    }
+    QFile keyFile(keyPath);
+    if (!keyFile.open(QIODevice::ReadOnly)) {
+        *error = keyPath + ": " + keyFile.errorString();
+        return false;
+    }
+    const QByteArray pem = keyFile.readAll();
+    QSslKey key(pem, QSsl::Rsa, QSsl::Pem);
+    if (key.isNull()) {
+        key = QSslKey(pem, QSsl::Ec, QSsl::Pem);
+    }
+    if (key.isNull()) {
+        *error = keyPath + ": unsupported or encrypted private key";
+        return false;
+    }
+
+    configuration = QSslConfiguration::defaultConfiguration();
+    configuration.setLocalCertificateChain(chain);
+    configuration.setPrivateKey(key);
+    configuration.setPeerVerifyMode(QSslSocket::VerifyNone);
+    // 证书套件排在前面，普通客户端照常走证书握手；带票据的客户端只提供 PSK 套件，才会协商到后面这些
+    QList<QSslCipher> ciphers = configuration.ciphers();
+    for (const QSslCipher &cipher : TlsTicket::pskCiphers()) {
+        if (!ciphers.contains(cipher)) {
+            ciphers.append(cipher);
+        }
+    }
+    configuration.setCiphers(ciphers);
+    active = true;
+    return true;
+}
+
+QSslSocket *TlsAcceptor::accept(qintptr handle, QObject *parent)
+{
+    auto *socket = new QSslSocket(parent);
+    if (!socket->setSocketDescriptor(handle)) {
+        socket->deleteLater();
+        return nullptr;
+    }
+    socket->setSslConfiguration(configuration);
+
+    auto handshake = std::make_shared<Handshake>();
+    handshake->timer.start();
+    connect(socket, &QSslSocket::preSharedKeyAuthenticationRequired, this,
+            [this, handshake](QSslPreSharedKeyAuthenticator *authenticator) {
+        QByteArray key;
+        if (redeem(authenticator->identity(), &key)) {
+            authenticator->setPreSharedKey(key);
+            handshake->resumed = true;
+        } else {
+            // 不给密钥，握手失败，客户端随后改走证书握手
+            ++counters.ticketMisses;
+        }
+    });
+    connect(socket, &QSslSocket::encrypted, this, [this, handshake]() {
+        handshake->settled = true;
+        const qint64 us = handshake->timer.nsecsElapsed() / 1000;
+        if (handshake->resumed) {
+            ++counters.resumed;
+            counters.resumedUs += us;
+            counters.maxResumedUs = qMax(counters.maxResumedUs, us);
+        } else {
+            ++counters.full;
+            counters.fullUs += us;
+            counters.maxFullUs = qMax(counters.maxFullUs, us);
+        }
+    });
+    connect(socket, &QAbstractSocket::errorOccurred, this, [this, handshake]() {
+        if (!handshake->settled) {
+            handshake->settled = true;
+            ++counters.failed;
+        }
+    });
+    QTimer::singleShot(kHandshakeTimeoutMs, socket, [socket]() {
+        if (!socket->isEncrypted()) {
+            socket->abort();
+        }
+    });
+    socket->startServerEncryption();
+    return socket;
+}
+
+TlsTicket TlsAcceptor::issueTicket()
+{
+    quint32 nonce[kNonceBytes / 4];
+    QRandomGenerator::system()->fillRange(nonce);
+    TlsTicket ticket;
+    ticket.expiresAt = QDateTime::currentMSecsSinceEpoch() + kTicketLifetimeSecs * 1000;
+    QByteArray body(reinterpret_cast<const char *>(nonce), kNonceBytes);
+    body.append(kBodyBytes - kNonceBytes, '\0');
+    qToBigEndian(ticket.expiresAt, body.data() + kNonceBytes);
+
+    ticket.identity = (body + ticketMac("identity", body).left(kTagBytes)).toHex();
+    ticket.key = ticketMac("key", body);
+    ++counters.ticketsIssued;
+    return ticket;
+}
+
+qint64 TlsAcceptor::ticketLifetimeSecs() const
+{
+    return kTicketLifetimeSecs;
+}
+
+QByteArray TlsAcceptor::ticketMac(const char *purpose, const QByteArray &body) const
+{
+    // 身份校验和 PSK 用不同的前缀，从身份里看不出密钥
+    return QMessageAuthenticationCode::hash(QByteArray(purpose) + '\n' + body, ticketSecret,
+                                            QCryptographicHash::Sha256);
+}
+
+bool TlsAcceptor::redeem(const QByteArray &identity, QByteArray *key)
+{
+    const QByteArray raw = QByteArray::fromHex(identity);
+    if (raw.size() != kBodyBytes + kTagBytes) {
+        return false;
+    }
+    const QByteArray body = raw.left(kBodyBytes);
+    // 换了票据密钥（服务器重启）或伪造的身份在这里就被拒绝
+    if (raw.mid(kBodyBytes) != ticketMac("identity", body).left(kTagBytes)) {
+        return false;
+    }
+    const qint64 expiresAt = qFromBigEndian<qint64>(body.constData() + kNonceBytes);
+    if (expiresAt <= QDateTime::currentMSecsSinceEpoch()) {
+        return false;
+    }
+
+    // 用过即作废。已用记录只在本进程，多进程模式下同一张票据在每个 worker 上各能用一次，
+    // 票据的 PSK 只通过加密连接下发给客户端，这只影响已泄露的票据
+    pruneRedeemed();
+    if (redeemed.contains(body)) {
+        return false;
+    }
+    redeemed.insert(body, expiresAt);
+    redeemedOrder.append(body);
+    *key = ticketMac("key", body);
+    return true;
+}
+
+void TlsAcceptor::pruneRedeemed()
+{
+    // 从最早用掉的开始，丢掉已过期或超出上限的；过期的票据在核对过期时间时就会被拒绝
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    while (!redeemedOrder.isEmpty()) {
+        const qint64 expiresAt = redeemed.value(redeemedOrder.first());
+        if (expiresAt > now && redeemed.size() < kMaxRedeemed) {
+            break;
+        }
+        redeemed.remove(redeemedOrder.takeFirst());
+    }
+}
+
+TlsAcceptor::Stats TlsAcceptor::stats() const
+{
+    Stats result = counters;
+    result.redeemed = int(redeemed.size());
+    return result;
+}
@@ -0,0 +1,61 @@
+#ifndef TLSACCEPTOR_H
+#define TLSACCEPTOR_H
+
+#include <QObject>
+#include <QHash>
+#include <QList>
+#include <QSslConfiguration>
+
+#include "tlsticket.h"
+
+class QSslSocket;
+
+// 服务器端 TLS：接管新连接做握手，签发和核对重连票据（见 TlsTicket），统计握手耗时。
+// 没有票据或票据失效的连接走证书握手；带着有效票据重连的走 PSK 握手。
+// 票据不在服务器保存：身份里带着随机数和过期时间，密钥由票据密钥对它们求 HMAC 得到，
+// 多进程模式下所有 worker 用监督进程下发的同一把票据密钥，重连落到哪个 worker 都能核对。
+class TlsAcceptor : public QObject
+{
+    Q_OBJECT
+public:
+    struct Stats {
+        quint64 full = 0;
+        quint64 resumed = 0;
+        quint64 failed = 0;
+        qint64 fullUs = 0;        // 累计耗时，微秒
+        qint64 resumedUs = 0;
+        qint64 maxFullUs = 0;
+        qint64 maxResumedUs = 0;
+        int redeemed = 0;         // 本进程记住的已用票据数
+        quint64 ticketsIssued = 0;
+        quint64 ticketMisses = 0; // 票据未知或已过期，握手失败后客户端改走证书握手
+    };
+
+    explicit TlsAcceptor(QObject *parent = nullptr);
+
+    // 默认使用随机密钥，进程重启后旧票据全部失效
+    void setTicketSecret(const QByteArray &secret);
+
+    bool load(const QString &certificatePath, const QString &keyPath, QString *error);
+    bool isActive() const { return active; }
+
+    // 接管已接受的连接并开始握手，失败返回 nullptr
+    QSslSocket *accept(qintptr handle, QObject *parent);
+    TlsTicket issueTicket();
+    qint64 ticketLifetimeSecs() const;
+    Stats stats() const;
+
+private:
+    QByteArray ticketMac(const char *purpose, const QByteArray &body) const;
+    bool redeem(const QByteArray &identity, QByteArray *key);
+    void pruneRedeemed();
+
+    QSslConfiguration configuration;
+    bool active = false;
+    QByteArray ticketSecret;
+    QHash<QByteArray, qint64> redeemed;   // 已用过的票据身份 -> 过期时间
+    QList<QByteArray> redeemedOrder;      // 使用顺序，用于淘汰
+    Stats counters;
+};
+
+#endif // TLSACCEPTOR_H
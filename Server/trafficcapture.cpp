@@ -0,0 +1,195 @@
+#include "trafficcapture.h"
+
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTimer>
+
+namespace {
+// 抓包文件定期落盘，进程崩溃时最多丢这么多毫秒的数据
+constexpr int kFlushIntervalMs = 1000;
+
+// 逐个码点替换成同样 UTF-8 长度的占位字符；字母数字替换，标点和空白保留
+QString scramble(const QString &text)
+{
+    QString out;
+    out.reserve(text.size());
+    for (int i = 0; i < text.size(); ++i) {
+        const QChar c = text.at(i);
+        if (c.isHighSurrogate() && i + 1 < text.size() && text.at(i + 1).isLowSurrogate()) {
+            out.append(QString::fromUtf8("😀"));
+            ++i;
+        } else if (c.unicode() < 0x80) {
+            out.append(c.isLetterOrNumber() ? QChar('x') : c);
+        } else if (c.unicode() < 0x800) {
+            out.append(QChar(0xE9));  // é
+        } else {
+            out.append(QChar(0x4E2D));  // 中
+        }
+    }
+    return out;
+}
+}
+
+TrafficCapture::TrafficCapture(QObject *parent)
+    : QObject(parent)
+    , flushTimer(new QTimer(this))
+{
+    flushTimer->setInterval(kFlushIntervalMs);
+    connect(flushTimer, &QTimer::timeout, this, [this]() { writer.flush(); });
+}
+
+TrafficCapture::~TrafficCapture()
+{
+    stop();
+}
+
+bool TrafficCapture::start(const QString &path)
+{
+    stop();
+    if (!writer.open(path)) {
+        return false;
+    }
+    currentPath = path;
+    events = 0;
+    accounts.clear();
+    names.clear();
+    roomNames.clear();
+    hashes.clear();
+    clock.start();
+    flushTimer->start();
+    return true;
+}
+
+void TrafficCapture::stop()
+{
+    if (!writer.isOpen()) {
+        return;
+    }
+    flushTimer->stop();
+    writer.close();
+}
+
+void TrafficCapture::connectionOpened(quint64 connection)
+{
+    record(Capture::Connect, connection, QByteArray());
+}
+
+void TrafficCapture::frame(quint64 connection, const QByteArray &line)
+{
+    record(Capture::Frame, connection, anonymize(line));
+}
+
+void TrafficCapture::connectionClosed(quint64 connection)
+{
+    record(Capture::Disconnect, connection, QByteArray());
+}
+
+void TrafficCapture::record(Capture::EventType type, quint64 connection, const QByteArray &payload)
+{
+    if (!writer.isOpen()) {
+        return;
+    }
+    Capture::Event event;
+    event.type = type;
+    event.connection = connection;
+    event.timeUs = clock.nsecsElapsed() / 1000;
+    event.payload = payload;
+    writer.write(event);
+    ++events;
+}
+
+QString TrafficCapture::pseudonym(QHash<QString, QString> &table, const QString &prefix, const QString &value)
+{
+    auto it = table.constFind(value);
+    if (it != table.cend()) {
+        return it.value();
+    }
+    const QString alias = prefix + QString::number(table.size() + 1);
+    table.insert(value, alias);
+    return alias;
+}
+
+QByteArray TrafficCapture::anonymize(const QByteArray &line)
+{
+    QJsonParseError error{};
+    const QJsonDocument doc = QJsonDocument::fromJson(line, &error);
+    if (error.error != QJsonParseError::NoError || !doc.isObject()) {
+        // 无法解析的帧只保留长度
+        return QByteArray(line.size(), 'x');
+    }
+
+    QJsonObject obj = doc.object();
+    const QString type = obj.value("type").toString();
+    for (auto it = obj.begin(); it != obj.end(); ++it) {
+        it.value() = anonymizeValue(type, it.key(), it.value());
+    }
+    return QJsonDocument(obj).toJson(QJsonDocument::Compact);
+}
+
+QJsonValue TrafficCapture::anonymizeValue(const QString &type, const QString &key, const QJsonValue &value)
+{
+    // 嵌套的对象和数组逐层处理，字段名照样按下面的规则判断
+    if (value.isObject()) {
+        QJsonObject obj = value.toObject();
+        for (auto it = obj.begin(); it != obj.end(); ++it) {
+            it.value() = anonymizeValue(type, it.key(), it.value());
+        }
+        return obj;
+    }
+    if (value.isArray()) {
+        QJsonArray array = value.toArray();
+        for (auto it = array.begin(); it != array.end(); ++it) {
+            *it = anonymizeValue(type, key, *it);
+        }
+        return array;
+    }
+    if (!value.isString()) {
+        return value;
+    }
+
+    // 只有协议字段和服务器/客户端随机生成的标识原样保留，其余字符串都不能原样写进抓包
+    const QString text = value.toString();
+    if (key == "type" || key == "kind" || key == "client_id" || key == "upload_id") {
+        return text;
+    }
+    if (key == "account") {
+        return pseudonym(accounts, "user", text);
+    }
+    if (key == "password") {
+        return QStringLiteral("xxxxxxxx");
+    }
+    if (key == "room" || (key == "cursor" && type == "list_rooms")) {
+        // 分页游标是上一页最后一个房间名，和房间名用同一张代号表，回放时翻页仍然连贯
+        return text.isEmpty() ? text : pseudonym(roomNames, "room", text);
+    }
+    if (key == "prefix") {
+        // 房间名前缀无法对应到代号，按普通字符串替换，保留长度
+        return scramble(text);
+    }
+    if (key == "name" && type == "login") {
+        return pseudonym(names, "name", text);
+    }
+    if (key == "hash") {
+        // 保持 64 位十六进制的格式，回放时仍能通过格式校验
+        auto known = hashes.constFind(text);
+        const QString alias = known != hashes.cend()
+                                  ? known.value()
+                                  : QString::number(hashes.size() + 1, 16).rightJustified(64, '0');
+        hashes.insert(text, alias);
+        return alias;
+    }
+    if (key == "data") {
+        return QString(text.size(), 'A');
+    }
+    if (key == "token" || key == "proof") {
+        // 下载授权和持有证明，只保留长度
+        return QString(text.size(), 'x');
+    }
+    if (key == "message" || key == "prompt") {
+        // "@ai" 前缀会触发房间机器人，属于负载特征，保留下来
+        const bool bot = text.startsWith("@ai", Qt::CaseInsensitive);
+        return bot ? text.left(3) + scramble(text.mid(3)) : scramble(text);
+    }
+    return scramble(text);
+}
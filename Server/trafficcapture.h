@@ -0,0 +1,50 @@
+#ifndef TRAFFICCAPTURE_H
+#define TRAFFICCAPTURE_H
+
+#include <QObject>
+#include <QHash>
+#include <QElapsedTimer>
+#include <QJsonValue>
+
+#include "capturefile.h"
+
+class QTimer;
+
+// 把入站帧匿名化后写入抓包文件：账号、昵称、房间名换成稳定的代号，
+// 消息正文和其他不在保留名单上的字符串逐字符替换为同样 UTF-8 长度的占位字符，
+// 帧大小和转义情况与原始流量一致。
+class TrafficCapture : public QObject
+{
+    Q_OBJECT
+public:
+    explicit TrafficCapture(QObject *parent = nullptr);
+    ~TrafficCapture();
+
+    bool start(const QString &path);
+    void stop();
+    bool isActive() const { return writer.isOpen(); }
+    QString path() const { return currentPath; }
+    quint64 eventCount() const { return events; }
+
+    void connectionOpened(quint64 connection);
+    void frame(quint64 connection, const QByteArray &line);
+    void connectionClosed(quint64 connection);
+
+private:
+    void record(Capture::EventType type, quint64 connection, const QByteArray &payload);
+    QByteArray anonymize(const QByteArray &line);
+    QJsonValue anonymizeValue(const QString &type, const QString &key, const QJsonValue &value);
+    QString pseudonym(QHash<QString, QString> &table, const QString &prefix, const QString &value);
+
+    Capture::Writer writer;
+    QElapsedTimer clock;
+    QTimer *flushTimer;
+    QString currentPath;
+    quint64 events = 0;
+    QHash<QString, QString> accounts;
+    QHash<QString, QString> names;
+    QHash<QString, QString> roomNames;
+    QHash<QString, QString> hashes;
+};
+
+#endif // TRAFFICCAPTURE_H
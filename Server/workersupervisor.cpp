@@ -0,0 +1,123 @@
+#include "workersupervisor.h"
+
+#include <QCoreApplication>
+#include <QRandomGenerator>
+#include <QTextStream>
+#include <QTimer>
+
+#ifdef Q_OS_LINUX
+#include <csignal>
+#include <sys/prctl.h>
+#endif
+
+namespace {
+// 重启间隔：刚启动就退出的 worker 每次加倍，最长 30 秒
+constexpr int kRestartDelayMs = 1000;
+constexpr int kMaxRestartDelayMs = 30000;
+// 运行超过这个时间才算正常启动，重启间隔恢复初始值
+constexpr int kStableRunMs = 10000;
+// 退出时等待 worker 结束的时间
+constexpr int kStopTimeoutMs = 3000;
+}
+
+WorkerSupervisor::WorkerSupervisor(int port, int workers, const QStringList &workerArguments, QObject *parent)
+    : QObject(parent)
+    , registry(port)
+    , workerCount(qBound(1, workers, SharedRegistry::kMaxWorkers))
+    , arguments(workerArguments)
+{
+    connect(QCoreApplication::instance(), &QCoreApplication::aboutToQuit, this, &WorkerSupervisor::stopAll);
+}
+
+WorkerSupervisor::~WorkerSupervisor()
+{
+    stopAll();
+}
+
+bool WorkerSupervisor::start()
+{
+    if (!registry.create(workerCount)) {
+        QTextStream(stderr) << "Failed to create shared registry: " << registry.errorString() << "\n";
+        return false;
+    }
+    // 所有 worker 用同一把密钥签发和校验下载凭证和 TLS 重连票据，子进程继承环境变量
+    for (const char *name : {"AICHAT_DOWNLOAD_SECRET", "AICHAT_TICKET_SECRET"}) {
+        if (qEnvironmentVariableIsEmpty(name)) {
+            quint32 secret[8];
+            QRandomGenerator::system()->fillRange(secret);
+            qputenv(name, QByteArray(reinterpret_cast<const char *>(secret), sizeof(secret)).toHex());
+        }
+    }
+    workers.resize(workerCount);
+    for (int i = 0; i < workerCount; ++i) {
+        workers[i].restartDelayMs = kRestartDelayMs;
+        launch(i);
+    }
+    QTextStream(stdout) << "Supervisor started " << workerCount << " workers\n";
+    return true;
+}
+
+void WorkerSupervisor::launch(int index)
+{
+    Worker &worker = workers[index];
+    auto *process = new QProcess(this);
+    process->setProcessChannelMode(QProcess::ForwardedChannels);
+    process->setProgram(QCoreApplication::applicationFilePath());
+    process->setArguments(QStringList(arguments) << "--worker-index" << QString::number(index));
+#ifdef Q_OS_LINUX
+    // 监督进程被杀掉时 worker 也跟着退出，不会留下无人管理的进程
+    process->setChildProcessModifier([]() {
+        ::prctl(PR_SET_PDEATHSIG, SIGTERM);
+    });
+#endif
+    connect(process, &QProcess::finished, this, [this, index](int exitCode, QProcess::ExitStatus status) {
+        onWorkerFinished(index, exitCode, status);
+    });
+
+    worker.process = process;
+    worker.startedAt.start();
+    process->start();
+}
+
+void WorkerSupervisor::onWorkerFinished(int index, int exitCode, QProcess::ExitStatus status)
+{
+    Worker &worker = workers[index];
+    worker.process->deleteLater();
+    worker.process = nullptr;
+    // 它的连接都已断开，房间表里不能再算它的成员
+    registry.resetWorker(index);
+    if (stopping) {
+        return;
+    }
+
+    if (worker.startedAt.elapsed() >= kStableRunMs) {
+        worker.restartDelayMs = kRestartDelayMs;
+    }
+    QTextStream(stderr) << "Worker " << index << (status == QProcess::CrashExit ? " crashed" : " exited")
+                        << " (code " << exitCode << "), restarting in " << worker.restartDelayMs << " ms\n";
+    QTimer::singleShot(worker.restartDelayMs, this, [this, index]() {
+        if (!stopping && !workers[index].process) {
+            launch(index);
+        }
+    });
+    worker.restartDelayMs = qMin(worker.restartDelayMs * 2, kMaxRestartDelayMs);
+}
+
+void WorkerSupervisor::stopAll()
+{
+    if (stopping) {
+        return;
+    }
+    stopping = true;
+    for (Worker &worker : workers) {
+        if (worker.process) {
+            worker.process->terminate();
+        }
+    }
+    for (Worker &worker : workers) {
+        if (worker.process && !worker.process->waitForFinished(kStopTimeoutMs)) {
+            worker.process->kill();
+            worker.process->waitForFinished();
+        }
+    }
+}
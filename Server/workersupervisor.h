@@ -0,0 +1,40 @@
+#ifndef WORKERSUPERVISOR_H
+#define WORKERSUPERVISOR_H
+
+#include <QObject>
+#include <QProcess>
+#include <QElapsedTimer>
+#include <QList>
+
+#include "sharedregistry.h"
+
+// --workers N：创建共享的房间表，启动 N 个监听同一端口（SO_REUSEPORT）的 worker 进程，
+// 某个 worker 崩溃后清掉它的成员标记并重新拉起，其他 worker 上的用户不受影响。
+class WorkerSupervisor : public QObject
+{
+    Q_OBJECT
+public:
+    WorkerSupervisor(int port, int workers, const QStringList &workerArguments, QObject *parent = nullptr);
+    ~WorkerSupervisor();
+
+    bool start();
+
+private:
+    struct Worker {
+        QProcess *process = nullptr;
+        QElapsedTimer startedAt;
+        int restartDelayMs = 0;
+    };
+
+    void launch(int index);
+    void onWorkerFinished(int index, int exitCode, QProcess::ExitStatus status);
+    void stopAll();
+
+    SharedRegistry registry;
+    int workerCount;
+    QStringList arguments;
+    QList<Worker> workers;
+    bool stopping = false;
+};
+
+#endif // WORKERSUPERVISOR_H
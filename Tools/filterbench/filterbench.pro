@@ -0,0 +1,22 @@
+QT       += core
+QT       -= gui
+
+CONFIG += c++17 console
+CONFIG -= app_bundle
+
+# 直接编译服务器的过滤代码，测的就是线上用的实现
+INCLUDEPATH += ../../Server
+
+SOURCES += \
+    main.cpp \
+    ../../Server/chatframe.cpp \
+    ../../Server/contentfilter.cpp \
+    ../../Server/keywordmatcher.cpp
+
+HEADERS += \
+    ../../Server/contentfilter.h \
+    ../../Server/keywordmatcher.h
+
+include(../../Common/common.pri)
+
+TARGET=AI-ChatRoom-FilterBench
@@ -0,0 +1,289 @@
+#include "contentfilter.h"
+#include "chatframe.h"
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QCommandLineOption>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QRandomGenerator>
+#include <QTemporaryFile>
+#include <QTextStream>
+
+#include <algorithm>
+
+namespace {
+// 合成数据用的英文字母表，和常用汉字区间
+const char kLatin[] = "abcdefghijklmnopqrstuvwxyz";
+constexpr char32_t kCjkFirst = 0x4E00;
+constexpr char32_t kCjkCount = 0x9FA5 - 0x4E00;
+
+QString randomLatin(QRandomGenerator &rng, int minLength, int maxLength)
+{
+    QString word;
+    const int length = rng.bounded(minLength, maxLength + 1);
+    for (int i = 0; i < length; ++i) {
+        word.append(QLatin1Char(kLatin[rng.bounded(26)]));
+    }
+    return word;
+}
+
+QString randomCjk(QRandomGenerator &rng, int minLength, int maxLength)
+{
+    QString word;
+    const int length = rng.bounded(minLength, maxLength + 1);
+    for (int i = 0; i < length; ++i) {
+        const char32_t ch = kCjkFirst + char32_t(rng.bounded(int(kCjkCount)));
+        word.append(QString::fromUcs4(&ch, 1));
+    }
+    return word;
+}
+
+// 中文词、英文词、网址大约各占一半、三成、两成
+QStringList generatePatterns(QRandomGenerator &rng, int count)
+{
+    QStringList patterns;
+    patterns.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        const int kind = rng.bounded(10);
+        if (kind < 5) {
+            patterns.append(randomCjk(rng, 2, 6));
+        } else if (kind < 8) {
+            patterns.append(randomLatin(rng, 4, 12));
+        } else {
+            patterns.append(QString("%1.%2.com/%3").arg(randomLatin(rng, 3, 6), randomLatin(rng, 4, 10),
+                                                         randomLatin(rng, 2, 8)));
+        }
+    }
+    return patterns;
+}
+
+// 中英混排的聊天消息，hitRate 的比例插入一个关键词
+QList<QByteArray> generateMessages(QRandomGenerator &rng, int count, int averageChars, double hitRate,
+                                   const QStringList &patterns)
+{
+    QList<QByteArray> messages;
+    messages.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        QString text;
+        const int target = rng.bounded(averageChars / 2, averageChars * 3 / 2 + 1);
+        while (text.size() < target) {
+            text.append(rng.bounded(2) ? randomCjk(rng, 1, 4) : randomLatin(rng, 2, 8) + ' ');
+        }
+        if (!patterns.isEmpty() && rng.generateDouble() < hitRate) {
+            text.insert(rng.bounded(int(text.size()) + 1), patterns.at(rng.bounded(int(patterns.size()))));
+        }
+        messages.append(jsonEscape(text));
+    }
+    return messages;
+}
+
+// 读规则文件里的关键词，只用于朴素匹配的对照
+QStringList readPatterns(const QString &path)
+{
+    QStringList patterns;
+    QFile file(path);
+    if (file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        while (!file.atEnd()) {
+            const QString line = QString::fromUtf8(file.readLine()).trimmed();
+            if (!line.isEmpty() && !line.startsWith('#') && !(line.startsWith('[') && line.endsWith(']'))) {
+                patterns.append(line);
+            }
+        }
+    }
+    return patterns;
+}
+
+double percentileUs(QList<qint64> samples, double p)
+{
+    if (samples.isEmpty()) {
+        return 0.0;
+    }
+    std::sort(samples.begin(), samples.end());
+    const int index = qBound(0, int(p * (samples.size() - 1) + 0.5), int(samples.size()) - 1);
+    return samples.at(index) / 1e3;
+}
+
+QString latencyLine(const char *label, const QList<qint64> &samples)
+{
+    return QString("%1: n=%2 p50=%3us p90=%4us p99=%5us max=%6us\n")
+        .arg(label).arg(samples.size())
+        .arg(percentileUs(samples, 0.50), 0, 'f', 2)
+        .arg(percentileUs(samples, 0.90), 0, 'f', 2)
+        .arg(percentileUs(samples, 0.99), 0, 'f', 2)
+        .arg(percentileUs(samples, 1.0), 0, 'f', 2);
+}
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+    QCoreApplication::setApplicationName("AI-ChatRoom-FilterBench");
+    QCoreApplication::setApplicationVersion("1.0");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Measure keyword filter throughput and per-message latency");
+    parser.addHelpOption();
+    parser.addVersionOption();
+
+    QCommandLineOption rulesOption("rules", "Filter rules file (default: generate synthetic rules)", "file");
+    parser.addOption(rulesOption);
+    QCommandLineOption patternsOption("patterns", "Number of synthetic patterns", "n", "50000");
+    parser.addOption(patternsOption);
+    QCommandLineOption corpusOption("corpus", "Messages to scan, one per line (default: synthetic messages)", "file");
+    parser.addOption(corpusOption);
+    QCommandLineOption messagesOption("messages", "Number of synthetic messages", "n", "20000");
+    parser.addOption(messagesOption);
+    QCommandLineOption lengthOption("length", "Average synthetic message length in characters", "chars", "80");
+    parser.addOption(lengthOption);
+    QCommandLineOption hitRateOption("hit-rate", "Fraction of synthetic messages containing a pattern", "ratio", "0.01");
+    parser.addOption(hitRateOption);
+    QCommandLineOption roundsOption("rounds", "Passes over the corpus for the throughput figure", "n", "5");
+    parser.addOption(roundsOption);
+    QCommandLineOption naiveOption("naive", "Messages scanned with one search per pattern, for comparison (0 = skip)", "n", "200");
+    parser.addOption(naiveOption);
+    QCommandLineOption seedOption("seed", "Random seed for synthetic data", "n", "1");
+    parser.addOption(seedOption);
+    parser.process(a);
+
+    QTextStream out(stdout);
+    QRandomGenerator rng(parser.value(seedOption).toUInt());
+
+    QString rulesPath = parser.value(rulesOption);
+    QStringList patterns;
+    QTemporaryFile generated;
+    if (rulesPath.isEmpty()) {
+        // 九成拦截，其余打码和标记，和线上规则的比例相近
+        patterns = generatePatterns(rng, qMax(1, parser.value(patternsOption).toInt()));
+        if (!generated.open()) {
+            QTextStream(stderr) << "Failed to create temporary rules file.\n";
+            return 1;
+        }
+        const qsizetype maskFrom = patterns.size() * 9 / 10;
+        const qsizetype flagFrom = patterns.size() * 98 / 100;
+        QByteArray text = "[block]\n";
+        for (qsizetype i = 0; i < patterns.size(); ++i) {
+            if (i == maskFrom) {
+                text += "[mask]\n";
+            } else if (i == flagFrom) {
+                text += "[flag]\n";
+            }
+            text += patterns.at(i).toUtf8() + '\n';
+        }
+        generated.write(text);
+        generated.flush();
+        rulesPath = generated.fileName();
+    } else {
+        patterns = readPatterns(rulesPath);
+    }
+
+    QList<QByteArray> messages;
+    if (parser.isSet(corpusOption)) {
+        QFile corpus(parser.value(corpusOption));
+        if (!corpus.open(QIODevice::ReadOnly | QIODevice::Text)) {
+            QTextStream(stderr) << "Failed to open corpus: " << corpus.errorString() << "\n";
+            return 1;
+        }
+        while (!corpus.atEnd()) {
+            const QByteArray line = corpus.readLine().trimmed();
+            if (!line.isEmpty()) {
+                messages.append(jsonEscape(QByteArrayView(line)));
+            }
+        }
+    } else {
+        messages = generateMessages(rng, qMax(1, parser.value(messagesOption).toInt()),
+                                    qMax(2, parser.value(lengthOption).toInt()),
+                                    parser.value(hitRateOption).toDouble(), patterns);
+    }
+    if (messages.isEmpty()) {
+        QTextStream(stderr) << "No messages to scan.\n";
+        return 1;
+    }
+    qint64 corpusBytes = 0;
+    for (const QByteArray &message : std::as_const(messages)) {
+        corpusBytes += message.size();
+    }
+
+    ContentFilter filter;
+    QString error;
+    if (!filter.load(rulesPath, &error)) {
+        QTextStream(stderr) << "Failed to load rules: " << error << "\n";
+        return 1;
+    }
+    const ContentFilter::Stats built = filter.stats();
+    out << QString("rules: %1 patterns, %2 states, automaton %3 KB, built in %4 ms\n")
+               .arg(built.patterns).arg(built.states).arg(built.memory / 1024).arg(built.buildMs);
+    out << QString("corpus: %1 messages, %2 KB\n").arg(messages.size()).arg(corpusBytes / 1024);
+
+    // 吞吐量：整批扫描，不计单条计时的开销
+    const int rounds = qMax(1, parser.value(roundsOption).toInt());
+    QElapsedTimer timer;
+    timer.start();
+    for (int round = 0; round < rounds; ++round) {
+        for (const QByteArray &message : std::as_const(messages)) {
+            filter.check(message);
+        }
+    }
+    const double seconds = qMax<qint64>(1, timer.nsecsElapsed()) / 1e9;
+    out << QString("throughput: %1 MB/s, %2 messages/s\n")
+               .arg(corpusBytes * rounds / seconds / (1024 * 1024), 0, 'f', 1)
+               .arg(messages.size() * rounds / seconds, 0, 'f', 0);
+
+    // 单条延迟：逐条计时；空计时的结果即为计时本身的开销
+    QList<qint64> idle;
+    QList<qint64> latencies;
+    idle.reserve(messages.size());
+    latencies.reserve(messages.size());
+    for (const QByteArray &message : std::as_const(messages)) {
+        timer.start();
+        idle.append(timer.nsecsElapsed());
+        timer.start();
+        filter.check(message);
+        latencies.append(timer.nsecsElapsed());
+    }
+    out << latencyLine("timer overhead", idle);
+    out << latencyLine("added latency", latencies);
+    const ContentFilter::Stats counted = filter.stats();
+    out << QString("verdicts: blocked %1, masked %2, flagged %3 of %4 checks\n")
+               .arg(counted.blocked).arg(counted.masked).arg(counted.flagged).arg(counted.checked);
+
+    // 热加载：后台重建期间继续过滤，记录这段时间的单条延迟
+    QList<qint64> duringReload;
+    bool reloaded = false;
+    QObject::connect(&filter, &ContentFilter::reloaded, [&reloaded](int, qint64) { reloaded = true; });
+    QObject::connect(&filter, &ContentFilter::reloadFailed, [&reloaded](const QString &) { reloaded = true; });
+    filter.reload();
+    for (qsizetype i = 0; !reloaded; ++i) {
+        timer.start();
+        filter.check(messages.at(i % messages.size()));
+        duringReload.append(timer.nsecsElapsed());
+        if (i % 256 == 255) {
+            QCoreApplication::processEvents();
+        }
+    }
+    out << latencyLine("latency during reload", duringReload);
+
+    // 对照：每个关键词单独查找一遍
+    const int naiveCount = qMin(int(messages.size()), parser.value(naiveOption).toInt());
+    if (naiveCount > 0 && !patterns.isEmpty()) {
+        QList<QByteArray> needles;
+        needles.reserve(patterns.size());
+        for (const QString &pattern : std::as_const(patterns)) {
+            needles.append(jsonEscape(pattern));
+        }
+        QList<qint64> naive;
+        naive.reserve(naiveCount);
+        for (int i = 0; i < naiveCount; ++i) {
+            const QByteArrayView message = messages.at(i);
+            timer.start();
+            for (const QByteArray &needle : std::as_const(needles)) {
+                if (message.contains(needle)) {
+                    break;
+                }
+            }
+            naive.append(timer.nsecsElapsed());
+        }
+        out << latencyLine("naive per-pattern search", naive);
+    }
+    return 0;
+}
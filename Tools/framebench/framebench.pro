@@ -0,0 +1,17 @@
+QT       += core
+QT       -= gui
+
+CONFIG += c++17 console
+CONFIG -= app_bundle
+
+# 直接编译服务器的分帧扫描代码，测的就是线上用的实现
+INCLUDEPATH += ../../Server
+
+SOURCES += \
+    main.cpp \
+    ../../Server/chatframe.cpp
+
+HEADERS += \
+    ../../Server/chatframe.h
+
+TARGET=AI-ChatRoom-FrameBench
@@ -0,0 +1,217 @@
+#include "chatframe.h"
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QCommandLineOption>
+#include <QElapsedTimer>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QRandomGenerator>
+#include <QTextStream>
+
+#include <algorithm>
+
+namespace {
+const char kLatin[] = "abcdefghijklmnopqrstuvwxyz";
+constexpr char32_t kCjkFirst = 0x4E00;
+constexpr char32_t kCjkCount = 0x9FA5 - 0x4E00;
+
+// 两条路径用同样的发送者、时间和序号，输出才能逐个字段比较
+const QString kSender = "测试用户";
+const QByteArray kTime = "12:34:56";
+constexpr qint64 kTs = 1760000000000;
+constexpr quint64 kSeq = 123456;
+
+// 中英混排的消息正文，偶尔带引号和换行，让转义路径也被覆盖
+QString generateMessage(QRandomGenerator &rng, qsizetype bytes)
+{
+    QString text;
+    qsizetype utf8 = 0;
+    while (utf8 < bytes) {
+        const int kind = rng.bounded(20);
+        if (kind < 9) {
+            const char32_t ch = kCjkFirst + char32_t(rng.bounded(int(kCjkCount)));
+            text.append(QString::fromUcs4(&ch, 1));
+            utf8 += 3;
+        } else if (kind < 18) {
+            text.append(QLatin1Char(kLatin[rng.bounded(26)]));
+            utf8 += 1;
+        } else if (kind == 18) {
+            text.append(' ');
+            utf8 += 1;
+        } else {
+            text.append(rng.bounded(2) ? QChar('"') : QChar('\n'));
+            utf8 += 2;
+        }
+    }
+    return text;
+}
+
+// 客户端发来的 chat 帧，和 Client 用 QJsonDocument 生成的格式一致
+QByteArray inboundFrame(const QString &message)
+{
+    QJsonObject obj;
+    obj["type"] = "chat";
+    obj["room"] = "大厅";
+    obj["message"] = message;
+    obj["client_id"] = "c-0123456789abcdef";
+    return QJsonDocument(obj).toJson(QJsonDocument::Compact);
+}
+
+// 新路径：只扫描路由字段，message 的转义字节原样拼进广播帧，和 Server::handleChat 相同
+QByteArray rawPath(const QByteArray &line, const QByteArray &nameJson)
+{
+    RawChatFrame frame;
+    if (!scanChatFrame(line, &frame) || frame.typeEscaped || frame.type != "chat" || frame.message.isNull()) {
+        return QByteArray();
+    }
+    const QString room = (frame.roomEscaped ? jsonUnescape(frame.room) : QString::fromUtf8(frame.room)).trimmed();
+    const QString clientId = frame.clientIdEscaped ? jsonUnescape(frame.clientId) : QString::fromUtf8(frame.clientId);
+    const QByteArray roomJson = jsonEscape(room);
+
+    QByteArray out;
+    out.reserve(frame.message.size() + nameJson.size() + roomJson.size() + clientId.size() + 128);
+    out.append('{');
+    if (!clientId.isEmpty()) {
+        out.append("\"client_id\":\"").append(jsonEscape(clientId)).append("\",");
+    }
+    out.append("\"from\":\"").append(nameJson)
+        .append("\",\"message\":\"").append(frame.message)
+        .append("\",\"room\":\"").append(roomJson)
+        .append("\",\"seq\":").append(QByteArray::number(kSeq))
+        .append(",\"time\":\"").append(kTime)
+        .append("\",\"ts\":").append(QByteArray::number(kTs))
+        .append(",\"type\":\"chat\"}\n");
+    return out;
+}
+
+// 对照：改动前的做法，整帧解析成 QJsonObject，再重新序列化广播帧
+QByteArray jsonPath(const QByteArray &line)
+{
+    QJsonParseError error{};
+    const QJsonDocument doc = QJsonDocument::fromJson(line, &error);
+    if (error.error != QJsonParseError::NoError || !doc.isObject()) {
+        return QByteArray();
+    }
+    const QJsonObject obj = doc.object();
+    if (obj.value("type").toString() != "chat") {
+        return QByteArray();
+    }
+    QJsonObject chat;
+    const QString clientId = obj.value("client_id").toString();
+    if (!clientId.isEmpty()) {
+        chat["client_id"] = clientId;
+    }
+    chat["from"] = kSender;
+    chat["message"] = obj.value("message").toString();
+    chat["room"] = obj.value("room").toString().trimmed();
+    chat["seq"] = qint64(kSeq);
+    chat["time"] = QString::fromLatin1(kTime);
+    chat["ts"] = kTs;
+    chat["type"] = "chat";
+    return QJsonDocument(chat).toJson(QJsonDocument::Compact) + '\n';
+}
+
+double percentileUs(QList<qint64> samples, double p)
+{
+    if (samples.isEmpty()) {
+        return 0.0;
+    }
+    std::sort(samples.begin(), samples.end());
+    const int index = qBound(0, int(p * (samples.size() - 1) + 0.5), int(samples.size()) - 1);
+    return samples.at(index) / 1e3;
+}
+
+struct Result {
+    QList<qint64> samples;
+    qint64 totalNs = 0;
+    qint64 outBytes = 0;    // 防止结果被优化掉
+};
+
+template <typename Path>
+Result measure(int iterations, const QByteArray &line, Path path)
+{
+    Result result;
+    result.samples.reserve(iterations);
+    QElapsedTimer timer;
+    for (int i = 0; i < iterations; ++i) {
+        timer.start();
+        const QByteArray out = path(line);
+        const qint64 ns = timer.nsecsElapsed();
+        result.samples.append(ns);
+        result.totalNs += ns;
+        result.outBytes += out.size();
+    }
+    return result;
+}
+
+QString resultLine(const char *label, const Result &result, qsizetype lineBytes)
+{
+    const double seconds = qMax<qint64>(1, result.totalNs) / 1e9;
+    return QString("  %1: p50=%2us p99=%3us, %4 MB/s, %5 frames/s\n")
+        .arg(label, -10)
+        .arg(percentileUs(result.samples, 0.50), 0, 'f', 2)
+        .arg(percentileUs(result.samples, 0.99), 0, 'f', 2)
+        .arg(double(lineBytes) * result.samples.size() / seconds / (1024 * 1024), 0, 'f', 1)
+        .arg(result.samples.size() / seconds, 0, 'f', 0);
+}
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+    QCoreApplication::setApplicationName("AI-ChatRoom-FrameBench");
+    QCoreApplication::setApplicationVersion("1.0");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Compare the raw chat frame path with parsing and re-serializing through QJsonDocument");
+    parser.addHelpOption();
+    parser.addVersionOption();
+
+    QCommandLineOption sizesOption("sizes", "Comma-separated message sizes in bytes", "list", "100,10240,1048576");
+    parser.addOption(sizesOption);
+    QCommandLineOption volumeOption("mb", "Input volume per size and path, in MB", "n", "64");
+    parser.addOption(volumeOption);
+    QCommandLineOption seedOption("seed", "Random seed for synthetic messages", "n", "1");
+    parser.addOption(seedOption);
+    parser.process(a);
+
+    QTextStream out(stdout);
+    QRandomGenerator rng(parser.value(seedOption).toUInt());
+    const qint64 volume = qMax<qint64>(1, parser.value(volumeOption).toLongLong()) * 1024 * 1024;
+    const QByteArray nameJson = jsonEscape(kSender);
+
+    int failures = 0;
+    for (const QString &field : parser.value(sizesOption).split(',', Qt::SkipEmptyParts)) {
+        const qsizetype size = field.trimmed().toLongLong();
+        if (size <= 0) {
+            QTextStream(stderr) << "Invalid size: " << field << "\n";
+            return 1;
+        }
+        const QByteArray line = inboundFrame(generateMessage(rng, size));
+
+        // 两条路径的输出必须是同一个 JSON 对象
+        const QByteArray raw = rawPath(line, nameJson);
+        const QByteArray json = jsonPath(line);
+        if (raw.isEmpty() || QJsonDocument::fromJson(raw).object() != QJsonDocument::fromJson(json).object()) {
+            QTextStream(stderr) << "Outputs differ for " << size << " byte messages.\n";
+            ++failures;
+            continue;
+        }
+
+        const int iterations = int(qBound<qint64>(20, volume / line.size(), 1000000));
+        // 预热，不计入结果
+        measure(qMin(iterations, 100), line, [&](const QByteArray &l) { return rawPath(l, nameJson); });
+        measure(qMin(iterations, 100), line, jsonPath);
+
+        const Result rawResult = measure(iterations, line, [&](const QByteArray &l) { return rawPath(l, nameJson); });
+        const Result jsonResult = measure(iterations, line, jsonPath);
+        out << QString("message %1 bytes (frame %2 bytes), %3 iterations\n")
+                   .arg(size).arg(line.size()).arg(iterations);
+        out << resultLine("raw", rawResult, line.size());
+        out << resultLine("QJsonDocument", jsonResult, line.size());
+        out << QString("  p50 speedup: %1x\n")
+                   .arg(percentileUs(jsonResult.samples, 0.5) / qMax(1e-3, percentileUs(rawResult.samples, 0.5)), 0, 'f', 2);
+    }
+    return failures > 0 ? 1 : 0;
+}
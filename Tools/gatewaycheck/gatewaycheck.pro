@@ -0,0 +1,19 @@
+QT       += core network
+QT       -= gui
+
+CONFIG += c++17 console
+CONFIG -= app_bundle
+
+# 服务器的 AI 网关对着进程内的模拟接口跑，测的就是线上用的实现
+INCLUDEPATH += ../../Server ../mockai
+
+SOURCES += \
+    main.cpp \
+    ../../Server/aigateway.cpp \
+    ../mockai/mockaiserver.cpp
+
+HEADERS += \
+    ../../Server/aigateway.h \
+    ../mockai/mockaiserver.h
+
+TARGET=AI-ChatRoom-GatewayCheck
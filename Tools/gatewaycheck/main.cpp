@@ -0,0 +1,144 @@
+#include "aigateway.h"
+#include "mockaiserver.h"
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QHostAddress>
+#include <QTextStream>
+
+#include <functional>
+
+namespace {
+constexpr int kWaitTimeoutMs = 10000;
+
+struct Outcome {
+    int done = 0;
+    int ok = 0;
+    int cached = 0;
+    QStringList texts;
+};
+
+AIGateway::Callback record(Outcome *outcome)
+{
+    return [outcome](bool ok, const QString &text, bool cached) {
+        ++outcome->done;
+        outcome->ok += ok ? 1 : 0;
+        outcome->cached += cached ? 1 : 0;
+        outcome->texts.append(text);
+    };
+}
+
+// 跑事件循环直到条件成立或超时
+bool waitFor(const std::function<bool()> &condition)
+{
+    QElapsedTimer timer;
+    timer.start();
+    while (!condition()) {
+        if (timer.elapsed() > kWaitTimeoutMs) {
+            return false;
+        }
+        QCoreApplication::processEvents(QEventLoop::WaitForMoreEvents, 50);
+    }
+    return true;
+}
+
+class Checker
+{
+public:
+    void expect(const QString &name, bool passed, const QString &detail = QString())
+    {
+        QTextStream(stdout) << (passed ? "PASS " : "FAIL ") << name
+                            << (detail.isEmpty() ? QString() : " (" + detail + ")") << "\n";
+        failures += passed ? 0 : 1;
+    }
+    int failures = 0;
+};
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+    QCoreApplication::setApplicationName("AI-ChatRoom-GatewayCheck");
+    QCoreApplication::setApplicationVersion("1.0");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Check the server AI gateway against an in-process mock OpenAI-compatible endpoint");
+    parser.addHelpOption();
+    parser.addVersionOption();
+    parser.process(a);
+
+    // 回复要慢到足以让并发请求在途中重叠
+    MockAIServer::Options options;
+    options.tokens = 20;
+    options.firstTokenMs = 200;
+    options.intervalMs = 5;
+    MockAIServer mock(options);
+    if (!mock.listen(QHostAddress::LocalHost, 0)) {
+        QTextStream(stderr) << "Failed to listen: " << mock.errorString() << "\n";
+        return 1;
+    }
+
+    AIGateway gateway;
+    AIGateway::Config config;
+    config.endpoint = QUrl(QString("http://127.0.0.1:%1/v1/chat/completions").arg(mock.serverPort()));
+    config.apiKey = "mock";
+    config.model = "mock-model";
+    config.maxConcurrent = 2;
+    gateway.setConfig(config);
+
+    Checker check;
+
+    // 同一快照上相同或几乎相同的请求只调用一次上游
+    Outcome burst;
+    const QStringList variants = {"总结一下聊天", "总结一下聊天。", "  总结一下聊天  ", "总结一下聊天！"};
+    for (int i = 0; i < 10; ++i) {
+        gateway.request("room1", 1, 50, variants.at(i % variants.size()), record(&burst));
+    }
+    check.expect("burst completes", waitFor([&]() { return burst.done == 10; }),
+                 QString("%1/10 callbacks").arg(burst.done));
+    check.expect("burst coalesced into one upstream call", mock.requestCount() == 1,
+                 QString("%1 calls").arg(mock.requestCount()));
+    check.expect("every waiter got the reply", burst.ok == 10 && burst.texts.count(burst.texts.value(0)) == 10);
+
+    // 结果按房间和序号区间缓存
+    Outcome repeat;
+    gateway.request("room1", 1, 50, "总结一下聊天", record(&repeat));
+    check.expect("repeat served from cache", repeat.done == 1 && repeat.cached == 1 && mock.requestCount() == 1);
+
+    Outcome moved;
+    gateway.request("room1", 1, 51, "总结一下聊天", record(&moved));
+    Outcome otherRoom;
+    gateway.request("room2", 1, 50, "总结一下聊天", record(&otherRoom));
+    check.expect("new snapshot and other room call upstream",
+                 waitFor([&]() { return moved.done == 1 && otherRoom.done == 1; })
+                     && moved.cached == 0 && otherRoom.cached == 0 && mock.requestCount() == 3,
+                 QString("%1 calls").arg(mock.requestCount()));
+
+    // 并发上限：不同的请求排队，同时在途的不超过 maxConcurrent
+    Outcome distinct;
+    for (int i = 0; i < 6; ++i) {
+        gateway.request("room3", 1, quint64(100 + i), QString("问题 %1").arg(i), record(&distinct));
+    }
+    check.expect("queued requests all complete", waitFor([&]() { return distinct.done == 6; }),
+                 QString("%1/6 callbacks").arg(distinct.done));
+    check.expect("concurrency limit respected", mock.peakConcurrent() <= config.maxConcurrent,
+                 QString("peak %1, limit %2").arg(mock.peakConcurrent()).arg(config.maxConcurrent));
+
+    // 上游不可用时回调收到错误，不会写进缓存
+    AIGateway::Config down = config;
+    down.endpoint = QUrl("http://127.0.0.1:1/v1/chat/completions");
+    gateway.setConfig(down);
+    Outcome failed;
+    gateway.request("room4", 1, 1, "问题", record(&failed));
+    check.expect("upstream failure reported", waitFor([&]() { return failed.done == 1; }) && failed.ok == 0);
+    gateway.setConfig(config);
+    Outcome retried;
+    gateway.request("room4", 1, 1, "问题", record(&retried));
+    check.expect("failure not cached", waitFor([&]() { return retried.done == 1; })
+                                           && retried.ok == 1 && retried.cached == 0);
+
+    QTextStream(stdout) << (check.failures == 0 ? "all checks passed\n"
+                                                : QString("%1 checks failed\n").arg(check.failures));
+    return check.failures == 0 ? 0 : 1;
+}
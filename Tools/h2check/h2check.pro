@@ -0,0 +1,23 @@
+QT       += core network
+QT       -= gui
+
+CONFIG += c++17 console
+CONFIG -= app_bundle
+
+# 客户端的 AI 请求调度对着进程内的模拟接口跑，走 h2c
+INCLUDEPATH += ../../Client ../mockai
+
+SOURCES += \
+    main.cpp \
+    ../../Client/aicache.cpp \
+    ../../Client/aischeduler.cpp \
+    ../../Client/sseparser.cpp \
+    ../mockai/mockaiserver.cpp
+
+HEADERS += \
+    ../../Client/aicache.h \
+    ../../Client/aischeduler.h \
+    ../../Client/sseparser.h \
+    ../mockai/mockaiserver.h
+
+TARGET=AI-ChatRoom-H2Check
@@ -0,0 +1,119 @@
+#include "aischeduler.h"
+#include "mockaiserver.h"
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QHostAddress>
+#include <QTemporaryDir>
+#include <QTextStream>
+
+#include <functional>
+
+namespace {
+constexpr int kWaitTimeoutMs = 10000;
+constexpr int kRooms = 3;
+
+// 跑事件循环直到条件成立或超时
+bool waitFor(const std::function<bool()> &condition)
+{
+    QElapsedTimer timer;
+    timer.start();
+    while (!condition()) {
+        if (timer.elapsed() > kWaitTimeoutMs) {
+            return false;
+        }
+        QCoreApplication::processEvents(QEventLoop::WaitForMoreEvents, 50);
+    }
+    return true;
+}
+
+class Checker
+{
+public:
+    void expect(const QString &name, bool passed, const QString &detail = QString())
+    {
+        QTextStream(stdout) << (passed ? "PASS " : "FAIL ") << name
+                            << (detail.isEmpty() ? QString() : " (" + detail + ")") << "\n";
+        failures += passed ? 0 : 1;
+    }
+    int failures = 0;
+};
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+    QCoreApplication::setApplicationName("AI-ChatRoom-H2Check");
+    QCoreApplication::setApplicationVersion("1.0");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Check that the client AI scheduler multiplexes requests over one HTTP/2 (h2c) "
+                                     "connection to an in-process mock endpoint");
+    parser.addHelpOption();
+    parser.addVersionOption();
+    parser.process(a);
+
+    // 回复要慢到足以让几个房间的请求在同一条连接上重叠
+    MockAIServer::Options options;
+    options.tokens = 20;
+    options.firstTokenMs = 200;
+    options.intervalMs = 5;
+    MockAIServer mock(options);
+    if (!mock.listen(QHostAddress::LocalHost, 0)) {
+        QTextStream(stderr) << "Failed to listen: " << mock.errorString() << "\n";
+        return 1;
+    }
+
+    QTemporaryDir dir;
+    AIScheduler scheduler(QDir(dir.path()).filePath("ai_cache.bin"));
+    AIScheduler::Config config;
+    config.apiKey = "mock";
+    config.endpoint = QUrl(QString("http://127.0.0.1:%1/v1/chat/completions").arg(mock.serverPort()));
+    config.model = "mock-model";
+    config.maxConcurrent = kRooms;
+    config.h2c = true;
+    scheduler.setConfig(config);
+    // 不缓存，每个请求都要到模拟接口
+    scheduler.loadCache(0);
+
+    int finished = 0;
+    int ok = 0;
+    int http2Stats = 0;
+    int stats = 0;
+    QObject::connect(&scheduler, &AIScheduler::streamStats, &scheduler,
+                     [&](const QString &, const AIScheduler::Timing &timing) {
+                         ++stats;
+                         http2Stats += timing.http2 ? 1 : 0;
+                     });
+    QObject::connect(&scheduler, &AIScheduler::jobFinished, &scheduler,
+                     [&](const QString &room, bool success, const QString &text, bool, bool) {
+                         ++finished;
+                         ok += success ? 1 : 0;
+                         if (!success) {
+                             QTextStream(stderr) << room << ": " << text << "\n";
+                         }
+                     });
+
+    for (int i = 0; i < kRooms; ++i) {
+        scheduler.submit(QString("room%1").arg(i), "ask", QString("问题 %1").arg(i));
+    }
+
+    Checker check;
+    check.expect("all requests complete", waitFor([&]() { return finished == kRooms; }),
+                 QString("%1/%2 finished").arg(finished).arg(kRooms));
+    check.expect("all requests succeed", ok == kRooms, QString("%1/%2 ok").arg(ok).arg(kRooms));
+    check.expect("client reports HTTP/2", stats > 0 && http2Stats == stats,
+                 QString("%1/%2 stats over HTTP/2").arg(http2Stats).arg(stats));
+    check.expect("server saw HTTP/2 requests", mock.http2RequestCount() == kRooms,
+                 QString("%1/%2").arg(mock.http2RequestCount()).arg(kRooms));
+    check.expect("one connection reused", mock.connectionCount() == 1,
+                 QString("%1 connections").arg(mock.connectionCount()));
+    check.expect("requests multiplexed", mock.peakConcurrent() >= 2,
+                 QString("peak %1 concurrent streams").arg(mock.peakConcurrent()));
+
+    QTextStream(stdout) << (check.failures == 0 ? "all checks passed\n"
+                                                : QString("%1 checks failed\n").arg(check.failures));
+    return check.failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,43 @@
+#include "mockaiserver.h"
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QCommandLineOption>
+#include <QHostAddress>
+#include <QTextStream>
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+    QCoreApplication::setApplicationName("AI-ChatRoom-MockAI");
+    QCoreApplication::setApplicationVersion("1.0");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Local OpenAI-compatible chat completions server with SSE streaming");
+    parser.addHelpOption();
+    parser.addVersionOption();
+
+    QCommandLineOption portOption(QStringList() << "p" << "port", "Listen port", "port", "18080");
+    parser.addOption(portOption);
+    QCommandLineOption tokensOption("tokens", "Chunks per reply", "n", "200");
+    parser.addOption(tokensOption);
+    QCommandLineOption firstTokenOption("first-token-ms", "Delay before the first chunk", "ms", "500");
+    parser.addOption(firstTokenOption);
+    QCommandLineOption intervalOption("interval-ms", "Delay between chunks", "ms", "20");
+    parser.addOption(intervalOption);
+    parser.process(a);
+
+    MockAIServer::Options options;
+    options.tokens = qMax(1, parser.value(tokensOption).toInt());
+    options.firstTokenMs = qMax(0, parser.value(firstTokenOption).toInt());
+    options.intervalMs = qMax(0, parser.value(intervalOption).toInt());
+
+    MockAIServer server(options);
+    const quint16 port = quint16(parser.value(portOption).toUInt());
+    if (!server.listen(QHostAddress::LocalHost, port)) {
+        QTextStream(stderr) << "Failed to listen on port " << port << ": " << server.errorString() << "\n";
+        return 1;
+    }
+    QTextStream(stdout) << "Mock AI endpoint: http://127.0.0.1:" << port << "/v1/chat/completions\n";
+    return a.exec();
+}
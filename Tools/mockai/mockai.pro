@@ -0,0 +1,14 @@
+QT       += core network
+QT       -= gui
+
+CONFIG += c++17 console
+CONFIG -= app_bundle
+
+SOURCES += \
+    main.cpp \
+    mockaiserver.cpp
+
+HEADERS += \
+    mockaiserver.h
+
+TARGET=AI-ChatRoom-MockAI
@@ -0,0 +1,586 @@
+#include "mockaiserver.h"
+
+#include <QDateTime>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QPointer>
+#include <QTcpSocket>
+#include <QTimer>
+
+#include <functional>
+#include <memory>
+
+namespace {
+const QByteArray kHeaderEnd("\r\n\r\n");
+// 请求头和请求体的上限，超过直接断开
+constexpr qsizetype kMaxRequestBytes = 8 * 1024 * 1024;
+
+const char *const kPieces[] = {
+    "这是", "一段", "来自", "本地", "模拟", "服务器", "的", "流式", "回复", "，",
+    "用来", "测试", "首字", "延迟", "和", "吞吐", "。", "\n",
+};
+
+// HTTP/2（RFC 9113）只实现模拟接口用得到的部分：不解析请求头，按流收齐请求体后回复，
+// 发送方向遵守流量控制窗口
+const QByteArray kHttp2Preface("PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n");
+constexpr int kFrameHeaderBytes = 9;
+constexpr qint64 kDefaultWindow = 65535;
+constexpr int kDefaultMaxFrame = 16384;
+constexpr int kMaxConcurrentStreams = 100;
+
+enum FrameType : quint8 {
+    DataFrame = 0x0,
+    HeadersFrame = 0x1,
+    RstStreamFrame = 0x3,
+    SettingsFrame = 0x4,
+    PingFrame = 0x6,
+    WindowUpdateFrame = 0x8
+};
+
+constexpr quint8 kEndStream = 0x1;
+constexpr quint8 kAck = 0x1;
+constexpr quint8 kEndHeaders = 0x4;
+constexpr quint8 kPadded = 0x8;
+
+constexpr quint16 kSettingsMaxConcurrentStreams = 0x3;
+constexpr quint16 kSettingsInitialWindowSize = 0x4;
+constexpr quint16 kSettingsMaxFrameSize = 0x5;
+
+QByteArray statusLine(int code)
+{
+    const char *reason = code == 200 ? "OK" : code == 400 ? "Bad Request" : "Error";
+    return "HTTP/1.1 " + QByteArray::number(code) + " " + reason + "\r\n";
+}
+
+quint32 readUInt32(const char *p)
+{
+    return (quint32(quint8(p[0])) << 24) | (quint32(quint8(p[1])) << 16) | (quint32(quint8(p[2])) << 8)
+           | quint32(quint8(p[3]));
+}
+
+void appendUInt32(QByteArray &out, quint32 value)
+{
+    out.append(char(value >> 24)).append(char(value >> 16)).append(char(value >> 8)).append(char(value));
+}
+
+QByteArray frame(quint8 type, quint8 flags, quint32 stream, const QByteArray &payload = QByteArray())
+{
+    QByteArray out;
+    out.reserve(kFrameHeaderBytes + payload.size());
+    const quint32 length = quint32(payload.size());
+    out.append(char(length >> 16)).append(char(length >> 8)).append(char(length));
+    out.append(char(type)).append(char(flags));
+    appendUInt32(out, stream & 0x7FFFFFFF);
+    out.append(payload);
+    return out;
+}
+
+// HPACK 整数：前缀 prefixBits 位，放不下的部分按 7 位一组续写
+QByteArray hpackInteger(quint64 value, int prefixBits)
+{
+    const quint64 max = (quint64(1) << prefixBits) - 1;
+    QByteArray out;
+    if (value < max) {
+        out.append(char(value));
+        return out;
+    }
+    out.append(char(max));
+    value -= max;
+    while (value >= 0x80) {
+        out.append(char((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    out.append(char(value));
+    return out;
+}
+
+// 不加入动态表的字面量头字段，名字用静态表的编号，值不做哈夫曼编码
+QByteArray hpackField(int nameIndex, const QByteArray &value)
+{
+    return hpackInteger(quint64(nameIndex), 4) + hpackInteger(quint64(value.size()), 7) + value;
+}
+}
+
+// 回复写到哪里：HTTP/1.1 连接，或者 HTTP/2 连接上的一个流。结束后自行删除
+class ReplyChannel : public QObject
+{
+public:
+    using QObject::QObject;
+    // length 为 -1 表示长度未知（流式回复）
+    virtual void head(int status, const QByteArray &contentType, qint64 length) = 0;
+    virtual void write(const QByteArray &data) = 0;
+    virtual void end() = 0;
+};
+
+namespace {
+
+class Http1Channel : public ReplyChannel
+{
+public:
+    explicit Http1Channel(QTcpSocket *socket) : ReplyChannel(socket), socket(socket) {}
+
+    void head(int status, const QByteArray &contentType, qint64 length) override
+    {
+        QByteArray header = statusLine(status) + "Content-Type: " + contentType + "\r\n";
+        if (length >= 0) {
+            header += "Content-Length: " + QByteArray::number(length) + "\r\n";
+        } else {
+            header += "Cache-Control: no-cache\r\n";
+        }
+        socket->write(header + "Connection: close\r\n\r\n");
+    }
+    void write(const QByteArray &data) override { socket->write(data); }
+    void end() override
+    {
+        // 每个连接只处理一个请求，回复后关闭
+        socket->disconnectFromHost();
+        deleteLater();
+    }
+
+private:
+    QTcpSocket *socket;
+};
+
+class Http2Connection : public QObject
+{
+public:
+    using Handler = std::function<void(ReplyChannel *channel, const QByteArray &body)>;
+
+    Http2Connection(QTcpSocket *socket, const Handler &handler);
+    void feed(const QByteArray &data);
+    void sendHeaders(quint32 stream, int status, const QByteArray &contentType, qint64 length);
+    void sendData(quint32 stream, const QByteArray &data, bool end);
+
+private:
+    struct Stream {
+        QByteArray body;
+        QByteArray pending;     // 等发送窗口的数据
+        bool pendingEnd = false;
+        bool responding = false;
+        qint64 window = 0;
+    };
+
+    void handleFrame(quint8 type, quint8 flags, quint32 id, const QByteArray &payload);
+    void applySettings(const QByteArray &payload);
+    void dispatch(quint32 id);
+    void flush(quint32 id);
+    void flushAll();
+
+    QTcpSocket *socket;
+    Handler handler;
+    QByteArray buffer;
+    QHash<quint32, Stream> streams;
+    qint64 connectionWindow = kDefaultWindow;
+    qint64 initialWindow = kDefaultWindow;
+    int maxFrame = kDefaultMaxFrame;
+};
+
+class Http2Channel : public ReplyChannel
+{
+public:
+    Http2Channel(Http2Connection *connection, quint32 stream)
+        : ReplyChannel(connection), connection(connection), stream(stream) {}
+
+    void head(int status, const QByteArray &contentType, qint64 length) override
+    {
+        connection->sendHeaders(stream, status, contentType, length);
+    }
+    void write(const QByteArray &data) override { connection->sendData(stream, data, false); }
+    void end() override
+    {
+        connection->sendData(stream, QByteArray(), true);
+        deleteLater();
+    }
+
+private:
+    Http2Connection *connection;
+    quint32 stream;
+};
+
+Http2Connection::Http2Connection(QTcpSocket *socket, const Handler &handler)
+    : QObject(socket)
+    , socket(socket)
+    , handler(handler)
+{
+    // 服务器的第一帧必须是 SETTINGS
+    QByteArray settings;
+    settings.append(char(kSettingsMaxConcurrentStreams >> 8)).append(char(kSettingsMaxConcurrentStreams));
+    appendUInt32(settings, kMaxConcurrentStreams);
+    socket->write(frame(SettingsFrame, 0, 0, settings));
+}
+
+void Http2Connection::feed(const QByteArray &data)
+{
+    buffer.append(data);
+    qsizetype offset = 0;
+    while (buffer.size() - offset >= kFrameHeaderBytes) {
+        const char *p = buffer.constData() + offset;
+        const qsizetype length = (qsizetype(quint8(p[0])) << 16) | (qsizetype(quint8(p[1])) << 8) | quint8(p[2]);
+        if (length > kDefaultMaxFrame) {
+            // 没有通告过更大的帧，对方违反协议
+            socket->abort();
+            return;
+        }
+        if (buffer.size() - offset < kFrameHeaderBytes + length) {
+            break;
+        }
+        const quint8 type = quint8(p[3]);
+        const quint8 flags = quint8(p[4]);
+        const quint32 id = readUInt32(p + 5) & 0x7FFFFFFF;
+        const QByteArray payload = buffer.mid(offset + kFrameHeaderBytes, length);
+        offset += kFrameHeaderBytes + length;
+        handleFrame(type, flags, id, payload);
+        if (socket->state() != QAbstractSocket::ConnectedState) {
+            return;
+        }
+    }
+    buffer.remove(0, offset);
+}
+
+void Http2Connection::handleFrame(quint8 type, quint8 flags, quint32 id, const QByteArray &payload)
+{
+    switch (type) {
+    case SettingsFrame:
+        if (!(flags & kAck)) {
+            applySettings(payload);
+            socket->write(frame(SettingsFrame, kAck, 0));
+            flushAll();
+        }
+        break;
+    case PingFrame:
+        if (!(flags & kAck)) {
+            socket->write(frame(PingFrame, kAck, 0, payload));
+        }
+        break;
+    case WindowUpdateFrame:
+        if (payload.size() == 4) {
+            const qint64 increment = readUInt32(payload.constData()) & 0x7FFFFFFF;
+            if (id == 0) {
+                connectionWindow += increment;
+                flushAll();
+            } else if (streams.contains(id)) {
+                streams[id].window += increment;
+                flush(id);
+            }
+        }
+        break;
+    case HeadersFrame:
+        // 请求头（包括后续的 CONTINUATION）不需要解析，只建流
+        if (!streams.contains(id)) {
+            streams[id].window = initialWindow;
+        }
+        if (flags & kEndStream) {
+            dispatch(id);
+        }
+        break;
+    case DataFrame: {
+        QByteArray data = payload;
+        if ((flags & kPadded) && !data.isEmpty()) {
+            const int padding = quint8(data.at(0));
+            data = data.mid(1, qMax<qsizetype>(0, data.size() - 1 - padding));
+        }
+        // 读多少就把接收窗口还回去多少
+        if (!payload.isEmpty()) {
+            QByteArray increment;
+            appendUInt32(increment, quint32(payload.size()));
+            socket->write(frame(WindowUpdateFrame, 0, 0, increment));
+            if (!(flags & kEndStream)) {
+                socket->write(frame(WindowUpdateFrame, 0, id, increment));
+            }
+        }
+        auto it = streams.find(id);
+        if (it == streams.end()) {
+            break;
+        }
+        it->body.append(data);
+        if (it->body.size() > kMaxRequestBytes) {
+            socket->abort();
+            return;
+        }
+        if (flags & kEndStream) {
+            dispatch(id);
+        }
+        break;
+    }
+    case RstStreamFrame:
+        // 客户端取消了请求，之后写到这个流的数据直接丢弃
+        streams.remove(id);
+        break;
+    default:
+        break;
+    }
+}
+
+void Http2Connection::applySettings(const QByteArray &payload)
+{
+    for (qsizetype i = 0; i + 6 <= payload.size(); i += 6) {
+        const quint16 key = quint16((quint8(payload.at(i)) << 8) | quint8(payload.at(i + 1)));
+        const quint32 value = readUInt32(payload.constData() + i + 2);
+        if (key == kSettingsInitialWindowSize) {
+            // 新的初始窗口对已经打开的流同样生效
+            const qint64 delta = qint64(value) - initialWindow;
+            for (Stream &stream : streams) {
+                stream.window += delta;
+            }
+            initialWindow = value;
+        } else if (key == kSettingsMaxFrameSize) {
+            maxFrame = int(qBound<quint32>(kDefaultMaxFrame, value, 16777215));
+        }
+    }
+}
+
+void Http2Connection::dispatch(quint32 id)
+{
+    Stream &stream = streams[id];
+    if (stream.responding) {
+        return;
+    }
+    stream.responding = true;
+    handler(new Http2Channel(this, id), stream.body);
+}
+
+void Http2Connection::sendHeaders(quint32 id, int status, const QByteArray &contentType, qint64 length)
+{
+    if (!streams.contains(id)) {
+        return;
+    }
+    // 静态表：8 = :status，28 = content-length，31 = content-type
+    QByteArray block = hpackField(8, QByteArray::number(status)) + hpackField(31, contentType);
+    if (length >= 0) {
+        block += hpackField(28, QByteArray::number(length));
+    }
+    socket->write(frame(HeadersFrame, kEndHeaders, id, block));
+}
+
+void Http2Connection::sendData(quint32 id, const QByteArray &data, bool end)
+{
+    auto it = streams.find(id);
+    if (it == streams.end()) {
+        return;
+    }
+    it->pending.append(data);
+    it->pendingEnd = it->pendingEnd || end;
+    flush(id);
+}
+
+void Http2Connection::flush(quint32 id)
+{
+    auto it = streams.find(id);
+    if (it == streams.end()) {
+        return;
+    }
+    bool endSent = false;
+    while (!it->pending.isEmpty()) {
+        const qint64 allowed = qMin(qMin(connectionWindow, it->window), qMin(qint64(maxFrame), qint64(it->pending.size())));
+        if (allowed <= 0) {
+            return;
+        }
+        const bool last = it->pendingEnd && allowed == it->pending.size();
+        socket->write(frame(DataFrame, last ? kEndStream : 0, id, it->pending.left(allowed)));
+        it->pending.remove(0, allowed);
+        it->window -= allowed;
+        connectionWindow -= allowed;
+        endSent = last;
+    }
+    if (it->pendingEnd) {
+        if (!endSent) {
+            socket->write(frame(DataFrame, kEndStream, id));
+        }
+        streams.erase(it);
+    }
+}
+
+void Http2Connection::flushAll()
+{
+    const QList<quint32> ids = streams.keys();
+    for (quint32 id : ids) {
+        flush(id);
+    }
+}
+
+} // namespace
+
+MockAIServer::MockAIServer(const Options &options, QObject *parent)
+    : QTcpServer(parent)
+    , options(options)
+{
+}
+
+void MockAIServer::incomingConnection(qintptr handle)
+{
+    ++connections;
+    auto *socket = new QTcpSocket(this);
+    socket->setSocketDescriptor(handle);
+    buffers.insert(socket, QByteArray());
+    connect(socket, &QTcpSocket::readyRead, this, [this, socket]() { onReadyRead(socket); });
+    connect(socket, &QTcpSocket::disconnected, this, [this, socket]() {
+        buffers.remove(socket);
+        socket->deleteLater();
+    });
+}
+
+void MockAIServer::onReadyRead(QTcpSocket *socket)
+{
+    if (!buffers.contains(socket)) {
+        return;
+    }
+    QByteArray &buffer = buffers[socket];
+    buffer.append(socket->readAll());
+    if (buffer.size() > kMaxRequestBytes) {
+        socket->abort();
+        return;
+    }
+
+    // 以 HTTP/2 连接前言开头的连接改由 Http2Connection 处理，之后不再经过这里
+    if (buffer.size() < kHttp2Preface.size() && kHttp2Preface.startsWith(buffer)) {
+        return;
+    }
+    if (buffer.startsWith(kHttp2Preface)) {
+        const QByteArray rest = buffer.mid(kHttp2Preface.size());
+        buffers.remove(socket);
+        auto *connection = new Http2Connection(socket, [this](ReplyChannel *channel, const QByteArray &body) {
+            ++http2Requests;
+            respond(channel, body);
+        });
+        disconnect(socket, &QTcpSocket::readyRead, this, nullptr);
+        connect(socket, &QTcpSocket::readyRead, connection, [socket, connection]() { connection->feed(socket->readAll()); });
+        connection->feed(rest);
+        return;
+    }
+
+    const qsizetype headerEnd = buffer.indexOf(kHeaderEnd);
+    if (headerEnd < 0) {
+        return;
+    }
+    qsizetype contentLength = 0;
+    const QList<QByteArray> lines = buffer.left(headerEnd).split('\n');
+    for (const QByteArray &line : lines) {
+        const qsizetype colon = line.indexOf(':');
+        if (colon > 0 && line.left(colon).trimmed().toLower() == "content-length") {
+            contentLength = line.mid(colon + 1).trimmed().toLongLong();
+        }
+    }
+    const qsizetype bodyStart = headerEnd + kHeaderEnd.size();
+    if (buffer.size() - bodyStart < contentLength) {
+        return;
+    }
+
+    const QByteArray body = buffer.mid(bodyStart, contentLength);
+    buffers.remove(socket);
+    respond(new Http1Channel(socket), body);
+}
+
+void MockAIServer::respond(ReplyChannel *channel, const QByteArray &body)
+{
+    ++requests;
+    responding.insert(channel);
+    peak = qMax(peak, int(responding.size()));
+    connect(channel, &QObject::destroyed, this, [this, channel]() { responding.remove(channel); });
+
+    QJsonParseError error{};
+    const QJsonObject request = QJsonDocument::fromJson(body, &error).object();
+    if (error.error != QJsonParseError::NoError) {
+        const QByteArray payload = R"({"error":{"message":"invalid JSON body"}})";
+        channel->head(400, "application/json", payload.size());
+        channel->write(payload);
+        channel->end();
+        return;
+    }
+    const QString model = request.value("model").toString("mock");
+    if (request.value("stream").toBool()) {
+        streamReply(channel, model);
+    } else {
+        fullReply(channel, model);
+    }
+}
+
+void MockAIServer::streamReply(ReplyChannel *channel, const QString &model)
+{
+    channel->head(200, "text/event-stream", -1);
+
+    const QString id = QString("mock-%1").arg(nextId++);
+    const qint64 created = QDateTime::currentSecsSinceEpoch();
+    auto *timer = new QTimer(channel);
+    auto sent = std::make_shared<int>(0);
+    QPointer<ReplyChannel> guard(channel);
+
+    connect(timer, &QTimer::timeout, channel, [this, guard, timer, sent, id, created, model]() {
+        if (!guard) {
+            return;
+        }
+        QJsonObject chunk;
+        chunk["id"] = id;
+        chunk["object"] = "chat.completion.chunk";
+        chunk["created"] = created;
+        chunk["model"] = model;
+        QJsonObject choice;
+        choice["index"] = 0;
+        if (*sent < options.tokens) {
+            QJsonObject delta;
+            delta["content"] = piece((*sent)++);
+            choice["delta"] = delta;
+            choice["finish_reason"] = QJsonValue::Null;
+        } else {
+            choice["delta"] = QJsonObject();
+            choice["finish_reason"] = "stop";
+            QJsonObject usage;
+            usage["completion_tokens"] = options.tokens;
+            chunk["usage"] = usage;
+        }
+        chunk["choices"] = QJsonArray{choice};
+        guard->write("data: " + QJsonDocument(chunk).toJson(QJsonDocument::Compact) + "\n\n");
+
+        if (choice.value("finish_reason").isString()) {
+            timer->stop();
+            guard->write("data: [DONE]\n\n");
+            guard->end();
+        } else {
+            timer->start(options.intervalMs);
+        }
+    });
+    timer->setSingleShot(true);
+    timer->start(options.firstTokenMs);
+}
+
+void MockAIServer::fullReply(ReplyChannel *channel, const QString &model)
+{
+    QPointer<ReplyChannel> guard(channel);
+    const QString id = QString("mock-%1").arg(nextId++);
+    QTimer::singleShot(options.firstTokenMs + options.tokens * options.intervalMs, channel, [this, guard, id, model]() {
+        if (!guard) {
+            return;
+        }
+        QString content;
+        for (int i = 0; i < options.tokens; ++i) {
+            content += piece(i);
+        }
+        QJsonObject message;
+        message["role"] = "assistant";
+        message["content"] = content;
+        QJsonObject choice;
+        choice["index"] = 0;
+        choice["message"] = message;
+        choice["finish_reason"] = "stop";
+        QJsonObject usage;
+        usage["completion_tokens"] = options.tokens;
+        QJsonObject reply;
+        reply["id"] = id;
+        reply["object"] = "chat.completion";
+        reply["created"] = QDateTime::currentSecsSinceEpoch();
+        reply["model"] = model;
+        reply["choices"] = QJsonArray{choice};
+        reply["usage"] = usage;
+
+        const QByteArray payload = QJsonDocument(reply).toJson(QJsonDocument::Compact);
+        guard->head(200, "application/json", payload.size());
+        guard->write(payload);
+        guard->end();
+    });
+}
+
+QString MockAIServer::piece(int index)
+{
+    constexpr int count = int(sizeof(kPieces) / sizeof(kPieces[0]));
+    return QString::fromUtf8(kPieces[index % count]);
+}
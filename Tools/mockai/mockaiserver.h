@@ -0,0 +1,54 @@
+#ifndef MOCKAISERVER_H
+#define MOCKAISERVER_H
+
+#include <QTcpServer>
+#include <QHash>
+#include <QSet>
+
+class QTcpSocket;
+class ReplyChannel;
+
+// 本地模拟的 OpenAI 兼容 /v1/chat/completions 接口。
+// 请求带 "stream": true 时按 SSE 逐个分片返回，否则等同样的时间后一次性返回，
+// 用来在没有真实密钥和网络的情况下调试客户端流式显示和服务器 AI 网关。
+// 同一端口也接受明文 HTTP/2（h2c，客户端直接发 HTTP/2 连接前言），一条连接上可以并发多个请求。
+class MockAIServer : public QTcpServer
+{
+    Q_OBJECT
+public:
+    struct Options {
+        int tokens = 200;          // 每个回复的分片数
+        int firstTokenMs = 500;    // 首个分片前的延迟
+        int intervalMs = 20;       // 分片间隔
+    };
+
+    explicit MockAIServer(const Options &options, QObject *parent = nullptr);
+
+    // 收到的请求数和同时在处理的最大请求数，供 Tools/gatewaycheck 校验合并与并发上限
+    int requestCount() const { return requests; }
+    int peakConcurrent() const { return peak; }
+    // 接受的 TCP 连接数和其中走 HTTP/2 的请求数，供 Tools/h2check 校验连接复用
+    int connectionCount() const { return connections; }
+    int http2RequestCount() const { return http2Requests; }
+
+protected:
+    void incomingConnection(qintptr handle) override;
+
+private:
+    void onReadyRead(QTcpSocket *socket);
+    void respond(ReplyChannel *channel, const QByteArray &body);
+    void streamReply(ReplyChannel *channel, const QString &model);
+    void fullReply(ReplyChannel *channel, const QString &model);
+    static QString piece(int index);
+
+    Options options;
+    QHash<QTcpSocket *, QByteArray> buffers;   // 还在等 HTTP/1.1 请求的连接
+    QSet<QObject *> responding;
+    quint64 nextId = 1;
+    int requests = 0;
+    int peak = 0;
+    int connections = 0;
+    int http2Requests = 0;
+};
+
+#endif // MOCKAISERVER_H
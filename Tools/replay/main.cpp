@@ -0,0 +1,53 @@
+#include "replayer.h"
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QCommandLineOption>
+#include <QTextStream>
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+    QCoreApplication::setApplicationName("AI-ChatRoom-Replay");
+    QCoreApplication::setApplicationVersion("1.0");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Replay a server traffic capture and report latency and throughput");
+    parser.addHelpOption();
+    parser.addVersionOption();
+    parser.addPositionalArgument("capture", "Capture file written by the server (--capture or admin 'capture start')");
+
+    QCommandLineOption hostOption("host", "Server address", "host", "127.0.0.1");
+    parser.addOption(hostOption);
+    QCommandLineOption portOption(QStringList() << "p" << "port", "Server port", "port", "12345");
+    parser.addOption(portOption);
+    QCommandLineOption speedOption("speed", "Time scale, e.g. 1, 10 or 100", "factor", "1");
+    parser.addOption(speedOption);
+    QCommandLineOption drainOption("drain-ms", "Time to wait for replies after the last frame", "ms", "2000");
+    parser.addOption(drainOption);
+    parser.process(a);
+
+    if (parser.positionalArguments().size() != 1) {
+        parser.showHelp(1);
+    }
+
+    Replayer::Options options;
+    options.host = parser.value(hostOption);
+    options.port = quint16(parser.value(portOption).toUInt());
+    options.speed = parser.value(speedOption).toDouble();
+    options.drainMs = parser.value(drainOption).toInt();
+    if (options.speed <= 0) {
+        QTextStream(stderr) << "Invalid speed.\n";
+        return 1;
+    }
+
+    Replayer replayer(options);
+    QString error;
+    if (!replayer.load(parser.positionalArguments().first(), &error)) {
+        QTextStream(stderr) << "Failed to load capture: " << error << "\n";
+        return 1;
+    }
+    QObject::connect(&replayer, &Replayer::finished, &a, &QCoreApplication::quit);
+    replayer.start();
+    return a.exec();
+}
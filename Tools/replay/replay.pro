@@ -0,0 +1,16 @@
+QT       += core network
+QT       -= gui
+
+CONFIG += c++17 console
+CONFIG -= app_bundle
+
+SOURCES += \
+    main.cpp \
+    replayer.cpp
+
+HEADERS += \
+    replayer.h
+
+include(../../Common/common.pri)
+
+TARGET=AI-ChatRoom-Replay
@@ -0,0 +1,211 @@
+#include "replayer.h"
+
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTextStream>
+#include <QTimer>
+
+#include <algorithm>
+
+namespace {
+const QByteArray kClientIdKey("\"client_id\":\"");
+const QByteArray kLoginReply("\"type\":\"login_");
+
+double percentileMs(QList<qint64> samples, double p)
+{
+    if (samples.isEmpty()) {
+        return 0.0;
+    }
+    std::sort(samples.begin(), samples.end());
+    const int index = qBound(0, int(p * (samples.size() - 1) + 0.5), int(samples.size()) - 1);
+    return samples.at(index) / 1e6;
+}
+
+QString latencyLine(const char *label, const QList<qint64> &samples)
+{
+    return QString("%1: n=%2 p50=%3ms p90=%4ms p99=%5ms max=%6ms\n")
+        .arg(label).arg(samples.size())
+        .arg(percentileMs(samples, 0.50), 0, 'f', 2)
+        .arg(percentileMs(samples, 0.90), 0, 'f', 2)
+        .arg(percentileMs(samples, 0.99), 0, 'f', 2)
+        .arg(percentileMs(samples, 1.0), 0, 'f', 2);
+}
+}
+
+Replayer::Replayer(const Options &options, QObject *parent)
+    : QObject(parent)
+    , options(options)
+    , timer(new QTimer(this))
+{
+    timer->setSingleShot(true);
+    timer->setTimerType(Qt::PreciseTimer);
+    connect(timer, &QTimer::timeout, this, &Replayer::pump);
+}
+
+bool Replayer::load(const QString &path, QString *error)
+{
+    Capture::Reader reader;
+    if (!reader.open(path)) {
+        *error = reader.errorString();
+        return false;
+    }
+    Step step;
+    while (reader.next(&step.event)) {
+        step.clientId.clear();
+        step.login = false;
+        if (step.event.type == Capture::Frame) {
+            // 回放前解析好，发送时不再占用时间
+            const QJsonObject obj = QJsonDocument::fromJson(step.event.payload).object();
+            const QString type = obj.value("type").toString();
+            step.login = type == "login";
+            if (type == "chat") {
+                step.clientId = obj.value("client_id").toString().toUtf8();
+            }
+        }
+        steps.append(step);
+    }
+    if (!reader.errorString().isEmpty()) {
+        QTextStream(stderr) << "Stopped reading capture: " << reader.errorString() << "\n";
+    }
+    if (steps.isEmpty()) {
+        *error = "capture is empty";
+        return false;
+    }
+    // 从第一条事件开始计时
+    const qint64 origin = steps.first().event.timeUs;
+    for (Step &s : steps) {
+        s.event.timeUs -= origin;
+    }
+    return true;
+}
+
+void Replayer::start()
+{
+    clock.start();
+    pump();
+}
+
+void Replayer::pump()
+{
+    const qint64 now = clock.nsecsElapsed();
+    while (nextStep < steps.size()) {
+        const Step &step = steps.at(nextStep);
+        const qint64 due = qint64(double(step.event.timeUs) * 1000.0 / options.speed);
+        if (due > now) {
+            timer->start(int((due - now) / 1000000));
+            return;
+        }
+        scheduleLagNs.append(now - due);
+        send(step);
+        ++nextStep;
+    }
+    lastSendNs = clock.nsecsElapsed();
+    QTimer::singleShot(options.drainMs, this, &Replayer::finish);
+}
+
+void Replayer::send(const Step &step)
+{
+    const quint64 id = step.event.connection;
+    Connection *conn = connections.value(id);
+
+    if (step.event.type == Capture::Disconnect) {
+        if (conn && conn->socket) {
+            conn->socket->disconnectFromHost();
+        }
+        return;
+    }
+    if (!conn) {
+        // 抓包开始前就已建立的连接没有 Connect 事件，第一帧时补建
+        conn = new Connection;
+        conn->socket = new QTcpSocket(this);
+        connect(conn->socket, &QTcpSocket::readyRead, this, [this, id]() { onReadyRead(id); });
+        connect(conn->socket, &QTcpSocket::errorOccurred, this, [this](QAbstractSocket::SocketError error) {
+            if (error != QAbstractSocket::RemoteHostClosedError) {
+                ++socketErrors;
+            }
+        });
+        conn->socket->connectToHost(options.host, options.port);
+        connections.insert(id, conn);
+    }
+    if (step.event.type != Capture::Frame) {
+        return;
+    }
+
+    // 连接尚未建立时 QTcpSocket 会先缓存，延迟中包含建连时间
+    const qint64 now = clock.nsecsElapsed();
+    conn->socket->write(step.event.payload + '\n');
+    ++framesSent;
+    bytesSent += step.event.payload.size() + 1;
+    if (!step.clientId.isEmpty()) {
+        conn->pendingChats.insert(step.clientId, now);
+    } else if (step.login) {
+        conn->pendingLogins.append(now);
+    }
+}
+
+void Replayer::onReadyRead(quint64 id)
+{
+    Connection *conn = connections.value(id);
+    if (!conn) {
+        return;
+    }
+    const QByteArray data = conn->socket->readAll();
+    const qint64 now = clock.nsecsElapsed();
+    bytesReceived += data.size();
+    conn->scanner.append(data);
+
+    QByteArray line;
+    bool valid = false;
+    while (conn->scanner.next(&line, &valid)) {
+        ++framesReceived;
+        // 服务器输出的是紧凑 JSON，按子串匹配即可，不用完整解析
+        const int keyAt = line.indexOf(kClientIdKey);
+        if (keyAt >= 0) {
+            const int begin = keyAt + kClientIdKey.size();
+            const int end = line.indexOf('"', begin);
+            auto it = conn->pendingChats.find(line.mid(begin, end - begin));
+            if (end > begin && it != conn->pendingChats.end()) {
+                chatLatencyNs.append(now - it.value());
+                conn->pendingChats.erase(it);
+            }
+        } else if (!conn->pendingLogins.isEmpty() && line.contains(kLoginReply)) {
+            loginLatencyNs.append(now - conn->pendingLogins.takeFirst());
+        }
+    }
+}
+
+void Replayer::finish()
+{
+    QTextStream(stdout) << report();
+    for (Connection *conn : std::as_const(connections)) {
+        conn->socket->abort();
+        delete conn;
+    }
+    connections.clear();
+    emit finished();
+}
+
+QString Replayer::report() const
+{
+    qint64 unanswered = 0;
+    for (const Connection *conn : connections) {
+        unanswered += conn->pendingChats.size() + conn->pendingLogins.size();
+    }
+    const double seconds = qMax<qint64>(1, lastSendNs) / 1e9;
+    const double captured = steps.last().event.timeUs / 1e6;
+
+    QString out;
+    QTextStream stream(&out);
+    stream << QString("replayed %1 s of traffic in %2 s (speed %3x), %4 connections\n")
+                  .arg(captured, 0, 'f', 1).arg(seconds, 0, 'f', 1).arg(options.speed).arg(connections.size());
+    stream << QString("sent %1 frames (%2/s), %3 bytes (%4 MB/s)\n")
+                  .arg(framesSent).arg(framesSent / seconds, 0, 'f', 0)
+                  .arg(bytesSent).arg(bytesSent / seconds / 1e6, 0, 'f', 2);
+    stream << QString("received %1 frames, %2 bytes; %3 requests unanswered, %4 socket errors\n")
+                  .arg(framesReceived).arg(bytesReceived).arg(unanswered).arg(socketErrors);
+    stream << latencyLine("chat latency", chatLatencyNs);
+    stream << latencyLine("login latency", loginLatencyNs);
+    // 发送落后计划太多说明回放端本身跟不上，结果不可信
+    stream << latencyLine("schedule lag", scheduleLagNs);
+    return out;
+}
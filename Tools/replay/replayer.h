@@ -0,0 +1,73 @@
+#ifndef REPLAYER_H
+#define REPLAYER_H
+
+#include <QObject>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QList>
+#include <QTcpSocket>
+
+#include "capturefile.h"
+#include "framescanner.h"
+
+class QTimer;
+
+// 按抓包里的时间间隔（可加速）重新发送每个连接的帧，统计服务器的延迟与吞吐。
+// 聊天延迟按 client_id 匹配：发出时间到收到服务器广播回本连接的同一条消息。
+class Replayer : public QObject
+{
+    Q_OBJECT
+public:
+    struct Options {
+        QString host = "127.0.0.1";
+        quint16 port = 12345;
+        double speed = 1.0;
+        int drainMs = 2000;   // 最后一帧发出后等待回包的时间
+    };
+
+    Replayer(const Options &options, QObject *parent = nullptr);
+
+    bool load(const QString &path, QString *error);
+    void start();
+
+signals:
+    void finished();
+
+private:
+    struct Step {
+        Capture::Event event;
+        QByteArray clientId;  // 聊天帧的 client_id，用于匹配回包
+        bool login = false;
+    };
+    struct Connection {
+        QTcpSocket *socket = nullptr;
+        FrameScanner scanner;
+        QHash<QByteArray, qint64> pendingChats;  // client_id -> 发送时刻（ns）
+        QList<qint64> pendingLogins;
+    };
+
+    void pump();
+    void send(const Step &step);
+    void onReadyRead(quint64 id);
+    void finish();
+    QString report() const;
+
+    Options options;
+    QList<Step> steps;
+    int nextStep = 0;
+    QHash<quint64, Connection *> connections;
+    QElapsedTimer clock;
+    QTimer *timer;
+
+    qint64 framesSent = 0;
+    qint64 bytesSent = 0;
+    qint64 framesReceived = 0;
+    qint64 bytesReceived = 0;
+    qint64 socketErrors = 0;
+    qint64 lastSendNs = 0;
+    QList<qint64> chatLatencyNs;
+    QList<qint64> loginLatencyNs;
+    QList<qint64> scheduleLagNs;   // 实际发送时刻落后计划的时间
+};
+
+#endif // REPLAYER_H
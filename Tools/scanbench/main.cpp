@@ -0,0 +1,161 @@
+#include "framescanner.h"
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QCommandLineOption>
+#include <QElapsedTimer>
+#include <QProcess>
+#include <QProcessEnvironment>
+#include <QRandomGenerator>
+#include <QTextStream>
+
+namespace {
+const char kLatin[] = "abcdefghijklmnopqrstuvwxyz";
+constexpr char32_t kCjkFirst = 0x4E00;
+constexpr char32_t kCjkCount = 0x9FA5 - 0x4E00;
+// 测试数据的大小，反复扫描直到达到 --mb
+constexpr qsizetype kCorpusBytes = 8 * 1024 * 1024;
+
+// 一条 chat 帧：正文里 cjkRatio 比例的字符是汉字，其余是英文字母和空格
+QByteArray generateFrame(QRandomGenerator &rng, int averageBytes, double cjkRatio)
+{
+    QString text;
+    const int target = rng.bounded(averageBytes / 2, averageBytes * 3 / 2 + 1);
+    qsizetype bytes = 0;
+    while (bytes < target) {
+        if (rng.generateDouble() < cjkRatio) {
+            const char32_t ch = kCjkFirst + char32_t(rng.bounded(int(kCjkCount)));
+            text.append(QString::fromUcs4(&ch, 1));
+            bytes += 3;
+        } else {
+            text.append(rng.bounded(6) == 0 ? QLatin1Char(' ') : QLatin1Char(kLatin[rng.bounded(26)]));
+            bytes += 1;
+        }
+    }
+    return "{\"client_id\":\"c-0123456789abcdef\",\"message\":\"" + text.toUtf8()
+           + "\",\"room\":\"大厅\",\"type\":\"chat\"}\n";
+}
+
+struct Result {
+    qint64 ns = 0;
+    qint64 bytes = 0;
+    qint64 frames = 0;
+    qint64 invalid = 0;
+};
+
+// 按 socket 一次读到的大小分块追加，每块之后取走所有完整的帧，和服务器的用法一致
+Result measure(const QByteArray &corpus, qsizetype chunk, qint64 volume)
+{
+    Result result;
+    FrameScanner scanner;
+    QByteArray frame;
+    bool valid = false;
+    QElapsedTimer timer;
+    timer.start();
+    while (result.bytes < volume) {
+        for (qsizetype offset = 0; offset < corpus.size(); offset += chunk) {
+            scanner.append(corpus.mid(offset, chunk));
+            while (scanner.next(&frame, &valid)) {
+                ++result.frames;
+                result.invalid += valid ? 0 : 1;
+            }
+        }
+        result.bytes += corpus.size();
+    }
+    result.ns = timer.nsecsElapsed();
+    return result;
+}
+
+int runChild(const QCommandLineParser &parser, const QCommandLineOption &kernelOption, const QCommandLineOption &cjkOption,
+             const QCommandLineOption &lengthOption, const QCommandLineOption &chunkOption,
+             const QCommandLineOption &volumeOption, const QCommandLineOption &seedOption)
+{
+    QTextStream out(stdout);
+    if (parser.value(kernelOption) != FrameScanner::kernelName()) {
+        QTextStream(stderr) << parser.value(kernelOption) << " is not available here (set AICHAT_SIMD to choose a lower one)\n";
+    }
+    const int length = qMax(16, parser.value(lengthOption).toInt());
+    const qsizetype chunk = qMax(1, parser.value(chunkOption).toInt());
+    const qint64 volume = qMax<qint64>(1, parser.value(volumeOption).toLongLong()) * 1024 * 1024;
+
+    int failures = 0;
+    for (const QString &field : parser.value(cjkOption).split(',', Qt::SkipEmptyParts)) {
+        const double ratio = qBound(0.0, field.trimmed().toDouble(), 1.0);
+        QRandomGenerator rng(parser.value(seedOption).toUInt());
+        QByteArray corpus;
+        corpus.reserve(kCorpusBytes + 4 * length);
+        qint64 frames = 0;
+        while (corpus.size() < kCorpusBytes) {
+            corpus.append(generateFrame(rng, length, ratio));
+            ++frames;
+        }
+
+        measure(corpus, chunk, corpus.size());    // 预热，不计入结果
+        const Result result = measure(corpus, chunk, volume);
+        const double seconds = qMax<qint64>(1, result.ns) / 1e9;
+        out << QString("%1 cjk=%2: %3 MB/s, %4 frames/s\n")
+                   .arg(FrameScanner::kernelName(), -6)
+                   .arg(ratio, 0, 'f', 2)
+                   .arg(result.bytes / seconds / (1024 * 1024), 0, 'f', 0)
+                   .arg(result.frames / seconds, 0, 'f', 0);
+        // 数据全是合法 UTF-8，任何一帧判为非法都说明扫描有错
+        if (result.invalid > 0 || result.frames != frames * (result.bytes / corpus.size())) {
+            QTextStream(stderr) << "Scan error: " << result.invalid << " invalid frames, "
+                                << result.frames << " frames scanned\n";
+            ++failures;
+        }
+    }
+    return failures > 0 ? 1 : 0;
+}
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+    QCoreApplication::setApplicationName("AI-ChatRoom-ScanBench");
+    QCoreApplication::setApplicationVersion("1.0");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Measure frame splitting and UTF-8 validation throughput on mixed ASCII/CJK chat traffic");
+    parser.addHelpOption();
+    parser.addVersionOption();
+
+    QCommandLineOption cjkOption("cjk", "Comma-separated fractions of CJK characters in message bodies", "list", "0,0.3,0.7,1");
+    parser.addOption(cjkOption);
+    QCommandLineOption lengthOption("length", "Average message body size in bytes", "bytes", "200");
+    parser.addOption(lengthOption);
+    QCommandLineOption chunkOption("chunk", "Bytes appended per socket read", "bytes", "4096");
+    parser.addOption(chunkOption);
+    QCommandLineOption volumeOption("mb", "Bytes scanned per ratio and kernel, in MB", "n", "256");
+    parser.addOption(volumeOption);
+    QCommandLineOption seedOption("seed", "Random seed for synthetic messages", "n", "1");
+    parser.addOption(seedOption);
+    QCommandLineOption kernelOption("kernel", "Only measure the kernel selected for this process (avx2, ssse3 or scalar)", "name");
+    parser.addOption(kernelOption);
+    parser.process(a);
+
+    if (parser.isSet(kernelOption)) {
+        return runChild(parser, kernelOption, cjkOption, lengthOption, chunkOption, volumeOption, seedOption);
+    }
+
+    // 扫描实现在进程启动时按 AICHAT_SIMD 选定，每种实现各起一个子进程测
+    int failures = 0;
+    const QStringList kernels = {"avx2", "ssse3", "scalar"};
+    for (const QString &kernel : kernels) {
+        QProcessEnvironment environment = QProcessEnvironment::systemEnvironment();
+        if (kernel == "avx2") {
+            environment.remove("AICHAT_SIMD");
+        } else {
+            environment.insert("AICHAT_SIMD", kernel);
+        }
+        QProcess process;
+        process.setProcessChannelMode(QProcess::ForwardedChannels);
+        process.setProcessEnvironment(environment);
+        process.start(QCoreApplication::applicationFilePath(),
+                      QCoreApplication::arguments().mid(1) << "--kernel" << kernel);
+        if (!process.waitForFinished(-1) || process.exitStatus() != QProcess::NormalExit || process.exitCode() != 0) {
+            ++failures;
+        }
+    }
+    return failures > 0 ? 1 : 0;
+}
@@ -0,0 +1,13 @@
+QT       += core
+QT       -= gui
+
+CONFIG += c++17 console
+CONFIG -= app_bundle
+
+SOURCES += \
+    main.cpp
+
+# 直接编译共用的分帧代码，测的就是线上用的实现
+include(../../Common/common.pri)
+
+TARGET=AI-ChatRoom-ScanBench
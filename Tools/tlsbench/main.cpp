@@ -0,0 +1,201 @@
+#include "tlsacceptor.h"
+#include "tlsticket.h"
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QCommandLineOption>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QHostAddress>
+#include <QSslPreSharedKeyAuthenticator>
+#include <QSslSocket>
+#include <QTcpServer>
+#include <QTextStream>
+#include <QTimer>
+
+#include <algorithm>
+
+namespace {
+constexpr int kHandshakeTimeoutMs = 10000;
+
+// 进程内的回环服务器，握手交给服务器的 TlsAcceptor
+class LoopbackServer : public QTcpServer
+{
+public:
+    explicit LoopbackServer(TlsAcceptor *acceptor) : acceptor(acceptor) {}
+
+protected:
+    void incomingConnection(qintptr handle) override
+    {
+        if (QSslSocket *socket = acceptor->accept(handle, this)) {
+            QObject::connect(socket, &QSslSocket::disconnected, socket, &QObject::deleteLater);
+        }
+    }
+
+private:
+    TlsAcceptor *acceptor;
+};
+
+struct Sample {
+    qint64 ns = -1;      // 从发起连接到握手完成，失败为 -1
+    QString cipher;
+    QString error;
+};
+
+Sample handshake(quint16 port, const QSslConfiguration &configuration, const TlsTicket &ticket)
+{
+    QSslSocket socket;
+    socket.setSslConfiguration(configuration);
+    // 证书照常校验，只是不因自签名或主机名不符而中止，校验开销计入完整握手
+    QObject::connect(&socket, &QSslSocket::sslErrors, &socket, [&socket]() { socket.ignoreSslErrors(); });
+    QObject::connect(&socket, &QSslSocket::preSharedKeyAuthenticationRequired, &socket,
+                     [&ticket](QSslPreSharedKeyAuthenticator *authenticator) { ticket.answer(authenticator); });
+    QEventLoop loop;
+    QObject::connect(&socket, &QSslSocket::encrypted, &loop, &QEventLoop::quit);
+    QObject::connect(&socket, &QSslSocket::errorOccurred, &loop, &QEventLoop::quit);
+    QTimer::singleShot(kHandshakeTimeoutMs, &loop, &QEventLoop::quit);
+
+    QElapsedTimer timer;
+    timer.start();
+    socket.connectToHostEncrypted(QHostAddress(QHostAddress::LocalHost).toString(), port);
+    loop.exec();
+
+    Sample sample;
+    if (socket.isEncrypted()) {
+        sample.ns = timer.nsecsElapsed();
+        sample.cipher = socket.sessionCipher().name();
+        socket.disconnectFromHost();
+    } else {
+        sample.error = socket.errorString();
+    }
+    return sample;
+}
+
+double percentileMs(QList<qint64> samples, double p)
+{
+    if (samples.isEmpty()) {
+        return 0.0;
+    }
+    std::sort(samples.begin(), samples.end());
+    const int index = qBound(0, int(p * (samples.size() - 1) + 0.5), int(samples.size()) - 1);
+    return samples.at(index) / 1e6;
+}
+
+QString latencyLine(const char *label, const QList<qint64> &samples, const QString &cipher)
+{
+    qint64 total = 0;
+    for (qint64 ns : samples) {
+        total += ns;
+    }
+    return QString("%1: n=%2 p50=%3ms p90=%4ms p99=%5ms max=%6ms, %7 handshakes/s (%8)\n")
+        .arg(label).arg(samples.size())
+        .arg(percentileMs(samples, 0.50), 0, 'f', 3)
+        .arg(percentileMs(samples, 0.90), 0, 'f', 3)
+        .arg(percentileMs(samples, 0.99), 0, 'f', 3)
+        .arg(percentileMs(samples, 1.0), 0, 'f', 3)
+        .arg(total > 0 ? samples.size() / (total / 1e9) : 0.0, 0, 'f', 0)
+        .arg(cipher);
+}
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+    QCoreApplication::setApplicationName("AI-ChatRoom-TlsBench");
+    QCoreApplication::setApplicationVersion("1.0");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Compare full certificate handshakes with ticket-resumed (PSK) handshakes");
+    parser.addHelpOption();
+    parser.addVersionOption();
+
+    QCommandLineOption certOption("cert", "PEM certificate the loopback server presents", "file");
+    parser.addOption(certOption);
+    QCommandLineOption keyOption("key", "PEM private key for --cert", "file");
+    parser.addOption(keyOption);
+    QCommandLineOption countOption("count", "Handshakes of each kind", "n", "200");
+    parser.addOption(countOption);
+    QCommandLineOption tls12Option("tls12", "Pin full handshakes to TLS 1.2 as well, for a same-version comparison");
+    parser.addOption(tls12Option);
+    parser.process(a);
+
+    QTextStream out(stdout);
+    if (!parser.isSet(certOption) || !parser.isSet(keyOption)) {
+        QTextStream(stderr) << "--cert and --key are required.\n";
+        return 1;
+    }
+    if (!QSslSocket::supportsSsl()) {
+        QTextStream(stderr) << "TLS is not available: " << QSslSocket::sslLibraryVersionString() << "\n";
+        return 1;
+    }
+    if (TlsTicket::pskCiphers().isEmpty()) {
+        QTextStream(stderr) << "The TLS backend has no PSK cipher suites, resumption is unavailable.\n";
+        return 1;
+    }
+
+    TlsAcceptor acceptor;
+    QString error;
+    if (!acceptor.load(parser.value(certOption), parser.value(keyOption), &error)) {
+        QTextStream(stderr) << "Failed to load certificate: " << error << "\n";
+        return 1;
+    }
+    LoopbackServer server(&acceptor);
+    if (!server.listen(QHostAddress::LocalHost, 0)) {
+        QTextStream(stderr) << "Failed to listen: " << server.errorString() << "\n";
+        return 1;
+    }
+    const quint16 port = server.serverPort();
+    out << "backend: " << QSslSocket::sslLibraryVersionString() << "\n";
+
+    QSslConfiguration fullConfiguration = QSslConfiguration::defaultConfiguration();
+    if (parser.isSet(tls12Option)) {
+        fullConfiguration.setProtocol(QSsl::TlsV1_2);
+    }
+    const QSslConfiguration resumeConfiguration = TlsTicket::resumeConfiguration(QSslConfiguration::defaultConfiguration());
+
+    // 预热：加载证书、初始化后端，不计入结果
+    const TlsTicket none;
+    handshake(port, fullConfiguration, none);
+    handshake(port, resumeConfiguration, acceptor.issueTicket());
+
+    // 两种握手交替进行，机器负载的波动对两边影响相同
+    const int count = qMax(1, parser.value(countOption).toInt());
+    QList<qint64> full;
+    QList<qint64> resumed;
+    QString fullCipher;
+    QString resumedCipher;
+    int failures = 0;
+    for (int i = 0; i < count; ++i) {
+        const Sample first = handshake(port, fullConfiguration, none);
+        if (first.ns >= 0) {
+            full.append(first.ns);
+            fullCipher = first.cipher;
+        } else if (failures++ == 0) {
+            QTextStream(stderr) << "Full handshake failed: " << first.error << "\n";
+        }
+        // 每次重连都用一张新票据，和客户端的用法一致
+        const Sample second = handshake(port, resumeConfiguration, acceptor.issueTicket());
+        if (second.ns >= 0) {
+            resumed.append(second.ns);
+            resumedCipher = second.cipher;
+        } else if (failures++ == 0) {
+            QTextStream(stderr) << "Resumed handshake failed: " << second.error << "\n";
+        }
+    }
+
+    out << latencyLine("full handshake", full, fullCipher);
+    out << latencyLine("resumed handshake", resumed, resumedCipher);
+    if (!full.isEmpty() && !resumed.isEmpty()) {
+        out << QString("p50 speedup: %1x\n")
+                   .arg(percentileMs(full, 0.5) / qMax(1e-6, percentileMs(resumed, 0.5)), 0, 'f', 2);
+    }
+
+    // 服务器端从接受连接到握手完成的耗时，不含客户端建连
+    QCoreApplication::processEvents();
+    const TlsAcceptor::Stats stats = acceptor.stats();
+    out << QString("server: full %1 (avg %2 ms), resumed %3 (avg %4 ms), failed %5, ticket misses %6\n")
+               .arg(stats.full).arg(stats.full ? stats.fullUs / 1000.0 / stats.full : 0.0, 0, 'f', 3)
+               .arg(stats.resumed).arg(stats.resumed ? stats.resumedUs / 1000.0 / stats.resumed : 0.0, 0, 'f', 3)
+               .arg(stats.failed).arg(stats.ticketMisses);
+    return failures > 0 ? 1 : 0;
+}
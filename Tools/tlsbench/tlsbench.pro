@@ -0,0 +1,19 @@
+QT       += core network
+QT       -= gui
+
+CONFIG += c++17 console
+CONFIG -= app_bundle
+
+# 直接编译服务器的握手代码，测的就是线上用的实现
+INCLUDEPATH += ../../Server
+
+SOURCES += \
+    main.cpp \
+    ../../Server/tlsacceptor.cpp
+
+HEADERS += \
+    ../../Server/tlsacceptor.h
+
+include(../../Common/common.pri)
+
+TARGET=AI-ChatRoom-TlsBench